@@ -0,0 +1,223 @@
+/*
+ * MPU9250.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+#ifndef INC_MPU9250_HPP_
+#define INC_MPU9250_HPP_
+
+/*
+ * Header-only C++ front-end of the accel/gyro read path (C++11):
+ *
+ *		using Imu = mpu::Mpu9250<mpu::HalI2c<&hi2c1>, mpu::AccelScale::G8, mpu::GyroScale::Dps1000, mpu::units::Si>;
+ *		Imu::init();
+ *		Imu::read(sample);
+ *
+ * Scale, units and address are template parameters, so the register values written by init and the conversion factors of read are
+ * constants of the instantiation: read is one 14 bytes burst and six multiplications by immediates, with no runtime
+ * Register_Initialization and no sensitivity variables. The class has no data members and every function is static, it adds no RAM.
+ * A Transport is any type with:
+ *
+ *		static bool write(uint8_t addr, uint8_t reg, const uint8_t *data, uint16_t size);
+ *		static bool read(uint8_t addr, uint8_t reg, uint8_t *data, uint16_t size);
+ *
+ * This header does not include MPU_SPEC.h (it defines the C driver globals), it can be used with or without the C driver at the same bus.
+ * With the Linux HAL of src/linux it runs against the same fake device as the C API.
+ */
+
+#include "stm32f4xx_hal.h"
+#include <stdint.h>
+
+namespace mpu{
+
+/*
+ * Register map, MPU-9250 register map Rev. 1.6
+ */
+namespace reg{
+	constexpr uint8_t SMPLRT_DIV			= 0x19;
+	constexpr uint8_t CONFIG				= 0x1A;
+	constexpr uint8_t GYRO_CONFIG			= 0x1B;
+	constexpr uint8_t ACCEL_CONFIG			= 0x1C;
+	constexpr uint8_t ACCEL_CONFIG2			= 0x1D;
+	constexpr uint8_t INT_PIN_CFG			= 0x37;
+	constexpr uint8_t INT_ENABLE			= 0x38;
+	constexpr uint8_t INT_STATUS			= 0x3A;
+	constexpr uint8_t ACCEL_XOUT_H			= 0x3B;
+	constexpr uint8_t TEMP_OUT_H			= 0x41;
+	constexpr uint8_t GYRO_XOUT_H			= 0x43;
+	constexpr uint8_t USER_CTRL				= 0x6A;
+	constexpr uint8_t PWR_MGMT_1			= 0x6B;
+	constexpr uint8_t PWR_MGMT_2			= 0x6C;
+	constexpr uint8_t WHO_AM_I				= 0x75;
+}
+
+constexpr uint8_t ADDR_1					= 0x68;				//AD0 low, ACCELGYRO_ADDR_1 of the C driver
+constexpr uint8_t ADDR_2					= 0x69;
+constexpr uint8_t WHO_AM_I_VALUE			= 0x71;
+constexpr uint8_t PWR_MGMT_1_AUTO_CLOCK		= 0x01;				//Best available clock, PLL when the gyro is ready
+constexpr float TEMP_SENSITIVITY			= 333.87f;
+constexpr float TEMP_OFFSET					= 21.0f;
+
+/*
+ * Same codes as MPU_ACCEL_SCALE and MPU_GYRO_SCALE (FS_SEL bits)
+ */
+enum class AccelScale : uint8_t{ G2 = 0, G4 = 1, G8 = 2, G16 = 3 };
+enum class GyroScale : uint8_t{ Dps250 = 0, Dps500 = 1, Dps1000 = 2, Dps2000 = 3 };
+
+constexpr float accelLsbPerG(AccelScale scale){
+
+	return 16384.0f / (1 << static_cast<uint8_t>(scale));
+}
+
+/*
+ * Gyro sensitivities of the datasheet, they are rounded, not 131 / 2^FS_SEL (same values as GyroScaleConfig of MPU_Driver.c)
+ */
+constexpr float GYRO_LSB_PER_DPS[4] = {131.0f, 65.5f, 32.8f, 16.4f};
+
+constexpr float gyroLsbPerDps(GyroScale scale){
+
+	return GYRO_LSB_PER_DPS[static_cast<uint8_t>(scale)];
+}
+
+constexpr uint8_t accelConfig(AccelScale scale){
+
+	return static_cast<uint8_t>(scale) << 3;					/* ACCEL_FS_SEL, self-test off */
+}
+
+constexpr uint8_t gyroConfig(GyroScale scale){
+
+	return static_cast<uint8_t>(scale) << 3;					/* GYRO_FS_SEL, FCHOICE_B 00 (DLPF used) */
+}
+
+/*
+ * Output units, accel factor from g and gyro factor from °/s
+ */
+namespace units{
+	struct Native{											/* g, °/s */
+		static constexpr float accel = 1.0f;
+		static constexpr float gyro = 1.0f;
+	};
+	struct Si{												/* m/s^2, rad/s */
+		static constexpr float accel = 9.807f;
+		static constexpr float gyro = 0.0174532925f;
+	};
+	struct Driver{											/* Same as the C driver with USE_SI: m/s^2, °/s */
+		static constexpr float accel = 9.807f;
+		static constexpr float gyro = 1.0f;
+	};
+}
+
+static_assert(accelLsbPerG(AccelScale::G2) == 16384.0f && accelLsbPerG(AccelScale::G16) == 2048.0f, "accel sensitivity");
+static_assert(gyroLsbPerDps(GyroScale::Dps250) == 131.0f && gyroLsbPerDps(GyroScale::Dps1000) == 32.8f && gyroLsbPerDps(GyroScale::Dps2000) == 16.4f, "gyro sensitivity");
+static_assert(accelConfig(AccelScale::G8) == 0x10 && gyroConfig(GyroScale::Dps2000) == 0x18, "FS_SEL position");
+
+struct Sample{
+	float accel[3];
+	float gyro[3];
+	float temperature;										//°C
+};
+
+/*
+ * Transport of the STM32 HAL (or of src/linux), blocking, register address of 8 bits
+ */
+template<I2C_HandleTypeDef *Handle>
+struct HalI2c{
+
+	static bool write(uint8_t addr, uint8_t reg, const uint8_t *data, uint16_t size){
+
+		return HAL_I2C_Mem_Write(Handle, addr << 1, reg, I2C_MEMADD_SIZE_8BIT, const_cast<uint8_t *>(data), size, HAL_MAX_DELAY) == HAL_OK;
+	}
+
+	static bool read(uint8_t addr, uint8_t reg, uint8_t *data, uint16_t size){
+
+		return HAL_I2C_Mem_Read(Handle, addr << 1, reg, I2C_MEMADD_SIZE_8BIT, data, size, HAL_MAX_DELAY) == HAL_OK;
+	}
+};
+
+template<class Transport, AccelScale Accel, GyroScale Gyro, class Units = units::Driver, uint8_t Address = ADDR_1>
+class Mpu9250{
+
+public:
+	static constexpr float accelFactor = Units::accel / accelLsbPerG(Accel);
+	static constexpr float gyroFactor = Units::gyro / gyroLsbPerDps(Gyro);
+
+	/*
+	 * @brief:  Wake the device and write both full scale ranges in one burst (GYRO_CONFIG and ACCEL_CONFIG are adjacent)
+	 * @retval: false if the bus failed or WHO_AM_I is not an MPU-9250
+	 */
+	static bool init(){
+
+		static constexpr uint8_t power = PWR_MGMT_1_AUTO_CLOCK;
+		static constexpr uint8_t config[2] = {gyroConfig(Gyro), accelConfig(Accel)};
+
+		return Transport::write(Address, reg::PWR_MGMT_1, &power, 1) &&
+			   Transport::write(Address, reg::GYRO_CONFIG, config, 2) &&
+			   whoAmI() == WHO_AM_I_VALUE;
+	}
+
+	static uint8_t whoAmI(){
+
+		uint8_t identity = 0;
+
+		Transport::read(Address, reg::WHO_AM_I, &identity, 1);
+		return identity;
+	}
+
+	/*
+	 * @brief:  Accel, temperature and gyro from one burst of ACCEL_XOUT_H to GYRO_ZOUT_L, all from the same sample
+	 * @retval: false if the bus failed, sample is not changed
+	 */
+	static bool read(Sample &sample){
+
+		uint8_t raw[14];
+
+		if(!Transport::read(Address, reg::ACCEL_XOUT_H, raw, sizeof(raw)))
+			return false;
+
+		sample.accel[0] = word(&raw[0]) * accelFactor;
+		sample.accel[1] = word(&raw[2]) * accelFactor;
+		sample.accel[2] = word(&raw[4]) * accelFactor;
+		sample.temperature = word(&raw[6]) * (1.0f / TEMP_SENSITIVITY) + TEMP_OFFSET;
+		sample.gyro[0] = word(&raw[8]) * gyroFactor;
+		sample.gyro[1] = word(&raw[10]) * gyroFactor;
+		sample.gyro[2] = word(&raw[12]) * gyroFactor;
+
+		return true;
+	}
+
+	/*
+	 * @brief:  Raw counts of the same burst, for the callers that convert later (FIFO style batches)
+	 */
+	static bool readRaw(int16_t accel[3], int16_t gyro[3]){
+
+		uint8_t raw[14];
+
+		if(!Transport::read(Address, reg::ACCEL_XOUT_H, raw, sizeof(raw)))
+			return false;
+
+		for(uint8_t i = 0; i < 3; i++){
+			accel[i] = word(&raw[2 * i]);
+			gyro[i] = word(&raw[8 + 2 * i]);
+		}
+
+		return true;
+	}
+
+private:
+	static int16_t word(const uint8_t *bytes){
+
+		return static_cast<int16_t>(bytes[0] << 8 | bytes[1]);
+	}
+};
+
+template<class Transport, AccelScale Accel, GyroScale Gyro, class Units, uint8_t Address>
+constexpr float Mpu9250<Transport, Accel, Gyro, Units, Address>::accelFactor;
+
+template<class Transport, AccelScale Accel, GyroScale Gyro, class Units, uint8_t Address>
+constexpr float Mpu9250<Transport, Accel, Gyro, Units, Address>::gyroFactor;
+
+}
+
+#endif /* INC_MPU9250_HPP_ */
@@ -0,0 +1,82 @@
+/*
+ * MPU_Array.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+#ifndef INC_MPU_ARRAY_H_
+#define INC_MPU_ARRAY_H_
+
+#include "MPU_SPEC.h"
+
+/*
+ * Several MPUs mounted on the same board, with the same axes orientation, read as one virtual IMU:
+ *
+ *		sync (FSYNC or data-ready of the first device) -> 14 bytes burst of every device, buses in parallel -> bias removed ->
+ *		average weighted by the inverse of each device noise variance
+ *
+ * Every member mirrors the driver configuration (shadow registers of MPU_SPEC.h), so @MPU_Init and the scale/filter configuration must be
+ * made before @MPU_ArrayInit, and the device used at @MPU_Init should be listed as one of the members.
+ * Two devices fit each bus (AD0 low and high), so up to 6 devices with the 3 I2C peripherals.
+ */
+#ifndef ARRAY_MAX_DEVICES
+#define ARRAY_MAX_DEVICES			6
+#endif
+
+#define ARRAY_BUSES					3
+
+#ifndef ARRAY_READ_TIMEOUT_MS
+#define ARRAY_READ_TIMEOUT_MS		5				//Limit for the whole burst schedule and for the data-ready wait
+#endif
+
+#ifndef ARRAY_ABORT_TIMEOUT_MS
+#define ARRAY_ABORT_TIMEOUT_MS		1				//Wait for the abort of a read in flight, then the I2C peripheral is restarted
+#endif
+
+#define ARRAY_READ_OK				0
+#define ARRAY_READ_TIMEOUT			1				//Some device did not answer, the fusion used the others
+#define ARRAY_READ_NOT_ALIGNED		2				//Devices latched different FSYNC states, the samples are from different periods
+
+/*
+ * Possible synchronization of the members
+ */
+typedef enum{
+	ARRAY_SYNC_NONE			= 0,				/* Read when asked, each device gives its last sample */
+	ARRAY_SYNC_FSYNC		= 1,				/* Shared FSYNC line latched at TEMP_OUT_L bit 0 (CONFIG EXT_SYNC_SET = 1), checked at each read */
+	ARRAY_SYNC_DATA_READY	= 2					/* Wait for the data-ready of the first device before the burst */
+}MPU_ARRAY_SYNC;
+
+typedef struct{
+	uint8_t bus;								//Index at MPU_ARRAY.bus
+	uint8_t addr;								//7 bits i2c address
+	uint8_t raw[14];							//Last burst, ACCEL_XOUT_H to GYRO_ZOUT_L
+	uint8_t valid;								//Last burst ended without error
+	float accel_bias[3];						//Offset to the array mean, accel unit
+	float gyro_bias[3];							//°/s
+	float accel_variance;						//Noise variance per axis measured at @MPU_ArrayCharacterize
+	float gyro_variance;
+	float accel_weight;							//Normalized inverse variance
+	float gyro_weight;
+}MPU_ARRAY_DEVICE;
+
+typedef struct{
+	MPU_ARRAY_DEVICE device[ARRAY_MAX_DEVICES];
+	uint8_t count;
+	I2C_HandleTypeDef *bus[ARRAY_BUSES];		//Handle of each bus used, the driver handle is shared when the bus is the same
+	I2C_HandleTypeDef bus_handle[ARRAY_BUSES];
+	uint8_t bus_order[ARRAY_BUSES][ARRAY_MAX_DEVICES];		//Devices read one after the other at each bus
+	uint8_t bus_count[ARRAY_BUSES];
+	MPU_ARRAY_SYNC sync;
+	float accel_fused_variance;					//Expected noise variance of the fused outputs, 1 / sum(1 / variance)
+	float gyro_fused_variance;
+}MPU_ARRAY;
+
+/*
+ * Array functions
+ */
+void MPU_ArrayInit(MPU_ARRAY *array, const uint8_t i2c[], const uint8_t mpu_i2c_addr[], uint8_t count, MPU_ARRAY_SYNC sync);
+uint8_t MPU_ArrayCharacterize(MPU_ARRAY *array, uint16_t numberOfSamples);
+uint8_t MPU_ArrayRead(MPU_ARRAY *array, float accel_data[], float gyro_data[]);
+
+#endif /* INC_MPU_ARRAY_H_ */
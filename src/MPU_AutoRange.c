@@ -0,0 +1,244 @@
+/*
+ * MPU_AutoRange.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+#include "MPU_AutoRange.h"
+
+static uint16_t PeakCounts(const int16_t raw[]);
+static int8_t ChannelStep(const MPU_AUTORANGE *range, AUTORANGE_CHANNEL *channel, uint16_t peak);
+static void ChannelInit(AUTORANGE_CHANNEL *channel, uint8_t scale, uint8_t min_scale, uint8_t max_scale);
+
+/*
+ * @brief:  Start the auto-ranging from the scales in use, a scale out of the limits is changed to the nearest one
+ * @param:  range - Auto-ranging state
+ * 			config - Thresholds and scale limits, NULL for the AUTORANGE_* defaults at 1 kHz and every scale
+ * @retval: AUTORANGE_OK or AUTORANGE_INVALID (nothing is changed), low_counts must be below half of high_counts
+ */
+uint8_t MPU_AutoRangeInit(MPU_AUTORANGE *range, const MPU_AUTORANGE_CONFIG *config){
+
+	MPU_AUTORANGE_CONFIG defaults = {AUTORANGE_HIGH_COUNTS, AUTORANGE_LOW_COUNTS, AUTORANGE_LOW_MS, AUTORANGE_SETTLE_SAMPLES, 1000,
+									 ACCEL_FULL_SCALE_2g, ACCEL_FULL_SCALE_16g, GYRO_FULL_SCALE_250dps, GYRO_FULL_SCALE_2000dps};
+	MPU_CONFIG_PROFILE profile;
+	uint8_t accel_scale, gyro_scale;
+
+	if(config == NULL)
+		config = &defaults;
+
+	if(2 * (uint32_t)config->low_counts >= config->high_counts ||		/* A switch down would saturate the smaller scale */
+	   config->accel_min > config->accel_max || config->accel_max > ACCEL_FULL_SCALE_16g ||
+	   config->gyro_min > config->gyro_max || config->gyro_max > GYRO_FULL_SCALE_2000dps)
+		return AUTORANGE_INVALID;
+
+	memset(range, 0, sizeof(MPU_AUTORANGE));
+
+	range->high_counts = config->high_counts;
+	range->low_counts = config->low_counts;
+	range->low_samples = (uint32_t)config->low_ms * config->sample_rate_hz / 1000;
+	range->settle_samples = config->settle_samples;
+
+	MPU_ProfileGet(&profile);									/* Scales from the shadow registers */
+
+	accel_scale = profile.accel_scale < config->accel_min ? config->accel_min : profile.accel_scale;
+	accel_scale = accel_scale > config->accel_max ? config->accel_max : accel_scale;
+	gyro_scale = profile.gyro_scale < config->gyro_min ? config->gyro_min : profile.gyro_scale;
+	gyro_scale = gyro_scale > config->gyro_max ? config->gyro_max : gyro_scale;
+
+	ChannelInit(&range->accel, accel_scale, config->accel_min, config->accel_max);
+	ChannelInit(&range->gyro, gyro_scale, config->gyro_min, config->gyro_max);
+
+	if(accel_scale != profile.accel_scale || gyro_scale != profile.gyro_scale){
+		MPU_BusDeferBegin();
+		if(accel_scale != profile.accel_scale)
+			MPU_AccelScaleChange(accel_scale);
+		if(gyro_scale != profile.gyro_scale)
+			MPU_GyroScaleChange(gyro_scale);
+		MPU_BusDeferEnd();
+	}
+
+	return AUTORANGE_OK;
+}
+
+/*
+ * @brief:  Tag one sample with its scales and change the scales when needed. The change is written before the return
+ * @param:  range - Auto-ranging state
+ * 			accel_raw - Three element vector of accelerometer counts
+ * 			gyro_raw - Three element vector of gyroscope counts
+ * 			sample - Where the tagged sample will be placed
+ * @retval: Switches made at this sample, OR of @MPU_AUTORANGE_EVENT
+ */
+uint8_t MPU_AutoRangeProcess(MPU_AUTORANGE *range, const int16_t accel_raw[], const int16_t gyro_raw[], MPU_RANGED_SAMPLE *sample){
+
+	uint8_t events = 0;
+	uint16_t accel_peak = PeakCounts(accel_raw);
+	uint16_t gyro_peak = PeakCounts(gyro_raw);
+	int8_t accel_step, gyro_step;
+
+	memcpy(sample->accel, accel_raw, sizeof(sample->accel));
+	memcpy(sample->gyro, gyro_raw, sizeof(sample->gyro));
+	sample->accel_scale = range->accel.scale;
+	sample->gyro_scale = range->gyro.scale;
+	sample->flags = 0;
+
+	range->stats.samples++;
+
+	if(accel_peak >= INT16_MAX)
+		sample->flags |= AUTORANGE_ACCEL_CLIPPED;
+	if(gyro_peak >= INT16_MAX)
+		sample->flags |= AUTORANGE_GYRO_CLIPPED;
+	if(range->accel.settle > 0)
+		sample->flags |= AUTORANGE_ACCEL_SETTLING;
+	if(range->gyro.settle > 0)
+		sample->flags |= AUTORANGE_GYRO_SETTLING;
+
+	if(sample->flags & (AUTORANGE_ACCEL_CLIPPED | AUTORANGE_GYRO_CLIPPED))
+		range->stats.clipped++;
+	if(sample->flags & (AUTORANGE_ACCEL_SETTLING | AUTORANGE_GYRO_SETTLING))
+		range->stats.settling++;
+
+	accel_step = ChannelStep(range, &range->accel, accel_peak);
+	gyro_step = ChannelStep(range, &range->gyro, gyro_peak);
+
+	if(accel_step == 0 && gyro_step == 0)
+		return 0;
+
+	MPU_BusDeferBegin();										/* ACCEL_CONFIG follows GYRO_CONFIG, both go in one burst */
+
+	if(accel_step != 0){
+		MPU_AccelScaleChange(range->accel.scale);
+		events |= accel_step > 0 ? AUTORANGE_ACCEL_UP : AUTORANGE_ACCEL_DOWN;
+		if(accel_step > 0)
+			range->stats.accel_up++;
+		else
+			range->stats.accel_down++;
+	}
+	if(gyro_step != 0){
+		MPU_GyroScaleChange(range->gyro.scale);
+		events |= gyro_step > 0 ? AUTORANGE_GYRO_UP : AUTORANGE_GYRO_DOWN;
+		if(gyro_step > 0)
+			range->stats.gyro_up++;
+		else
+			range->stats.gyro_down++;
+	}
+
+	MPU_BusDeferEnd();
+
+	return events;
+}
+
+/*
+ * @brief:  Read the newest sample (@MPU_ImuReadRaw) and process it, call it at the data-ready interrupt (or from the task it wakes)
+ * @param:  range - Auto-ranging state
+ * 			sample - Where the tagged sample will be placed
+ * @retval: Switches made at this sample, OR of @MPU_AUTORANGE_EVENT
+ */
+uint8_t MPU_AutoRangeDataReady(MPU_AUTORANGE *range, MPU_RANGED_SAMPLE *sample){
+
+	int16_t accel_raw[3], gyro_raw[3];
+
+	MPU_ImuReadRaw(accel_raw, gyro_raw);
+
+	return MPU_AutoRangeProcess(range, accel_raw, gyro_raw, sample);
+}
+
+/*
+ * @brief:  Convert a tagged sample with the scales it was measured at. Sensors flagged as settling are not converted
+ * @param:  sample - Tagged sample
+ * 			accel_data - Three element vector for the calibrated acceleration, can be NULL
+ * 			gyro_data - Three element vector for the angular velocity, can be NULL
+ * @retval: 1 if every requested sensor was converted, 0 if one was settling (its vector is not changed)
+ */
+uint8_t MPU_AutoRangeConvert(const MPU_RANGED_SAMPLE *sample, float accel_data[], float gyro_data[]){
+
+	uint8_t converted = 1;
+
+	if(accel_data != NULL && (sample->flags & AUTORANGE_ACCEL_SETTLING)){
+		accel_data = NULL;
+		converted = 0;
+	}
+	if(gyro_data != NULL && (sample->flags & AUTORANGE_GYRO_SETTLING)){
+		gyro_data = NULL;
+		converted = 0;
+	}
+
+	MPU_ConvertRawScaled(accel_data != NULL ? sample->accel : NULL, gyro_data != NULL ? sample->gyro : NULL,
+						 sample->accel_scale, sample->gyro_scale, accel_data, gyro_data);
+
+	return converted;
+}
+
+/*
+ * @brief:  Switch and sample counters
+ * @param:  range - Auto-ranging state
+ * 			stats - Where the counters will be copied
+ * @retval: None
+ */
+void MPU_AutoRangeGetStats(const MPU_AUTORANGE *range, MPU_AUTORANGE_STATS *stats){
+
+	*stats = range->stats;
+}
+
+/*
+ * @brief:  Internal function, largest absolute count of the three axis (32768 for -32768)
+ */
+static uint16_t PeakCounts(const int16_t raw[]){
+
+	uint16_t peak = 0, value;
+
+	for(uint8_t i = 0; i < 3; i++){
+		value = raw[i] < 0 ? (uint16_t)(-(int32_t)raw[i]) : (uint16_t)raw[i];
+		if(value > peak)
+			peak = value;
+	}
+
+	return peak;
+}
+
+/*
+ * @brief:  Internal function, scale decision of one sensor, the new scale is placed at the channel
+ * @retval: 1 for a larger scale, -1 for a smaller one, 0 to keep it
+ */
+static int8_t ChannelStep(const MPU_AUTORANGE *range, AUTORANGE_CHANNEL *channel, uint16_t peak){
+
+	if(channel->settle > 0){
+		channel->settle--;										/* Counts of an uncertain scale do not decide */
+		return 0;
+	}
+
+	if(peak >= range->high_counts){
+		channel->low_count = 0;
+		if(channel->scale >= channel->max_scale)
+			return 0;
+		channel->scale++;
+		channel->settle = range->settle_samples;
+		return 1;
+	}
+
+	if(peak >= range->low_counts || channel->scale <= channel->min_scale){
+		channel->low_count = 0;
+		return 0;
+	}
+
+	if(++channel->low_count < range->low_samples)
+		return 0;
+
+	channel->low_count = 0;
+	channel->scale--;
+	channel->settle = range->settle_samples;
+
+	return -1;
+}
+
+/*
+ * @brief:  Internal function, clear the state of one sensor
+ */
+static void ChannelInit(AUTORANGE_CHANNEL *channel, uint8_t scale, uint8_t min_scale, uint8_t max_scale){
+
+	channel->scale = scale;
+	channel->min_scale = min_scale;
+	channel->max_scale = max_scale;
+	channel->settle = 0;
+	channel->low_count = 0;
+}
@@ -0,0 +1,117 @@
+/*
+ * MPU_AutoRange.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+#ifndef INC_MPU_AUTORANGE_H_
+#define INC_MPU_AUTORANGE_H_
+
+#include "MPU_SPEC.h"
+
+/*
+ * Automatic full-scale range of the accelerometer and the gyroscope, on the raw counts of each sample:
+ *
+ *		up:		one axis at or above high_counts (near the saturation), the next larger scale is set at once
+ *		down:	every axis below low_counts for low_ms, the next smaller scale is set
+ *
+ * low_counts is below half of high_counts, so a signal that caused a switch down is still below high_counts at the smaller scale
+ * (twice the counts) and the ranges do not toggle.
+ *
+ * Every sample is tagged with the scales it was measured at (@MPU_RANGED_SAMPLE) and is converted by @MPU_AutoRangeConvert with
+ * those scales (@MPU_ConvertRawScaled), never with the sensitivity in use when the conversion runs. After a switch the register
+ * write and the filter delay make the scale of the next samples uncertain: settle_samples samples are flagged AUTORANGE_*_SETTLING
+ * and are not converted. Raise settle_samples with the DLPF delay (delay ms * rate / 1000 + 1).
+ *
+ * Samples come from @MPU_AutoRangeDataReady (one 15 bytes read at the data-ready interrupt or the task it wakes) or from
+ * @MPU_AutoRangeProcess with counts of other reads. With the fifo the frames queued before the write are at the old scale, use
+ * settle_samples of at least the frames read per drain. Both scales, when they change at the same sample, go in one burst.
+ * MPU_Motion.h converts its thresholds with the accel scale at @MPU_MotionInit: call it again when the accel scale changes.
+ */
+#ifndef AUTORANGE_HIGH_COUNTS
+#define AUTORANGE_HIGH_COUNTS		30000			//About 92 % of the full scale
+#endif
+
+#ifndef AUTORANGE_LOW_COUNTS
+#define AUTORANGE_LOW_COUNTS		12000			//About 37 % of the full scale, 73 % of the next smaller one
+#endif
+
+#ifndef AUTORANGE_LOW_MS
+#define AUTORANGE_LOW_MS			500				//Quiet time before a smaller scale is set
+#endif
+
+#ifndef AUTORANGE_SETTLE_SAMPLES
+#define AUTORANGE_SETTLE_SAMPLES	2				//Samples of uncertain scale after a switch
+#endif
+
+#define AUTORANGE_OK				0
+#define AUTORANGE_INVALID			1				//Scale limits out of order or above 3, low_counts not below half of high_counts
+
+typedef enum{
+	AUTORANGE_ACCEL_CLIPPED		= 0x01,				/* One axis at the limit of the ADC, the value is not the real one */
+	AUTORANGE_GYRO_CLIPPED		= 0x02,
+	AUTORANGE_ACCEL_SETTLING	= 0x04,				/* Measured during a switch, not converted */
+	AUTORANGE_GYRO_SETTLING		= 0x08
+}MPU_AUTORANGE_FLAG;
+
+typedef enum{
+	AUTORANGE_ACCEL_UP			= 0x01,
+	AUTORANGE_ACCEL_DOWN		= 0x02,
+	AUTORANGE_GYRO_UP			= 0x04,
+	AUTORANGE_GYRO_DOWN			= 0x08
+}MPU_AUTORANGE_EVENT;
+
+typedef struct{
+	uint16_t high_counts;
+	uint16_t low_counts;
+	uint16_t low_ms;
+	uint16_t settle_samples;
+	uint16_t sample_rate_hz;					//Rate of the processed samples, converts low_ms to samples
+	MPU_ACCEL_SCALE accel_min, accel_max;		//Scales the auto-ranging can set, the same value locks the accelerometer
+	MPU_GYRO_SCALE gyro_min, gyro_max;
+}MPU_AUTORANGE_CONFIG;
+
+typedef struct{
+	int16_t accel[3];							//Counts
+	int16_t gyro[3];
+	MPU_ACCEL_SCALE accel_scale;				//Scales the counts were measured at
+	MPU_GYRO_SCALE gyro_scale;
+	uint8_t flags;								//OR of @MPU_AUTORANGE_FLAG
+}MPU_RANGED_SAMPLE;
+
+typedef struct{
+	uint32_t samples;
+	uint32_t accel_up, accel_down;
+	uint32_t gyro_up, gyro_down;
+	uint32_t clipped;							//Samples with one axis at the limit of the ADC
+	uint32_t settling;							//Samples not converted after a switch
+}MPU_AUTORANGE_STATS;
+
+typedef struct{
+	uint8_t scale;								//Scale set at the device
+	uint8_t min_scale, max_scale;
+	uint16_t settle;							//Samples still flagged after the last switch
+	uint32_t low_count;							//Consecutive samples below low_counts
+}AUTORANGE_CHANNEL;
+
+typedef struct{
+	AUTORANGE_CHANNEL accel;
+	AUTORANGE_CHANNEL gyro;
+	uint16_t high_counts;
+	uint16_t low_counts;
+	uint32_t low_samples;
+	uint16_t settle_samples;
+	MPU_AUTORANGE_STATS stats;
+}MPU_AUTORANGE;
+
+/*
+ * Auto-ranging functions
+ */
+uint8_t MPU_AutoRangeInit(MPU_AUTORANGE *range, const MPU_AUTORANGE_CONFIG *config);
+uint8_t MPU_AutoRangeProcess(MPU_AUTORANGE *range, const int16_t accel_raw[], const int16_t gyro_raw[], MPU_RANGED_SAMPLE *sample);
+uint8_t MPU_AutoRangeDataReady(MPU_AUTORANGE *range, MPU_RANGED_SAMPLE *sample);
+uint8_t MPU_AutoRangeConvert(const MPU_RANGED_SAMPLE *sample, float accel_data[], float gyro_data[]);
+void MPU_AutoRangeGetStats(const MPU_AUTORANGE *range, MPU_AUTORANGE_STATS *stats);
+
+#endif /* INC_MPU_AUTORANGE_H_ */
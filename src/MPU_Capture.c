@@ -0,0 +1,156 @@
+/*
+ * MPU_Capture.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+#include "MPU_Capture.h"
+
+static void CaptureStart(MPU_CAPTURE *capture);
+
+/*
+ * @brief:  Clear the history and arm the capture
+ * @param:  capture - Capture state
+ * 			pre_frames - Frames kept before the trigger, up to CAPTURE_HISTORY_FRAMES
+ * 			post_frames - Frames taken after the trigger, pre_frames + post_frames up to CAPTURE_WINDOW_FRAMES
+ * @retval: CAPTURE_OK or CAPTURE_INVALID
+ */
+uint8_t MPU_CaptureInit(MPU_CAPTURE *capture, uint16_t pre_frames, uint16_t post_frames){
+
+	if(pre_frames > CAPTURE_HISTORY_FRAMES || (uint32_t)pre_frames + post_frames > CAPTURE_WINDOW_FRAMES)
+		return CAPTURE_INVALID;
+
+	capture->pre_frames = pre_frames;
+	capture->post_frames = post_frames;
+	capture->head = 0;
+	capture->stored = 0;
+	capture->count = 0;
+	capture->request = 0;
+	capture->state = CAPTURE_ARMED;
+	memset(&capture->stats, 0, sizeof(MPU_CAPTURE_STATS));
+
+	return CAPTURE_OK;
+}
+
+/*
+ * @brief:  Add one frame to the history (and to the window while the post part is taken)
+ * @param:  capture - Capture state
+ * 			frame - CAPTURE_FRAME_BYTES bytes, for example a burst from ACCEL_XOUT_H or @MPU_ReadAllRaw
+ * @retval: None
+ */
+void MPU_CapturePush(MPU_CAPTURE *capture, const uint8_t frame[]){
+
+	if(capture->request){
+		capture->request = 0;
+		CaptureStart(capture);
+	}
+
+	memcpy(capture->history[capture->head], frame, CAPTURE_FRAME_BYTES);
+	if(++capture->head == CAPTURE_HISTORY_FRAMES)
+		capture->head = 0;
+	if(capture->stored < CAPTURE_HISTORY_FRAMES)
+		capture->stored++;
+
+	capture->stats.frames++;
+
+	if(capture->state == CAPTURE_TRIGGERED){
+		if(capture->remaining > 0){
+			memcpy(capture->window[capture->count++], frame, CAPTURE_FRAME_BYTES);
+			capture->remaining--;
+		}
+		if(capture->remaining == 0)
+			capture->state = CAPTURE_READY;					/* Written last, the window is complete when it is seen */
+	}
+}
+
+/*
+ * @brief:  Add consecutive frames, for example the output of @MPU_FifoReadRaw when @MPU_FifoFrameBytes is CAPTURE_FRAME_BYTES
+ * @param:  capture - Capture state
+ * 			frames - count * CAPTURE_FRAME_BYTES bytes
+ * 			count - Number of frames
+ * @retval: None
+ */
+void MPU_CapturePushFrames(MPU_CAPTURE *capture, const uint8_t frames[], uint16_t count){
+
+	for(uint16_t i = 0; i < count; i++)
+		MPU_CapturePush(capture, &frames[i * CAPTURE_FRAME_BYTES]);
+}
+
+/*
+ * @brief:  Request a window, it starts at the next frame pushed. Can be called from any context
+ * @param:  capture - Capture state
+ * @retval: 1 if accepted, 0 if a window is being captured or was not released
+ */
+uint8_t MPU_CaptureTrigger(MPU_CAPTURE *capture){
+
+	if(capture->state != CAPTURE_ARMED || capture->request){
+		capture->stats.ignored++;
+		return 0;
+	}
+
+	capture->request = 1;
+
+	return 1;
+}
+
+/*
+ * @brief:  Frozen window, it is not changed by the acquisition until @MPU_CaptureRelease
+ * @param:  capture - Capture state
+ * 			window - Where the block description will be placed
+ * @retval: 1 if the window is ready, 0 otherwise (window is not changed)
+ */
+uint8_t MPU_CaptureGetWindow(const MPU_CAPTURE *capture, MPU_CAPTURE_WINDOW *window){
+
+	if(capture->state != CAPTURE_READY)
+		return 0;
+
+	window->frames = &capture->window[0][0];
+	window->count = capture->count;
+	window->trigger = capture->trigger;
+	window->first_frame = capture->first_frame;
+
+	return 1;
+}
+
+/*
+ * @brief:  Give the window back, the next trigger can be accepted. Call it after the export (or when a capture must be dropped)
+ * @param:  capture - Capture state
+ * @retval: None
+ */
+void MPU_CaptureRelease(MPU_CAPTURE *capture){
+
+	if(capture->state == CAPTURE_READY)
+		capture->state = CAPTURE_ARMED;
+}
+
+/*
+ * @brief:  Frame and trigger counters
+ * @param:  capture - Capture state
+ * 			stats - Where the counters will be copied
+ * @retval: None
+ */
+void MPU_CaptureGetStats(const MPU_CAPTURE *capture, MPU_CAPTURE_STATS *stats){
+
+	*stats = capture->stats;
+}
+
+/*
+ * @brief:  Internal function, copy the pre part from the history, at most two memcpy (the history wraps once)
+ */
+static void CaptureStart(MPU_CAPTURE *capture){
+
+	uint16_t pre = capture->pre_frames < capture->stored ? capture->pre_frames : capture->stored;
+	uint16_t start = (capture->head + CAPTURE_HISTORY_FRAMES - pre) % CAPTURE_HISTORY_FRAMES;
+	uint16_t first = CAPTURE_HISTORY_FRAMES - start < pre ? CAPTURE_HISTORY_FRAMES - start : pre;
+
+	memcpy(capture->window[0], capture->history[start], first * CAPTURE_FRAME_BYTES);
+	memcpy(capture->window[first], capture->history[0], (pre - first) * CAPTURE_FRAME_BYTES);
+
+	capture->count = pre;
+	capture->trigger = pre;
+	capture->remaining = capture->post_frames;
+	capture->first_frame = capture->stats.frames - pre;
+	capture->stats.triggers++;
+	capture->state = CAPTURE_TRIGGERED;
+}
@@ -0,0 +1,88 @@
+/*
+ * MPU_Capture.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+#ifndef INC_MPU_CAPTURE_H_
+#define INC_MPU_CAPTURE_H_
+
+#include "MPU_SPEC.h"
+
+/*
+ * Pre-trigger capture of raw frames at the full rate:
+ *
+ *		history:	circular buffer, every frame pushed is written there (data-ready path or fifo drain)
+ *		window:		at the trigger the last pre_frames of the history are copied to it, then the next post_frames are appended
+ *
+ * When the post part is complete the window is frozen and can be exported as one contiguous block while the acquisition
+ * keeps writing the history. A new trigger is accepted after @MPU_CaptureRelease.
+ *
+ * @MPU_CapturePush and @MPU_CapturePushFrames must be called from one context (the data-ready interrupt or the sampling task).
+ * @MPU_CaptureTrigger can be called from any context, for example the callback of MPU_Motion.h: it only sets a request, the window
+ * starts at the next frame pushed, so the pre part ends with the last frame pushed before the trigger.
+ * The copy of the pre part (pre_frames * CAPTURE_FRAME_BYTES) is made at that push.
+ */
+#ifndef CAPTURE_FRAME_BYTES
+#define CAPTURE_FRAME_BYTES			14				//Accel, temperature and gyro burst or fifo frame, RAW_FRAME_BYTES for @MPU_ReadAllRaw frames
+#endif
+
+#ifndef CAPTURE_HISTORY_FRAMES
+#define CAPTURE_HISTORY_FRAMES		256				//Longest pre window, 256 ms at 1 kHz
+#endif
+
+#ifndef CAPTURE_WINDOW_FRAMES
+#define CAPTURE_WINDOW_FRAMES		512				//Longest pre + post window
+#endif
+
+#define CAPTURE_OK					0
+#define CAPTURE_INVALID				1				//pre_frames or pre_frames + post_frames too long
+
+typedef enum{
+	CAPTURE_ARMED		= 0,						/* Waiting for a trigger */
+	CAPTURE_TRIGGERED	= 1,						/* Collecting the post frames */
+	CAPTURE_READY		= 2							/* Window frozen until @MPU_CaptureRelease */
+}MPU_CAPTURE_STATE;
+
+typedef struct{
+	const uint8_t *frames;						//count * CAPTURE_FRAME_BYTES, oldest first
+	uint16_t count;
+	uint16_t trigger;							//Frames before the trigger, the first post frame is frames[trigger]
+	uint32_t first_frame;						//Index of frames[0] since @MPU_CaptureInit, gives its time with the sample rate
+}MPU_CAPTURE_WINDOW;
+
+typedef struct{
+	uint32_t frames;							//Frames pushed
+	uint32_t triggers;							//Windows started
+	uint32_t ignored;							//Triggers while a window was being captured or not released
+}MPU_CAPTURE_STATS;
+
+typedef struct{
+	uint8_t history[CAPTURE_HISTORY_FRAMES][CAPTURE_FRAME_BYTES];
+	uint8_t window[CAPTURE_WINDOW_FRAMES][CAPTURE_FRAME_BYTES];
+	uint16_t pre_frames;
+	uint16_t post_frames;
+	uint16_t head;								//Next history frame written
+	uint16_t stored;							//Valid history frames, up to CAPTURE_HISTORY_FRAMES
+	uint16_t count;								//Window frames
+	uint16_t trigger;
+	uint16_t remaining;							//Post frames still to be appended
+	uint32_t first_frame;
+	volatile uint8_t request;
+	volatile MPU_CAPTURE_STATE state;
+	MPU_CAPTURE_STATS stats;
+}MPU_CAPTURE;
+
+/*
+ * Capture functions
+ */
+uint8_t MPU_CaptureInit(MPU_CAPTURE *capture, uint16_t pre_frames, uint16_t post_frames);
+void MPU_CapturePush(MPU_CAPTURE *capture, const uint8_t frame[]);
+void MPU_CapturePushFrames(MPU_CAPTURE *capture, const uint8_t frames[], uint16_t count);
+uint8_t MPU_CaptureTrigger(MPU_CAPTURE *capture);
+uint8_t MPU_CaptureGetWindow(const MPU_CAPTURE *capture, MPU_CAPTURE_WINDOW *window);
+void MPU_CaptureRelease(MPU_CAPTURE *capture);
+void MPU_CaptureGetStats(const MPU_CAPTURE *capture, MPU_CAPTURE_STATS *stats);
+
+#endif /* INC_MPU_CAPTURE_H_ */
@@ -0,0 +1,145 @@
+/*
+ * MPU_Clock.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+#include "MPU_Clock.h"
+#include <math.h>
+
+#define CLOCK_ONE					4294967296.0f	//1 tick at 32.32 fixed point
+
+/*
+ * @brief:  Start the estimate at the rate of the configuration in use (@MPU_SampleRateNominal), call it again after a rate change
+ * @param:  clock - Estimator state
+ * 			tick_hz - Rate of the MCU timebase of the timestamps (1000 for HAL_GetTick, the core clock for a cycle counter)
+ * 			memory_updates - Updates averaged once settled, 0 for CLOCK_MEMORY_UPDATES. With HAL_GetTick one tick is 1000 ppm of a 1 kHz
+ * 							 period, give minutes of updates to resolve the drift
+ * @retval: None
+ */
+void MPU_ClockInit(MPU_CLOCK *clock, float tick_hz, uint32_t memory_updates){
+
+	memset(clock, 0, sizeof(MPU_CLOCK));
+
+	clock->tick_hz = tick_hz;
+	clock->nominal_period = tick_hz / MPU_SampleRateNominal();
+	clock->period = (uint64_t)(clock->nominal_period * CLOCK_ONE);
+	clock->min_period = (uint64_t)(clock->nominal_period * (1 - CLOCK_MAX_ERROR) * CLOCK_ONE);
+	clock->max_period = (uint64_t)(clock->nominal_period * (1 + CLOCK_MAX_ERROR) * CLOCK_ONE);
+	clock->memory = memory_updates > 1 ? memory_updates : CLOCK_MEMORY_UPDATES;
+	clock->period_count = clock->memory < CLOCK_PRIOR_UPDATES ? clock->memory : CLOCK_PRIOR_UPDATES;
+}
+
+/*
+ * @brief:  Add the samples made since the previous update
+ * @param:  clock - Estimator state
+ * 			samples - New samples, 1 for a data-ready interrupt or the frames drained from the fifo
+ * 			timestamp - MCU time of the last of them, ticks
+ * @retval: None
+ */
+void MPU_ClockUpdate(MPU_CLOCK *clock, uint32_t samples, uint32_t timestamp){
+
+	uint64_t measured = (uint64_t)timestamp << 32;
+	uint64_t predicted;
+	float error, period, alpha, beta, k;
+
+	if(samples == 0)
+		return;
+
+	clock->stats.updates++;
+	clock->stats.samples += samples;
+
+	if(clock->count == 0){
+		clock->time = measured;
+		clock->count = 1;
+		return;
+	}
+
+	predicted = clock->time + samples * clock->period;
+	error = (int64_t)(measured - predicted) / CLOCK_ONE;		/* The difference is small, the wrap of both cancels */
+	period = clock->period / CLOCK_ONE;
+
+	if(fabsf(error) > CLOCK_RESYNC_PERIODS * period){
+		clock->time = measured;									/* Samples lost or not counted, the phase is not known */
+		clock->count = 1;										/* The period and its weight are kept */
+		clock->stats.resyncs++;
+		return;
+	}
+
+	if(clock->count < clock->memory)
+		clock->count++;
+	else if(fabsf(error) > clock->stats.max_error)
+		clock->stats.max_error = fabsf(error);
+
+	if(clock->period_count < clock->memory)
+		clock->period_count++;
+
+	k = clock->count;											/* Least squares line of the last k updates */
+	alpha = 2 * (2 * k - 1) / (k * (k + 1));
+	k = clock->period_count;
+	beta = 6 / (k * (k + 1));
+
+	clock->time = predicted + (int64_t)(alpha * error * CLOCK_ONE);
+	clock->period += (int64_t)(beta * error / samples * CLOCK_ONE);
+
+	if(clock->period < clock->min_period)						/* Timestamps of a few ticks per sample move it by whole ticks */
+		clock->period = clock->min_period;
+	if(clock->period > clock->max_period)
+		clock->period = clock->max_period;
+}
+
+/*
+ * @brief:  Estimated output data rate
+ * @param:  clock - Estimator state
+ * @retval: Samples per second of the MCU timebase
+ */
+float MPU_ClockRate(const MPU_CLOCK *clock){
+
+	return clock->tick_hz * CLOCK_ONE / clock->period;
+}
+
+/*
+ * @brief:  Error of the sample clock from the configured rate
+ * @param:  clock - Estimator state
+ * @retval: ppm, positive when the device samples faster than the configuration
+ */
+float MPU_ClockDrift(const MPU_CLOCK *clock){
+
+	int64_t difference = (uint64_t)(clock->nominal_period * CLOCK_ONE) - clock->period;		/* Float ratios of the two lose the ppm */
+
+	return difference / (clock->period / CLOCK_ONE) / CLOCK_ONE * 1e6f;
+}
+
+/*
+ * @brief:  Time between two samples, the integration step
+ * @param:  clock - Estimator state
+ * @retval: Seconds of the MCU timebase
+ */
+float MPU_ClockDt(const MPU_CLOCK *clock){
+
+	return clock->period / CLOCK_ONE / clock->tick_hz;
+}
+
+/*
+ * @brief:  Fitted time of one sample, without the jitter of the timestamps. For the frames of a fifo drain, frame i of n is
+ * 			samples_before_last = n - 1 - i
+ * @param:  clock - Estimator state
+ * 			samples_before_last - 0 for the last sample of the last update
+ * @retval: MCU ticks, rounded
+ */
+uint32_t MPU_ClockTimestamp(const MPU_CLOCK *clock, uint32_t samples_before_last){
+
+	return (uint32_t)((clock->time - samples_before_last * clock->period + (1ULL << 31)) >> 32);
+}
+
+/*
+ * @brief:  Update counters
+ * @param:  clock - Estimator state
+ * 			stats - Where the counters will be copied
+ * @retval: None
+ */
+void MPU_ClockGetStats(const MPU_CLOCK *clock, MPU_CLOCK_STATS *stats){
+
+	*stats = clock->stats;
+}
@@ -0,0 +1,79 @@
+/*
+ * MPU_Clock.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+#ifndef INC_MPU_CLOCK_H_
+#define INC_MPU_CLOCK_H_
+
+#include "MPU_SPEC.h"
+
+/*
+ * Sample clock of the device measured with the MCU timebase:
+ *
+ *		model:		t(n) = t0 + n * period, t in MCU ticks, n the sample index
+ *		update:		e = timestamp - predicted time of the last sample
+ *					time += alpha * e, period += beta * e / samples
+ *
+ * alpha and beta are the gains of the least squares line fit of the last k updates and stop at k = memory_updates, so the first
+ * estimate is ready after a few updates and the drift (temperature) is still followed later. alpha counts the updates since the
+ * start or the last resync, beta counts the updates the period has averaged: it starts at CLOCK_PRIOR_UPDATES with the nominal
+ * period, as if the configured rate had been measured that many times, so one quantized interval can not replace it.
+ * The period stays within CLOCK_MAX_ERROR of the nominal one.
+ * The time and the period are kept in 32.32 fixed point ticks, so a multi-hour log keeps sub tick resolution and the 32 bit
+ * timestamps may wrap.
+ *
+ * Counts of samples come from:
+ *		data-ready:	@MPU_ClockUpdate(clock, 1, timestamp) at each interrupt, timestamp captured at the interrupt entry
+ *		fifo:		@MPU_ClockUpdate(clock, frames, timestamp) after each drain of the whole fifo, timestamp taken at the read of
+ *					FIFO_COUNT (@MPU_FifoCounter). The count only moves in whole samples, the loop averages that jitter
+ *
+ * Select the PLL clock (CLKSEL_AUTO_PLL, done by @MPU_Init): with the internal oscillator the error is several %.
+ * An error above CLOCK_RESYNC_PERIODS periods (missed interrupt, fifo overflow) restarts the time at the timestamp, the
+ * period and its beta are kept.
+ * @MPU_ClockDt gives the integration step (for example of @MPU_EkfPredict), @MPU_ClockTimestamp the time of each sample.
+ */
+#ifndef CLOCK_MEMORY_UPDATES
+#define CLOCK_MEMORY_UPDATES		1024			//Updates averaged once the estimate is settled
+#endif
+
+#ifndef CLOCK_PRIOR_UPDATES
+#define CLOCK_PRIOR_UPDATES			64				//Weight of the nominal period at the start, in updates
+#endif
+
+#define CLOCK_RESYNC_PERIODS		4
+#define CLOCK_MAX_ERROR				0.1f			//Limit of the period from the nominal one, the internal oscillator is within a few %
+
+typedef struct{
+	uint32_t updates;
+	uint32_t samples;
+	uint32_t resyncs;
+	float max_error;							//Largest |e| since the estimate settled, ticks
+}MPU_CLOCK_STATS;
+
+typedef struct{
+	uint64_t time;								//Time of the last sample, 32.32 ticks (the high word wraps as the timestamps)
+	uint64_t period;							//32.32 ticks per sample
+	uint64_t min_period, max_period;			//Nominal period -/+ CLOCK_MAX_ERROR
+	float tick_hz;
+	float nominal_period;						//Ticks per sample at the configured rate
+	uint32_t memory;
+	uint32_t count;								//Updates since the start or the last resync, up to memory (alpha)
+	uint32_t period_count;						//Updates averaged by the period, CLOCK_PRIOR_UPDATES to memory (beta)
+	MPU_CLOCK_STATS stats;
+}MPU_CLOCK;
+
+/*
+ * Sample clock functions
+ */
+void MPU_ClockInit(MPU_CLOCK *clock, float tick_hz, uint32_t memory_updates);
+void MPU_ClockUpdate(MPU_CLOCK *clock, uint32_t samples, uint32_t timestamp);
+float MPU_ClockRate(const MPU_CLOCK *clock);
+float MPU_ClockDrift(const MPU_CLOCK *clock);
+float MPU_ClockDt(const MPU_CLOCK *clock);
+uint32_t MPU_ClockTimestamp(const MPU_CLOCK *clock, uint32_t samples_before_last);
+void MPU_ClockGetStats(const MPU_CLOCK *clock, MPU_CLOCK_STATS *stats);
+
+#endif /* INC_MPU_CLOCK_H_ */
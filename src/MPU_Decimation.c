@@ -0,0 +1,176 @@
+/*
+ * MPU_Decimation.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+/*
+ * High rate accel/gyro stream decimated on the MCU instead of the MPU internal DLPF, see MPU_Decimation.h for the filter chain.
+ * The fifo bandwidth is limited by the host bus: at 400 kHz I2C one 12 bytes frame (accel and gyro) fits roughly 3 kHz,
+ * 8 kHz and 32 kHz streams need the gyro alone at fifo or a faster link.
+ */
+
+#include "MPU_Decimation.h"
+#include <math.h>
+
+static float firCoefficients[DECIM_FIR_TAPS] __attribute__((aligned(MPU_BATCH_ALIGN)))
+#ifdef DECIM_FIR_COEFFICIENTS
+	= DECIM_FIR_COEFFICIENTS
+#endif
+;
+
+static float cicGain = 1;								/* 1 / DECIM_CIC_RATIO^DECIM_CIC_ORDER, CIC gain at DC */
+
+static float FirDot(float *history);
+
+/*
+ * @brief:  Reset the decimator state and compute the filter coefficients
+ * @param:  decimator - State of the filter chain
+ * @retval: None
+ */
+void MPU_DecimatorInit(MPU_DECIMATOR *decimator){
+
+	memset(decimator, 0, sizeof(MPU_DECIMATOR));
+
+	cicGain = 1.0 / pow(DECIM_CIC_RATIO, DECIM_CIC_ORDER);
+
+#ifndef DECIM_FIR_COEFFICIENTS
+	float cutoff = DECIM_FIR_CUTOFF * 0.5 / DECIM_FIR_RATIO;				/* cycles/sample at the FIR input */
+	float center = (DECIM_FIR_TAPS - 1) / 2.0;
+	float sum = 0;
+	float t;
+
+	for(uint16_t k = 0; k < DECIM_FIR_TAPS; k++){
+
+		t = k - center;
+		firCoefficients[k] = (t == 0) ? 2 * cutoff : sinf(2 * M_PI * cutoff * t) / (M_PI * t);
+		firCoefficients[k] *= 0.54 - 0.46 * cosf(2 * M_PI * k / (DECIM_FIR_TAPS - 1));		/* Hamming window */
+		sum += firCoefficients[k];
+	}
+
+	for(uint16_t k = 0; k < DECIM_FIR_TAPS; k++)
+		firCoefficients[k] /= sum;														/* Unity gain at DC */
+#endif
+}
+
+/*
+ * @brief:  Configure the MPU for the high rate stream: gyro filter as chosen, accel DLPF bypassed (4 kHz) and accel plus gyro at fifo.
+ * 			Uses the gyro table at @MPU_GyroTempLowPassFilterConfig, for example GYRO_FCHOICE11 with DLPF_CFG7 gives 8 kHz and 3600 Hz bandwidth
+ * @param:  gyro_fchoice - FCHOICE value of @MPU_GyroTempLowPassFilterConfig
+ * 			gyro_dlpf - DLPF_CFG value of @MPU_GyroTempLowPassFilterConfig
+ * @retval: None
+ */
+void MPU_DecimatorSensorConfig(uint8_t gyro_fchoice, DLPF gyro_dlpf){
+
+	MPU_GyroTempLowPassFilterConfig(gyro_fchoice, gyro_dlpf);
+	MPU_AccelLowPassFilterConfig(ACCEL_FCHOICE0_b, DLPF_CFGX);
+	MPU_FifoConfig(0x78, FIFO_MODE_NOT_OVERRIDE);				/* Gyro X, Y, Z and accel, no temperature */
+}
+
+/*
+ * @brief:  Run one block of raw counts through the filter chain
+ * 			Each channel is processed over the whole block before the next one, so the state of one channel stays at registers and
+ * 			the FIR dot product runs over contiguous memory.
+ * 			output->capacity must hold input->length / DECIM_TOTAL_RATIO + 1 samples, input samples that would not fit are dropped.
+ * 			The output keeps raw counts, convert it with @MPU_BatchConvert at the low rate
+ * @param:  decimator - State of the filter chain
+ * 			input - Block read by @MPU_FifoReadBatchRaw
+ * 			output - Decimated block, temperature (if not NULL at both batches) is the input sample at each output instant
+ * @retval: Number of samples placed at output (also at output->length)
+ */
+uint16_t MPU_DecimatorProcess(MPU_DECIMATOR *decimator, MPU_SOA_BATCH *input, MPU_SOA_BATCH *output){
+
+	float *in[DECIM_CHANNELS]  = {input->ax, input->ay, input->az, input->gx, input->gy, input->gz};
+	float *out[DECIM_CHANNELS] = {output->ax, output->ay, output->az, output->gx, output->gy, output->gz};
+	uint16_t phase = decimator->fir_phase * DECIM_CIC_RATIO + decimator->cic_phase;		/* Input samples since the last output */
+	uint16_t length = input->length;
+	uint16_t produced = 0;
+	uint16_t index = 0;
+	uint8_t cic_phase = 0, fir_phase = 0;
+	float x;
+
+	if((uint32_t)output->capacity * DECIM_TOTAL_RATIO - phase < length)
+		length = output->capacity * DECIM_TOTAL_RATIO - phase;
+
+	for(uint8_t ch = 0; ch < DECIM_CHANNELS; ch++){
+
+		float *history = decimator->history[ch];
+#if DECIM_CIC_ORDER > 0
+		uint32_t *integrator = decimator->integrator[ch];
+		uint32_t *comb = decimator->comb[ch];
+		uint32_t y, previous;
+#endif
+
+		index = decimator->history_index;
+		cic_phase = decimator->cic_phase;
+		fir_phase = decimator->fir_phase;
+		produced = 0;
+
+		for(uint16_t i = 0; i < length; i++){
+
+#if DECIM_CIC_ORDER > 0
+			y = (uint32_t)(int32_t)in[ch][i];
+			for(uint8_t s = 0; s < DECIM_CIC_ORDER; s++){
+				integrator[s] += y;
+				y = integrator[s];
+			}
+
+			if(++cic_phase < DECIM_CIC_RATIO)
+				continue;
+			cic_phase = 0;
+
+			for(uint8_t s = 0; s < DECIM_CIC_ORDER; s++){
+				previous = y;
+				y -= comb[s];
+				comb[s] = previous;
+			}
+			x = (int32_t)y * cicGain;
+#else
+			x = in[ch][i];
+#endif
+
+			if(index == 0)
+				index = DECIM_FIR_TAPS;
+			index--;
+			history[index] = history[index + DECIM_FIR_TAPS] = x;		/* Newest sample at the lowest address */
+
+			if(++fir_phase < DECIM_FIR_RATIO)
+				continue;
+			fir_phase = 0;
+
+			out[ch][produced++] = FirDot(&history[index]);
+		}
+	}
+
+	decimator->history_index = index;
+	decimator->cic_phase = cic_phase;
+	decimator->fir_phase = fir_phase;
+
+	if(input->temp != NULL && output->temp != NULL){
+		for(uint16_t i = DECIM_TOTAL_RATIO - 1 - phase, k = 0; i < length; i += DECIM_TOTAL_RATIO)
+			output->temp[k++] = input->temp[i];
+	}
+
+	output->length = produced;
+
+	return produced;
+}
+
+/*
+ * @brief:  Internal function, FIR output from the last DECIM_FIR_TAPS samples, newest first.
+ * 			Four partial sums break the dependency chain so the loop maps to SIMD multiply-accumulate
+ */
+static float FirDot(float *history){
+
+	float acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+
+	for(uint16_t k = 0; k < DECIM_FIR_TAPS; k += 4){
+		acc0 += history[k]     * firCoefficients[k];
+		acc1 += history[k + 1] * firCoefficients[k + 1];
+		acc2 += history[k + 2] * firCoefficients[k + 2];
+		acc3 += history[k + 3] * firCoefficients[k + 3];
+	}
+
+	return (acc0 + acc1) + (acc2 + acc3);
+}
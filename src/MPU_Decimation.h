@@ -0,0 +1,76 @@
+/*
+ * MPU_Decimation.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+#ifndef INC_MPU_DECIMATION_H_
+#define INC_MPU_DECIMATION_H_
+
+#include "MPU_SPEC.h"
+
+/*
+ * Filter chain, fixed at compile time:
+ *
+ *		fifo (raw counts) -> CIC decimation by DECIM_CIC_RATIO -> FIR decimation by DECIM_FIR_RATIO -> @MPU_BatchConvert
+ *
+ * The CIC works with integer counts, so its integrators can wrap around without error. The bit growth is DECIM_CIC_ORDER * log2(DECIM_CIC_RATIO),
+ * it must stay below 16 bits (32 bits accumulators for 16 bits samples).
+ * Set DECIM_CIC_ORDER to 0 to remove the CIC stage.
+ */
+#ifndef DECIM_CIC_ORDER
+#define DECIM_CIC_ORDER			3					//Number of integrator and comb stages
+#endif
+
+#ifndef DECIM_CIC_RATIO
+#define DECIM_CIC_RATIO			4					//Decimation of the CIC stage
+#endif
+
+#ifndef DECIM_FIR_RATIO
+#define DECIM_FIR_RATIO			2					//Decimation of the FIR stage
+#endif
+
+#ifndef DECIM_FIR_TAPS
+#define DECIM_FIR_TAPS			32					//Number of FIR coefficients, multiple of 4 so the dot product runs in whole SIMD blocks
+#endif
+
+#ifndef DECIM_FIR_CUTOFF
+#define DECIM_FIR_CUTOFF		0.4					//FIR cutoff as a fraction of its output Nyquist frequency
+#endif
+
+/*
+ * Define DECIM_FIR_COEFFICIENTS as an initializer list of DECIM_FIR_TAPS floats to use a custom FIR (for example with CIC droop compensation),
+ * otherwise a Hamming windowed sinc with DECIM_FIR_CUTOFF is computed at @MPU_DecimatorInit
+ */
+
+#define DECIM_CHANNELS			6					//ax, ay, az, gx, gy, gz
+#define DECIM_TOTAL_RATIO		(DECIM_CIC_RATIO * DECIM_FIR_RATIO)
+
+#if DECIM_CIC_ORDER == 0 && DECIM_CIC_RATIO != 1
+#error "DECIM_CIC_RATIO must be 1 when the CIC stage is removed"
+#endif
+
+#if DECIM_FIR_TAPS % 4 != 0
+#error "DECIM_FIR_TAPS must be a multiple of 4"
+#endif
+
+typedef struct{
+#if DECIM_CIC_ORDER > 0
+	uint32_t integrator[DECIM_CHANNELS][DECIM_CIC_ORDER];	//Unsigned so the wrap around is defined
+	uint32_t comb[DECIM_CHANNELS][DECIM_CIC_ORDER];			//Last input of each comb stage
+#endif
+	float history[DECIM_CHANNELS][2 * DECIM_FIR_TAPS];		//FIR input written twice, so the last DECIM_FIR_TAPS samples are always contiguous
+	uint16_t history_index;
+	uint8_t cic_phase;
+	uint8_t fir_phase;
+}MPU_DECIMATOR;
+
+/*
+ * Decimation functions
+ */
+void MPU_DecimatorInit(MPU_DECIMATOR *decimator);
+void MPU_DecimatorSensorConfig(uint8_t gyro_fchoice, DLPF gyro_dlpf);
+uint16_t MPU_DecimatorProcess(MPU_DECIMATOR *decimator, MPU_SOA_BATCH *input, MPU_SOA_BATCH *output);
+
+#endif /* INC_MPU_DECIMATION_H_ */
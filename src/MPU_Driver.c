@@ -33,6 +33,30 @@ static void matrixTransp(float *m1, float *transp, int lines, int columns);
 static void matrixInv(float *mfrom, float *mto, int lines, int columns);
 static void matrixCopy(float *mfrom, float *mto, int lines, int columns);
 static void eye(float *m, int lines, int columns);
+static uint8_t FifoFrameSize(uint8_t components);
+static void BatchFrameDecode(uint8_t frame[], uint8_t components, MPU_SOA_BATCH *batch, uint16_t i);
+static void BatchConvert(MPU_SOA_BATCH *batch, uint16_t count, uint8_t components);
+static void BatchPad(MPU_SOA_BATCH *batch);
+static uint8_t AxisIndex(uint8_t axis);
+static void AccelVectorTransform(uint8_t raw_accel[], float accel_data[]);
+static void GyroVectorTransform(uint8_t raw_gyro[], float gyro_data[]);
+static uint8_t TempBiasLookup(float temperature, float gyro_bias[], float accel_bias[]);
+static void TempBiasCompensate(float temperature, float accel_data[], float gyro_data[]);
+static void GyroBiasInUse(float temperature, float gyro_bias[]);
+static void MagVectorTransform(uint8_t mag_return[], float mag_data[]);
+static void MagCorrectionUpdate();
+static void symmetricEigen3(float m[3][3], float eigenvectors[3][3], float eigenvalues[3]);
+static float magEllipsoidFit(const float *samples, uint16_t numberOfSamples, float soft_iron[3][3], float hard_iron[3]);
+static uint8_t WaitDataReady(uint32_t timeout_ms);
+static uint8_t SelfTestAverage(int32_t accel_sum[], int32_t gyro_sum[]);
+static uint8_t MagWriteOnce(MPU_REGISTER reg_to_write);
+static uint8_t MagSelfTest(int16_t mag_response[]);
+static uint8_t AuxSlaveRegisters(uint8_t slave, MPU_REGISTER **slave_addr, MPU_REGISTER **slave_reg, MPU_REGISTER **slave_ctrl);
+static uint8_t AuxSlaveLength(uint8_t slave);
+static uint8_t AuxTransferOnce(uint8_t slave_addr, uint8_t reg, uint8_t value, uint8_t *data_in);
+static void BusEnqueue(uint8_t addr, uint8_t reg, uint8_t value, uint8_t number_of_bytes, uint8_t *data_return, MPU_BUS_PRIORITY priority);
+static uint8_t CalibAverage(uint8_t average_gyro, const MPU_CALIB_CONFIG *config, MPU_CALIB_REPORT *report);
+static uint8_t AccelWaitPose(AXIS axis, uint8_t up, UART_HandleTypeDef *uart, char name[]);
 
 static void hardCodedAccelParam();
 
@@ -52,21 +76,51 @@ static uint8_t flagAccelCalibrated = 0;
 static uint8_t flagMagCalibrated = 0;
 
 static float *accelCalibrationParam;
-static float magCalibrationParam[6];
 
-static float X0;
-static float Y0;
-static float Z0;
-
-static float M_OSx;
-static float M_OSy;
-static float M_OSz;
-
-static float A,B,C;
-
-static float M_SCx;
-static float M_SCy;
-static float M_SCz;
+static float magSoftIron[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};		/* Ellipsoid to sphere correction, uT to uT */
+static float magHardIron[3];										/* Ellipsoid center in uT */
+static float magCorrection[3][3];									/* magSoftIron * diag(sensitivity * ASA adjust), applied to raw counts */
+static float magBias[3];											/* -magSoftIron * magHardIron */
+
+static float accelVectorCache[3];						/* Last vector read, used by the per axis functions */
+static float gyroVectorCache[3];
+static float magVectorCache[3];
+static uint8_t accelAxisConsumed = 0x07;				/* Bit n set: axis n of the cache was already returned */
+static uint8_t gyroAxisConsumed = 0x07;
+static uint8_t magAxisConsumed = 0x07;
+
+static MPU_TEMP_BIAS_MODEL tempBiasModel;
+static uint8_t tempBiasEnabled = 0;
+static float lastTemperature = 21;
+static const uint16_t accelSensitivity[4] = {16384, 8192, 4096, 2048};	/* Counts per g and per °/s, indexed by the full scale */
+static const float gyroSensitivity[4] = {131, 65.5, 32.8, 16.4};
+static uint8_t lastMagRaw[6] = {0};					/* HXL..HZH of the last valid measurement, see @MPU_ReadAllRaw */
+
+static uint8_t magSchedulerActive = 0;
+static uint8_t magSchedulerDivisor;
+static uint8_t magSchedulerCounter;
+static uint8_t magSchedulerFresh = 0;					/* A scheduled sample was not yet returned by MPU_MagReadVector */
+static uint8_t magSchedulerRawFresh = 0;				/* A scheduled sample was not yet taken by MPU_ReadAllRaw */
+static uint8_t magSchedulerDelay;						/* I2C_MST_DLY before the scheduler */
+static MPU_MAG_SCHEDULER_STATS magSchedulerStats;
+
+typedef struct{
+	uint8_t addr;										/* Device i2c address */
+	uint8_t reg;
+	uint8_t value;										/* Byte of a write */
+	uint8_t number_of_bytes;							/* 0 for a write, bytes of a read */
+	uint8_t *data_return;
+	uint8_t priority;
+}BUS_OPERATION;
+
+static BUS_OPERATION busQueue[BUS_QUEUE_SIZE];
+static uint8_t busQueueLength = 0;
+static uint8_t busDeferDepth = 0;						/* Nested MPU_BusDeferBegin calls */
+static MPU_BUS_STATS busStats;
+
+static uint8_t womCycle = 0;							/* Low power cycle started by MPU_WakeOnMotionEnable */
+static uint8_t womSavedPower2;							/* PWR_MGMT_2 and ACCEL_CONFIG2 before the cycle */
+static uint8_t womSavedAccelConfig2;
 
 /*
  * @brief: MPU initialization function
@@ -93,13 +147,19 @@ void MPU_Init(uint8_t i2c, uint8_t mpu_i2c_addr, MPU_ACCEL_SCALE accel_scale, MP
 	AccelScaleConfig(accel_scale);
 	GyroScaleConfig(gyro_scale);
 
+	MPU_BusDeferBegin();
+	__MPU_WRITE(GYRO_CONFIG, MPU_ADDR_USED);			/* 0x1B and 0x1C, one burst */
 	__MPU_WRITE(ACCEL_CONFIG, MPU_ADDR_USED);
-	__MPU_WRITE(GYRO_CONFIG, MPU_ADDR_USED);
+	MPU_BusDeferEnd();
+
+	PWR_MGMT_1.data_cmd &= ~0x07;
+	PWR_MGMT_1.data_cmd |= CLKSEL_AUTO_PLL;				/* The sample clock follows the gyro drive, not the internal oscillator */
+	__MPU_WRITE(PWR_MGMT_1, MPU_ADDR_USED);
 
 	HAL_Delay(1);								/* To change from power-down mode to another mode, its necessary at least 100 us (AK8963 datasheet Rev. 10/2013) */
 	MPU_MagConfigControl(MAG_CONTINUOUS_MEASUREMENT2, _16_BIT);
 
-	MPU_GyroCalibrate(1000);
+	MPU_GyroCalibrateAdaptive(NULL, NULL);			/* Stops as soon as the bias is known to CALIB_GYRO_TOLERANCE, 2000 samples at most */
 
 	accelCalibrationParam = malloc(4 * 3 * sizeof(float));
 
@@ -264,26 +324,37 @@ static void Register_Initialization(){
  */
 static void I2C_Initialization(uint8_t I2Cx){
 
+	MPU_I2CHandleInit(&mpu_i2c_comm, I2Cx);
+}
+
+/*
+ * @brief:  Initialize one i2c handle with the settings used to talk with the MPU, used by the driver and by modules that own other buses
+ * @param:  handle - Handle to be initialized
+ * 			I2Cx - What I2C peripheral will be used (USE_I2C1, USE_I2C2, USE_I2C3)
+ * @retval: None
+ */
+void MPU_I2CHandleInit(I2C_HandleTypeDef *handle, uint8_t I2Cx){
+
 	if(I2Cx == USE_I2C1){
-		mpu_i2c_comm.Instance = I2C1;
+		handle->Instance = I2C1;
 	}
 
 	else if(I2Cx == USE_I2C2){
-		mpu_i2c_comm.Instance = I2C2;
+		handle->Instance = I2C2;
 	}
 	else{
-		mpu_i2c_comm.Instance = I2C3;
+		handle->Instance = I2C3;
 	}
-	mpu_i2c_comm.Init.ClockSpeed 		= 400000;
-	mpu_i2c_comm.Init.DutyCycle 		= I2C_DUTYCYCLE_2;
-	mpu_i2c_comm.Init.OwnAddress1 		= 0;
-	mpu_i2c_comm.Init.AddressingMode	= I2C_ADDRESSINGMODE_7BIT;
-	mpu_i2c_comm.Init.DualAddressMode 	= I2C_DUALADDRESS_DISABLE;
-	mpu_i2c_comm.Init.OwnAddress2 		= 0;
-	mpu_i2c_comm.Init.GeneralCallMode 	= I2C_GENERALCALL_DISABLE;
-	mpu_i2c_comm.Init.NoStretchMode 	= I2C_NOSTRETCH_DISABLE;
-
-	HAL_I2C_Init(&mpu_i2c_comm);
+	handle->Init.ClockSpeed 		= 400000;
+	handle->Init.DutyCycle 			= I2C_DUTYCYCLE_2;
+	handle->Init.OwnAddress1 		= 0;
+	handle->Init.AddressingMode		= I2C_ADDRESSINGMODE_7BIT;
+	handle->Init.DualAddressMode 	= I2C_DUALADDRESS_DISABLE;
+	handle->Init.OwnAddress2 		= 0;
+	handle->Init.GeneralCallMode 	= I2C_GENERALCALL_DISABLE;
+	handle->Init.NoStretchMode 		= I2C_NOSTRETCH_DISABLE;
+
+	HAL_I2C_Init(handle);
 }
 
 /*
@@ -295,7 +366,19 @@ static void I2C_Initialization(uint8_t I2Cx){
  * @retval: None
  */
 void __MPU_WRITE(MPU_REGISTER mpu_r, uint8_t addr){
-	HAL_I2C_Master_Transmit(&mpu_i2c_comm, (uint16_t)(addr << 1), (uint8_t*)&mpu_r, sizeof(mpu_r), HAL_MAX_DELAY);
+
+	MPU_BUS_LOCK();
+
+	if(busDeferDepth){
+		BusEnqueue(addr, mpu_r.register_address, mpu_r.data_cmd, 0, NULL, MPU_BUS_PRIORITY_CONFIG);
+	}
+	else{
+		busStats.requested++;
+		busStats.issued++;
+		HAL_I2C_Master_Transmit(&mpu_i2c_comm, (uint16_t)(addr << 1), (uint8_t*)&mpu_r, sizeof(mpu_r), HAL_MAX_DELAY);
+	}
+
+	MPU_BUS_UNLOCK();
 }
 
 
@@ -308,8 +391,16 @@ void __MPU_WRITE(MPU_REGISTER mpu_r, uint8_t addr){
  */
 void __MPU_READ(MPU_REGISTER mpu_r, uint8_t number_of_bytes, uint8_t *data_return, uint8_t addr){
 
-	HAL_I2C_Master_Transmit(&mpu_i2c_comm, (uint16_t)(addr << 1), (uint8_t*)&mpu_r.register_address, sizeof(mpu_r.register_address), HAL_MAX_DELAY);
-	HAL_I2C_Master_Receive(&mpu_i2c_comm, (uint16_t)(addr << 1), (uint8_t*)data_return, number_of_bytes, HAL_MAX_DELAY);
+	MPU_BUS_LOCK();
+
+	if(busQueueLength)
+		MPU_BusFlush();								/* The read must see the writes queued before it */
+
+	busStats.requested += 2;
+	busStats.issued++;
+	HAL_I2C_Mem_Read(&mpu_i2c_comm, (uint16_t)(addr << 1), mpu_r.register_address, I2C_MEMADD_SIZE_8BIT, data_return, number_of_bytes, HAL_MAX_DELAY);		/* Register address and data with a repeated start */
+
+	MPU_BUS_UNLOCK();
 }
 
 /*
@@ -328,6 +419,7 @@ float MPU_Temperature_Read(){
 	signed_raw = raw_temp[0] << 8 | raw_temp[1];
 
 	tempSensor = signed_raw/TEMP_SENSITIVITY + 21;
+	lastTemperature = tempSensor;
 
 	return tempSensor;
 }
@@ -344,65 +436,152 @@ float MPU_Temperature_Read(){
 uint8_t MPU_ReadAllSensores(float accel_data[], float gyro_data[], float mag_data[])
 {
 
-	int16_t raw_data[6];
 	uint8_t return_data[14];
-	float rawAccel[4];
 
+	MPU_BUS_LOCK();
 
-	if(!flagAccelCalibrated)
-	{
-		M_OSx = M_OSy = M_OSz = 0;
-		M_SCx = M_SCy = M_SCz = 1;
-	}
+	__MPU_READ(ACCEL_XOUT_H, 14, return_data, MPU_ADDR_USED);
+
+	lastTemperature = (int16_t)(return_data[6] << 8 | return_data[7])/TEMP_SENSITIVITY + 21;
+
+	AccelVectorTransform(return_data, accel_data);
+	GyroVectorTransform(&return_data[8], gyro_data);
+	TempBiasCompensate(lastTemperature, accel_data, gyro_data);
+
+	MPU_MagReadVector(mag_data);
+
+	MPU_BUS_UNLOCK();
+
+	return 0;
+}
+
+
+/*
+ *	@brief: Read all sensors at once without conversion, for logging and telemetry (see @MPU_TelemetrySendRaw)
+ *			While @MPU_MagSchedulerStart runs, only the 14 bytes are read, the magnetometer is the last one taken by @MPU_MagSchedulerTick
+ *	@param:
+ *			frame: RAW_FRAME_BYTES bytes, ACCEL_XOUT_H to GYRO_ZOUT_L (big endian), HXL to HZH of the AK8963 (little endian) and a status
+ *				   byte with RAW_FRAME_MAG_NEW. Without a new measurement (no data ready or overflow) HXL to HZH repeat the last valid
+ *				   one, so a consumer of the magnetometer must take only the frames with RAW_FRAME_MAG_NEW (the AK8963 runs at 100 Hz at most)
+ *	@retval: 1 if the magnetometer bytes are a new measurement, 0 if they are the last one
+*/
+uint8_t MPU_ReadAllRaw(uint8_t frame[])
+{
+
+	uint8_t return_data[22];
+	uint8_t new_data;
+
+	MPU_BUS_LOCK();
 
 	__MPU_READ(ACCEL_XOUT_H, 14, return_data, MPU_ADDR_USED);
 
-	raw_data[0] =  return_data[0] << 8 | return_data[1];
-	raw_data[1] =  return_data[2] << 8 | return_data[3];
-	raw_data[2] =  return_data[4] << 8 | return_data[5];
+	if(magSchedulerActive){
+		new_data = magSchedulerRawFresh;
+		magSchedulerRawFresh = 0;
+	}
+	else{
+		__MAG_READ(ST1, 8, &return_data[14]);							/* ST1, HXL..HZH, ST2 */
+
+		new_data = (return_data[14] & 0x01) && !(return_data[21] & 0x08);
+		if(new_data)
+			memcpy(lastMagRaw, &return_data[15], 6);
+	}
 
-	raw_data[3] =  return_data[8] << 8 | return_data[9];
-	raw_data[4] =  return_data[10] << 8 | return_data[11];
-	raw_data[5] =  return_data[12] << 8 | return_data[13];
+	memcpy(&frame[14], lastMagRaw, 6);								/* Under the lock, the tick may write it */
 
+	MPU_BUS_UNLOCK();
 
-	rawAccel[0] = MPU_AccelTransformRead(raw_data[0]);
-	rawAccel[1] = MPU_AccelTransformRead(raw_data[1]);
-	rawAccel[2] = MPU_AccelTransformRead(raw_data[2]);
-	rawAccel[3] = 1;
+	memcpy(frame, return_data, 14);
+	frame[20] = new_data ? RAW_FRAME_MAG_NEW : 0;
 
-	matrixMult(rawAccel, accelCalibrationParam, accel_data, 1, 4, 3);
+	return new_data;
+}
 
-	gyro_data[0] = MPU_GyroTransformRead(raw_data[3]) - gyroxStaticBias;
-	gyro_data[1] = MPU_GyroTransformRead(raw_data[4]) - gyroyStaticBias;
-	gyro_data[2] = MPU_GyroTransformRead(raw_data[5]) - gyrozStaticBias;
+/*
+ *	@brief: Read accelerometer and gyroscope counts of the same sample, for the auto-ranging of MPU_AutoRange.h
+ *			One 15 bytes burst from INT_STATUS to GYRO_ZOUT_L, the interrupt flags come with the sample
+ *	@param:
+ *			accel_raw: Three element vector where the accelerometer counts will be placed
+ *			gyro_raw: Three element vector where the gyroscope counts will be placed
+ *	@retval: INT_STATUS, it is cleared by this read
+*/
+uint8_t MPU_ImuReadRaw(int16_t accel_raw[], int16_t gyro_raw[])
+{
 
-	uint8_t mag_return[6];
-	int16_t raw_mag_data[3];
-	uint8_t st;
+	uint8_t return_data[15];
 
-	HAL_Delay(1);
-	__MAG_READ(ST1, 1, &st);
+	MPU_BUS_LOCK();
+	__MPU_READ(INT_STATUS, 15, return_data, MPU_ADDR_USED);
+	MPU_BUS_UNLOCK();
+
+	lastTemperature = (int16_t)(return_data[7] << 8 | return_data[8])/TEMP_SENSITIVITY + 21;	/* Bias in use of the temperature model */
+
+	for(uint8_t i = 0; i < 3; i++){
+		accel_raw[i] = (int16_t)(return_data[1 + 2*i] << 8 | return_data[2 + 2*i]);
+		gyro_raw[i] = (int16_t)(return_data[9 + 2*i] << 8 | return_data[10 + 2*i]);
+	}
 
-	if(st & 0x01 || st & 0x11){
+	return return_data[0];
+}
 
-	__MAG_READ(HXL, 6, mag_return);
+/*
+ *	@brief: Convert counts measured at a known full scale, not at the one in use, with the same calibration as the vector reads
+ *			The sensitivities come from the tables of the scale configuration, not from the ones in use, so a sample keeps its
+ *			sensitivity while the scale is changed by another task. The temperature bias model is applied at the temperature of
+ *			the last read (@MPU_ImuReadRaw takes it with the counts)
+ *	@param:
+ *			accel_raw, gyro_raw: Three element vectors of counts, either can be NULL
+ *			accel_scale, gyro_scale: Full scales the counts were measured at
+ *			accel_data, gyro_data: Three element vectors where the converted data will be placed
+ *	@retval: None
+*/
+void MPU_ConvertRawScaled(const int16_t accel_raw[], const int16_t gyro_raw[], MPU_ACCEL_SCALE accel_scale, MPU_GYRO_SCALE gyro_scale,
+						  float accel_data[], float gyro_data[])
+{
 
-	raw_mag_data[0] = mag_return[0] | mag_return[1] << 8;
-	raw_mag_data[1] = mag_return[2] | mag_return[3] << 8;
-	raw_mag_data[2] = mag_return[4] | mag_return[5] << 8;
+	float *p = accelCalibrationParam;
+	float x, y, z, factor;
 
-	mag_data[0] = (AK8963_SENSITIVITY * raw_mag_data[0] * magx_Adj - M_OSx)/M_SCx;
-	mag_data[1] = (AK8963_SENSITIVITY * raw_mag_data[1] * magy_Adj - M_OSy)/M_SCy;
-	mag_data[2] = (AK8963_SENSITIVITY * raw_mag_data[2] * magz_Adj - M_OSz)/M_SCz;
+	if(accel_raw != NULL){
+		factor = (USE_SI ? SI_ACCELERATION : 1.0) / accelSensitivity[accel_scale & 0x03];
+		x = accel_raw[0] * factor;
+		y = accel_raw[1] * factor;
+		z = accel_raw[2] * factor;
 
+		accel_data[0] = x * p[0] + y * p[3] + z * p[6] + p[9];			/* Same as matrixMult([x y z 1], accelCalibrationParam) */
+		accel_data[1] = x * p[1] + y * p[4] + z * p[7] + p[10];
+		accel_data[2] = x * p[2] + y * p[5] + z * p[8] + p[11];
 	}
 
-	__MAG_READ(ST2, 1, &st);
+	if(gyro_raw != NULL){
+		factor = 1.0 / gyroSensitivity[gyro_scale & 0x03];
+		gyro_data[0] = gyro_raw[0] * factor - gyroxStaticBias;
+		gyro_data[1] = gyro_raw[1] * factor - gyroyStaticBias;
+		gyro_data[2] = gyro_raw[2] * factor - gyrozStaticBias;
+	}
 
-	return 0;
+	TempBiasCompensate(lastTemperature, accel_raw != NULL ? accel_data : NULL, gyro_raw != NULL ? gyro_data : NULL);
 }
 
+/*
+ *	@brief: Output data rate set by the configuration (SMPLRT_DIV, DLPF and FCHOICE_B), the real one follows the sample clock,
+ *			see MPU_Clock.h
+ *	@param: None
+ *	@retval: Gyroscope and fifo rate in Hz
+*/
+float MPU_SampleRateNominal()
+{
+
+	uint8_t fchoice_b = GYRO_CONFIG.data_cmd & 0x03;
+	uint8_t dlpf = CONFIG.data_cmd & 0x07;
+
+	if(fchoice_b)										/* DLPF bypassed, SMPLRT_DIV is only used with 0 < DLPF_CFG < 7 */
+		return 32000;
+	if(dlpf == DLPF_CFG0 || dlpf == DLPF_CFG7)
+		return 8000;
+
+	return 1000.0 / (1 + SMPLRT_DIV.data_cmd);
+}
 
 /*
  * @brief:	Return the device identity
@@ -419,44 +598,98 @@ uint8_t MPU_WhoAmI(){
 }
 
 /* @brief:  Function to read last accelerometer data
+ * 			Thin wrapper over @MPU_AccelReadVector: a new sample is only read when the requested axis was already returned
+ * 			since the last vector read, so reading X, Y and Z in sequence costs one transaction and the axes come from the same sample
  * @param:  axis - Specify what axis will be read, can be: X_AXIS, Y_AXIS or Z_AXIS
- * @retval: Raw information that is coming from MPU accelerometer ADC
+ * @retval: Calibrated acceleration of the requested axis
  */
 float MPU_AccelRead(uint8_t axis){
 
-	int16_t data_return;
-	uint8_t accel_data[6];
-	float accelx, accely, accelz;
-	float rawAccel[3];
-	float calAccel[3];
+	uint8_t axis_bit = 1 << AxisIndex(axis);
+	float value;
 
-	__MPU_READ(ACCEL_XOUT_H, 6, accel_data, MPU_ADDR_USED);
+	MPU_BUS_LOCK();										/* The cache is shared with the other tasks */
 
-	data_return = accel_data[0] << 8 | accel_data[1];
-	accelx = MPU_AccelTransformRead(data_return);
+	if(accelAxisConsumed & axis_bit)
+		MPU_AccelReadVector(accelVectorCache);
 
-	data_return = accel_data[2] << 8 | accel_data[3];
-	accely = MPU_AccelTransformRead(data_return);
+	accelAxisConsumed |= axis_bit;
+	value = accelVectorCache[AxisIndex(axis)];
 
-	data_return = accel_data[4] << 8 | accel_data[5];
-	accelz = MPU_AccelTransformRead(data_return);
+	MPU_BUS_UNLOCK();
 
-	rawAccel[0] = accelx;
-	rawAccel[1] = accely;
-	rawAccel[2] = accelz;
-	rawAccel[3] = 1;
+	return value;
+}
 
-	matrixMult(rawAccel, accelCalibrationParam, calAccel, 1, 4, 3);
-	if(axis == X_AXIS){
-		return calAccel[0];
-	}
-	else if(axis == Y_AXIS){
-		return calAccel[1];
+/* @brief:  Read the three accelerometer axis from one burst and one calibration multiply
+ * @param:  accel_data - Three element float vector where calibrated acceleration will be placed
+ * @retval: None
+ */
+void MPU_AccelReadVector(float accel_data[]){
+
+	uint8_t raw_accel[8];
+
+	if(tempBiasEnabled){
+		__MPU_READ(ACCEL_XOUT_H, 8, raw_accel, MPU_ADDR_USED);			/* TEMP_OUT follows the accel registers */
+		lastTemperature = (int16_t)(raw_accel[6] << 8 | raw_accel[7])/TEMP_SENSITIVITY + 21;
 	}
 	else{
-		return calAccel[2];
+		__MPU_READ(ACCEL_XOUT_H, 6, raw_accel, MPU_ADDR_USED);
 	}
 
+	AccelVectorTransform(raw_accel, accel_data);
+	TempBiasCompensate(lastTemperature, accel_data, NULL);
+
+	memcpy(accelVectorCache, accel_data, sizeof(accelVectorCache));
+	accelAxisConsumed = 0;
+}
+
+/* @brief:  Read the three accelerometer axis as counts without conversion (event detection, see MPU_Motion.h)
+ * 			One 7 bytes burst from INT_STATUS, the register before ACCEL_XOUT_H, so the interrupt flags come with the sample
+ * @param:  accel_raw - Three element vector where the counts will be placed, accel_sensitivity_used counts per g
+ * @retval: INT_STATUS, it is cleared by this read
+ */
+uint8_t MPU_AccelReadRaw(int16_t accel_raw[]){
+
+	uint8_t raw_accel[7];
+
+	MPU_BUS_LOCK();
+	__MPU_READ(INT_STATUS, 7, raw_accel, MPU_ADDR_USED);
+	MPU_BUS_UNLOCK();
+
+	accel_raw[0] = (int16_t)(raw_accel[1] << 8 | raw_accel[2]);
+	accel_raw[1] = (int16_t)(raw_accel[3] << 8 | raw_accel[4]);
+	accel_raw[2] = (int16_t)(raw_accel[5] << 8 | raw_accel[6]);
+
+	return raw_accel[0];
+}
+
+/*
+ * @brief:  Internal driver function, converts the six accelerometer bytes (big endian, X to Z) to calibrated acceleration
+ */
+static void AccelVectorTransform(uint8_t raw_accel[], float accel_data[]){
+
+	float rawAccel[4];
+
+	rawAccel[0] = MPU_AccelTransformRead(raw_accel[0] << 8 | raw_accel[1]);
+	rawAccel[1] = MPU_AccelTransformRead(raw_accel[2] << 8 | raw_accel[3]);
+	rawAccel[2] = MPU_AccelTransformRead(raw_accel[4] << 8 | raw_accel[5]);
+	rawAccel[3] = 1;
+
+	matrixMult(rawAccel, accelCalibrationParam, accel_data, 1, 4, 3);
+}
+
+/*
+ * @brief:  Internal driver function, index of one @AXIS value at three element vectors
+ */
+static uint8_t AxisIndex(uint8_t axis){
+
+	if(axis == X_AXIS)
+		return 0;
+	else if(axis == Y_AXIS)
+		return 1;
+	else
+		return 2;
 }
 
 static float AccelRawReading(uint8_t axis)
@@ -490,10 +723,15 @@ static float AccelRawReading(uint8_t axis)
  */
 void MPU_AccelScaleChange(MPU_ACCEL_SCALE new_scale){
 
+	MPU_BUS_LOCK();										/* A read of another task sees the register and the sensitivity together */
+
+	ACCEL_CONFIG.data_cmd &= ~(0x03 << 3);
 	ACCEL_CONFIG.data_cmd |= new_scale << 3;
 	AccelScaleConfig(new_scale);
 
 	__MPU_WRITE(ACCEL_CONFIG, MPU_ADDR_USED);
+
+	MPU_BUS_UNLOCK();
 }
 
 /*
@@ -504,18 +742,7 @@ void MPU_AccelScaleChange(MPU_ACCEL_SCALE new_scale){
  */
 static void AccelScaleConfig(MPU_ACCEL_SCALE accel_scale){
 
-	if(accel_scale == ACCEL_FULL_SCALE_16g){
-		accel_sensitivity_used = 2048;
-	}
-	else if(accel_scale == ACCEL_FULL_SCALE_8g){
-		accel_sensitivity_used = 4096;
-	}
-	else if(accel_scale == ACCEL_FULL_SCALE_4g){
-		accel_sensitivity_used = 8192;
-	}
-	else{
-		accel_sensitivity_used = 16384;
-	}
+	accel_sensitivity_used = accelSensitivity[accel_scale & 0x03];
 }
 
 /*
@@ -552,6 +779,7 @@ static float MPU_AccelTransformRead(int16_t raw_data_read){
  */
 void MPU_AccelLowPassFilterConfig(uint8_t ACCEL_FCHOICE, DLPF A_DLPF_CFG){
 
+	ACCEL_CONFIG2.data_cmd &= ~0x0F;					/* Previous choice must not stay at the shadow */
 	ACCEL_CONFIG2.data_cmd |= ACCEL_FCHOICE << 3;
 
 	ACCEL_CONFIG2.data_cmd |= A_DLPF_CFG;
@@ -823,6 +1051,85 @@ uint8_t MPU_GetFlagAccelCalibrated()
 	return flagAccelCalibrated;
 }
 
+/*
+ *	@brief: Six position accelerometer calibration of @MPU_AccelCalibrate, each position averaged until its mean is known to the tolerance
+ *			The positions are asked in the same order, Z up, Z down, Y up, Y down, X up and X down
+ *	@param:
+ *			config - Tolerance, motion thresholds and samples limit of each position, NULL for CALIB_ACCEL_TOLERANCE, CALIB_GYRO_MOTION,
+ *					 CALIB_ACCEL_MOTION and CALIB_MAX_SAMPLES
+ *			uart - To inform the user what step is in the process
+ *			report - Six reports, one for each position in the order above, can be NULL
+ *	@retval: 1 if the calibration was applied and every position converged, 0 otherwise. See MPU_GetFlagAccelCalibrated
+ *			 A position with fewer than CALIB_WARMUP_BLOCKS blocks of accepted samples stops it, the previous calibration is kept
+ */
+uint8_t MPU_AccelCalibrateAdaptive(const MPU_CALIB_CONFIG *config, UART_HandleTypeDef *uart, MPU_CALIB_REPORT report[6])
+{
+	const MPU_CALIB_CONFIG default_config = {CALIB_ACCEL_TOLERANCE, CALIB_GYRO_MOTION, CALIB_ACCEL_MOTION, CALIB_MAX_SAMPLES};
+	const AXIS axis[6] = {Z_AXIS, Z_AXIS, Y_AXIS, Y_AXIS, X_AXIS, X_AXIS};
+	char *name[6] = {"Z Up: ", "Z Down: ", "Y Up: ", "Y Down: ", "X Up: ", "X Down: "};
+	MPU_CALIB_REPORT local_report[6];
+	float rawData[6][4];
+	uint8_t converged = 1;
+
+	if(config == NULL)
+		config = &default_config;
+	if(report == NULL)
+		report = local_report;
+
+	for(uint8_t i = 0; i < 6; i++)
+	{
+		if(!AccelWaitPose(axis[i], !(i & 1), uart, name[i]))
+			return 0;
+
+		HAL_Delay(100);
+
+		converged &= CalibAverage(0, config, &report[i]);
+
+		if(report[i].samples < CALIB_WARMUP_BLOCKS * CALIB_BLOCK_SAMPLES)		/* Mostly motion, the mean is not the pose */
+			return 0;
+
+		rawData[i][0] = report[i].mean[0];
+		rawData[i][1] = report[i].mean[1];
+		rawData[i][2] = report[i].mean[2];
+		rawData[i][3] = 1;
+	}
+
+	accelCalibration((float *)rawData);
+	flagAccelCalibrated = 1;
+
+	return converged;
+}
+
+/*
+ *	@brief: Internal driver function, wait the user to put one axis up or down, same limits as oneAxisAccelCalibration
+ *	@retval: 0 if the maximum time expired
+ */
+static uint8_t AccelWaitPose(AXIS axis, uint8_t up, UART_HandleTypeDef *uart, char name[])
+{
+	char buffer[100];
+	float lastRead;
+
+	snprintf(buffer, sizeof(buffer), "%s put the axis %s now\n", name, up ? "up" : "down");
+	HAL_UART_Transmit(uart, (uint8_t *)buffer, strlen(buffer), HAL_MAX_DELAY);
+
+	for(uint32_t i = 0; i < 500000; i++)			/* The maximum time that the user have to turn the axis to the correct way */
+	{
+		lastRead = AccelRawReading(axis);
+
+		if((up && lastRead > 9.0 && lastRead < 11.0) || (!up && lastRead < -9.0 && lastRead > -11.0))
+		{
+			snprintf(buffer, sizeof(buffer), "%s Sampling started!\n", name);
+			HAL_UART_Transmit(uart, (uint8_t *)buffer, strlen(buffer), HAL_MAX_DELAY);
+			return 1;
+		}
+	}
+
+	snprintf(buffer, sizeof(buffer), "%s Maximum time expired \n", name);
+	HAL_UART_Transmit(uart, (uint8_t *)buffer, strlen(buffer), HAL_MAX_DELAY);
+
+	return 0;
+}
+
 
 static void accelCalibration(float *rawData)
 {
@@ -856,30 +1163,60 @@ static void accelCalibration(float *rawData)
 
 
 /*@brief: 	Function to read last gyroscope data
+ * 			Thin wrapper over @MPU_GyroReadVector, see @MPU_AccelRead
  *@param: 	axis - Specify what axis will be read, can be: X_AXIS, Y_AXIS or Z_AXIS
- *@retval: 	Raw information that is coming from MPU gyroscope ADC
+ *@retval: 	Angular velocity of the requested axis without the static bias
  */
 float MPU_GyroRead(uint8_t axis){
 
-	int16_t data_return = 0;
-	uint8_t giro_data[2];
+	uint8_t axis_bit = 1 << AxisIndex(axis);
+	float value;
 
-	if(axis == X_AXIS){
-		__MPU_READ(GYRO_XOUT_H, 2, giro_data, MPU_ADDR_USED);
-		data_return = giro_data[0] << 8 | giro_data[1];
-		return MPU_GyroTransformRead(data_return) - gyroxStaticBias;
-	}
-	else if(axis == Y_AXIS){
-		__MPU_READ(GYRO_YOUT_H, 2, giro_data, MPU_ADDR_USED);
-		data_return = giro_data[0] << 8 | giro_data[1];
-		return MPU_GyroTransformRead(data_return) - gyroyStaticBias;
+	MPU_BUS_LOCK();										/* The cache is shared with the other tasks */
+
+	if(gyroAxisConsumed & axis_bit)
+		MPU_GyroReadVector(gyroVectorCache);
+
+	gyroAxisConsumed |= axis_bit;
+	value = gyroVectorCache[AxisIndex(axis)];
+
+	MPU_BUS_UNLOCK();
+
+	return value;
+}
+
+/*@brief: 	Read the three gyroscope axis from one burst
+ *@param: 	gyro_data - Three element float vector where angular velocity without the static bias will be placed
+ *@retval: 	None
+ */
+void MPU_GyroReadVector(float gyro_data[]){
+
+	uint8_t raw_gyro[8];
+
+	if(tempBiasEnabled){
+		__MPU_READ(TEMP_OUT_H, 8, raw_gyro, MPU_ADDR_USED);				/* TEMP_OUT comes just before the gyro registers */
+		lastTemperature = (int16_t)(raw_gyro[0] << 8 | raw_gyro[1])/TEMP_SENSITIVITY + 21;
+		GyroVectorTransform(&raw_gyro[2], gyro_data);
 	}
 	else{
-		__MPU_READ(GYRO_ZOUT_H, 2, giro_data, MPU_ADDR_USED);
-		data_return = giro_data[0] << 8 | giro_data[1];
-		return MPU_GyroTransformRead(data_return) - gyrozStaticBias;
+		__MPU_READ(GYRO_XOUT_H, 6, raw_gyro, MPU_ADDR_USED);
+		GyroVectorTransform(raw_gyro, gyro_data);
 	}
 
+	TempBiasCompensate(lastTemperature, NULL, gyro_data);
+
+	memcpy(gyroVectorCache, gyro_data, sizeof(gyroVectorCache));
+	gyroAxisConsumed = 0;
+}
+
+/*
+ * @brief:  Internal driver function, converts the six gyroscope bytes (big endian, X to Z) to angular velocity without the static bias
+ */
+static void GyroVectorTransform(uint8_t raw_gyro[], float gyro_data[]){
+
+	gyro_data[0] = MPU_GyroTransformRead(raw_gyro[0] << 8 | raw_gyro[1]) - gyroxStaticBias;
+	gyro_data[1] = MPU_GyroTransformRead(raw_gyro[2] << 8 | raw_gyro[3]) - gyroyStaticBias;
+	gyro_data[2] = MPU_GyroTransformRead(raw_gyro[4] << 8 | raw_gyro[5]) - gyrozStaticBias;
 }
 
 static float GyroRawReading(uint8_t axis)
@@ -915,18 +1252,7 @@ static float GyroRawReading(uint8_t axis)
  */
 static void GyroScaleConfig(MPU_GYRO_SCALE gyro_scale){
 
-	if(gyro_scale == GYRO_FULL_SCALE_2000dps){
-		gyro_sensitivity_used = 16.4;
-	}
-	else if(gyro_scale == GYRO_FULL_SCALE_1000dps){
-		gyro_sensitivity_used = 32.8;
-	}
-	else if(gyro_scale == GYRO_FULL_SCALE_500dps){
-		gyro_sensitivity_used = 65.5;
-	}
-	else{
-		gyro_sensitivity_used = 131;
-	}
+	gyro_sensitivity_used = gyroSensitivity[gyro_scale & 0x03];
 }
 
 /* @brief: Function used to change the sensitivity of the gyroscope at any desired instant
@@ -934,10 +1260,15 @@ static void GyroScaleConfig(MPU_GYRO_SCALE gyro_scale){
  */
 void MPU_GyroScaleChange(MPU_GYRO_SCALE new_scale){
 
+	MPU_BUS_LOCK();
+
+	GYRO_CONFIG.data_cmd &= ~(0x03 << 3);
 	GYRO_CONFIG.data_cmd |= new_scale << 3;
 	GyroScaleConfig(new_scale);
 
 	__MPU_WRITE(GYRO_CONFIG, MPU_ADDR_USED);
+
+	MPU_BUS_UNLOCK();
 }
 
 /*
@@ -987,84 +1318,509 @@ uint8_t MPU_GetFlagGyroCalibrated()
 }
 
 /*
- *@brief: Digital Low Pass Filter Configuration, the gyroscope and temperature sensor are filtered according to the value of DLPF_CFG and FCHOICE_B
- *		  as shown in the table below:
- *
- *	      FCHOICE     DLPF_CFG				Gyroscope					Temperature Sensor
- *	     <1>  <0>				 BandWith	Delay(ms)	Fs(kHz)		BandWith		Delay(ms)
- *	      x	   1		x		   8800		 0.064		  32		  4000			  0.04
- *	      0    1		x		   3600      0.11		  32		  4000			  0.04
- *	      1    1		0		    250      0.97		   8		  4000			  0.04
- *	      1    1		1			184      2.9	       1		   188			  1.9
- *	      1    1		2			92       3.9		   1		    98			  2.8
- *	      1    1		3			41       5.9		   1			42			  4.8
- *	      1    1		4			20       9.9		   1			20			  8.3
- *	      1    1 		5			10       17.85		   1			10			  13.4
- *	      1    1		6			 5       33.48		   1			 5			  18.6
- *	      1    1		7		   3600		 0.17		   8		  4000			  0.04
- *@param:  FCHOICE: Used to bypass DLPF as show in the table above
- *		   DLPG_CFG: For the digital low pass filter to be used, can be one value of @DLPF
- *@retval: None
+ * 	@brief: Remove gyro static bias like @MPU_GyroCalibrate, but stop as soon as the bias is known to the tolerance.
+ * 			Samples taken while the device moves are rejected, a quiet unit needs a few hundred samples instead of 1000
+ *	@param:
+ *			config - Tolerance, motion thresholds and samples limit, NULL for CALIB_GYRO_TOLERANCE, CALIB_GYRO_MOTION, CALIB_ACCEL_MOTION
+ *					 and CALIB_MAX_SAMPLES
+ *			report - Where the bias, noise and achieved uncertainty will be placed, can be NULL
+ *	@retval: 1 if the tolerance was reached, 0 if the samples limit came first (the bias is still applied). See MPU_GetFlagGyroCalibrated
  */
-void MPU_GyroTempLowPassFilterConfig(uint8_t FCHOICE, DLPF DLPF_CFG){
+uint8_t MPU_GyroCalibrateAdaptive(const MPU_CALIB_CONFIG *config, MPU_CALIB_REPORT *report)
+{
+	const MPU_CALIB_CONFIG default_config = {CALIB_GYRO_TOLERANCE, CALIB_GYRO_MOTION, CALIB_ACCEL_MOTION, CALIB_MAX_SAMPLES};
+	MPU_CALIB_REPORT local_report;
+	uint8_t converged;
 
-	CONFIG.data_cmd |= DLPF_CFG;
-	__MPU_WRITE(CONFIG, MPU_ADDR_USED);
+	if(config == NULL)
+		config = &default_config;
+	if(report == NULL)
+		report = &local_report;
 
-	GYRO_CONFIG.data_cmd |= FCHOICE;
-	__MPU_WRITE(GYRO_CONFIG, MPU_ADDR_USED);
+	flagGyroCalibrated = 0;
+
+	converged = CalibAverage(1, config, report);
+
+	if(report->samples >= CALIB_WARMUP_BLOCKS * CALIB_BLOCK_SAMPLES)
+	{
+		gyroxStaticBias = report->mean[0];
+		gyroyStaticBias = report->mean[1];
+		gyrozStaticBias = report->mean[2];
+		flagGyroCalibrated = 1;
+	}
+
+	return converged;
 }
 
-/* @brief: Used to remove DC bias from gyro sensor data output, the values in these registers are subtracted from the gyro going into the sensor registers
- * @param:
- *			axis  - Must be one value of @AXIS enum
- *			value - Value that should be subtracted from the gyro data output
- *					If the value that are displaying at one axis is x °/s, and the desired value is 0 °/s, the value parameter must be -x
- * @retval: None
+/*
+ * 	@brief: Internal driver function, average the gyro (average_gyro = 1) or the accel output until the confidence interval of the
+ * 			mean is below the tolerance, see the adaptive calibration definitions at MPU_SPEC.h
+ * 			Both sensors are read from one burst, a sample is rejected when any axis of them is out of the motion thresholds
+ * 	@retval: 1 if converged
  */
-void MPU_GyroOffset(AXIS axis, float value){
-	int16_t raw_data = (int16_t)(value * 32.8);		//According with the application note of InvenSense, the value of the bias inputed needs to be in +-1000dps sensitivity range
+static uint8_t CalibAverage(uint8_t average_gyro, const MPU_CALIB_CONFIG *config, MPU_CALIB_REPORT *report)
+{
+	float accel_unit = USE_SI ? SI_ACCELERATION : 1;
+	float tolerance = config->tolerance * (average_gyro ? 1 : accel_unit);
+	float accel_motion = config->accel_motion * accel_unit;
+	float accel[3], gyro[3], *value;
+	float accel_mean[3], gyro_mean[3];						/* Running means of the accepted samples, motion test */
+	float sample_mean[3], sample_m2[3];						/* Welford of the samples, noise report */
+	float block_sum[3], block_mean[3], block_m2[3];			/* Welford of the block means, interval */
+	uint16_t count = 0, blocks = 0, in_block = 0, rejects = 0;
+	uint8_t raw[14], moving, converged = 0;
+
+	memset(report, 0, sizeof(MPU_CALIB_REPORT));
+
+	for(uint16_t reads = 0; reads < config->max_samples && !converged; reads++)
+	{
+		if(count == 0)										/* Start, or restart after the device moved */
+		{
+			memset(accel_mean, 0, sizeof(accel_mean));
+			memset(gyro_mean, 0, sizeof(gyro_mean));
+			memset(sample_mean, 0, sizeof(sample_mean));
+			memset(sample_m2, 0, sizeof(sample_m2));
+			memset(block_sum, 0, sizeof(block_sum));
+			memset(block_mean, 0, sizeof(block_mean));
+			memset(block_m2, 0, sizeof(block_m2));
+			blocks = 0;
+			in_block = 0;
+		}
 
-	MPU_REGISTER OFFSET_TO_SEND_H;
-	MPU_REGISTER OFFSET_TO_SEND_L;
+		WaitDataReady(CALIB_SAMPLE_TIMEOUT_MS);				/* Consecutive reads of the same sample would narrow the interval */
+		__MPU_READ(ACCEL_XOUT_H, 14, raw, MPU_ADDR_USED);
 
-	if(axis == X_AXIS){
+		moving = 0;
+		for(uint8_t k = 0; k < 3; k++)
+		{
+			accel[k] = MPU_AccelTransformRead(raw[2 * k] << 8 | raw[2 * k + 1]);
+			gyro[k]  = MPU_GyroTransformRead(raw[8 + 2 * k] << 8 | raw[9 + 2 * k]);
 
-		memcpy(&OFFSET_TO_SEND_H, &XG_OFFSET_H, sizeof(XG_OFFSET_H));
-		memcpy(&OFFSET_TO_SEND_L, &XG_OFFSET_L, sizeof(XG_OFFSET_L));
-	}
-	else if(axis == Y_AXIS){
+			if(blocks >= CALIB_WARMUP_BLOCKS &&
+			   (fabsf(gyro[k] - gyro_mean[k]) > config->gyro_motion || fabsf(accel[k] - accel_mean[k]) > accel_motion))
+				moving = 1;
+		}
 
-		memcpy(&OFFSET_TO_SEND_H, &YG_OFFSET_H, sizeof(YG_OFFSET_H));
-		memcpy(&OFFSET_TO_SEND_L, &YG_OFFSET_L, sizeof(YG_OFFSET_L));
-	}
-	else{
+		if(moving)
+		{
+			report->rejected++;
+			if(++rejects >= CALIB_RESTART_REJECTS)
+			{
+				count = 0;
+				rejects = 0;
+				report->restarts++;
+			}
+			continue;
+		}
 
-		memcpy(&OFFSET_TO_SEND_H, &ZG_OFFSET_H, sizeof(ZG_OFFSET_H));
-		memcpy(&OFFSET_TO_SEND_L, &ZG_OFFSET_L, sizeof(ZG_OFFSET_L));
-	}
+		rejects = 0;
+		count++;
+		value = average_gyro ? gyro : accel;
 
-	OFFSET_TO_SEND_H.data_cmd = 0;
-	OFFSET_TO_SEND_L.data_cmd = 0;
-	OFFSET_TO_SEND_H.data_cmd |= (raw_data >> 8) && 0xff;
-	OFFSET_TO_SEND_L.data_cmd |= (raw_data & 0xFF);
+		for(uint8_t k = 0; k < 3; k++)
+		{
+			float delta = value[k] - sample_mean[k];
 
-	__MPU_WRITE(OFFSET_TO_SEND_H, MPU_ADDR_USED);
-	__MPU_WRITE(OFFSET_TO_SEND_L, MPU_ADDR_USED);
-}
+			accel_mean[k] += (accel[k] - accel_mean[k]) / count;
+			gyro_mean[k]  += (gyro[k] - gyro_mean[k]) / count;
+			sample_mean[k] += delta / count;
+			sample_m2[k] += delta * (value[k] - sample_mean[k]);
+			block_sum[k] += value[k];
+		}
 
-/*
- * @brief: Configuration of FIFO mode of operation and component enabling
- * @param:
+		if(++in_block < CALIB_BLOCK_SAMPLES)
+			continue;
+
+		blocks++;
+		in_block = 0;
+		converged = blocks >= CALIB_WARMUP_BLOCKS;
+
+		for(uint8_t k = 0; k < 3; k++)
+		{
+			float x = block_sum[k] / CALIB_BLOCK_SAMPLES;
+			float delta = x - block_mean[k];
+
+			block_mean[k] += delta / blocks;
+			block_m2[k] += delta * (x - block_mean[k]);
+			block_sum[k] = 0;
+
+			if(blocks >= 2)
+				report->uncertainty[k] = CALIB_CONFIDENCE_Z * sqrtf(block_m2[k] / (blocks - 1) / blocks);
+
+			if(report->uncertainty[k] > tolerance)
+				converged = 0;
+		}
+	}
+
+	for(uint8_t k = 0; k < 3; k++)
+	{
+		report->mean[k] = blocks > 0 ? block_mean[k] : sample_mean[k];
+		report->std[k] = count > 1 ? sqrtf(sample_m2[k] / (count - 1)) : 0;
+		if(blocks < 2)
+			report->uncertainty[k] = INFINITY;
+	}
+
+	report->samples = count;
+	report->converged = converged;
+
+	return converged;
+}
+
+/*
+ * 	@brief: Add a correction to the bias in use, for example the residual bias estimated by a filter. It goes to the static bias of
+ * 			@MPU_GyroCalibrate and, with the temperature bias model enabled, to every learned bin too: the model replaces the static
+ * 			bias at the read path, the correction is taken as a shift of the whole bias curve
+ *	@param: delta - Three element vector in °/s, it will be subtracted from the following gyro outputs
+ *	@retval: None
+ */
+void MPU_GyroAdjustBias(const float delta[])
+{
+	gyroxStaticBias += delta[0];
+	gyroyStaticBias += delta[1];
+	gyrozStaticBias += delta[2];
+
+	if(!tempBiasEnabled)
+		return;
+
+	for(uint8_t bin = 0; bin < TEMP_BIAS_BINS; bin++){
+		if(tempBiasModel.samples[bin] == 0)
+			continue;
+
+		for(uint8_t k = 0; k < 3; k++)
+			tempBiasModel.gyro_bias[bin][k] += delta[k];
+	}
+}
+
+/*
+ * 	@brief: Bias in use at the last read temperature: the static bias of @MPU_GyroCalibrate, or the temperature model bias when it is
+ * 			enabled and covers that temperature. Both are changed by @MPU_GyroAdjustBias (see MPU_ZeroMotion.h)
+ *	@param: bias - Three element vector where the bias in °/s will be placed
+ *	@retval: None
+ */
+void MPU_GyroGetBias(float bias[])
+{
+	GyroBiasInUse(lastTemperature, bias);
+}
+
+/*
+ * 	@brief: Move the bias in use (@MPU_GyroGetBias) to the offset registers XG_OFFSET_H to ZG_OFFSET_L, the device then removes it
+ * 			before the data registers and the fifo. The part that fits the registers (1/32.8 °/s steps) is taken from the static bias
+ * 			and from the learned bins of the temperature model (enabled or not, they hold the bias of the outputs), so the calibrated
+ * 			output does not change. One 6 bytes read and one 6 bytes burst write
+ *	@param: None
+ *	@retval: 1 if the whole bias was moved, 0 if one register saturated (the rest stays at the static bias)
+ */
+uint8_t MPU_GyroBiasOffload()
+{
+	uint8_t offset_data[6];
+	MPU_REGISTER *offset_registers[6] = {&XG_OFFSET_H, &XG_OFFSET_L, &YG_OFFSET_H, &YG_OFFSET_L, &ZG_OFFSET_H, &ZG_OFFSET_L};
+	float *static_bias[3] = {&gyroxStaticBias, &gyroyStaticBias, &gyrozStaticBias};
+	float bias[3], moved;
+	int32_t offset;
+	uint8_t fits = 1;
+
+	MPU_BUS_LOCK();
+
+	__MPU_READ(XG_OFFSET_H, 6, offset_data, MPU_ADDR_USED);
+	GyroBiasInUse(lastTemperature, bias);
+
+	for(uint8_t k = 0; k < 3; k++){
+		offset = (int16_t)(offset_data[2*k] << 8 | offset_data[2*k + 1]) - lroundf(bias[k] * 32.8f);	/* Register in the ±1000 °/s scale, added to the output */
+
+		if(offset > INT16_MAX || offset < INT16_MIN){
+			offset = offset > INT16_MAX ? INT16_MAX : INT16_MIN;
+			fits = 0;
+		}
+
+		moved = ((int16_t)(offset_data[2*k] << 8 | offset_data[2*k + 1]) - offset) / 32.8f;
+		*static_bias[k] -= moved;
+		for(uint8_t bin = 0; bin < TEMP_BIAS_BINS; bin++){			/* The outputs lose the moved part at every temperature */
+			if(tempBiasModel.samples[bin])
+				tempBiasModel.gyro_bias[bin][k] -= moved;
+		}
+
+		offset_registers[2*k]->data_cmd = (uint16_t)offset >> 8;
+		offset_registers[2*k + 1]->data_cmd = offset & 0xFF;
+	}
+
+	MPU_BusDeferBegin();											/* 0x13 to 0x18, one burst */
+	for(uint8_t i = 0; i < 6; i++)
+		__MPU_WRITE(*offset_registers[i], MPU_ADDR_USED);
+	MPU_BusDeferEnd();
+
+	MPU_BUS_UNLOCK();
+
+	return fits;
+}
+
+/*
+ * 	@brief: Enable or disable the temperature compensated bias model at the read path
+ * 			While disabled the static bias of @MPU_GyroCalibrate is used. Bins without TEMP_BIAS_MIN_SAMPLES also fall back to it
+ *	@param: enable - 1 to use the model, 0 otherwise
+ *	@retval: None
+ */
+void MPU_TempBiasEnable(uint8_t enable)
+{
+	tempBiasEnabled = enable;
+}
+
+/*
+ * 	@brief: Feed the temperature compensated bias model with one sample
+ * 			Call it periodically, the sample is only used if the device is stationary: angular velocity (bias in use removed) below
+ * 			TEMP_BIAS_STILL_GYRO and acceleration magnitude within TEMP_BIAS_STILL_ACCEL of 1g.
+ * 			The gyro bias is fully observable when stationary, for the accelerometer only the component along gravity is, so this is what
+ * 			the model keeps
+ *	@param: None
+ *	@retval: 1 if the sample was used, 0 if the device was moving or the temperature is outside the model range
+ */
+uint8_t MPU_TempBiasLearn()
+{
+	uint8_t return_data[14];
+	float accel[3], gyro[3], bias[3];
+	float temperature, norm;
+	float gravity = USE_SI ? SI_ACCELERATION : 1.0;
+	int16_t bin;
+	uint16_t weight;
+
+	__MPU_READ(ACCEL_XOUT_H, 14, return_data, MPU_ADDR_USED);
+
+	temperature = (int16_t)(return_data[6] << 8 | return_data[7])/TEMP_SENSITIVITY + 21;
+	lastTemperature = temperature;
+
+	AccelVectorTransform(return_data, accel);
+
+	gyro[0] = MPU_GyroTransformRead(return_data[8] << 8 | return_data[9]);
+	gyro[1] = MPU_GyroTransformRead(return_data[10] << 8 | return_data[11]);
+	gyro[2] = MPU_GyroTransformRead(return_data[12] << 8 | return_data[13]);
+
+	norm = sqrtf(accel[0] * accel[0] + accel[1] * accel[1] + accel[2] * accel[2]);
+
+	if(fabsf(norm - gravity) > TEMP_BIAS_STILL_ACCEL)
+		return 0;
+
+	GyroBiasInUse(temperature, bias);								/* The model bias once it covers the temperature */
+
+	if(fabsf(gyro[0] - bias[0]) > TEMP_BIAS_STILL_GYRO ||
+	   fabsf(gyro[1] - bias[1]) > TEMP_BIAS_STILL_GYRO ||
+	   fabsf(gyro[2] - bias[2]) > TEMP_BIAS_STILL_GYRO)
+		return 0;
+
+	bin = (int16_t)floorf((temperature - TEMP_BIAS_MIN_C) / TEMP_BIAS_BIN_WIDTH_C);
+
+	if(bin < 0 || bin >= TEMP_BIAS_BINS)
+		return 0;
+
+	if(tempBiasModel.samples[bin] < TEMP_BIAS_MAX_WEIGHT)
+		tempBiasModel.samples[bin]++;
+
+	weight = tempBiasModel.samples[bin];
+
+	for(uint8_t k = 0; k < 3; k++)
+	{
+		tempBiasModel.gyro_bias[bin][k]  += (gyro[k] - tempBiasModel.gyro_bias[bin][k]) / weight;
+		tempBiasModel.accel_bias[bin][k] += (accel[k] * (1 - gravity / norm) - tempBiasModel.accel_bias[bin][k]) / weight;
+	}
+
+	return 1;
+}
+
+/*
+ * 	@brief: Copy the temperature compensated bias model, so it can be stored with the rest of the calibration
+ *	@param: model - Where the model will be copied
+ *	@retval: None
+ */
+void MPU_TempBiasGetModel(MPU_TEMP_BIAS_MODEL *model)
+{
+	memcpy(model, &tempBiasModel, sizeof(tempBiasModel));
+}
+
+/*
+ * 	@brief: Restore a temperature compensated bias model previously obtained by @MPU_TempBiasGetModel
+ *	@param: model - Model to be used
+ *	@retval: None
+ */
+void MPU_TempBiasSetModel(const MPU_TEMP_BIAS_MODEL *model)
+{
+	memcpy(&tempBiasModel, model, sizeof(tempBiasModel));
+}
+
+/*
+ * 	@brief: Erase all of the temperature compensated bias model bins
+ *	@param: None
+ *	@retval: None
+ */
+void MPU_TempBiasClear()
+{
+	memset(&tempBiasModel, 0, sizeof(tempBiasModel));
+}
+
+/*
+ * @brief:  Internal driver function, bias of the model at one temperature, linear interpolation between the centers of the two nearest bins
+ * @retval: 1 if at least one of the bins has enough samples, 0 otherwise
+ */
+static uint8_t TempBiasLookup(float temperature, float gyro_bias[], float accel_bias[])
+{
+	float position = (temperature - TEMP_BIAS_MIN_C) / TEMP_BIAS_BIN_WIDTH_C - 0.5;		/* Position relative to the bin centers */
+	float frac = 0;
+	int16_t low, high;
+	uint8_t low_ok, high_ok;
+
+	if(position <= 0){
+		low = high = 0;
+	}
+	else if(position >= TEMP_BIAS_BINS - 1){
+		low = high = TEMP_BIAS_BINS - 1;
+	}
+	else{
+		low = (int16_t)position;
+		high = low + 1;
+		frac = position - low;
+	}
+
+	low_ok  = tempBiasModel.samples[low] >= TEMP_BIAS_MIN_SAMPLES;
+	high_ok = tempBiasModel.samples[high] >= TEMP_BIAS_MIN_SAMPLES;
+
+	if(!low_ok && !high_ok)
+		return 0;
+
+	if(!high_ok)
+		frac = 0;
+	else if(!low_ok)
+		frac = 1;
+
+	for(uint8_t k = 0; k < 3; k++)
+	{
+		gyro_bias[k]  = tempBiasModel.gyro_bias[low][k]  + (tempBiasModel.gyro_bias[high][k]  - tempBiasModel.gyro_bias[low][k])  * frac;
+		accel_bias[k] = tempBiasModel.accel_bias[low][k] + (tempBiasModel.accel_bias[high][k] - tempBiasModel.accel_bias[low][k]) * frac;
+	}
+
+	return 1;
+}
+
+/*
+ * @brief:  Internal driver function, gyro bias removed from the outputs at one temperature: the model bias when it is enabled and
+ * 			covers the temperature, the static bias otherwise
+ */
+static void GyroBiasInUse(float temperature, float gyro_bias[])
+{
+	float accel_bias[3];
+
+	if(tempBiasEnabled && TempBiasLookup(temperature, gyro_bias, accel_bias))
+		return;
+
+	gyro_bias[0] = gyroxStaticBias;
+	gyro_bias[1] = gyroyStaticBias;
+	gyro_bias[2] = gyrozStaticBias;
+}
+
+/*
+ * @brief:  Internal driver function, replaces the static gyro bias by the model bias and removes the accel bias of the model
+ * 			Nothing is done if the model is disabled or does not cover the temperature
+ * @param:  temperature - Die temperature of the sample
+ * 			accel_data - Calibrated acceleration, can be NULL
+ * 			gyro_data - Angular velocity with the static bias removed, can be NULL
+ */
+static void TempBiasCompensate(float temperature, float accel_data[], float gyro_data[])
+{
+	float gyro_bias[3], accel_bias[3];
+
+	if(!tempBiasEnabled || !TempBiasLookup(temperature, gyro_bias, accel_bias))
+		return;
+
+	if(gyro_data != NULL){
+		gyro_data[0] += gyroxStaticBias - gyro_bias[0];
+		gyro_data[1] += gyroyStaticBias - gyro_bias[1];
+		gyro_data[2] += gyrozStaticBias - gyro_bias[2];
+	}
+	if(accel_data != NULL){
+		accel_data[0] -= accel_bias[0];
+		accel_data[1] -= accel_bias[1];
+		accel_data[2] -= accel_bias[2];
+	}
+}
+
+/*
+ *@brief: Digital Low Pass Filter Configuration, the gyroscope and temperature sensor are filtered according to the value of DLPF_CFG and FCHOICE_B
+ *		  as shown in the table below:
+ *
+ *	      FCHOICE     DLPF_CFG				Gyroscope					Temperature Sensor
+ *	     <1>  <0>				 BandWith	Delay(ms)	Fs(kHz)		BandWith		Delay(ms)
+ *	      x	   1		x		   8800		 0.064		  32		  4000			  0.04
+ *	      0    1		x		   3600      0.11		  32		  4000			  0.04
+ *	      1    1		0		    250      0.97		   8		  4000			  0.04
+ *	      1    1		1			184      2.9	       1		   188			  1.9
+ *	      1    1		2			92       3.9		   1		    98			  2.8
+ *	      1    1		3			41       5.9		   1			42			  4.8
+ *	      1    1		4			20       9.9		   1			20			  8.3
+ *	      1    1 		5			10       17.85		   1			10			  13.4
+ *	      1    1		6			 5       33.48		   1			 5			  18.6
+ *	      1    1		7		   3600		 0.17		   8		  4000			  0.04
+ *@param:  FCHOICE: Used to bypass DLPF as show in the table above
+ *		   DLPG_CFG: For the digital low pass filter to be used, can be one value of @DLPF
+ *@retval: None
+ */
+void MPU_GyroTempLowPassFilterConfig(uint8_t FCHOICE, DLPF DLPF_CFG){
+
+	CONFIG.data_cmd &= ~0x07;
+	CONFIG.data_cmd |= DLPF_CFG;
+	__MPU_WRITE(CONFIG, MPU_ADDR_USED);
+
+	GYRO_CONFIG.data_cmd &= ~0x03;
+	GYRO_CONFIG.data_cmd |= FCHOICE;
+	__MPU_WRITE(GYRO_CONFIG, MPU_ADDR_USED);
+}
+
+/* @brief: Used to remove DC bias from gyro sensor data output, the values in these registers are subtracted from the gyro going into the sensor registers
+ * @param:
+ *			axis  - Must be one value of @AXIS enum
+ *			value - Value that should be subtracted from the gyro data output
+ *					If the value that are displaying at one axis is x °/s, and the desired value is 0 °/s, the value parameter must be -x
+ * @retval: None
+ */
+void MPU_GyroOffset(AXIS axis, float value){
+	int16_t raw_data = (int16_t)(value * 32.8);		//According with the application note of InvenSense, the value of the bias inputed needs to be in +-1000dps sensitivity range
+
+	MPU_REGISTER OFFSET_TO_SEND_H;
+	MPU_REGISTER OFFSET_TO_SEND_L;
+
+	if(axis == X_AXIS){
+
+		memcpy(&OFFSET_TO_SEND_H, &XG_OFFSET_H, sizeof(XG_OFFSET_H));
+		memcpy(&OFFSET_TO_SEND_L, &XG_OFFSET_L, sizeof(XG_OFFSET_L));
+	}
+	else if(axis == Y_AXIS){
+
+		memcpy(&OFFSET_TO_SEND_H, &YG_OFFSET_H, sizeof(YG_OFFSET_H));
+		memcpy(&OFFSET_TO_SEND_L, &YG_OFFSET_L, sizeof(YG_OFFSET_L));
+	}
+	else{
+
+		memcpy(&OFFSET_TO_SEND_H, &ZG_OFFSET_H, sizeof(ZG_OFFSET_H));
+		memcpy(&OFFSET_TO_SEND_L, &ZG_OFFSET_L, sizeof(ZG_OFFSET_L));
+	}
+
+	OFFSET_TO_SEND_H.data_cmd = 0;
+	OFFSET_TO_SEND_L.data_cmd = 0;
+	OFFSET_TO_SEND_H.data_cmd |= (raw_data >> 8) & 0xff;
+	OFFSET_TO_SEND_L.data_cmd |= (raw_data & 0xFF);
+
+	__MPU_WRITE(OFFSET_TO_SEND_H, MPU_ADDR_USED);
+	__MPU_WRITE(OFFSET_TO_SEND_L, MPU_ADDR_USED);
+}
+
+/*
+ * @brief: Configuration of FIFO mode of operation and component enabling
+ * @param:
  * 			If:
  *				enable_mpu_components[7] = 1 ->  temperature data (TEMP_OUT_H, TEMP_OUT_L)    will be buffered at fifo, even if data path is in standby
  * 				enable_mpu_components[6] = 1 ->  Gyro X axis data (GYRO_XOUT_X, GYRO_XOUT_L)  will be buffered at fifo, even if data path is in standby
  *				enable_mpu_components[5] = 1 ->  Gyro Y axis data (GYRO_YOUT_X, GYRO_YOUT_L)  will be buffered at fifo, even if data path is in standby
  * 				enable_mpu_components[4] = 1 ->  Gyro Z axis data (GYRO_ZOUT_X, GYRO_ZOUT_L)  will be buffered at fifo, even if data path is in standby
  *				enable_mpu_components[3] = 1 -> accel data (all axis)  will be buffered at fifo, even if data path is in standby
- * 				enable_mpu_components[2] = 1 -> associated with auxiliary i2c, TODO
- *				enable_mpu_components[1] = 1 -> associated with auxiliary i2c, TODO
- * 				enable_mpu_components[0] = 1 -> associated with auxiliary i2c, TODO
+ * 				enable_mpu_components[2] = 1 -> EXT_SENS_DATA read by aux i2c slave 2 will be buffered at fifo
+ *				enable_mpu_components[1] = 1 -> EXT_SENS_DATA read by aux i2c slave 1 will be buffered at fifo
+ * 				enable_mpu_components[0] = 1 -> EXT_SENS_DATA read by aux i2c slave 0 will be buffered at fifo
+ * 				Slave 3 is enabled at fifo by I2C_MST_CTRL, see @MPU_AuxAttach
  *
  * fifo_mode - if fifo_mode = FIFO_NOT_OVERRIDE, new incoming data will not replace the oldest data
  * 			   if fifo_mode = FIFO_OVERRIDE, new incoming data will replace the oldest
@@ -1075,10 +1831,12 @@ void MPU_FifoConfig(uint8_t enable_mpu_components, uint8_t fifo_mode){
 	USER_CTRL.data_cmd |= 1 << 6;						//FIFO Enable
 	USER_CTRL.data_cmd |= 1 << 2;						//Reset Fifo module
 	__MPU_WRITE(USER_CTRL, MPU_ADDR_USED);
+	USER_CTRL.data_cmd &= ~(1 << 2);					//FIFO_RST clears itself
 
-	FIFO_EN.data_cmd |= enable_mpu_components;		//controls what data will be put at fifo
+	FIFO_EN.data_cmd = (FIFO_EN.data_cmd & 0x07) | enable_mpu_components;		//controls what data will be put at fifo, aux slaves are kept
 	__MPU_WRITE(FIFO_EN, MPU_ADDR_USED);
 
+	CONFIG.data_cmd &= ~(1 << 6);
 	CONFIG.data_cmd |= fifo_mode << 6;					//controls if new data override or not the oldest
 	__MPU_WRITE(CONFIG, MPU_ADDR_USED);
 }
@@ -1096,8 +1854,7 @@ int16_t MPU_FifoCounter(){
 	uint8_t data_register[2] = {0};
 	uint16_t to_return;
 
-	HAL_I2C_Master_Transmit(&mpu_i2c_comm, (uint16_t)(MPU_ADDR_USED << 1), (uint8_t*)&FIFO_COUNTH.register_address, sizeof(FIFO_COUNTH.register_address), HAL_MAX_DELAY);
-	HAL_I2C_Master_Receive(&mpu_i2c_comm, (uint16_t)(MPU_ADDR_USED << 1), (uint8_t*)&data_register, 2, HAL_MAX_DELAY);
+	__MPU_READ(FIFO_COUNTH, 2, data_register, MPU_ADDR_USED);		/* Queued writes go first, the read is counted at busStats */
 
 	to_return = ((uint16_t)(data_register[0] & 0x1F) << 8) | data_register[1];
 	return to_return;
@@ -1118,73 +1875,356 @@ int16_t MPU_FifoReadData(){
 	uint8_t data_register[2] = {0};
 	uint16_t to_return;
 
-	HAL_I2C_Master_Transmit(&mpu_i2c_comm, (uint16_t)(MPU_ADDR_USED << 1), (uint8_t*)&FIFO_R_W.register_address, sizeof(FIFO_R_W.register_address), HAL_MAX_DELAY);
-	HAL_I2C_Master_Receive(&mpu_i2c_comm, (uint16_t)(MPU_ADDR_USED << 1), (uint8_t*)&data_register, 2, HAL_MAX_DELAY);
+	__MPU_READ(FIFO_R_W, 2, data_register, MPU_ADDR_USED);		/* Queued writes go first, the read is counted at busStats */
 
 	to_return = ((uint16_t)(data_register[0]  << 8)) | data_register[1];
 	return to_return;
 }
 
-
 /*
- *@brief: Device information for Magnetometer
- *@param: None
- *@retval: Device information for Magnetometer
+ * @brief:  Internal driver function, number of bytes that one sample takes at fifo according with the components enabled at FIFO_EN
+ * @param:  components - Bits of FIFO_EN that are enabled, see @MPU_FifoConfig
+ * @retval: Size of one fifo frame in bytes
  */
+static uint8_t FifoFrameSize(uint8_t components){
 
-uint8_t MPU_MagGetInfo(){
+	uint8_t frame_size = 0;
 
-	uint8_t info;
+	if(components & (1 << 7))	frame_size += 2;			/* Temperature */
+	if(components & (1 << 6))	frame_size += 2;			/* Gyro X */
+	if(components & (1 << 5))	frame_size += 2;			/* Gyro Y */
+	if(components & (1 << 4))	frame_size += 2;			/* Gyro Z */
+	if(components & (1 << 3))	frame_size += 6;			/* Accel, all axis */
 
-	__MAG_READ(INFO, 1, &info);
-	return info;
+	return frame_size;
 }
 
-
 /*
- *@brief: Register status 1 for magnetometer
- *		  BIT 0: DRDY (Data Ready) = "0" Normal; "1" Data is ready
- *		  		 Bit turns "1" when data is ready in single measurement mode or self-test mode. It returns "0" when any one of ST2 register or measurement
- *		  		 data register (HXL to HZH) is read
- *		  BIT 1: DOR (Data Overrun) = "0" Normal; "1" Data overrun
- *		  		 DOR bit turns to "1" when data has been skipped in continuous measurement mode or external trigger measurement model mode. It returns to "0"
- *		  		 when any one of ST2 register or measurement data register is read
- *@param: None
- *@retval: One byte of data with BIT 0 and BIT 1 with meaningful data has described above
+ * @brief:  Internal driver function, places the raw counts of one frame at position i of the batch arrays
+ * 			Frame data comes in register address order: accel, temperature, gyro x, gyro y, gyro z
+ * @param:  frame - First byte of the frame
+ * 			components - Bits of FIFO_EN that are present at the frame
+ * 			batch - Destination arrays
+ * 			i - Position at the batch arrays
+ * @retval: None
  */
-uint8_t MPU_MagGetStatus1(){
+static void BatchFrameDecode(uint8_t frame[], uint8_t components, MPU_SOA_BATCH *batch, uint16_t i){
 
-	uint8_t status;
+	uint8_t k = 0;
 
-	__MAG_READ(ST1,1,&status);
-	return status;
+	if(components & (1 << 3)){
+		batch->ax[i] = (int16_t)(frame[0] << 8 | frame[1]);
+		batch->ay[i] = (int16_t)(frame[2] << 8 | frame[3]);
+		batch->az[i] = (int16_t)(frame[4] << 8 | frame[5]);
+		k = 6;
+	}
+	if(components & (1 << 7)){
+		if(batch->temp != NULL)
+			batch->temp[i] = (int16_t)(frame[k] << 8 | frame[k + 1]);
+		k += 2;
+	}
+	if(components & (1 << 6)){
+		batch->gx[i] = (int16_t)(frame[k] << 8 | frame[k + 1]);
+		k += 2;
+	}
+	if(components & (1 << 5)){
+		batch->gy[i] = (int16_t)(frame[k] << 8 | frame[k + 1]);
+		k += 2;
+	}
+	if(components & (1 << 4)){
+		batch->gz[i] = (int16_t)(frame[k] << 8 | frame[k + 1]);
+	}
 }
 
 /*
- *@brief: Register status 2 for magnetometer
- *		BIT 3: HOFL (Magnetic sensor overflow) = "0" Normal; "1" Magnetic sensor overflow occurred
- *				In single measurement mode, continuous measurement mode, external trigger measurement mode and self-test mode, magnetic
- *				sensor may overflow even though measurement data register is not saturated. In this case, measurement data is not correct and HOFL
- *s				bit turns to “1”. When next measurement stars, it returns to “0”
- *		BIT 4: BITM (Output bit setting (mirror) ) = "0" 14-bit output; "1" 16-bit output
- *				Mirror data of BIT bit of CNTL1 register. ST2 register has a role as data reading end register, also. When any of measurement data
- *				register is read in continuous measurement mode or external trigger measurement mode, it means data reading start and taken as  data
- *				reading  until  ST2  register  is  read.  Therefore,  when  any  of  measurement  data  is  read,  be  sure to read ST2 register at the end.
- *
- *@param: None
- *@retval: One byte of data with BIT 3 and BIT 4 with meaningful data has described above
- *
+ * @brief:  Internal driver function, converts in place the raw counts of the batch arrays to calibrated data
+ * 			Each channel is converted by its own loop over contiguous memory, so the compiler can vectorize it
+ * @param:  batch - Arrays holding raw counts
+ * 			count - Number of samples to convert
+ * 			components - Bits of FIFO_EN that are present at the batch
+ * @retval: None
  */
-uint8_t MPU_MagGetStatus2(){
+static void BatchConvert(MPU_SOA_BATCH *batch, uint16_t count, uint8_t components){
+
+	float accel_scale = (USE_SI ? SI_ACCELERATION : 1.0) / accel_sensitivity_used;
+	float gyro_scale  = 1.0 / gyro_sensitivity_used;
+	float *p = accelCalibrationParam;
+	float x, y, z;
+	uint16_t i;
+
+	if(components & (1 << 3)){
+		for(i = 0; i < count; i++){
+			x = batch->ax[i] * accel_scale;
+			y = batch->ay[i] * accel_scale;
+			z = batch->az[i] * accel_scale;
+
+			batch->ax[i] = x * p[0] + y * p[3] + z * p[6] + p[9];		/* Same as matrixMult([x y z 1], accelCalibrationParam) */
+			batch->ay[i] = x * p[1] + y * p[4] + z * p[7] + p[10];
+			batch->az[i] = x * p[2] + y * p[5] + z * p[8] + p[11];
+		}
+	}
+	if(components & (1 << 6)){
+		for(i = 0; i < count; i++)
+			batch->gx[i] = batch->gx[i] * gyro_scale - gyroxStaticBias;
+	}
+	if(components & (1 << 5)){
+		for(i = 0; i < count; i++)
+			batch->gy[i] = batch->gy[i] * gyro_scale - gyroyStaticBias;
+	}
+	if(components & (1 << 4)){
+		for(i = 0; i < count; i++)
+			batch->gz[i] = batch->gz[i] * gyro_scale - gyrozStaticBias;
+	}
+	if((components & (1 << 7)) && batch->temp != NULL){
+		for(i = 0; i < count; i++)
+			batch->temp[i] = batch->temp[i] / TEMP_SENSITIVITY + 21;
 
-	uint8_t status;
+		if(tempBiasEnabled && (components & 0x78) == 0x78){			/* Per sample compensation needs accel and all gyro axis */
+			float accel[3], gyro[3];
 
-	__MAG_READ(ST2, 1, &status);
-	return status;
-}
+			for(i = 0; i < count; i++){
+				accel[0] = batch->ax[i];	accel[1] = batch->ay[i];	accel[2] = batch->az[i];
+				gyro[0]  = batch->gx[i];	gyro[1]  = batch->gy[i];	gyro[2]  = batch->gz[i];
 
-/*
- *@brief: Measurement data of magnetic sensor X-axis/Y-axis/Z-axis
+				TempBiasCompensate(batch->temp[i], accel, gyro);
+
+				batch->ax[i] = accel[0];	batch->ay[i] = accel[1];	batch->az[i] = accel[2];
+				batch->gx[i] = gyro[0];		batch->gy[i] = gyro[1];		batch->gz[i] = gyro[2];
+			}
+		}
+	}
+}
+
+/*
+ * @brief:  Internal driver function, zeroes the arrays from the last valid sample until the next multiple of 4,
+ * 			so SIMD kernels can always process whole blocks
+ */
+static void BatchPad(MPU_SOA_BATCH *batch){
+
+	for(uint16_t i = batch->length; i < MPU_BATCH_PADDED(batch->length) && i < batch->capacity; i++){
+		batch->ax[i] = batch->ay[i] = batch->az[i] = 0;
+		batch->gx[i] = batch->gy[i] = batch->gz[i] = 0;
+		if(batch->temp != NULL)
+			batch->temp[i] = 0;
+	}
+}
+
+/*
+ * @brief:  Drain the fifo into caller structure of arrays buffers
+ * 			The frame layout is taken from the components enabled at @MPU_FifoConfig, each burst reads as many whole frames as fits at
+ * 			FIFO_MAX_BURST_BYTES. Channels that are not enabled at fifo are not written
+ * @param:  batch - Arrays where data will be placed, see @MPU_SOA_BATCH. Use MPU_BATCH_BUFFER to declare aligned and padded arrays
+ * @retval: Number of samples placed at the batch (also at batch->length)
+ */
+uint16_t MPU_FifoReadBatch(MPU_SOA_BATCH *batch){
+
+	MPU_FifoReadBatchRaw(batch);
+	MPU_BatchConvert(batch);
+
+	return batch->length;
+}
+
+/*
+ * @brief:  Same as @MPU_FifoReadBatch, but the arrays keep the raw ADC counts (as float) of each channel
+ * 			Used when the stream is filtered before the conversion, see @MPU_BatchConvert
+ * @param:  batch - Arrays where data will be placed, see @MPU_SOA_BATCH
+ * @retval: Number of samples placed at the batch (also at batch->length)
+ */
+uint16_t MPU_FifoReadBatchRaw(MPU_SOA_BATCH *batch){
+
+	uint8_t components = FIFO_EN.data_cmd & 0xF8;
+	uint8_t aux_bytes = MPU_AuxFifoBytes();
+	uint8_t frame_size = FifoFrameSize(components) + aux_bytes;		/* External sensor bytes close each frame */
+	uint8_t burst[FIFO_MAX_BURST_BYTES];
+	uint16_t frames_to_read, frames_per_burst, n;
+
+	batch->length = 0;
+	batch->ext_size = aux_bytes;
+
+	if(frame_size == 0)
+		return 0;
+
+	MPU_BUS_LOCK();											/* Count and drain must see the same fifo */
+
+	frames_to_read = MPU_FifoCounter() / frame_size;
+	if(frames_to_read > batch->capacity)
+		frames_to_read = batch->capacity;
+
+	frames_per_burst = FIFO_MAX_BURST_BYTES / frame_size;
+
+	for(uint16_t i = 0; i < frames_to_read; i += n){
+
+		n = frames_to_read - i;
+		if(n > frames_per_burst)
+			n = frames_per_burst;
+
+		__MPU_READ(FIFO_R_W, n * frame_size, burst, MPU_ADDR_USED);
+
+		for(uint16_t j = 0; j < n; j++){
+			BatchFrameDecode(&burst[j * frame_size], components, batch, i + j);
+			if(aux_bytes && batch->ext != NULL)
+				memcpy(&batch->ext[(i + j) * aux_bytes], &burst[(j + 1) * frame_size - aux_bytes], aux_bytes);
+		}
+	}
+
+	MPU_BUS_UNLOCK();
+
+	batch->length = frames_to_read;
+	BatchPad(batch);
+
+	return frames_to_read;
+}
+
+/*
+ * @brief:  Drain whole fifo frames without decoding them, the bytes as they are at the fifo (big endian, external sensor bytes last)
+ * @param:  data - Where the frames will be placed, max_frames * @MPU_FifoFrameBytes bytes
+ * 			max_frames - Maximum number of frames to read
+ * @retval: Number of frames read
+ */
+uint16_t MPU_FifoReadRaw(uint8_t data[], uint16_t max_frames){
+
+	uint8_t frame_size = MPU_FifoFrameBytes();
+	uint16_t frames_to_read, frames_per_burst, n;
+
+	if(frame_size == 0)
+		return 0;
+
+	MPU_BUS_LOCK();											/* Count and drain must see the same fifo */
+
+	frames_to_read = MPU_FifoCounter() / frame_size;
+	if(frames_to_read > max_frames)
+		frames_to_read = max_frames;
+
+	frames_per_burst = FIFO_MAX_BURST_BYTES / frame_size;
+
+	for(uint16_t i = 0; i < frames_to_read; i += n){
+
+		n = frames_to_read - i;
+		if(n > frames_per_burst)
+			n = frames_per_burst;
+
+		__MPU_READ(FIFO_R_W, n * frame_size, &data[i * frame_size], MPU_ADDR_USED);
+	}
+
+	MPU_BUS_UNLOCK();
+
+	return frames_to_read;
+}
+
+/*
+ * @brief:  Bytes of one fifo frame with the components enabled at @MPU_FifoConfig and the slaves of @MPU_AuxAttach
+ * @param:  None
+ * @retval: Frame size in bytes
+ */
+uint8_t MPU_FifoFrameBytes(){
+
+	return FifoFrameSize(FIFO_EN.data_cmd & 0xF8) + MPU_AuxFifoBytes();
+}
+
+/*
+ * @brief:  Convert in place batch->length samples of raw ADC counts to calibrated data, for the channels enabled at fifo
+ * 			The counts do not need to be integers, so filtered or decimated counts can be converted at the lower rate
+ * @param:  batch - Arrays holding raw counts
+ * @retval: None
+ */
+void MPU_BatchConvert(MPU_SOA_BATCH *batch){
+
+	BatchConvert(batch, batch->length, FIFO_EN.data_cmd & 0xF8);
+}
+
+/*
+ * @brief:  Read consecutive samples from the data registers into caller structure of arrays buffers
+ * 			Each sample is one 14 bytes burst (accel, temperature and gyro) taken after the raw data ready bit of INT_STATUS
+ * @param:  batch - Arrays where data will be placed, see @MPU_SOA_BATCH
+ * 			numberOfSamples - Number of samples to read, limited by batch->capacity
+ * @retval: Number of samples placed at the batch (also at batch->length), fewer than requested when one data ready did not come
+ * 			in two periods of the configured rate (@MPU_SampleRateNominal)
+ */
+uint16_t MPU_BurstReadBatch(MPU_SOA_BATCH *batch, uint16_t numberOfSamples){
+
+	uint8_t return_data[14];
+	uint32_t timeout_ms = 2000 / MPU_SampleRateNominal() + 1;
+	uint16_t i;
+
+	if(numberOfSamples > batch->capacity)
+		numberOfSamples = batch->capacity;
+
+	for(i = 0; i < numberOfSamples; i++){
+
+		if(!WaitDataReady(timeout_ms))
+			break;
+
+		__MPU_READ(ACCEL_XOUT_H, 14, return_data, MPU_ADDR_USED);
+		BatchFrameDecode(return_data, 0xF8, batch, i);
+	}
+
+	BatchConvert(batch, i, 0xF8);
+	batch->length = i;
+	BatchPad(batch);
+
+	return i;
+}
+
+
+/*
+ *@brief: Device information for Magnetometer
+ *@param: None
+ *@retval: Device information for Magnetometer
+ */
+
+uint8_t MPU_MagGetInfo(){
+
+	uint8_t info;
+
+	__MAG_READ(INFO, 1, &info);
+	return info;
+}
+
+
+/*
+ *@brief: Register status 1 for magnetometer
+ *		  BIT 0: DRDY (Data Ready) = "0" Normal; "1" Data is ready
+ *		  		 Bit turns "1" when data is ready in single measurement mode or self-test mode. It returns "0" when any one of ST2 register or measurement
+ *		  		 data register (HXL to HZH) is read
+ *		  BIT 1: DOR (Data Overrun) = "0" Normal; "1" Data overrun
+ *		  		 DOR bit turns to "1" when data has been skipped in continuous measurement mode or external trigger measurement model mode. It returns to "0"
+ *		  		 when any one of ST2 register or measurement data register is read
+ *@param: None
+ *@retval: One byte of data with BIT 0 and BIT 1 with meaningful data has described above
+ */
+uint8_t MPU_MagGetStatus1(){
+
+	uint8_t status;
+
+	__MAG_READ(ST1,1,&status);
+	return status;
+}
+
+/*
+ *@brief: Register status 2 for magnetometer
+ *		BIT 3: HOFL (Magnetic sensor overflow) = "0" Normal; "1" Magnetic sensor overflow occurred
+ *				In single measurement mode, continuous measurement mode, external trigger measurement mode and self-test mode, magnetic
+ *				sensor may overflow even though measurement data register is not saturated. In this case, measurement data is not correct and HOFL
+ *s				bit turns to “1”. When next measurement stars, it returns to “0”
+ *		BIT 4: BITM (Output bit setting (mirror) ) = "0" 14-bit output; "1" 16-bit output
+ *				Mirror data of BIT bit of CNTL1 register. ST2 register has a role as data reading end register, also. When any of measurement data
+ *				register is read in continuous measurement mode or external trigger measurement mode, it means data reading start and taken as  data
+ *				reading  until  ST2  register  is  read.  Therefore,  when  any  of  measurement  data  is  read,  be  sure to read ST2 register at the end.
+ *
+ *@param: None
+ *@retval: One byte of data with BIT 3 and BIT 4 with meaningful data has described above
+ *
+ */
+uint8_t MPU_MagGetStatus2(){
+
+	uint8_t status;
+
+	__MAG_READ(ST2, 1, &status);
+	return status;
+}
+
+/*
+ *@brief: Measurement data of magnetic sensor X-axis/Y-axis/Z-axis
   *	Steps accordingly with Ak8963 Datasheet (Rev. 2013/10):
  *		1) Check data ready of not by any of the following method.
  *		   - Polling DRDY bit of ST1 register
@@ -1199,57 +2239,249 @@ uint8_t MPU_MagGetStatus2(){
  *@retval: information that is coming from MPU magnetometer em uT
  */
 float MPU_MagRead(AXIS axis){
-	float to_return = -60000;
 
-	uint8_t st;
+	uint8_t axis_bit = 1 << AxisIndex(axis);
+	float value = -60000;						/* No new data available */
 
-	__MAG_READ(ST1, 1, &st);
+	MPU_BUS_LOCK();
 
-	if(!flagAccelCalibrated)
-	{
-		M_OSx = M_OSy = M_OSz = 0;
-		M_SCx = M_SCy = M_SCz = 1;
+	if(!(magAxisConsumed & axis_bit) || (!magSchedulerActive && MPU_MagReadVector(magVectorCache))){
+		magAxisConsumed |= axis_bit;
+		magSchedulerFresh = 0;					/* With the scheduler the tick refills the cache, its sample is not new again */
+		value = magVectorCache[AxisIndex(axis)];
 	}
 
-	if(st & 0x01){							/* Check if DRDY bit was set to 1 */
+	MPU_BUS_UNLOCK();
+
+	return value;
+}
+
+/*
+ *@brief: Read the three magnetometer axis at once
+ *		  ST1, measurement data and ST2 are read by only one SLV0 transaction of 8 bytes, so ST2 always closes the data reading
+ *		  as the AK8963 requires and the three axis come from the same measurement
+ *@param: mag_data - Three element float vector where magnetometer data in uT will be placed, it is not changed if there is no new data
+ *@retval: 1 if new data was placed at mag_data, 0 if DRDY was not set or the magnetic sensor overflowed (HOFL)
+ */
+uint8_t MPU_MagReadVector(float mag_data[]){
 
-		uint8_t mag_vet[2];
+	uint8_t mag_return[8];
+	uint8_t new_data = 0;
 
-		if(axis == X_AXIS){
-			int16_t magx;
+	MPU_BUS_LOCK();										/* SLV0 programming and EXT_SENS_DATA must not be interleaved */
 
-		   __MAG_READ(HXL, 2, mag_vet);
+	if(magSchedulerActive){								/* The scheduler owns the AK8963, only hand over its last sample */
+		if(magSchedulerFresh){
+			memcpy(mag_data, magVectorCache, sizeof(magVectorCache));
+			magSchedulerFresh = 0;
+			new_data = 1;
+		}
+	}
+	else{
+		__MAG_READ(ST1, 8, mag_return);					/* ST1, HXL, HXH, HYL, HYH, HZL, HZH, ST2 */
 
-			magx = mag_vet[1] << 8 | mag_vet[0];
-			to_return = AK8963_SENSITIVITY * magx * magx_Adj;
-			to_return = (to_return - M_OSx)/M_SCx;
+		if((mag_return[0] & 0x01) && !(mag_return[7] & 0x08)){
+			MagVectorTransform(mag_return, mag_data);
 
+			memcpy(magVectorCache, mag_data, sizeof(magVectorCache));
+			magAxisConsumed = 0;
+			new_data = 1;
 		}
-		else if(axis == Y_AXIS){
-			int16_t magy;
+	}
+
+	MPU_BUS_UNLOCK();
+
+	return new_data;
+}
+
+/*
+ *@brief: Internal driver function, converts the AK8963 ST1..ST2 bytes to calibrated magnetic field in uT
+ */
+static void MagVectorTransform(uint8_t mag_return[], float mag_data[]){
+
+	float raw_mag_data[3];
 
-			__MAG_READ(HYL, 2, mag_vet);
+	raw_mag_data[0] = (int16_t)(mag_return[1] | mag_return[2] << 8);
+	raw_mag_data[1] = (int16_t)(mag_return[3] | mag_return[4] << 8);
+	raw_mag_data[2] = (int16_t)(mag_return[5] | mag_return[6] << 8);
+
+	for(uint8_t i = 0; i < 3; i++)							/* One matrix-vector multiply-add, sensitivity and calibration are folded in */
+		mag_data[i] = magCorrection[i][0] * raw_mag_data[0] + magCorrection[i][1] * raw_mag_data[1] + magCorrection[i][2] * raw_mag_data[2] + magBias[i];
+}
 
-			magy = mag_vet[1] << 8 | mag_vet[0];
-			to_return = AK8963_SENSITIVITY * magy * magy_Adj;
-			to_return = (to_return - M_OSy)/M_SCy;
-		}else{
-			int16_t magz;
+/*
+ * @brief: Internal driver function, folds the sensitivity, the ASA adjust and the ellipsoid correction into magCorrection and magBias
+ * 		   Must be called when any of them changes
+ */
+static void MagCorrectionUpdate(){
 
-			 __MAG_READ(HZL, 2, mag_vet);
+	float adjust[3] = {AK8963_SENSITIVITY * magx_Adj, AK8963_SENSITIVITY * magy_Adj, AK8963_SENSITIVITY * magz_Adj};
 
-			magz = mag_vet[1] << 8 | mag_vet[0];
-			to_return = AK8963_SENSITIVITY * magz * magz_Adj;
-			to_return = (to_return - M_OSz)/M_SCz;
+	for(uint8_t i = 0; i < 3; i++){
+		magBias[i] = 0;
+		for(uint8_t j = 0; j < 3; j++){
+			magCorrection[i][j] = magSoftIron[i][j] * adjust[j];
+			magBias[i] -= magSoftIron[i][j] * magHardIron[j];
 		}
-		__MAG_READ(ST2, 1, &st);
 	}
+}
+
+/*
+ *@brief: Start the magnetometer scheduler. The AK8963 leaves the continuous mode and each measurement is requested by the MPU:
+ *		  - SLV0 reads ST1 to ST2 (8 bytes) into EXT_SENS_DATA_00..07
+ *		  - SLV4 is programmed with a CNTL1 write of single measurement mode, each enable of I2C_SLV4_CTRL makes one write
+ *		  Both are delayed slaves with I2C_MST_DLY = divisor - 1, so the MPU accesses them at the same sample every divisor samples:
+ *		  SLV0 reads the measurement triggered at the last access, then SLV4 triggers the next one. A read of the data or of ST2
+ *		  clears DRDY, with a read at every sample only one sample would hold it; this way EXT_SENS_DATA keeps ST1 DRDY of a
+ *		  finished measurement until the next access.
+ *		  @MPU_MagSchedulerTick must be called once per accel/gyro sample (data ready path). Every divisor samples it takes the last
+ *		  access and arms SLV4 again, so the mag rate is imu_rate_hz/divisor, the latency is divisor to 2 * divisor samples and each
+ *		  measurement is returned once.
+ *		  While the scheduler runs, do not use __MAG_WRITE/__MAG_READ, they reprogram SLV0, nor @MPU_AuxSetDelay: I2C_MST_DLY is the
+ *		  one of the scheduler, the delayed aux slaves are also read every divisor samples. It is restored by @MPU_MagSchedulerStop
+ *@param: divisor - Number of accel/gyro samples between two magnetometer samples, 3 to 32
+ *		  imu_rate_hz - Accel/gyro output data rate configured at SMPLRT_DIV/CONFIG
+ *@retval: MAG_SCHEDULER_OK, MAG_SCHEDULER_TOO_FAST if one measurement does not fit at divisor samples or MAG_SCHEDULER_TOO_SLOW
+ */
+uint8_t MPU_MagSchedulerStart(uint8_t divisor, float imu_rate_hz){
+
+	if(divisor < 3 || (divisor - 2) * 1000.0 / imu_rate_hz < MAG_MEASUREMENT_TIME_MS)		/* Trigger and read back take one sample each */
+		return MAG_SCHEDULER_TOO_FAST;
+
+	if(divisor > 32)
+		return MAG_SCHEDULER_TOO_SLOW;
+
+	MPU_BUS_LOCK();										/* No other SLV0 or SLV4 access until the scheduler runs */
+
+	CNTL1.data_cmd = MAG_POWER_DOWN;
+	__MAG_WRITE(CNTL1);
+	HAL_Delay(2);										/* Power-down needs 100 us before another mode, plus one sample for the write */
+
+	MPU_BusDeferBegin();
+
+	I2C_SLV0_ADDR.data_cmd = 1 << 7 | AK8963_ADDR;		/* Read ST1..ST2 at every access */
+	I2C_SLV0_REG.data_cmd = ST1.register_address;
+	I2C_SLV0_CTRL.data_cmd = 1 << 7 | 8;
+	__MPU_WRITE(I2C_SLV0_ADDR, MPU_ADDR_USED);
+	__MPU_WRITE(I2C_SLV0_REG, MPU_ADDR_USED);
+	__MPU_WRITE(I2C_SLV0_CTRL, MPU_ADDR_USED);
+
+	I2C_SLV4_ADDR.data_cmd = AK8963_ADDR;				/* Write transaction */
+	I2C_SLV4_REG.data_cmd = CNTL1.register_address;
+	I2C_SLV4_DO.data_cmd = MAG_SINGLE_MEASUREMENT | (_16_BIT << 4);
+	__MPU_WRITE(I2C_SLV4_ADDR, MPU_ADDR_USED);
+	__MPU_WRITE(I2C_SLV4_REG, MPU_ADDR_USED);
+	__MPU_WRITE(I2C_SLV4_DO, MPU_ADDR_USED);
+
+	I2C_MST_DELAY_CTRL.data_cmd |= 1 << 4 | 1 << 0;		/* I2C_SLV4_DLY_EN, I2C_SLV0_DLY_EN */
+	__MPU_WRITE(I2C_MST_DELAY_CTRL, MPU_ADDR_USED);
+
+	MPU_BusDeferEnd();
+
+	magSchedulerDelay = I2C_SLV4_CTRL.data_cmd & 0x1F;
+	magSchedulerDivisor = divisor;
+	magSchedulerCounter = 0;
+	magSchedulerFresh = 0;
+	magSchedulerRawFresh = 0;
+	memset(&magSchedulerStats, 0, sizeof(MPU_MAG_SCHEDULER_STATS));
+	magSchedulerActive = 1;
+
+	I2C_SLV4_CTRL.data_cmd = 1 << 7 | (divisor - 1);	/* First measurement at the next access */
+	__MPU_WRITE(I2C_SLV4_CTRL, MPU_ADDR_USED);
+
+	MPU_BUS_UNLOCK();
+
+	return MAG_SCHEDULER_OK;
+}
+
+/*
+ *@brief: Advance the magnetometer scheduler by one accel/gyro sample, see @MPU_MagSchedulerStart
+ *@param: mag_data - Three element float vector where magnetometer data in uT will be placed when a measurement is due
+ *@retval: 1 if a new measurement was placed at mag_data, 0 otherwise (not due, no DRDY at ST1 or HOFL overflow at ST2, see
+ *		   @MPU_MagSchedulerGetStats)
+ */
+uint8_t MPU_MagSchedulerTick(float mag_data[]){
+
+	uint8_t mag_return[8];
+	uint8_t new_data = 0;
+
+	if(!magSchedulerActive || ++magSchedulerCounter < magSchedulerDivisor)
+		return 0;
+
+	magSchedulerCounter = 0;
+
+	MPU_BUS_LOCK();
+
+	__MPU_READ(EXT_SENS_DATA_00, 8, mag_return, MPU_ADDR_USED);		/* ST1, HXL, HXH, HYL, HYH, HZL, HZH, ST2 */
+
+	I2C_SLV4_CTRL.data_cmd |= 1 << 7;									/* Next measurement */
+	__MPU_WRITE(I2C_SLV4_CTRL, MPU_ADDR_USED);
+
+	magSchedulerStats.due++;
+
+	if(!(mag_return[0] & 0x01))											/* ST1 DRDY, else the bytes are of the last measurement */
+		magSchedulerStats.not_ready++;
+	else if(mag_return[7] & 0x08)
+		magSchedulerStats.overflows++;
+	else{
+		magSchedulerStats.samples++;
 
-	else if(st & 0x10){
-	__MAG_READ(ST2, 1, &st);
+		memcpy(lastMagRaw, &mag_return[1], 6);							/* For @MPU_ReadAllRaw */
+		magSchedulerRawFresh = 1;
+
+		MagVectorTransform(mag_return, mag_data);
+
+		memcpy(magVectorCache, mag_data, sizeof(magVectorCache));
+		magAxisConsumed = 0;
+		magSchedulerFresh = 1;
+		new_data = 1;
 	}
 
-	return to_return;
+	MPU_BUS_UNLOCK();
+
+	return new_data;
+}
+
+/*
+ *@brief: Counters of the magnetometer scheduler since the last @MPU_MagSchedulerStart
+ *@param: stats - Where the counters will be copied
+ *@retval: None
+ */
+void MPU_MagSchedulerGetStats(MPU_MAG_SCHEDULER_STATS *stats){
+
+	memcpy(stats, &magSchedulerStats, sizeof(MPU_MAG_SCHEDULER_STATS));
+}
+
+/*
+ *@brief: Stop the magnetometer scheduler and return the AK8963 to continuous measurement mode 2 (100 Hz)
+ *@param: None
+ *@retval: None
+ */
+void MPU_MagSchedulerStop(){
+
+	MPU_BUS_LOCK();										/* SLV0 and SLV4 are given back only with the AK8963 in continuous mode */
+
+	magSchedulerActive = 0;
+
+	MPU_BusDeferBegin();
+
+	I2C_SLV0_CTRL.data_cmd = 0;
+	__MPU_WRITE(I2C_SLV0_CTRL, MPU_ADDR_USED);
+
+	I2C_SLV4_CTRL.data_cmd = magSchedulerDelay;							/* I2C_MST_DLY of @MPU_AuxSetDelay */
+	__MPU_WRITE(I2C_SLV4_CTRL, MPU_ADDR_USED);
+
+	I2C_MST_DELAY_CTRL.data_cmd &= ~(1 << 4 | 1 << 0);
+	__MPU_WRITE(I2C_MST_DELAY_CTRL, MPU_ADDR_USED);
+
+	MPU_BusDeferEnd();
+
+	HAL_Delay(MAG_MEASUREMENT_TIME_MS);					/* Let a pending single measurement end, the AK8963 is back at power-down after it */
+
+	CNTL1.data_cmd = MAG_CONTINUOUS_MEASUREMENT2 | (_16_BIT << 4);
+	__MAG_WRITE(CNTL1);
+
+	MPU_BUS_UNLOCK();
 }
 
 /*
@@ -1285,307 +2517,1450 @@ static void MPU_MagConfigControl(MPU_MAG_OPMODE mode, MPU_MAG_OUTPUT_SETTING out
 	INT_PIN_CFG.data_cmd = 1 << 1;					//Enable the host to have control over aux pins
 	__MPU_WRITE(INT_PIN_CFG, MPU_ADDR_USED);
 
-	CNTL1.data_cmd = MAG_FUSE_ROOM;
-	__MPU_WRITE(CNTL1, AK8963_ADDR);
+	CNTL1.data_cmd = MAG_FUSE_ROOM;
+	__MPU_WRITE(CNTL1, AK8963_ADDR);
+
+	__MPU_READ(ASAX, 1, &read_sensitity, AK8963_ADDR);
+	magx_Adj = (float)(read_sensitity - 128.0)/256.0 + 1;
+
+	__MPU_READ(ASAY, 1, &read_sensitity, AK8963_ADDR);
+	magy_Adj = (float)(read_sensitity - 128.0)/256.0 + 1;
+
+	__MPU_READ(ASAZ, 1, &read_sensitity, AK8963_ADDR);
+	magz_Adj = (float)(read_sensitity - 128.0)/256.0 + 1;
+
+	CNTL1.data_cmd = MAG_POWER_DOWN;
+	__MPU_WRITE(CNTL1, AK8963_ADDR);
+	HAL_Delay(1);
+
+	CNTL1.data_cmd = mode | (output_mde << 4);
+	__MPU_WRITE(CNTL1, AK8963_ADDR);
+
+	INT_PIN_CFG.data_cmd &= ~(1 << 1);
+	__MPU_WRITE(INT_PIN_CFG, MPU_ADDR_USED);
+
+	I2C_MST_CTRL.data_cmd = 0xD;
+	__MPU_WRITE(I2C_MST_CTRL, MPU_ADDR_USED);					/* Set I2C Master Clock to 400 kHz */
+
+	USER_CTRL.data_cmd |= 1 << 5;					//Enable I2C Master, MPU will directly obtain mag data
+	__MPU_WRITE(USER_CTRL, MPU_ADDR_USED);
+
+	MagCorrectionUpdate();
+}
+
+/*
+ * @brief: This  register  disables  I2C  bus  interface.  I2C  bus  interface  is  enabled  in  default.
+ * Once I2C bus interface is disabled, it is impossible to write other value to I2CDIS register. To enable I2C bus interface,
+ * reset AK8963 or input start condition 8 times continuously
+ * @param: None
+ * @retval: None
+ */
+void MPU_MagI2CDisable(){
+	I2CDIS.data_cmd = 0b00011011;						//AS THE RM defines
+	__MAG_WRITE(I2CDIS);
+}
+
+
+/*
+ *	@brief:	Used to write one specific configuration at magnetometer registers
+ *  @param:	One @MPU_REGISTER specific to the magnetometer
+ *	@retval: None
+ *
+ */
+void __MAG_WRITE(MPU_REGISTER reg_to_write)
+{
+	MPU_BusDeferBegin();
+
+	I2C_SLV0_DO.data_cmd = reg_to_write.data_cmd;	/* DO is not adjacent to the other SLV0 registers, it must be ready before CTRL enables the slave */
+	__MPU_WRITE(I2C_SLV0_DO, MPU_ADDR_USED);
+
+	I2C_SLV0_ADDR.data_cmd = 0 << 7;				/* Start a write transaction */
+	I2C_SLV0_ADDR.data_cmd |= AK8963_ADDR;			/* Puts the magnetometer I2C address at first 7 bits */
+	__MPU_WRITE(I2C_SLV0_ADDR, MPU_ADDR_USED);
+
+	I2C_SLV0_REG.data_cmd = reg_to_write.register_address;
+	__MPU_WRITE(I2C_SLV0_REG, MPU_ADDR_USED);
+
+	I2C_SLV0_CTRL.data_cmd = 0x01 << 7;
+	I2C_SLV0_CTRL.data_cmd |= 0x01;
+	__MPU_WRITE(I2C_SLV0_CTRL, MPU_ADDR_USED);		/* ADDR, REG and CTRL (0x25 to 0x27) go as one burst */
+
+	MPU_BusDeferEnd();
+}
+
+/*
+ *	@brief:	Used to read one specific configuration from magnetometer registers
+ *			While slaves 1 to 3 are attached SLV0 keeps the length AUX_MAG_READ_BYTES, so their EXT_SENS_DATA offsets do not move:
+ *			reads of that length use SLV0 (if it already reads), the others are made byte by byte through SLV4 (not with the
+ *			magnetometer scheduler)
+ *  @param:
+ *  		reg_to_read: @MPU_REGISTER specific to the magnetometer
+ *  		bytes: Number of bytes to be read
+ *  		data_vet: Vetor where data will be placed
+ *	@retval: AUX_OK, AUX_NACK or AUX_TIMEOUT of the SLV4 reads, AUX_INVALID if the read does not fit the attached slaves
+ *			 (data_vet is zeroed)
+ *
+ */
+uint8_t __MAG_READ(MPU_REGISTER reg_to_read, uint8_t bytes, uint8_t data_vet[])
+{
+	uint8_t result = AUX_OK;
+
+	MPU_BUS_LOCK();									/* SLV0 stays programmed for this read until EXT_SENS_DATA is taken */
+
+	if((AuxSlaveLength(1) || AuxSlaveLength(2) || AuxSlaveLength(3)) && (bytes != AUX_MAG_READ_BYTES || !AuxSlaveLength(0))){
+
+		if(bytes > AUX_MAG_READ_BYTES || magSchedulerActive){
+			memset(data_vet, 0, bytes);
+			result = AUX_INVALID;
+		}
+		for(uint8_t i = 0; i < bytes && result == AUX_OK; i++)
+			result = AuxTransferOnce(1 << 7 | AK8963_ADDR, reg_to_read.register_address + i, 0, &data_vet[i]);
+
+		MPU_BUS_UNLOCK();
+		return result;
+	}
+
+	MPU_BusDeferBegin();
+
+	I2C_SLV0_ADDR.data_cmd = 1 << 7;				/* Start a read transaction*/
+	I2C_SLV0_ADDR.data_cmd |= AK8963_ADDR;			/* Puts the magnetometer I2C address at the first 7 bits */
+	__MPU_WRITE(I2C_SLV0_ADDR, MPU_ADDR_USED);			/* Tells for what ext-sensor, mpu will make a read transaction */
+
+	I2C_SLV0_REG.data_cmd = reg_to_read.register_address;			/* What ext-sensor register, mpu will read */
+	__MPU_WRITE(I2C_SLV0_REG, MPU_ADDR_USED);
+
+	I2C_SLV0_CTRL.data_cmd = 0x01 << 7;					/* Enabling reading data from this slave */
+	I2C_SLV0_CTRL.data_cmd |= bytes;					/* Number of bytes to be read from I2C slave 0 */
+	__MPU_WRITE(I2C_SLV0_CTRL, MPU_ADDR_USED);
+
+	MPU_BusDeferEnd();
+
+	HAL_Delay(1);
+
+	__MPU_READ(EXT_SENS_DATA_00, bytes, data_vet, MPU_ADDR_USED);			/* Here i must read EXT_SENS_DATA_0(bytes-1) */
+
+	MPU_BUS_UNLOCK();
+
+	return result;
+}
+
+/*
+ *	@brief:	Calibrate magnetometer data. Move MPU making 8 shaped movements
+ *			A general ellipsoid (hard and soft iron, with cross axis terms) is fitted by least squares:
+ *				a*x^2 + b*y^2 + c*z^2 + 2f*y*z + 2g*x*z + 2h*x*y + 2p*x + 2q*y + 2r*z = 1
+ *			The samples are centered and scaled before the fit, and the 9x9 normal equations are accumulated sample by sample.
+ *			From the fit: center (hard iron) and M = A/k, the ellipsoid matrix normalized to (m - center)^t * M * (m - center) = 1.
+ *			The soft iron correction is sqrt(M) = V * sqrt(D) * V^t, scaled by the geometric mean radius so the output stays in uT.
+ *			The read path then costs one matrix-vector multiply-add per sample, see MagVectorTransform
+ *  @param:
+ *  		numberOfSamples: number of magnetometer samples to be collected
+ *  		uart: A UART_HandleTypeDef to debug
+ *
+ *	@return: 1 if calibrated (see MPU_GetFlagMagCalibrated), 0 if a sample did not come in MAG_CALIB_SAMPLE_TIMEOUT_MS, the memory
+ *			 was not allocated or the fit is not an ellipsoid. The previous correction is cleared in every case
+ */
+uint8_t MPU_MagCalibrate(uint16_t numberOfSamples, UART_HandleTypeDef *uart)
+{
+
+	float *samples = malloc(numberOfSamples * 3 * sizeof(float));
+	float mag[3];
+	float field;
+	uint32_t start;
+
+	char debugBuffer[200];
+
+	flagMagCalibrated = 0;
+	eye(&magSoftIron[0][0], 3, 3);								/* Samples must not be corrected by a previous calibration */
+	memset(magHardIron, 0, sizeof(magHardIron));
+	MagCorrectionUpdate();
+
+	if(samples == NULL)
+		return 0;
+
+	sprintf(debugBuffer, "Starting the sampling process\n");
+	HAL_UART_Transmit(uart, (uint8_t *)debugBuffer, strlen(debugBuffer), HAL_MAX_DELAY);
+
+	for(uint16_t i = 0; i<numberOfSamples; i++)
+	{
+		start = HAL_GetTick();
+		while(!MPU_MagReadVector(mag)){						/* Wait for a new measurement, the three axis come from it */
+			if(HAL_GetTick() - start > MAG_CALIB_SAMPLE_TIMEOUT_MS){
+				free(samples);
+
+				sprintf(debugBuffer, "No magnetometer data, check the continuous mode\n");
+				HAL_UART_Transmit(uart, (uint8_t *)debugBuffer, strlen(debugBuffer), HAL_MAX_DELAY);
+				return 0;
+			}
+		}
+
+		for(uint8_t j = 0; j < 3; j++)
+			samples[i * 3 + j] = mag[j];
+	}
+
+	field = magEllipsoidFit(samples, numberOfSamples, magSoftIron, magHardIron);
+
+	free(samples);
+
+	if(field == 0){
+
+		sprintf(debugBuffer, "Fit is not an ellipsoid, move the sensor over more orientations\n");
+		HAL_UART_Transmit(uart, (uint8_t *)debugBuffer, strlen(debugBuffer), HAL_MAX_DELAY);
+		return 0;
+	}
+
+	MagCorrectionUpdate();
+	flagMagCalibrated = 1;
+
+	sprintf(debugBuffer, "Hard iron: %f %f %f Field: %f uT\n", magHardIron[0], magHardIron[1], magHardIron[2], field);
+	HAL_UART_Transmit(uart, (uint8_t *)debugBuffer, strlen(debugBuffer), HAL_MAX_DELAY);
+
+	return 1;
+}
+
+/*
+ * @brief:  Internal driver function, least squares ellipsoid fit of the magnetometer samples
+ * 			(u - c)^t * A * (u - c) = 1 at unit scale, soft_iron = radius * sqrt(A) maps the ellipsoid to a sphere of the mean radius
+ * @param:  samples - numberOfSamples x 3, row major, uT
+ * 			soft_iron, hard_iron - Correction, only written when the fit is an ellipsoid
+ * @retval: Field (sphere radius) in uT, 0 if the fit is not an ellipsoid
+ */
+static float magEllipsoidFit(const float *samples, uint16_t numberOfSamples, float soft_iron[3][3], float hard_iron[3]){
+
+	float normal[9][9];
+	float inv[9][9];
+	float rhs[9];
+	float v[9];
+	float row[9];
+	float u[3];
+	float centroid[3] = {0, 0, 0};
+	float scale = 0;
+
+	float ellipsoid[3][3], ellipsoidInv[3][3];
+	float center[3];
+	float k;
+	float eigenvectors[3][3], eigenvalues[3];
+	float radius = 1;
+
+	memset(normal, 0, sizeof(normal));
+	memset(rhs, 0, sizeof(rhs));
+
+	for(uint16_t i = 0; i<numberOfSamples; i++)
+	{
+		for(uint8_t j = 0; j < 3; j++)
+			centroid[j] += samples[i * 3 + j] / numberOfSamples;
+	}
+
+	for(uint16_t i = 0; i<numberOfSamples; i++)
+	{
+		for(uint8_t j = 0; j < 3; j++)
+			scale += powf(samples[i * 3 + j] - centroid[j], 2) / numberOfSamples;
+	}
+	scale = sqrtf(scale);										/* RMS distance to the centroid, fit is made at unit scale */
+
+	for(uint16_t i = 0; i<numberOfSamples; i++)
+	{
+		for(uint8_t j = 0; j < 3; j++)
+			u[j] = (samples[i * 3 + j] - centroid[j]) / scale;
+
+		row[0] = u[0] * u[0];		row[1] = u[1] * u[1];		row[2] = u[2] * u[2];
+		row[3] = 2 * u[1] * u[2];	row[4] = 2 * u[0] * u[2];	row[5] = 2 * u[0] * u[1];
+		row[6] = 2 * u[0];			row[7] = 2 * u[1];			row[8] = 2 * u[2];
+
+		for(uint8_t r = 0; r < 9; r++){
+			rhs[r] += row[r];
+			for(uint8_t c = 0; c < 9; c++)
+				normal[r][c] += row[r] * row[c];					/* H^t * H */
+		}
+	}
+
+	/* Last square method */
+	matrixInv(&normal[0][0], &inv[0][0], 9, 9);					/* (H^t * H)^(-1) */
+	matrixMult(&inv[0][0], rhs, v, 9, 9, 1);					/* (H^t * H)^(-1) * H^t * 1 */
+
+	ellipsoid[0][0] = v[0];	ellipsoid[0][1] = v[5];	ellipsoid[0][2] = v[4];
+	ellipsoid[1][0] = v[5];	ellipsoid[1][1] = v[1];	ellipsoid[1][2] = v[3];
+	ellipsoid[2][0] = v[4];	ellipsoid[2][1] = v[3];	ellipsoid[2][2] = v[2];
+
+	matrixInv(&ellipsoid[0][0], &ellipsoidInv[0][0], 3, 3);
+	matrixMult(&ellipsoidInv[0][0], &v[6], center, 3, 3, 1);
+
+	for(uint8_t j = 0; j < 3; j++)
+		center[j] = -center[j];									/* center = -A^(-1) * [p q r]^t */
+
+	k = 1 - (center[0] * v[6] + center[1] * v[7] + center[2] * v[8]);
+
+	for(uint8_t r = 0; r < 3; r++)
+		for(uint8_t c = 0; c < 3; c++)
+			ellipsoid[r][c] /= k;
+
+	symmetricEigen3(ellipsoid, eigenvectors, eigenvalues);
+
+	if(eigenvalues[0] <= 0 || eigenvalues[1] <= 0 || eigenvalues[2] <= 0)
+		return 0;
+
+	for(uint8_t j = 0; j < 3; j++)
+		radius *= 1 / sqrtf(eigenvalues[j]);
+	radius = cbrtf(radius);										/* Geometric mean radius, at unit scale */
+
+	for(uint8_t r = 0; r < 3; r++){
+		for(uint8_t c = 0; c < 3; c++){
+			soft_iron[r][c] = 0;
+			for(uint8_t j = 0; j < 3; j++)
+				soft_iron[r][c] += eigenvectors[r][j] * sqrtf(eigenvalues[j]) * eigenvectors[c][j];
+			soft_iron[r][c] *= radius;
+		}
+		hard_iron[r] = centroid[r] + scale * center[r];
+	}
+
+	return radius * scale;
+}
+
+/*	@brief: Return the magnetometer calibration state
+ *	@param: None
+ *	@retval: Flag that indicates the state of the calibration process
+ */
+uint8_t MPU_GetFlagMagCalibrated()
+{
+	return flagMagCalibrated;
+}
+
+/*	@brief: Copy the magnetometer correction, so it can be stored with the rest of the calibration
+ *			corrected = soft_iron * (field - hard_iron)
+ *	@param: soft_iron - 3x3 row major matrix
+ *			hard_iron - Three element vector in uT
+ *	@retval: None
+ */
+void MPU_MagGetCorrection(float soft_iron[], float hard_iron[])
+{
+	memcpy(soft_iron, magSoftIron, sizeof(magSoftIron));
+	memcpy(hard_iron, magHardIron, sizeof(magHardIron));
+}
+
+/*	@brief: Restore a magnetometer correction previously obtained by @MPU_MagGetCorrection
+ *	@param: soft_iron - 3x3 row major matrix
+ *			hard_iron - Three element vector in uT
+ *	@retval: None
+ */
+void MPU_MagSetCorrection(const float soft_iron[], const float hard_iron[])
+{
+	memcpy(magSoftIron, soft_iron, sizeof(magSoftIron));
+	memcpy(magHardIron, hard_iron, sizeof(magHardIron));
+	MagCorrectionUpdate();
+	flagMagCalibrated = 1;
+}
+
+/*
+ * @brief: Disable one or more MPU components
+ * @param:
+ * 		  disable_accel can be one value of @MPU_DISABLE_AXIS
+ *		  disable_gyroscope can be one value of @MPU_DISABLE_AXIS
+ *
+ * @retval: None
+ */
+void MPU_DisableComponents(MPU_DISABLE_AXIS disable_accel, MPU_DISABLE_AXIS disable_gyroscope){
+
+	PWR_MGMT_2.data_cmd = (disable_accel << 3) | disable_gyroscope;;		//information of what accel axis (last three bits) and gyro axis(first three bits) must be disable
+	__MPU_WRITE(PWR_MGMT_2, MPU_ADDR_USED);
+}
+
+/* @brief:  Reset all gyro, accel and digital temp signal path. This bit also clears all the data sensor registers
+ * @param:  None
+ * @retval: None
+ */
+void MPU_ResetDataRegisters(){
+
+	USER_CTRL.data_cmd |= 1 << 0;
+	__MPU_WRITE(USER_CTRL, MPU_ADDR_USED);
+	USER_CTRL.data_cmd &= ~(1 << 0);
+}
+
+/*
+ * @brief: Reset one or more sensor data path, the sensor register will not be cleared, for this, use @MPU_SignalPathReset
+ * @param: sensor_to_reset: One value of @RESET_SENSOR_SIGNAL_PATH
+ * @retval: None
+ */
+void MPU_SignalPathReset(RESET_SENSOR_SIGNAL_PATH sensor_to_reset){
+
+	SIGNAL_PATH_RESET.data_cmd  = sensor_to_reset;
+	__MPU_WRITE(SIGNAL_PATH_RESET, MPU_ADDR_USED);
+	SIGNAL_PATH_RESET.data_cmd  = 0;
+}
+
+/*
+ *  @brief:  Reset internal registers and restores default settings
+ * @param:  None
+ * @retval: None
+ */
+void MPU_ResetWholeIC(){
+
+	PWR_MGMT_1.data_cmd |= 1 << 7;
+	__MPU_WRITE(PWR_MGMT_1, MPU_ADDR_USED);
+	PWR_MGMT_1.data_cmd &= ~(1 << 7);
+}
+
+/*
+ * @brief:  Hardware self-test of gyroscope, accelerometer and magnetometer
+ * 			1) 1 kHz, 92 Hz DLPF, 250 dps and 2 g. SELF_TEST_SAMPLES bursts are averaged without self-test
+ * 			2) Self-test bits of GYRO_CONFIG and ACCEL_CONFIG set, SELF_TEST_SAMPLES bursts are averaged again
+ * 			3) Response = (2) - (1) is compared with the factory response from the OTP codes at SELF_TEST_X_GYRO..SELF_TEST_Z_ACCEL:
+ * 			   factory = 2620 * 1.01^(code - 1) LSB
+ * 			4) AK8963 self-test: ASTC SELF bit and self-test mode, output checked against the datasheet limits
+ * 			The configuration registers are restored from their shadow values at the end.
+ * 			Every data ready wait is bounded by SELF_TEST_SAMPLE_TIMEOUT_MS, the whole test takes about 2 * SELF_TEST_SAMPLES + 2 * SELF_TEST_SETTLE_MS
+ * 			+ 10 ms. The magnetometer scheduler must not be running (SLV4 is used)
+ * @param:  result - Responses and pass flags of each axis
+ * @retval: 1 if every axis passed, 0 otherwise (also 0 if the data ready timed out)
+ */
+uint8_t MPU_SelfTest(MPU_SELF_TEST_RESULT *result){
+
+	MPU_REGISTER saved[5] = {SMPLRT_DIV, CONFIG, GYRO_CONFIG, ACCEL_CONFIG, ACCEL_CONFIG2};
+	MPU_REGISTER test_config[5] = {SMPLRT_DIV, CONFIG, GYRO_CONFIG, ACCEL_CONFIG, ACCEL_CONFIG2};
+	MPU_REGISTER otp_codes[6] = {SELF_TEST_X_GYRO, SELF_TEST_Y_GYRO, SELF_TEST_Z_GYRO, SELF_TEST_X_ACCEL, SELF_TEST_Y_ACCEL, SELF_TEST_Z_ACCEL};
+	int32_t accel_os[3], gyro_os[3], accel_st[3], gyro_st[3];
+	uint8_t code;
+	uint8_t sampled;
+	float response, factory;
+
+	memset(result, 0, sizeof(MPU_SELF_TEST_RESULT));
+
+	MPU_BUS_LOCK();										/* Test configuration, SLV0 and SLV4 of the magnetometer part are not shared */
+
+	test_config[0].data_cmd = 0;						/* SMPLRT_DIV: 1 kHz */
+	test_config[1].data_cmd = DLPF_CFG2;				/* CONFIG: gyro DLPF 92 Hz */
+	test_config[2].data_cmd = 0;						/* GYRO_CONFIG: 250 dps, FCHOICE_B = 0 */
+	test_config[3].data_cmd = 0;						/* ACCEL_CONFIG: 2 g */
+	test_config[4].data_cmd = DLPF_CFG2;				/* ACCEL_CONFIG2: accel DLPF 92 Hz */
+
+	for(uint8_t i = 0; i < 5; i++)
+		__MPU_WRITE(test_config[i], MPU_ADDR_USED);
+
+	sampled = SelfTestAverage(accel_os, gyro_os);
+
+	test_config[2].data_cmd = 0xE0;						/* XG_ST, YG_ST, ZG_ST */
+	test_config[3].data_cmd = 0xE0;						/* XA_ST, YA_ST, ZA_ST */
+	__MPU_WRITE(test_config[2], MPU_ADDR_USED);
+	__MPU_WRITE(test_config[3], MPU_ADDR_USED);
+	HAL_Delay(SELF_TEST_SETTLE_MS);
+
+	sampled = sampled && SelfTestAverage(accel_st, gyro_st);
+
+	test_config[2].data_cmd = 0;
+	test_config[3].data_cmd = 0;
+	__MPU_WRITE(test_config[2], MPU_ADDR_USED);
+	__MPU_WRITE(test_config[3], MPU_ADDR_USED);
+	HAL_Delay(SELF_TEST_SETTLE_MS);
+
+	for(uint8_t i = 0; i < 5; i++)
+		__MPU_WRITE(saved[i], MPU_ADDR_USED);
+
+	if(!sampled){
+		MPU_BUS_UNLOCK();
+		return 0;
+	}
+
+	for(uint8_t k = 0; k < 3; k++){
+
+		result->gyro_offset[k] = gyro_os[k] / 131.0;
+
+		__MPU_READ(otp_codes[k], 1, &code, MPU_ADDR_USED);
+		response = gyro_st[k] - gyro_os[k];
+
+		if(code != 0){
+			factory = 2620 * powf(1.01, code - 1);
+			result->gyro_response[k] = response / factory;
+			if(result->gyro_response[k] > SELF_TEST_GYRO_MIN_RATIO)
+				result->gyro_pass |= 1 << k;
+		}
+		else{
+			result->gyro_response[k] = fabsf(response) / 131.0;
+			if(result->gyro_response[k] >= SELF_TEST_GYRO_MIN_DPS)
+				result->gyro_pass |= 1 << k;
+		}
+
+		if(fabsf(result->gyro_offset[k]) > SELF_TEST_GYRO_MAX_OFFSET)
+			result->gyro_pass &= ~(1 << k);
+
+		__MPU_READ(otp_codes[k + 3], 1, &code, MPU_ADDR_USED);
+		response = accel_st[k] - accel_os[k];
+
+		if(code != 0){
+			factory = 2620 * powf(1.01, code - 1);
+			result->accel_response[k] = response / factory;
+			if(result->accel_response[k] > SELF_TEST_ACCEL_MIN_RATIO && result->accel_response[k] < SELF_TEST_ACCEL_MAX_RATIO)
+				result->accel_pass |= 1 << k;
+		}
+		else{
+			result->accel_response[k] = fabsf(response) * 1000 / 16384.0;
+			if(result->accel_response[k] > SELF_TEST_ACCEL_MIN_MG && result->accel_response[k] < SELF_TEST_ACCEL_MAX_MG)
+				result->accel_pass |= 1 << k;
+		}
+	}
+
+	result->mag_pass = MagSelfTest(result->mag_response);
+
+	MPU_BUS_UNLOCK();
+
+	return result->gyro_pass == 0x07 && result->accel_pass == 0x07 && result->mag_pass == 0x07;
+}
+
+/*
+ * @brief:  Internal driver function, sums SELF_TEST_SAMPLES accel and gyro bursts and returns the averages (LSB) at the same arrays
+ * @retval: 1 if all of the samples were read, 0 if one data ready timed out
+ */
+static uint8_t SelfTestAverage(int32_t accel_sum[], int32_t gyro_sum[]){
+
+	uint8_t return_data[14];
+
+	memset(accel_sum, 0, 3 * sizeof(int32_t));
+	memset(gyro_sum, 0, 3 * sizeof(int32_t));
+
+	for(uint16_t i = 0; i < SELF_TEST_SAMPLES; i++){
+
+		if(!WaitDataReady(SELF_TEST_SAMPLE_TIMEOUT_MS))
+			return 0;
+
+		__MPU_READ(ACCEL_XOUT_H, 14, return_data, MPU_ADDR_USED);
+
+		for(uint8_t k = 0; k < 3; k++){
+			accel_sum[k] += (int16_t)(return_data[2 * k] << 8 | return_data[2 * k + 1]);
+			gyro_sum[k]  += (int16_t)(return_data[8 + 2 * k] << 8 | return_data[9 + 2 * k]);
+		}
+	}
+
+	for(uint8_t k = 0; k < 3; k++){
+		accel_sum[k] /= SELF_TEST_SAMPLES;
+		gyro_sum[k]  /= SELF_TEST_SAMPLES;
+	}
+
+	return 1;
+}
+
+/*
+ * @brief:  Internal driver function, waits the raw data ready bit of INT_STATUS (RAW_RDY_EN is enabled if needed)
+ * @param:  timeout_ms - Maximum wait, HAL_MAX_DELAY waits forever
+ * @retval: 1 if a new sample is ready, 0 on timeout
+ */
+static uint8_t WaitDataReady(uint32_t timeout_ms){
+
+	uint8_t status;
+	uint32_t start = HAL_GetTick();
+
+	if(!(INT_ENABLE.data_cmd & 0x01)){
+		INT_ENABLE.data_cmd |= 0x01;						/* RAW_RDY_EN, so INT_STATUS reports new samples */
+		__MPU_WRITE(INT_ENABLE, MPU_ADDR_USED);
+	}
+
+	do{
+		__MPU_READ(INT_STATUS, 1, &status, MPU_ADDR_USED);		/* Reading INT_STATUS clears it */
+		if(status & 0x01)
+			return 1;
+	}while(timeout_ms == HAL_MAX_DELAY || HAL_GetTick() - start <= timeout_ms);
+
+	return 0;
+}
+
+/*
+ * @brief:  Internal driver function, one single write to a magnetometer register through SLV4
+ * 			Unlike __MAG_WRITE, SLV4 makes the write only once, so mode changes are not repeated at every sample
+ * @retval: AUX_OK, AUX_NACK or AUX_TIMEOUT
+ */
+static uint8_t MagWriteOnce(MPU_REGISTER reg_to_write){
+
+	return AuxTransferOnce(AK8963_ADDR, reg_to_write.register_address, reg_to_write.data_cmd, NULL);
+}
+
+/*
+ * @brief:  Internal driver function, AK8963 self-test as its datasheet: power-down, ASTC SELF = 1, self-test mode, wait DRDY, read data,
+ * 			ASTC SELF = 0, power-down. The AK8963 is returned to continuous measurement mode 2
+ * @param:  mag_response - Sensitivity adjusted output of each axis
+ * @retval: Pass flags, bit 0 X, bit 1 Y, bit 2 Z. 0 if one SLV4 write of the mode or of ASTC failed
+ */
+static uint8_t MagSelfTest(int16_t mag_response[]){
+
+	uint8_t mag_return[8];
+	uint8_t pass = 0;
+	uint8_t result;
+	uint32_t start;
+
+	CNTL1.data_cmd = MAG_POWER_DOWN;
+	result = MagWriteOnce(CNTL1);
+	HAL_Delay(1);
+
+	ASTC.data_cmd = 1 << 6;
+	if(result == AUX_OK)
+		result = MagWriteOnce(ASTC);
+
+	CNTL1.data_cmd = MAG_SELF_TEST | (_16_BIT << 4);
+	if(result == AUX_OK)
+		result = MagWriteOnce(CNTL1);
+
+	mag_return[0] = 0;
+	start = HAL_GetTick();
+	while(result == AUX_OK && !(mag_return[0] & 0x01) && HAL_GetTick() - start <= MAG_MEASUREMENT_TIME_MS + SELF_TEST_SAMPLE_TIMEOUT_MS)
+		__MAG_READ(ST1, 8, mag_return);					/* ST1, HXL..HZH, ST2 */
+
+	ASTC.data_cmd = 0;									/* Restored even after a failed write, the self-test field must not stay on */
+	if(MagWriteOnce(ASTC) != AUX_OK)
+		result = AUX_NACK;
+
+	CNTL1.data_cmd = MAG_POWER_DOWN;
+	MagWriteOnce(CNTL1);
+	HAL_Delay(1);
+
+	CNTL1.data_cmd = MAG_CONTINUOUS_MEASUREMENT2 | (_16_BIT << 4);
+	MagWriteOnce(CNTL1);
+
+	if(result != AUX_OK || !(mag_return[0] & 0x01))
+		return 0;
+
+	mag_response[0] = (int16_t)(mag_return[1] | mag_return[2] << 8) * magx_Adj;
+	mag_response[1] = (int16_t)(mag_return[3] | mag_return[4] << 8) * magy_Adj;
+	mag_response[2] = (int16_t)(mag_return[5] | mag_return[6] << 8) * magz_Adj;
+
+	if(abs(mag_response[0]) <= MAG_SELF_TEST_XY_LIMIT)
+		pass |= 1 << 0;
+	if(abs(mag_response[1]) <= MAG_SELF_TEST_XY_LIMIT)
+		pass |= 1 << 1;
+	if(mag_response[2] >= MAG_SELF_TEST_Z_MIN && mag_response[2] <= MAG_SELF_TEST_Z_MAX)
+		pass |= 1 << 2;
+
+	return pass;
+}
+
+static void matrixMult(float *m1, float *m2, float *mr, int m1Line, int m1Column, int m2Column)
+{
+	//[a,b] * [b,d] = [a,d]
+    int i, j, k;
+    for (i = 0; i < m1Line; i++) {
+        for (j = 0; j < m2Column; j++) {
+        	mr[i*m2Column + j] = 0;
+            for (k = 0; k < m1Column; k++)
+            	mr[i*m2Column + j] += m1[i*m1Column + k] * m2[k*m2Column + j];
+        }
+    }
+}
+
+static void matrixTransp(float *m1, float *transp, int lines, int columns)
+{
+	for (int i=0;i<lines;i++)
+	{
+		for (int j=0;j<columns;j++)
+		{
+			transp[j*lines + i] = m1[i*columns + j];
+		}
+	}
+
+}
+
+static void matrixInv(float *mfrom, float *inv, int lines, int columns)
+{
+
+	float temp;
+	float *tempS = malloc(lines * columns * sizeof(float));
+
+	matrixCopy(mfrom, tempS, lines, columns);
+	eye(inv, lines, columns);
+
+	for(uint16_t k = 0; k<lines; k++)
+	{
+		temp = tempS[(k * columns + k)];
+		for(uint16_t j = 0; j<lines; j++)
+		{
+			tempS[(k * columns + j)] /= temp;
+			inv[(k * columns + j )] /= temp;
+		}
+		for(uint16_t i = 0; i<lines; i++)
+		{
+			temp = tempS[(i * columns + k)];
+			for(uint16_t j = 0; j<lines; j++)
+			{
+				if(i == k)
+					break;
+
+				tempS[(i*columns + j)] -= tempS[(k*columns + j)] * temp;
+				inv[(i*columns + j)] -= inv[(k*columns + j)] * temp;
+			}
+		}
+	}
+
+	free(tempS);
+}
+
+static void matrixCopy(float *mfrom, float *mto, int lines, int columns)
+{
+
+	for(int i = 0; i<lines; i++)
+	{
+		for(int j = 0; j<columns; j++)
+		{
+			mto[ (i * columns + j ) ] = mfrom[ (i * columns + j) ];
+		}
+	}
+}
+
+/*
+ * @brief: Eigen decomposition of a symmetric 3x3 matrix by cyclic Jacobi rotations, m is destroyed
+ * 		   m = eigenvectors * diag(eigenvalues) * eigenvectors^t, eigenvectors at the columns
+ */
+static void symmetricEigen3(float m[3][3], float eigenvectors[3][3], float eigenvalues[3])
+{
+	float theta, t, c, s, mkp, mkq;
+
+	eye(&eigenvectors[0][0], 3, 3);
+
+	for(uint8_t sweep = 0; sweep < 50; sweep++)
+	{
+		if(fabsf(m[0][1]) + fabsf(m[0][2]) + fabsf(m[1][2]) < 1e-9)
+			break;
+
+		for(uint8_t p = 0; p < 2; p++)
+		{
+			for(uint8_t q = p + 1; q < 3; q++)
+			{
+				if(m[p][q] == 0)
+					continue;
+
+				theta = (m[q][q] - m[p][p]) / (2 * m[p][q]);
+				t = (theta >= 0 ? 1 : -1) / (fabsf(theta) + sqrtf(theta * theta + 1));
+				c = 1 / sqrtf(t * t + 1);
+				s = t * c;
+
+				for(uint8_t k = 0; k < 3; k++)		/* m * J */
+				{
+					mkp = m[k][p];	mkq = m[k][q];
+					m[k][p] = c * mkp - s * mkq;
+					m[k][q] = s * mkp + c * mkq;
+				}
+				for(uint8_t k = 0; k < 3; k++)		/* J^t * m */
+				{
+					mkp = m[p][k];	mkq = m[q][k];
+					m[p][k] = c * mkp - s * mkq;
+					m[q][k] = s * mkp + c * mkq;
+				}
+				for(uint8_t k = 0; k < 3; k++)		/* V * J */
+				{
+					mkp = eigenvectors[k][p];	mkq = eigenvectors[k][q];
+					eigenvectors[k][p] = c * mkp - s * mkq;
+					eigenvectors[k][q] = s * mkp + c * mkq;
+				}
+			}
+		}
+	}
+
+	for(uint8_t i = 0; i < 3; i++)
+		eigenvalues[i] = m[i][i];
+}
+
+static void eye(float *m, int lines, int columns)
+{
+
+	for(int i = 0; i<lines; i++)
+	{
+
+		for(int j = 0; j<columns; j++)
+		{
+			m[(i*columns + j)] = 0;
+
+			if(i == j)
+				m[(i*columns + j)] = 1;
+		}
+	}
+
+}
+
+
+
+/*
+ * @brief:  Attach one external sensor to the MPU i2c master. The MPU reads it at every sample (or every 1 + delay samples) into
+ * 			EXT_SENS_DATA, so the data is taken with the motion data without any other host transaction, see @MPU_AuxBurstRead.
+ * 			The EXT_SENS_DATA bytes are given in slave order, so the offset of one slave changes when a lower slave is attached or
+ * 			detached, see @MPU_AuxDataOffset. While one is attached the magnetometer read of SLV0 keeps AUX_MAG_READ_BYTES (see
+ * 			__MAG_READ), so the offsets do not move with it. Configure the sensor before, with @MPU_AuxWrite
+ * @param:  slave - 1, 2 or 3, slave 0 is used by the magnetometer
+ * 			config - Sensor address, register and length, see @MPU_AUX_SLAVE
+ * @retval: AUX_OK or AUX_INVALID
+ */
+uint8_t MPU_AuxAttach(uint8_t slave, const MPU_AUX_SLAVE *config){
+
+	MPU_REGISTER *slave_addr, *slave_reg, *slave_ctrl;
+	uint8_t used = 0;
+
+	if(slave == 0 || !AuxSlaveRegisters(slave, &slave_addr, &slave_reg, &slave_ctrl))
+		return AUX_INVALID;
+
+	for(uint8_t i = 1; i < 4; i++){
+		if(i != slave)
+			used += AuxSlaveLength(i);
+	}
+	if(AuxSlaveLength(0))
+		used += AUX_MAG_READ_BYTES;								/* The magnetometer read is set to its fixed length below */
+
+	if(config->length == 0 || config->length > AUX_SLAVE_MAX_BYTES || used + config->length > AUX_EXT_SENS_BYTES)
+		return AUX_INVALID;
+
+	slave_addr->data_cmd = 1 << 7 | config->addr;				/* Read transaction */
+	slave_reg->data_cmd = config->reg;
+	slave_ctrl->data_cmd = 1 << 7 | config->length;
+	if(config->swap)
+		slave_ctrl->data_cmd |= 1 << 6;							/* I2C_SLVx_BYTE_SW */
+
+	MPU_BusDeferBegin();
+	if(AuxSlaveLength(0) && AuxSlaveLength(0) != AUX_MAG_READ_BYTES){
+		I2C_SLV0_REG.data_cmd = ST1.register_address;			/* Same read as __MAG_READ will make while the slave is attached */
+		I2C_SLV0_CTRL.data_cmd = (I2C_SLV0_CTRL.data_cmd & 0xF0) | AUX_MAG_READ_BYTES;
+		__MPU_WRITE(I2C_SLV0_REG, MPU_ADDR_USED);
+		__MPU_WRITE(I2C_SLV0_CTRL, MPU_ADDR_USED);
+	}
+	__MPU_WRITE(*slave_addr, MPU_ADDR_USED);
+	__MPU_WRITE(*slave_reg, MPU_ADDR_USED);
+	__MPU_WRITE(*slave_ctrl, MPU_ADDR_USED);
+	MPU_BusDeferEnd();
+
+	if(config->delayed)
+		I2C_MST_DELAY_CTRL.data_cmd |= 1 << slave;				/* I2C_SLVx_DLY_EN */
+	else
+		I2C_MST_DELAY_CTRL.data_cmd &= ~(1 << slave);
+	__MPU_WRITE(I2C_MST_DELAY_CTRL, MPU_ADDR_USED);
+
+	if(slave == 3){
+		if(config->to_fifo)
+			I2C_MST_CTRL.data_cmd |= 1 << 5;					/* SLV_3_FIFO_EN */
+		else
+			I2C_MST_CTRL.data_cmd &= ~(1 << 5);
+		__MPU_WRITE(I2C_MST_CTRL, MPU_ADDR_USED);
+	}
+	else{
+		if(config->to_fifo)
+			FIFO_EN.data_cmd |= 1 << slave;
+		else
+			FIFO_EN.data_cmd &= ~(1 << slave);
+		__MPU_WRITE(FIFO_EN, MPU_ADDR_USED);
+	}
+
+	if(!(USER_CTRL.data_cmd & (1 << 5))){
+		USER_CTRL.data_cmd |= 1 << 5;							/* I2C_MST_EN */
+		__MPU_WRITE(USER_CTRL, MPU_ADDR_USED);
+	}
+
+	return AUX_OK;
+}
+
+/*
+ * @brief:  Stop the periodic read of one external sensor, remove it from fifo and from the delayed slaves
+ * @param:  slave - 1, 2 or 3
+ * @retval: None
+ */
+void MPU_AuxDetach(uint8_t slave){
+
+	MPU_REGISTER *slave_addr, *slave_reg, *slave_ctrl;
+
+	if(slave == 0 || !AuxSlaveRegisters(slave, &slave_addr, &slave_reg, &slave_ctrl))
+		return;
+
+	slave_ctrl->data_cmd = 0;
+	__MPU_WRITE(*slave_ctrl, MPU_ADDR_USED);
+
+	I2C_MST_DELAY_CTRL.data_cmd &= ~(1 << slave);				/* I2C_SLVx_DLY_EN, a later attach starts undelayed */
+	__MPU_WRITE(I2C_MST_DELAY_CTRL, MPU_ADDR_USED);
+
+	if(slave == 3){
+		I2C_MST_CTRL.data_cmd &= ~(1 << 5);
+		__MPU_WRITE(I2C_MST_CTRL, MPU_ADDR_USED);
+	}
+	else{
+		FIFO_EN.data_cmd &= ~(1 << slave);
+		__MPU_WRITE(FIFO_EN, MPU_ADDR_USED);
+	}
+}
+
+/*
+ * @brief:  Rate divider of the slaves attached with delayed = 1, they are read every 1 + delay samples
+ * @param:  delay - I2C_MST_DLY, 0 to 31
+ * @retval: None
+ */
+void MPU_AuxSetDelay(uint8_t delay){
+
+	I2C_SLV4_CTRL.data_cmd = (I2C_SLV4_CTRL.data_cmd & ~0x1F) | (delay & 0x1F);
+	__MPU_WRITE(I2C_SLV4_CTRL, MPU_ADDR_USED);
+}
+
+/*
+ * @brief:  Write one register of an external sensor, only once, through SLV4. Used to configure the sensors before @MPU_AuxAttach
+ * 			Do not use it while the magnetometer scheduler runs, it also uses SLV4
+ * @param:  addr - 7 bits i2c address of the external sensor
+ * 			reg - Register of the external sensor
+ * 			value - Byte to be written
+ * @retval: AUX_OK, AUX_NACK or AUX_TIMEOUT
+ */
+uint8_t MPU_AuxWrite(uint8_t addr, uint8_t reg, uint8_t value){
+
+	return AuxTransferOnce(addr, reg, value, NULL);
+}
+
+/*
+ * @brief:  Read one register of an external sensor, only once, through SLV4. Used for identification and calibration registers
+ * @param:  addr - 7 bits i2c address of the external sensor
+ * 			reg - Register of the external sensor
+ * 			value - Where the byte read will be placed
+ * @retval: AUX_OK, AUX_NACK or AUX_TIMEOUT
+ */
+uint8_t MPU_AuxReadByte(uint8_t addr, uint8_t reg, uint8_t *value){
+
+	return AuxTransferOnce(1 << 7 | addr, reg, 0, value);
+}
+
+/*
+ * @brief:  Position of the bytes of one slave at EXT_SENS_DATA, the enabled slaves fill it in slave order
+ * @param:  slave - 0 to 3
+ * @retval: Offset from EXT_SENS_DATA_00, add 14 for the position at @MPU_AuxBurstRead
+ */
+uint8_t MPU_AuxDataOffset(uint8_t slave){
+
+	uint8_t offset = 0;
+
+	for(uint8_t i = 0; i < slave && i < 4; i++)
+		offset += AuxSlaveLength(i);
+
+	return offset;
+}
+
+/*
+ * @brief:  Last bytes read by one slave
+ * @param:  slave - 0 to 3
+ * 			data - Where the bytes will be placed, the length given at @MPU_AuxAttach
+ * @retval: None
+ */
+void MPU_AuxRead(uint8_t slave, uint8_t data[]){
+
+	MPU_REGISTER ext_data = EXT_SENS_DATA_00;
+	uint8_t length = AuxSlaveLength(slave);
+
+	if(length == 0)
+		return;
+
+	ext_data.register_address += MPU_AuxDataOffset(slave);
+	__MPU_READ(ext_data, length, data, MPU_ADDR_USED);
+}
+
+/*
+ * @brief:  Read the motion data and every external sensor with one burst, EXT_SENS_DATA_00 follows GYRO_ZOUT_L
+ * @param:  raw - At least 14 + AUX_EXT_SENS_BYTES bytes. raw[0..13] accel, temperature and gyro (as ACCEL_XOUT_H onwards),
+ * 			raw[14..] EXT_SENS_DATA, slave n at raw[14 + @MPU_AuxDataOffset(n)]
+ * @retval: Number of bytes read
+ */
+uint8_t MPU_AuxBurstRead(uint8_t raw[]){
+
+	uint8_t length = 14 + MPU_AuxDataOffset(4);
+
+	__MPU_READ(ACCEL_XOUT_H, length, raw, MPU_ADDR_USED);
+
+	return length;
+}
+
+/*
+ * @brief:  Bytes that the external sensors add to each fifo frame, they come after the gyro data in slave order
+ * @param:  None
+ * @retval: Bytes of external sensors at each fifo frame
+ */
+uint8_t MPU_AuxFifoBytes(){
+
+	uint8_t bytes = 0;
+
+	for(uint8_t i = 0; i < 3; i++){
+		if(FIFO_EN.data_cmd & (1 << i))
+			bytes += AuxSlaveLength(i);
+	}
+	if(I2C_MST_CTRL.data_cmd & (1 << 5))
+		bytes += AuxSlaveLength(3);
+
+	return bytes;
+}
+
+/*
+ * @brief:  Internal driver function, shadow registers of slave 0 to 3
+ * @retval: 1 if the slave exists, 0 otherwise
+ */
+static uint8_t AuxSlaveRegisters(uint8_t slave, MPU_REGISTER **slave_addr, MPU_REGISTER **slave_reg, MPU_REGISTER **slave_ctrl){
+
+	switch(slave){
+	case 0:		*slave_addr = &I2C_SLV0_ADDR;	*slave_reg = &I2C_SLV0_REG;		*slave_ctrl = &I2C_SLV0_CTRL;	break;
+	case 1:		*slave_addr = &I2C_SLV1_ADDR;	*slave_reg = &I2C_SLV1_REG;		*slave_ctrl = &I2C_SLV1_CTRL;	break;
+	case 2:		*slave_addr = &I2C_SLV2_ADDR;	*slave_reg = &I2C_SLV2_REG;		*slave_ctrl = &I2C_SLV2_CTRL;	break;
+	case 3:		*slave_addr = &I2C_SLV3_ADDR;	*slave_reg = &I2C_SLV3_REG;		*slave_ctrl = &I2C_SLV3_CTRL;	break;
+	default:	return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * @brief:  Internal driver function, bytes that one slave places at EXT_SENS_DATA (0 if it is not enabled or is a write)
+ */
+static uint8_t AuxSlaveLength(uint8_t slave){
+
+	MPU_REGISTER *slave_addr, *slave_reg, *slave_ctrl;
+
+	if(!AuxSlaveRegisters(slave, &slave_addr, &slave_reg, &slave_ctrl))
+		return 0;
+
+	if(!(slave_ctrl->data_cmd & (1 << 7)) || !(slave_addr->data_cmd & (1 << 7)))
+		return 0;
+
+	return slave_ctrl->data_cmd & 0x0F;
+}
+
+/*
+ * @brief:  Internal driver function, one single SLV4 transaction, unlike SLV0 to SLV3 it is not repeated at every sample
+ * @param:  slave_addr - 7 bits address, bit 7 set for a read
+ * 			reg - Register of the external sensor
+ * 			value - Byte written (write transaction)
+ * 			data_in - Byte read from I2C_SLV4_DI (read transaction), can be NULL
+ * @retval: AUX_OK, AUX_NACK or AUX_TIMEOUT
+ */
+static uint8_t AuxTransferOnce(uint8_t slave_addr, uint8_t reg, uint8_t value, uint8_t *data_in){
 
-	__MPU_READ(ASAX, 1, &read_sensitity, AK8963_ADDR);
-	magx_Adj = (float)(read_sensitity - 128.0)/256.0 + 1;
+	uint8_t status;
+	uint8_t result = AUX_TIMEOUT;
+	uint32_t start = HAL_GetTick();
 
-	__MPU_READ(ASAY, 1, &read_sensitity, AK8963_ADDR);
-	magy_Adj = (float)(read_sensitity - 128.0)/256.0 + 1;
+	MPU_BUS_LOCK();												/* SLV4 is shared, the transaction must not be interleaved */
 
-	__MPU_READ(ASAZ, 1, &read_sensitity, AK8963_ADDR);
-	magz_Adj = (float)(read_sensitity - 128.0)/256.0 + 1;
+	I2C_SLV4_ADDR.data_cmd = slave_addr;
+	I2C_SLV4_REG.data_cmd = reg;
+	I2C_SLV4_DO.data_cmd = value;
+	I2C_SLV4_CTRL.data_cmd |= 1 << 7;							/* I2C_MST_DLY is kept */
 
-	CNTL1.data_cmd = MAG_POWER_DOWN;
-	__MPU_WRITE(CNTL1, AK8963_ADDR);
-	HAL_Delay(1);
+	MPU_BusDeferBegin();										/* 0x31 to 0x34, one burst */
+	__MPU_WRITE(I2C_SLV4_ADDR, MPU_ADDR_USED);
+	__MPU_WRITE(I2C_SLV4_REG, MPU_ADDR_USED);
+	__MPU_WRITE(I2C_SLV4_DO, MPU_ADDR_USED);
+	__MPU_WRITE(I2C_SLV4_CTRL, MPU_ADDR_USED);
+	MPU_BusDeferEnd();
 
-	CNTL1.data_cmd = mode | (output_mde << 4);
-	__MPU_WRITE(CNTL1, AK8963_ADDR);
+	do{
+		__MPU_READ(I2C_MST_STATUS, 1, &status, MPU_ADDR_USED);
+		if(status & (1 << 4))									/* I2C_SLV4_NACK */
+			result = AUX_NACK;
+		else if(status & (1 << 6))								/* I2C_SLV4_DONE */
+			result = AUX_OK;
+	}while(result == AUX_TIMEOUT && HAL_GetTick() - start <= AUX_TIMEOUT_MS);
 
-	INT_PIN_CFG.data_cmd &= ~(1 << 1);
-	__MPU_WRITE(INT_PIN_CFG, MPU_ADDR_USED);
+	if(result == AUX_OK && data_in != NULL)
+		__MPU_READ(I2C_SLV4_DI, 1, data_in, MPU_ADDR_USED);
 
-	I2C_MST_CTRL.data_cmd = 0xD;
-	__MPU_WRITE(I2C_MST_CTRL, MPU_ADDR_USED);					/* Set I2C Master Clock to 400 kHz */
+	MPU_BUS_UNLOCK();
 
-	USER_CTRL.data_cmd |= 1 << 5;					//Enable I2C Master, MPU will directly obtain mag data
-	__MPU_WRITE(USER_CTRL, MPU_ADDR_USED);
+	return result;
 }
 
 /*
- * @brief: This  register  disables  I2C  bus  interface.  I2C  bus  interface  is  enabled  in  default.
- * Once I2C bus interface is disabled, it is impossible to write other value to I2CDIS register. To enable I2C bus interface,
- * reset AK8963 or input start condition 8 times continuously
- * @param: None
+ * @brief:  Start deferring the register writes: __MPU_WRITE only queues them until the matching @MPU_BusDeferEnd.
+ * 			Calls can be nested, the queue is sent when the outermost one ends. Any register read flushes the queue before it
+ * @param:  None
  * @retval: None
  */
-void MPU_MagI2CDisable(){
-	I2CDIS.data_cmd = 0b00011011;						//AS THE RM defines
-	__MAG_WRITE(I2CDIS);
-}
+void MPU_BusDeferBegin(){
 
+	MPU_BUS_LOCK();									/* Held until the matching MPU_BusDeferEnd, other tasks do not write into the queue */
+	busDeferDepth++;
+}
 
 /*
- *	@brief:	Used to write one specific configuration at magnetometer registers
- *  @param:	One @MPU_REGISTER specific to the magnetometer
- *	@retval: None
- *
+ * @brief:  End one @MPU_BusDeferBegin, the outermost one flushes the queue
+ * @param:  None
+ * @retval: Transactions sent by the flush
  */
-void __MAG_WRITE(MPU_REGISTER reg_to_write)
-{
-	I2C_SLV0_ADDR.data_cmd = 0 << 7;				/* Start a write transaction */
-	I2C_SLV0_ADDR.data_cmd |= AK8963_ADDR;			/* Puts the magnetometer I2C address at first 7 bits */
-	__MPU_WRITE(I2C_SLV0_ADDR, MPU_ADDR_USED);
+uint8_t MPU_BusDeferEnd(){
 
-	I2C_SLV0_REG.data_cmd = reg_to_write.register_address;
-	__MPU_WRITE(I2C_SLV0_REG, MPU_ADDR_USED);
+	uint8_t issued = 0;
 
-	I2C_SLV0_DO.data_cmd = reg_to_write.data_cmd;
-	__MPU_WRITE(I2C_SLV0_DO, MPU_ADDR_USED);
+	if(!busDeferDepth)
+		return 0;
 
-	I2C_SLV0_CTRL.data_cmd = 0x01 << 7;
-	I2C_SLV0_CTRL.data_cmd |= 0x01;
-	__MPU_WRITE(I2C_SLV0_CTRL, MPU_ADDR_USED);
+	if(--busDeferDepth == 0)
+		issued = MPU_BusFlush();
+
+	MPU_BUS_UNLOCK();
+
+	return issued;
 }
 
 /*
- *	@brief:	Used to read one specific configuration from magnetometer registers
- *  @param:
- *  		reg_to_read: @MPU_REGISTER specific to the magnetometer
- *  		bytes: Number of bytes to be read
- *  		data_vet: Vetor where data will be placed
- *	@retval: Error code TODO
- *
+ * @brief:  Queue one register write, sent at the next @MPU_BusFlush
+ * @param:  reg - Register and the value at reg.data_cmd
+ * 			addr - Device i2c address
+ * 			priority - See @MPU_BUS_PRIORITY
+ * @retval: Number of queued operations
  */
-uint8_t __MAG_READ(MPU_REGISTER reg_to_read, uint8_t bytes, uint8_t data_vet[])
-{
-	I2C_SLV0_ADDR.data_cmd = 1 << 7;				/* Start a read transaction*/
-	I2C_SLV0_ADDR.data_cmd |= AK8963_ADDR;			/* Puts the magnetometer I2C address at the first 7 bits */
-	__MPU_WRITE(I2C_SLV0_ADDR, MPU_ADDR_USED);			/* Tells for what ext-sensor, mpu will make a read transaction */
-
-	I2C_SLV0_REG.data_cmd = reg_to_read.register_address;			/* What ext-sensor register, mpu will read */
-	__MPU_WRITE(I2C_SLV0_REG, MPU_ADDR_USED);
+uint8_t MPU_BusQueueWrite(MPU_REGISTER reg, uint8_t addr, MPU_BUS_PRIORITY priority){
 
-	I2C_SLV0_CTRL.data_cmd = 0x01 << 7;					/* Enabling reading data from this slave */
-	I2C_SLV0_CTRL.data_cmd |= bytes;					/* Number of bytes to be read from I2C slave 0 */
-	__MPU_WRITE(I2C_SLV0_CTRL, MPU_ADDR_USED);
-
-	HAL_Delay(1);
+	uint8_t length;
 
-	__MPU_READ(EXT_SENS_DATA_00, bytes, data_vet, MPU_ADDR_USED);			/* Here i must read EXT_SENS_DATA_0(bytes-1) */
+	MPU_BUS_LOCK();
+	BusEnqueue(addr, reg.register_address, reg.data_cmd, 0, NULL, priority);
+	length = busQueueLength;
+	MPU_BUS_UNLOCK();
 
-	return 0;												/*TODO: Error code will be made in the future */
+	return length;
 }
 
 /*
- *	@brief:	Calibrate magnetometer data. Move MPU making 8 shaped movements
- *  @param:
- *  		numberOfSamples: number of magnetometer samples to be collected
- *  		uart: A UART_HandleTypeDef to debug
- *
- *
+ * @brief:  Queue one register read, data_return is filled at the next @MPU_BusFlush.
+ * 			A MPU_BUS_PRIORITY_SAMPLE read is served before the configuration writes queued before it
+ * @param:  reg - First register read
+ * 			number_of_bytes - Bytes read with register auto-increment
+ * 			data_return - Where the bytes will be placed, must be valid until the flush
+ * 			addr - Device i2c address
+ * 			priority - See @MPU_BUS_PRIORITY
+ * @retval: Number of queued operations
  */
-void MPU_MagCalibrate(uint16_t numberOfSamples, UART_HandleTypeDef *uart)
-{
+uint8_t MPU_BusQueueRead(MPU_REGISTER reg, uint8_t number_of_bytes, uint8_t data_return[], uint8_t addr, MPU_BUS_PRIORITY priority){
 
-	float *rawData = malloc(numberOfSamples * 6 * sizeof(float));
-	float *w = malloc(numberOfSamples * sizeof(float));
+	uint8_t length;
 
-	float magX, magY, magZ;
+	MPU_BUS_LOCK();
+	BusEnqueue(addr, reg.register_address, 0, number_of_bytes, data_return, priority);
+	length = busQueueLength;
+	MPU_BUS_UNLOCK();
 
-	char debugBuffer[200];
+	return length;
+}
 
-	sprintf(debugBuffer, "Starting the sampling process\n");
-	HAL_UART_Transmit(uart, (uint8_t *)debugBuffer, strlen(debugBuffer), HAL_MAX_DELAY);
+/*
+ * @brief:  Send the queued operations, higher priority first and in queue order inside the same priority.
+ * 			Consecutive writes to adjacent registers of the same device (same priority) are sent as one auto-increment burst,
+ * 			each read is one transaction with a repeated start
+ * @param:  None
+ * @retval: Transactions sent
+ */
+uint8_t MPU_BusFlush(){
 
-	for(uint i = 0; i<numberOfSamples; i++)
-	{
+	BUS_OPERATION sorted[BUS_QUEUE_SIZE];
+	BUS_OPERATION *op;
+	uint8_t burst[BUS_MAX_BURST + 1];
+	uint8_t length;
+	uint8_t issued = 0;
+	uint8_t n = 0, count;
 
-		magX = MPU_MagRead(X_AXIS);
-		magY = MPU_MagRead(Y_AXIS);
-		magZ = MPU_MagRead(Z_AXIS);
+	MPU_BUS_LOCK();
 
-		rawData[i * numberOfSamples] = magX;
-		rawData[i * numberOfSamples + 1] = magY;
-		rawData[i * numberOfSamples + 2] = magZ;
-		rawData[i * numberOfSamples + 3] = -(magY * magY);
-		rawData[i * numberOfSamples + 4] = -(magZ * magZ);
-		rawData[i * numberOfSamples + 5] = 1;
+	length = busQueueLength;
+	busQueueLength = 0;											/* The reads below must not flush again */
 
-		w[i] = magX * magX;
+	for(uint8_t priority = 0; priority < BUS_PRIORITIES; priority++){	/* Stable order by priority */
+		for(uint8_t i = 0; i < length; i++){
+			if(busQueue[i].priority == priority)
+				sorted[n++] = busQueue[i];
+		}
 	}
 
+	for(uint8_t i = 0; i < length; i += count){
 
-	/* Last square method */
-	float *rawDataT = malloc(6 * numberOfSamples * sizeof(float));
-	float *r1 = malloc(6 * 6 * sizeof(float));
-	float *inv = malloc(6 * 6 * sizeof(float));
-	float *r2 = malloc(6 * numberOfSamples * sizeof(float));
+		op = &sorted[i];
+		count = 1;
 
-	matrixTransp(rawData, rawDataT, numberOfSamples, 6);		/* H^t*/
-	matrixMult(rawDataT, rawData, r1, 6, numberOfSamples, 6);	/* H^t * H */
-	matrixInv(r1, inv, 6, 6);									/* (H^t * H)^(-1) */
-	matrixMult(inv, rawDataT, r2, 6, 6, numberOfSamples);		/* (H^t * H)^(-1) * H^t */
-	matrixMult(r2, w, magCalibrationParam, 6, numberOfSamples, 1);		/* (H^t * H)^(-1) * H^t * w */
+		if(op->number_of_bytes){
+			HAL_I2C_Mem_Read(&mpu_i2c_comm, (uint16_t)(op->addr << 1), op->reg, I2C_MEMADD_SIZE_8BIT, op->data_return, op->number_of_bytes, HAL_MAX_DELAY);
+			busStats.requested += 2;
+		}
+		else{
+			burst[0] = op->reg;
+			burst[1] = op->value;
+
+			while(i + count < length && count < BUS_MAX_BURST && sorted[i + count].number_of_bytes == 0 && sorted[i + count].addr == op->addr
+					&& sorted[i + count].priority == op->priority && sorted[i + count].reg == op->reg + count){
+				burst[count + 1] = sorted[i + count].value;
+				count++;
+			}
 
-	flagMagCalibrated = 1;
+			HAL_I2C_Master_Transmit(&mpu_i2c_comm, (uint16_t)(op->addr << 1), burst, count + 1, HAL_MAX_DELAY);
+			busStats.requested += count;
+			if(count > 1)
+				busStats.bursts++;
+		}
 
-	M_OSx = X0 = magCalibrationParam[0]/2;
-	M_OSy = Y0 = magCalibrationParam[1]/(2 * magCalibrationParam[3]);
-	M_OSz = Z0 = magCalibrationParam[2]/(2 * magCalibrationParam[4]);
+		issued++;
+	}
 
-	A = magCalibrationParam[5] + pow(X0, 2) + magCalibrationParam[3] * pow(Y0, 2) + magCalibrationParam[4] * pow(Z0, 2);
-	B = A / magCalibrationParam[3];
-	C = A / magCalibrationParam[4];
+	busStats.issued += issued;
+	busStats.saved = busStats.requested - busStats.issued;
 
-	M_SCx = sqrt(A);
-	M_SCy = sqrtf(B);
-	M_SCz = sqrt(C);
+	MPU_BUS_UNLOCK();
 
-	free(rawData);
-	free(w);
-	free(rawDataT);
-	free(r1);
-	free(r2);
+	return issued;
 }
 
 /*
- * @brief: Disable one or more MPU components
- * @param:
- * 		  disable_accel can be one value of @MPU_DISABLE_AXIS
- *		  disable_gyroscope can be one value of @MPU_DISABLE_AXIS
- *
+ * @brief:  Transactions counters since the start or the last @MPU_BusResetStats
+ * @param:  stats - Where the counters will be copied
  * @retval: None
  */
-void MPU_DisableComponents(MPU_DISABLE_AXIS disable_accel, MPU_DISABLE_AXIS disable_gyroscope){
+void MPU_BusGetStats(MPU_BUS_STATS *stats){
 
-	PWR_MGMT_2.data_cmd = (disable_accel << 3) | disable_gyroscope;;		//information of what accel axis (last three bits) and gyro axis(first three bits) must be disable
-	__MPU_WRITE(PWR_MGMT_2, MPU_ADDR_USED);
+	busStats.saved = busStats.requested - busStats.issued;
+	memcpy(stats, &busStats, sizeof(MPU_BUS_STATS));
 }
 
-/* @brief:  Reset all gyro, accel and digital temp signal path. This bit also clears all the data sensor registers
+/*
+ * @brief:  Clear the transactions counters
  * @param:  None
  * @retval: None
  */
-void MPU_ResetDataRegisters(){
+void MPU_BusResetStats(){
 
-	USER_CTRL.data_cmd |= 1 << 0;
-	__MPU_WRITE(USER_CTRL, MPU_ADDR_USED);
-	USER_CTRL.data_cmd &= ~(1 << 0);
+	memset(&busStats, 0, sizeof(MPU_BUS_STATS));
 }
 
 /*
- * @brief: Reset one or more sensor data path, the sensor register will not be cleared, for this, use @MPU_SignalPathReset
- * @param: sensor_to_reset: One value of @RESET_SENSOR_SIGNAL_PATH
+ * @brief:  Internal driver function, add one operation to the queue, flushing it first when full
+ */
+static void BusEnqueue(uint8_t addr, uint8_t reg, uint8_t value, uint8_t number_of_bytes, uint8_t *data_return, MPU_BUS_PRIORITY priority){
+
+	BUS_OPERATION *op;
+
+	if(busQueueLength == BUS_QUEUE_SIZE)
+		MPU_BusFlush();
+
+	op = &busQueue[busQueueLength++];
+	op->addr = addr;
+	op->reg = reg;
+	op->value = value;
+	op->number_of_bytes = number_of_bytes;
+	op->data_return = data_return;
+	op->priority = priority;
+}
+
+/*
+ * @brief:  Enable the wake-on-motion interrupt, INT pin and WOM_INT at INT_STATUS when any accel axis changes more than threshold_mg
+ * 			between two samples. It can be the hardware first stage of the event detection of MPU_Motion.h
+ * @param:  threshold_mg - 4 to 1020 mg, 4 mg steps
+ * 			odr - WOM_CONTINUOUS keeps the sampling of the gyro and accel (the data-ready interrupt stays as it was),
+ * 				  other @MPU_WOM_ODR values put the device in the accel only low power cycle at that rate
  * @retval: None
  */
-void MPU_SignalPathReset(RESET_SENSOR_SIGNAL_PATH sensor_to_reset){
+void MPU_WakeOnMotionEnable(uint16_t threshold_mg, MPU_WOM_ODR odr){
 
-	SIGNAL_PATH_RESET.data_cmd  = sensor_to_reset;
-	__MPU_WRITE(SIGNAL_PATH_RESET, MPU_ADDR_USED);
-	SIGNAL_PATH_RESET.data_cmd  = 0;
+	uint16_t threshold = threshold_mg / WOM_THRESHOLD_LSB_MG;
+
+	MPU_BUS_LOCK();
+
+	if(odr != WOM_CONTINUOUS && !womCycle){
+		womSavedPower2 = PWR_MGMT_2.data_cmd;
+		womSavedAccelConfig2 = ACCEL_CONFIG2.data_cmd;
+
+		PWR_MGMT_2.data_cmd = DISABLE_ALL_AXIS;				/* Gyro off, accel on */
+		__MPU_WRITE(PWR_MGMT_2, MPU_ADDR_USED);
+
+		ACCEL_CONFIG2.data_cmd = 1 << 3 | DLPF_CFG1;		/* Sequence of the datasheet, ACCEL_FCHOICE_B and A_DLPF_CFG 1 */
+		__MPU_WRITE(ACCEL_CONFIG2, MPU_ADDR_USED);
+	}
+
+	INT_ENABLE.data_cmd |= WOM_INT_BIT;
+	__MPU_WRITE(INT_ENABLE, MPU_ADDR_USED);
+
+	MOT_DETECT_CTRL.data_cmd = 1 << 7 | 1 << 6;				/* ACCEL_INTEL_EN, ACCEL_INTEL_MODE compare with the previous sample */
+	__MPU_WRITE(MOT_DETECT_CTRL, MPU_ADDR_USED);
+
+	WOM_THR.data_cmd = threshold > 255 ? 255 : (threshold == 0 ? 1 : threshold);
+	__MPU_WRITE(WOM_THR, MPU_ADDR_USED);
+
+	if(odr != WOM_CONTINUOUS){
+		LP_ACCEL_ODR.data_cmd = odr;
+		__MPU_WRITE(LP_ACCEL_ODR, MPU_ADDR_USED);
+
+		PWR_MGMT_1.data_cmd |= 1 << 5;						/* CYCLE */
+		__MPU_WRITE(PWR_MGMT_1, MPU_ADDR_USED);
+		womCycle = 1;
+	}
+
+	MPU_BUS_UNLOCK();
 }
 
 /*
- *  @brief:  Reset internal registers and restores default settings
+ * @brief:  Disable the wake-on-motion interrupt and leave the low power cycle, if it was started
  * @param:  None
  * @retval: None
  */
-void MPU_ResetWholeIC(){
+void MPU_WakeOnMotionDisable(){
 
-	PWR_MGMT_1.data_cmd |= 1 << 7;
-	__MPU_WRITE(PWR_MGMT_1, MPU_ADDR_USED);
-	PWR_MGMT_1.data_cmd &= ~(1 << 7);
-}
+	MPU_BUS_LOCK();
 
-static void matrixMult(float *m1, float *m2, float *mr, int m1Line, int m1Column, int m2Column)
-{
-	//[a,b] * [b,d] = [a,d]
-    int i, j, k;
-    for (i = 0; i < m1Line; i++) {
-        for (j = 0; j < m2Column; j++) {
-        	mr[i*m2Column + j] = 0;
-            for (k = 0; k < m1Column; k++)
-            	mr[i*m2Column + j] += m1[i*m1Column + k] * m2[k*m2Column + j];
-        }
-    }
-}
+	INT_ENABLE.data_cmd &= ~WOM_INT_BIT;
+	__MPU_WRITE(INT_ENABLE, MPU_ADDR_USED);
 
-static void matrixTransp(float *m1, float *transp, int lines, int columns)
-{
-	for (int i=0;i<lines;i++)
-	{
-		for (int j=0;j<columns;j++)
-		{
-			transp[j*lines + i] = m1[i*columns + j];
-		}
+	MOT_DETECT_CTRL.data_cmd = 0;
+	__MPU_WRITE(MOT_DETECT_CTRL, MPU_ADDR_USED);
+
+	if(womCycle){
+		PWR_MGMT_1.data_cmd &= ~(1 << 5);
+		__MPU_WRITE(PWR_MGMT_1, MPU_ADDR_USED);
+
+		PWR_MGMT_2.data_cmd = womSavedPower2;
+		__MPU_WRITE(PWR_MGMT_2, MPU_ADDR_USED);
+
+		ACCEL_CONFIG2.data_cmd = womSavedAccelConfig2;
+		__MPU_WRITE(ACCEL_CONFIG2, MPU_ADDR_USED);
+		womCycle = 0;
 	}
 
+	MPU_BUS_UNLOCK();
 }
 
-static void matrixInv(float *mfrom, float *inv, int lines, int columns)
-{
+/*
+ * @brief:  Read INT_STATUS, reading it clears the interrupt flags (and the INT pin when it is latched)
+ * @param:  None
+ * @retval: INT_STATUS, test WOM_INT_BIT and RAW_RDY_INT_BIT
+ */
+uint8_t MPU_InterruptStatus(){
 
-	float temp;
-	float *tempS = malloc(lines * columns * sizeof(float));
+	uint8_t status;
 
-	matrixCopy(mfrom, tempS, lines, columns);
-	eye(inv, lines, columns);
+	MPU_BUS_LOCK();
+	__MPU_READ(INT_STATUS, 1, &status, MPU_ADDR_USED);
+	MPU_BUS_UNLOCK();
 
-	for(uint16_t k = 0; k<lines; k++)
-	{
-		temp = tempS[(k * columns + k)];
-		for(uint16_t j = 0; j<lines; j++)
-		{
-			tempS[(k * columns + j)] /= temp;
-			inv[(k * columns + j )] /= temp;
-		}
-		for(uint16_t i = 0; i<lines; i++)
-		{
-			temp = tempS[(i * columns + k)];
-			for(uint16_t j = 0; j<lines; j++)
-			{
-				if(i == k)
-					break;
+	return status;
+}
 
-				tempS[(i*columns + j)] -= tempS[(k*columns + j)] * temp;
-				inv[(i*columns + j)] -= inv[(k*columns + j)] * temp;
-			}
-		}
-	}
+/*
+ * @brief:  Check a profile without the device, it can run at the host or before the bus is up
+ * @param:  profile - Profile to be checked
+ * @retval: PROFILE_OK or the first PROFILE_INVALID_* code found
+ */
+uint8_t MPU_ProfileValidate(const MPU_CONFIG_PROFILE *profile){
 
-	free(tempS);
+	if(profile->gyro_scale > GYRO_FULL_SCALE_2000dps || profile->accel_scale > ACCEL_FULL_SCALE_16g)
+		return PROFILE_INVALID_SCALE;
+
+	if(profile->gyro_dlpf > DLPF_CFG7 || profile->accel_dlpf > DLPF_CFG7 || profile->gyro_fchoice_b > 0x03 || profile->accel_fchoice_b > 1)
+		return PROFILE_INVALID_FILTER;
+
+	if((profile->fifo_enable & 0x07) || profile->fifo_mode > 1)
+		return PROFILE_INVALID_FIFO;
+
+	if(profile->clock_source >= 6)
+		return PROFILE_INVALID_CLOCK;
+
+	if(profile->accel_disable > DISABLE_ALL_AXIS || profile->gyro_disable > DISABLE_ALL_AXIS)
+		return PROFILE_INVALID_POWER;
+
+	return PROFILE_OK;
 }
 
-static void matrixCopy(float *mfrom, float *mto, int lines, int columns)
-{
+/*
+ * @brief:  Validate and apply a profile in three burst writes. The shadow registers are rebuilt from it, so no bit of a previous
+ * 			configuration stays, and the sensitivities follow the new scales. The fifo is reset when it is enabled
+ * @param:  profile - Profile to apply
+ * @retval: PROFILE_OK, or the code of @MPU_ProfileValidate and nothing is written
+ */
+uint8_t MPU_ProfileApply(const MPU_CONFIG_PROFILE *profile){
 
-	for(int i = 0; i<lines; i++)
-	{
-		for(int j = 0; j<columns; j++)
-		{
-			mto[ (i * columns + j ) ] = mfrom[ (i * columns + j) ];
-		}
+	uint8_t error = MPU_ProfileValidate(profile);
+
+	if(error != PROFILE_OK)
+		return error;
+
+	MPU_BUS_LOCK();
+
+	SMPLRT_DIV.data_cmd = profile->sample_rate_div;
+	CONFIG.data_cmd = profile->fifo_mode << 6 | profile->gyro_dlpf;
+	GYRO_CONFIG.data_cmd = profile->gyro_scale << 3 | profile->gyro_fchoice_b;
+	ACCEL_CONFIG.data_cmd = profile->accel_scale << 3;
+	ACCEL_CONFIG2.data_cmd = profile->accel_fchoice_b << 3 | profile->accel_dlpf;
+
+	FIFO_EN.data_cmd = (FIFO_EN.data_cmd & 0x07) | profile->fifo_enable;
+
+	USER_CTRL.data_cmd &= 1 << 5;										/* Only I2C_MST_EN is kept, the reset bits clear themselves */
+	if(profile->fifo_enable || (FIFO_EN.data_cmd & 0x07))
+		USER_CTRL.data_cmd |= 1 << 6;									/* FIFO_EN */
+	PWR_MGMT_1.data_cmd = profile->clock_source;
+	PWR_MGMT_2.data_cmd = profile->accel_disable << 3 | profile->gyro_disable;
+
+	AccelScaleConfig(profile->accel_scale);
+	GyroScaleConfig(profile->gyro_scale);
+
+	if(USER_CTRL.data_cmd & (1 << 6)){
+		USER_CTRL.data_cmd |= 1 << 2;									/* FIFO_RST with the same burst, the old frames are dropped */
+		MPU_ProfileReapply();
+		USER_CTRL.data_cmd &= ~(1 << 2);
 	}
+	else
+		MPU_ProfileReapply();
+
+	MPU_BUS_UNLOCK();
+
+	return PROFILE_OK;
 }
 
-static void eye(float *m, int lines, int columns)
-{
+/*
+ * @brief:  Profile of the configuration in use, from the shadow registers, so it can be stored and applied later
+ * @param:  profile - Where the profile will be placed
+ * @retval: None
+ */
+void MPU_ProfileGet(MPU_CONFIG_PROFILE *profile){
+
+	profile->sample_rate_div = SMPLRT_DIV.data_cmd;
+	profile->gyro_dlpf = CONFIG.data_cmd & 0x07;
+	profile->fifo_mode = (CONFIG.data_cmd >> 6) & 0x01;
+	profile->gyro_fchoice_b = GYRO_CONFIG.data_cmd & 0x03;
+	profile->gyro_scale = (GYRO_CONFIG.data_cmd >> 3) & 0x03;
+	profile->accel_scale = (ACCEL_CONFIG.data_cmd >> 3) & 0x03;
+	profile->accel_fchoice_b = (ACCEL_CONFIG2.data_cmd >> 3) & 0x01;
+	profile->accel_dlpf = ACCEL_CONFIG2.data_cmd & 0x07;
+	profile->fifo_enable = FIFO_EN.data_cmd & 0xF8;
+	profile->clock_source = PWR_MGMT_1.data_cmd & 0x07;
+	profile->accel_disable = (PWR_MGMT_2.data_cmd >> 3) & 0x07;
+	profile->gyro_disable = PWR_MGMT_2.data_cmd & 0x07;
+}
 
-	for(int i = 0; i<lines; i++)
-	{
+/*
+ * @brief:  Write the three configuration ranges from the shadow registers, 3 transactions (the bus queue joins adjacent registers)
+ * 			Call it after @MPU_ResetWholeIC (when the device is up again) or when @MPU_ProfileVerify finds a brown-out
+ * @param:  None
+ * @retval: None
+ */
+void MPU_ProfileReapply(){
 
-		for(int j = 0; j<columns; j++)
-		{
-			m[(i*columns + j)] = 0;
+	MPU_BusDeferBegin();
 
-			if(i == j)
-				m[(i*columns + j)] = 1;
-		}
-	}
+	__MPU_WRITE(SMPLRT_DIV, MPU_ADDR_USED);					/* 0x19 to 0x1D */
+	__MPU_WRITE(CONFIG, MPU_ADDR_USED);
+	__MPU_WRITE(GYRO_CONFIG, MPU_ADDR_USED);
+	__MPU_WRITE(ACCEL_CONFIG, MPU_ADDR_USED);
+	__MPU_WRITE(ACCEL_CONFIG2, MPU_ADDR_USED);
+
+	__MPU_WRITE(FIFO_EN, MPU_ADDR_USED);						/* 0x23 to 0x27 */
+	__MPU_WRITE(I2C_MST_CTRL, MPU_ADDR_USED);
+	__MPU_WRITE(I2C_SLV0_ADDR, MPU_ADDR_USED);
+	__MPU_WRITE(I2C_SLV0_REG, MPU_ADDR_USED);
+	__MPU_WRITE(I2C_SLV0_CTRL, MPU_ADDR_USED);
+
+	__MPU_WRITE(USER_CTRL, MPU_ADDR_USED);					/* 0x6A to 0x6C */
+	__MPU_WRITE(PWR_MGMT_1, MPU_ADDR_USED);
+	__MPU_WRITE(PWR_MGMT_2, MPU_ADDR_USED);
 
+	MPU_BusDeferEnd();
 }
 
+/*
+ * @brief:  Read the three configuration ranges back (3 burst reads) and compare them with the shadow registers.
+ * 			After a brown-out or an unexpected reset the device is back at its defaults, call @MPU_ProfileReapply
+ * @param:  None
+ * @retval: 1 if the device holds the configuration, 0 otherwise
+ */
+uint8_t MPU_ProfileVerify(){
+
+	uint8_t sampling[5], fifo[5], power[3];
 
+	MPU_BUS_LOCK();
+	__MPU_READ(SMPLRT_DIV, 5, sampling, MPU_ADDR_USED);
+	__MPU_READ(FIFO_EN, 5, fifo, MPU_ADDR_USED);
+	__MPU_READ(USER_CTRL, 3, power, MPU_ADDR_USED);
+	MPU_BUS_UNLOCK();
+
+	return sampling[0] == SMPLRT_DIV.data_cmd && sampling[1] == CONFIG.data_cmd && sampling[2] == GYRO_CONFIG.data_cmd &&
+		   sampling[3] == ACCEL_CONFIG.data_cmd && sampling[4] == ACCEL_CONFIG2.data_cmd &&
+		   fifo[0] == FIFO_EN.data_cmd && fifo[1] == I2C_MST_CTRL.data_cmd && fifo[2] == I2C_SLV0_ADDR.data_cmd &&
+		   fifo[3] == I2C_SLV0_REG.data_cmd && fifo[4] == I2C_SLV0_CTRL.data_cmd &&
+		   (power[0] & ~0x07) == (USER_CTRL.data_cmd & ~0x07) && (power[1] & ~0x80) == PWR_MGMT_1.data_cmd && power[2] == PWR_MGMT_2.data_cmd;
+}
@@ -0,0 +1,443 @@
+/*
+ * MPU_Ekf.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+/*
+ * Error-state Kalman filter, see MPU_Ekf.h for the model and the cycle budget.
+ * Error convention: R_true = R(q) * (I + [dtheta]x), so a world vector e is seen at the body as v + [v]x * dtheta, v = R(q)^T * e.
+ * No trigonometric function runs at predict or update, the rotation of each step is the normalized quaternion [1, w*dt/2].
+ */
+
+#include "MPU_Ekf.h"
+#include <math.h>
+
+#define EKF_DEG2RAD					0.017453292f
+
+/*
+ * Fixed size products, one function for each size, the loops have constant bounds and the compiler unrolls them
+ */
+#define EKF_DEFINE_MULT(name, N, K, M)																	\
+static inline void name(const float a[N][K], const float b[K][M], float out[N][M]){					\
+	for(uint8_t i = 0; i < N; i++)																		\
+		for(uint8_t j = 0; j < M; j++){																	\
+			float sum = 0;																				\
+			for(uint8_t k = 0; k < K; k++)																\
+				sum += a[i][k] * b[k][j];																\
+			out[i][j] = sum;																			\
+		}																								\
+}
+
+#define EKF_DEFINE_MULT_T(name, N, K, M)																\
+static inline void name(const float a[N][K], const float b[M][K], float out[N][M]){					\
+	for(uint8_t i = 0; i < N; i++)																		\
+		for(uint8_t j = 0; j < M; j++){																	\
+			float sum = 0;																				\
+			for(uint8_t k = 0; k < K; k++)																\
+				sum += a[i][k] * b[j][k];																\
+			out[i][j] = sum;																			\
+		}																								\
+}
+
+#define EKF_DEFINE_MULT_V(name, N, K)																	\
+static inline void name(const float a[N][K], const float v[K], float out[N]){							\
+	for(uint8_t i = 0; i < N; i++){																		\
+		float sum = 0;																					\
+		for(uint8_t k = 0; k < K; k++)																	\
+			sum += a[i][k] * v[k];																		\
+		out[i] = sum;																					\
+	}																									\
+}
+
+EKF_DEFINE_MULT(Mult33, 3, 3, 3)							/* a * b */
+EKF_DEFINE_MULT_T(MultT33, 3, 3, 3)							/* a * b^T */
+EKF_DEFINE_MULT_V(MultV33, 3, 3)							/* a * vector */
+
+#ifdef EKF_CYCLE_COUNTER
+#define EKF_CYCLES_START()			uint32_t cycles_start = (EKF_CYCLE_COUNTER)
+#define EKF_CYCLES_END(worst)		do{ uint32_t cycles = (EKF_CYCLE_COUNTER) - cycles_start; if(cycles > (worst)) (worst) = cycles; }while(0)
+#else
+#define EKF_CYCLES_START()
+#define EKF_CYCLES_END(worst)
+#endif
+
+static void QuaternionMult(const float p[], const float q[], float out[]);
+static void QuaternionNormalize(float q[]);
+static void QuaternionToMatrix(const float q[], float R[3][3]);
+static void Skew(const float v[], float S[3][3]);
+static uint8_t SymmetricInverse(const float a[3][3], float out[3][3]);
+static void Symmetrize(float a[3][3]);
+static uint8_t EkfUpdate(MPU_EKF *ekf, const float predicted[], const float measured[], float variance);
+
+/*
+ * @brief:  Start the filter level with the gravity measured by the accelerometer, yaw 0 and zero residual bias
+ * @param:  ekf - Filter state
+ * 			accel_data - Accelerometer vector in g, see @MPU_AccelReadVector, board at rest
+ * @retval: None
+ */
+void MPU_EkfInit(MPU_EKF *ekf, const float accel_data[]){
+
+	float roll = atan2f(accel_data[1], accel_data[2]);
+	float pitch = atan2f(-accel_data[0], sqrtf(accel_data[1] * accel_data[1] + accel_data[2] * accel_data[2]));
+	float cr = cosf(roll / 2), sr = sinf(roll / 2), cp = cosf(pitch / 2), sp = sinf(pitch / 2);
+
+	memset(ekf, 0, sizeof(MPU_EKF));
+
+	ekf->q[0] = cr * cp;
+	ekf->q[1] = sr * cp;
+	ekf->q[2] = cr * sp;
+	ekf->q[3] = -sr * sp;
+
+	for(uint8_t i = 0; i < 3; i++){
+		ekf->Paa[i][i] = EKF_INITIAL_ANGLE * EKF_INITIAL_ANGLE;
+		ekf->Pbb[i][i] = EKF_INITIAL_BIAS * EKF_INITIAL_BIAS;
+	}
+}
+
+/*
+ * @brief:  Propagate the attitude and the covariance by one gyro sample
+ * @param:  ekf - Filter state
+ * 			gyro_data - Gyro vector in °/s, see @MPU_GyroReadVector
+ * 			dt - Time since the last predict, s
+ * @retval: None
+ */
+void MPU_EkfPredict(MPU_EKF *ekf, const float gyro_data[], float dt){
+
+	EKF_CYCLES_START();
+
+	float dq[4], q[4], Phi[3][3], PhiPaa[3][3], PhiPab[3][3], Paa[3][3];
+	float gyro_variance = (float)(EKF_GYRO_NOISE * EKF_GYRO_NOISE) * EKF_DEG2RAD * EKF_DEG2RAD * dt;
+	float bias_variance = (float)(EKF_BIAS_WALK * EKF_BIAS_WALK) * dt;
+	float g = -dt * EKF_DEG2RAD;							/* Bias to angle block of F */
+
+	dq[0] = 1;
+	for(uint8_t i = 0; i < 3; i++)
+		dq[i + 1] = (gyro_data[i] - ekf->bias[i]) * EKF_DEG2RAD * dt / 2;
+	QuaternionNormalize(dq);
+
+	QuaternionMult(ekf->q, dq, q);
+	QuaternionNormalize(q);
+	memcpy(ekf->q, q, sizeof(q));
+
+	/* Phi = R(dq)^T, the error rotates against the body */
+	QuaternionToMatrix(dq, Phi);
+	for(uint8_t i = 0; i < 3; i++)
+		for(uint8_t j = i + 1; j < 3; j++){
+			float t = Phi[i][j];
+			Phi[i][j] = Phi[j][i];
+			Phi[j][i] = t;
+		}
+
+	/*
+	 * F * P * F^T with F = [Phi, g*I; 0, I]:
+	 *		Paa = Phi*Paa*Phi^T + g*(Phi*Pab + (Phi*Pab)^T) + g^2*Pbb
+	 *		Pab = Phi*Pab + g*Pbb
+	 *		Pbb = Pbb
+	 */
+	Mult33(Phi, ekf->Paa, PhiPaa);
+	MultT33(PhiPaa, Phi, Paa);
+	Mult33(Phi, ekf->Pab, PhiPab);
+
+	for(uint8_t i = 0; i < 3; i++)
+		for(uint8_t j = 0; j < 3; j++){
+			ekf->Paa[i][j] = Paa[i][j] + g * (PhiPab[i][j] + PhiPab[j][i]) + g * g * ekf->Pbb[i][j];
+			ekf->Pab[i][j] = PhiPab[i][j] + g * ekf->Pbb[i][j];
+		}
+
+	for(uint8_t i = 0; i < 3; i++){
+		ekf->Paa[i][i] += gyro_variance;
+		ekf->Pbb[i][i] += bias_variance;
+	}
+
+	Symmetrize(ekf->Paa);
+
+	ekf->stats.predicts++;
+
+	EKF_CYCLES_END(ekf->stats.worst_predict_cycles);
+}
+
+/*
+ * @brief:  Correct the roll, pitch and the bias with the gravity direction
+ * @param:  ekf - Filter state
+ * 			accel_data - Accelerometer vector in g
+ * @retval: 1 if the update was applied, 0 if the norm was out of EKF_ACCEL_GATE (linear acceleration) or the innovation was singular
+ */
+uint8_t MPU_EkfUpdateAccel(MPU_EKF *ekf, const float accel_data[]){
+
+	EKF_CYCLES_START();
+
+	float norm = sqrtf(accel_data[0] * accel_data[0] + accel_data[1] * accel_data[1] + accel_data[2] * accel_data[2]);
+	float measured[3], predicted[3];
+	const float *q = ekf->q;
+	uint8_t applied;
+
+	if(fabsf(norm - 1) > EKF_ACCEL_GATE){
+		ekf->stats.rejected++;
+		return 0;
+	}
+
+	norm = 1 / norm;
+	for(uint8_t i = 0; i < 3; i++)
+		measured[i] = accel_data[i] * norm;
+
+	predicted[0] = 2 * (q[1] * q[3] - q[0] * q[2]);		/* R^T * [0 0 1] */
+	predicted[1] = 2 * (q[2] * q[3] + q[0] * q[1]);
+	predicted[2] = q[0] * q[0] - q[1] * q[1] - q[2] * q[2] + q[3] * q[3];
+
+	applied = EkfUpdate(ekf, predicted, measured, EKF_ACCEL_NOISE * EKF_ACCEL_NOISE);
+
+	EKF_CYCLES_END(ekf->stats.worst_update_cycles);
+
+	return applied;
+}
+
+/*
+ * @brief:  Correct the yaw and the bias with the horizontal part of the magnetic field.
+ * 			The first call only stores the world reference (the current heading becomes the reference of the yaw)
+ * @param:  ekf - Filter state
+ * 			mag_data - Magnetometer vector in uT at the accel/gyro axes, calibrated, see @MPU_MagReadVector
+ * @retval: 1 if the update was applied, 0 for the first call or a field parallel to gravity
+ */
+uint8_t MPU_EkfUpdateMag(MPU_EKF *ekf, const float mag_data[]){
+
+	EKF_CYCLES_START();
+
+	float R[3][3], gravity[3], measured[3], predicted[3], world[3];
+	float along = 0, norm = 0;
+	uint8_t applied;
+
+	QuaternionToMatrix(ekf->q, R);
+
+	for(uint8_t i = 0; i < 3; i++){							/* Gravity at the body, third row of R */
+		gravity[i] = R[2][i];
+		along += mag_data[i] * gravity[i];
+	}
+
+	for(uint8_t i = 0; i < 3; i++){
+		measured[i] = mag_data[i] - along * gravity[i];
+		norm += measured[i] * measured[i];
+	}
+
+	norm = sqrtf(norm);
+	if(norm < 1e-3f)
+		return 0;
+
+	norm = 1 / norm;
+	for(uint8_t i = 0; i < 3; i++)
+		measured[i] *= norm;
+
+	if(!ekf->mag_reference_set){
+		MultV33(R, measured, world);
+		world[2] = 0;
+		norm = sqrtf(world[0] * world[0] + world[1] * world[1]);
+		for(uint8_t i = 0; i < 3; i++)
+			ekf->mag_reference[i] = world[i] / norm;
+		ekf->mag_reference_set = 1;
+		return 0;
+	}
+
+	for(uint8_t i = 0; i < 3; i++)							/* R^T * reference */
+		predicted[i] = R[0][i] * ekf->mag_reference[0] + R[1][i] * ekf->mag_reference[1];
+
+	applied = EkfUpdate(ekf, predicted, measured, EKF_MAG_NOISE * EKF_MAG_NOISE);
+
+	EKF_CYCLES_END(ekf->stats.worst_update_cycles);
+
+	return applied;
+}
+
+/*
+ * @brief:  Attitude as Euler angles (Z-Y-X)
+ * @param:  ekf - Filter state
+ * 			euler - Three element vector where roll, pitch and yaw in degrees will be placed
+ * @retval: None
+ */
+void MPU_EkfGetEuler(const MPU_EKF *ekf, float euler[]){
+
+	const float *q = ekf->q;
+	float sin_pitch = 2 * (q[0] * q[2] - q[3] * q[1]);
+
+	if(sin_pitch > 1)
+		sin_pitch = 1;
+	else if(sin_pitch < -1)
+		sin_pitch = -1;
+
+	euler[0] = atan2f(2 * (q[0] * q[1] + q[2] * q[3]), 1 - 2 * (q[1] * q[1] + q[2] * q[2])) / EKF_DEG2RAD;
+	euler[1] = asinf(sin_pitch) / EKF_DEG2RAD;
+	euler[2] = atan2f(2 * (q[0] * q[3] + q[1] * q[2]), 1 - 2 * (q[2] * q[2] + q[3] * q[3])) / EKF_DEG2RAD;
+}
+
+/*
+ * @brief:  Move the estimated residual bias into the bias in use of the driver (see @MPU_GyroAdjustBias). The following
+ * 			@MPU_GyroReadVector outputs come without it, so the filter bias goes back to zero. The covariance is kept
+ * @param:  ekf - Filter state
+ * @retval: None
+ */
+void MPU_EkfCommitBias(MPU_EKF *ekf){
+
+	MPU_GyroAdjustBias(ekf->bias);
+
+	memset(ekf->bias, 0, sizeof(ekf->bias));
+}
+
+/*
+ * @brief:  Counters of the filter, and the measured worst cycles when EKF_CYCLE_COUNTER is defined
+ * @param:  ekf - Filter state
+ * 			stats - Where the counters will be copied
+ * @retval: None
+ */
+void MPU_EkfGetStats(const MPU_EKF *ekf, MPU_EKF_STATS *stats){
+
+	*stats = ekf->stats;
+}
+
+/*
+ * @brief:  Internal function, measurement update with H = [[predicted]x, 0]:
+ *
+ *		Ua = Paa*S^T, Ub = Pab^T*S^T, S = [predicted]x
+ *		innovation covariance = S*Ua + variance*I
+ *		Ka = Ua*inverse, Kb = Ub*inverse
+ *		Paa -= Ka*Ua^T, Pab -= Ka*Ub^T, Pbb -= Kb*Ub^T
+ */
+static uint8_t EkfUpdate(MPU_EKF *ekf, const float predicted[], const float measured[], float variance){
+
+	float S[3][3], Pba[3][3], Ua[3][3], Ub[3][3], C[3][3], Cinv[3][3], Ka[3][3], Kb[3][3], KU[3][3];
+	float residual[3], dtheta[3], dbias[3], dq[4], q[4];
+
+	Skew(predicted, S);
+
+	for(uint8_t i = 0; i < 3; i++)
+		for(uint8_t j = 0; j < 3; j++)
+			Pba[i][j] = ekf->Pab[j][i];
+
+	MultT33(ekf->Paa, S, Ua);
+	MultT33(Pba, S, Ub);
+	Mult33(S, Ua, C);
+
+	for(uint8_t i = 0; i < 3; i++)
+		C[i][i] += variance;
+
+	if(!SymmetricInverse(C, Cinv))
+		return 0;
+
+	Mult33(Ua, Cinv, Ka);
+	Mult33(Ub, Cinv, Kb);
+
+	for(uint8_t i = 0; i < 3; i++)
+		residual[i] = measured[i] - predicted[i];
+
+	MultV33(Ka, residual, dtheta);
+	MultV33(Kb, residual, dbias);
+
+	MultT33(Ka, Ua, KU);
+	for(uint8_t i = 0; i < 3; i++)
+		for(uint8_t j = 0; j < 3; j++)
+			ekf->Paa[i][j] -= KU[i][j];
+
+	MultT33(Ka, Ub, KU);
+	for(uint8_t i = 0; i < 3; i++)
+		for(uint8_t j = 0; j < 3; j++)
+			ekf->Pab[i][j] -= KU[i][j];
+
+	MultT33(Kb, Ub, KU);
+	for(uint8_t i = 0; i < 3; i++)
+		for(uint8_t j = 0; j < 3; j++)
+			ekf->Pbb[i][j] -= KU[i][j];
+
+	Symmetrize(ekf->Paa);
+	Symmetrize(ekf->Pbb);
+
+	/* Injection, the error state goes back to zero */
+	dq[0] = 1;
+	for(uint8_t i = 0; i < 3; i++){
+		dq[i + 1] = dtheta[i] / 2;
+		ekf->bias[i] += dbias[i];
+	}
+
+	QuaternionMult(ekf->q, dq, q);
+	QuaternionNormalize(q);
+	memcpy(ekf->q, q, sizeof(q));
+
+	ekf->stats.updates++;
+
+	return 1;
+}
+
+/*
+ * @brief:  Internal function, Hamilton product p * q
+ */
+static void QuaternionMult(const float p[], const float q[], float out[]){
+
+	out[0] = p[0] * q[0] - p[1] * q[1] - p[2] * q[2] - p[3] * q[3];
+	out[1] = p[0] * q[1] + p[1] * q[0] + p[2] * q[3] - p[3] * q[2];
+	out[2] = p[0] * q[2] - p[1] * q[3] + p[2] * q[0] + p[3] * q[1];
+	out[3] = p[0] * q[3] + p[1] * q[2] - p[2] * q[1] + p[3] * q[0];
+}
+
+static void QuaternionNormalize(float q[]){
+
+	float inverse = 1 / sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+
+	for(uint8_t i = 0; i < 4; i++)
+		q[i] *= inverse;
+}
+
+/*
+ * @brief:  Internal function, rotation matrix of a unit quaternion (body to world)
+ */
+static void QuaternionToMatrix(const float q[], float R[3][3]){
+
+	float xx = q[1] * q[1], yy = q[2] * q[2], zz = q[3] * q[3];
+	float xy = q[1] * q[2], xz = q[1] * q[3], yz = q[2] * q[3];
+	float wx = q[0] * q[1], wy = q[0] * q[2], wz = q[0] * q[3];
+
+	R[0][0] = 1 - 2 * (yy + zz);	R[0][1] = 2 * (xy - wz);		R[0][2] = 2 * (xz + wy);
+	R[1][0] = 2 * (xy + wz);		R[1][1] = 1 - 2 * (xx + zz);	R[1][2] = 2 * (yz - wx);
+	R[2][0] = 2 * (xz - wy);		R[2][1] = 2 * (yz + wx);		R[2][2] = 1 - 2 * (xx + yy);
+}
+
+/*
+ * @brief:  Internal function, cross product matrix, [v]x * a = v x a
+ */
+static void Skew(const float v[], float S[3][3]){
+
+	S[0][0] = 0;		S[0][1] = -v[2];	S[0][2] = v[1];
+	S[1][0] = v[2];		S[1][1] = 0;		S[1][2] = -v[0];
+	S[2][0] = -v[1];	S[2][1] = v[0];		S[2][2] = 0;
+}
+
+/*
+ * @brief:  Internal function, inverse of a symmetric 3x3 matrix by its cofactors
+ * @retval: 0 if the matrix is singular
+ */
+static uint8_t SymmetricInverse(const float a[3][3], float out[3][3]){
+
+	float c00 = a[1][1] * a[2][2] - a[1][2] * a[1][2];
+	float c01 = a[0][2] * a[1][2] - a[0][1] * a[2][2];
+	float c02 = a[0][1] * a[1][2] - a[0][2] * a[1][1];
+	float c11 = a[0][0] * a[2][2] - a[0][2] * a[0][2];
+	float c12 = a[0][1] * a[0][2] - a[0][0] * a[1][2];
+	float c22 = a[0][0] * a[1][1] - a[0][1] * a[0][1];
+	float det = a[0][0] * c00 + a[0][1] * c01 + a[0][2] * c02;
+	float inverse;
+
+	if(fabsf(det) < 1e-12f)
+		return 0;
+
+	inverse = 1 / det;
+
+	out[0][0] = c00 * inverse;	out[0][1] = c01 * inverse;	out[0][2] = c02 * inverse;
+	out[1][0] = out[0][1];		out[1][1] = c11 * inverse;	out[1][2] = c12 * inverse;
+	out[2][0] = out[0][2];		out[2][1] = out[1][2];		out[2][2] = c22 * inverse;
+
+	return 1;
+}
+
+static void Symmetrize(float a[3][3]){
+
+	for(uint8_t i = 0; i < 3; i++)
+		for(uint8_t j = i + 1; j < 3; j++)
+			a[i][j] = a[j][i] = (a[i][j] + a[j][i]) / 2;
+}
@@ -0,0 +1,99 @@
+/*
+ * MPU_Ekf.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+#ifndef INC_MPU_EKF_H_
+#define INC_MPU_EKF_H_
+
+#include "MPU_SPEC.h"
+
+/*
+ * Error-state Kalman filter of the attitude and the gyro bias:
+ *
+ *		nominal state:	q (body to world quaternion), b (residual gyro bias, °/s, over the bias removed by @MPU_GyroCalibrate)
+ *		error state:	dtheta (3, rad, body frame), db (3, °/s), covariance P (6x6 kept as the blocks Paa, Pab, Pbb)
+ *
+ * @MPU_EkfPredict integrates gyro - b, @MPU_EkfUpdateAccel and @MPU_EkfUpdateMag correct with the gravity and the magnetic field directions.
+ * The error state is injected into q and b after each update and reset to zero. The accelerometer alone does not observe the bias about
+ * the gravity axis, it needs the magnetometer update (or rotations of the board).
+ * @MPU_EkfCommitBias moves b into the bias in use of the driver (@MPU_GyroAdjustBias: the static bias and the bins of the temperature
+ * bias model when it is enabled), so the corrected @MPU_GyroReadVector output keeps being refined. Do not commit while MPU_ZeroMotion.h
+ * tracks the bias (bias_gain above 0), one owner changes the bias in use.
+ *
+ * Every matrix has a size fixed at compile time and lives at the stack or at MPU_EKF, no heap. The 6x6 products are written with the
+ * 3x3 blocks of F = [Phi, -dt*I; 0, I] and H = [[v]x, 0], so the zero and identity blocks cost nothing.
+ *
+ * Worst case cycles, Cortex-M4F single precision FPU at -O2, estimated from the operation count of each step (a multiply-accumulate taken
+ * as VLDR + VLDR + VFMA without overlap, 5 cycles; VDIV and VSQRT 14 cycles; other FPU operations 2 cycles with their load/store):
+ *
+ *		@MPU_EkfPredict			105 MAC + 2 VSQRT + 2 VDIV + 90 other		~ 800 cycles
+ *		@MPU_EkfUpdateAccel		290 MAC + 2 VSQRT + 3 VDIV + 100 other		~ 1700 cycles
+ *		@MPU_EkfUpdateMag		300 MAC + 2 VSQRT + 3 VDIV + 110 other		~ 1750 cycles
+ *
+ * At 168 MHz that is about 25 us for one predict plus both updates. Define EKF_CYCLE_COUNTER as an expression returning a free running
+ * cycle counter (for example DWT->CYCCNT) to measure the worst case of the target at MPU_EKF_STATS.
+ */
+#ifndef EKF_GYRO_NOISE
+#define EKF_GYRO_NOISE				0.01			//Gyro white noise density, (°/s)/sqrt(Hz)
+#endif
+
+#ifndef EKF_BIAS_WALK
+#define EKF_BIAS_WALK				0.0005			//Gyro bias random walk, (°/s)*sqrt(Hz)
+#endif
+
+#ifndef EKF_ACCEL_NOISE
+#define EKF_ACCEL_NOISE				0.05			//Gravity direction noise of one accel update, unit vector
+#endif
+
+#ifndef EKF_MAG_NOISE
+#define EKF_MAG_NOISE				0.1				//Field direction noise of one mag update, unit vector
+#endif
+
+#ifndef EKF_ACCEL_GATE
+#define EKF_ACCEL_GATE				0.1				//Accel updates are skipped when | |a| - 1 g | is above it (linear acceleration)
+#endif
+
+#ifndef EKF_INITIAL_ANGLE
+#define EKF_INITIAL_ANGLE			0.1				//Initial attitude standard deviation, rad
+#endif
+
+#ifndef EKF_INITIAL_BIAS
+#define EKF_INITIAL_BIAS			0.5				//Initial residual bias standard deviation, °/s
+#endif
+
+typedef struct{
+	uint32_t predicts;
+	uint32_t updates;							//Accel and mag updates applied
+	uint32_t rejected;							//Accel updates skipped by EKF_ACCEL_GATE
+#ifdef EKF_CYCLE_COUNTER
+	uint32_t worst_predict_cycles;
+	uint32_t worst_update_cycles;
+#endif
+}MPU_EKF_STATS;
+
+typedef struct{
+	float q[4];									//w, x, y, z, body to world
+	float bias[3];								//Residual gyro bias, °/s
+	float Paa[3][3];							//Attitude error covariance, rad^2
+	float Pab[3][3];							//Attitude and bias cross covariance, rad*°/s
+	float Pbb[3][3];							//Bias covariance, (°/s)^2
+	float mag_reference[3];						//Horizontal field direction at world frame, taken at the first mag update
+	uint8_t mag_reference_set;
+	MPU_EKF_STATS stats;
+}MPU_EKF;
+
+/*
+ * Error-state Kalman filter functions
+ */
+void MPU_EkfInit(MPU_EKF *ekf, const float accel_data[]);
+void MPU_EkfPredict(MPU_EKF *ekf, const float gyro_data[], float dt);
+uint8_t MPU_EkfUpdateAccel(MPU_EKF *ekf, const float accel_data[]);
+uint8_t MPU_EkfUpdateMag(MPU_EKF *ekf, const float mag_data[]);
+void MPU_EkfGetEuler(const MPU_EKF *ekf, float euler[]);
+void MPU_EkfCommitBias(MPU_EKF *ekf);
+void MPU_EkfGetStats(const MPU_EKF *ekf, MPU_EKF_STATS *stats);
+
+#endif /* INC_MPU_EKF_H_ */
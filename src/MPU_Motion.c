@@ -0,0 +1,281 @@
+/*
+ * MPU_Motion.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+#include "MPU_Motion.h"
+
+static uint32_t SquaredCounts(int32_t mg);
+static uint16_t WindowSamples(uint16_t ms, uint16_t rate_hz);
+static void MotionRaise(MPU_MOTION *motion, MPU_MOTION_EVENT event, uint32_t magnitude_sq, uint16_t duration, const int16_t accel_raw[]);
+
+/*
+ * @brief:  Convert the thresholds of the configuration for the accel full scale in use and clear the detection state
+ * @param:  motion - Detector state
+ * 			config - Thresholds and windows, NULL for the MOTION_* defaults at 1 kHz
+ * 			callback - Called at each event from the processing functions, can be NULL
+ * 			context - Given back to the callback
+ * @retval: None
+ */
+void MPU_MotionInit(MPU_MOTION *motion, const MPU_MOTION_CONFIG *config, MPU_MOTION_CALLBACK callback, void *context){
+
+	MPU_MOTION_CONFIG defaults = {MOTION_FREE_FALL_MG, MOTION_FREE_FALL_MS, MOTION_SHOCK_MG, MOTION_SHOCK_SAMPLES, MOTION_TAP_MG,
+								  MOTION_TAP_MAX_MS, MOTION_TAP_QUIET_MS, MOTION_HYSTERESIS_MG, 1000, 0};
+
+	if(config == NULL)
+		config = &defaults;
+
+	memset(motion, 0, sizeof(MPU_MOTION));
+
+	motion->free_fall_enter = SquaredCounts(config->free_fall_mg);
+	motion->free_fall_exit = SquaredCounts(config->free_fall_mg + config->hysteresis_mg);
+	motion->shock_enter = SquaredCounts(config->shock_mg);
+	motion->shock_exit = SquaredCounts(config->shock_mg - config->hysteresis_mg);
+	motion->tap_enter = SquaredCounts(config->tap_mg);
+	motion->tap_exit = SquaredCounts(config->tap_mg - config->hysteresis_mg);
+
+	motion->free_fall_samples = WindowSamples(config->free_fall_ms, config->sample_rate_hz);
+	motion->shock_samples = config->shock_samples > 0 ? config->shock_samples : 1;
+	motion->tap_max_samples = WindowSamples(config->tap_max_ms, config->sample_rate_hz);
+	motion->tap_quiet_samples = WindowSamples(config->tap_quiet_ms, config->sample_rate_hz);
+	motion->wom_hold_samples = (uint32_t)config->wom_hold_ms * config->sample_rate_hz / 1000;
+
+	motion->callback = callback;
+	motion->context = context;
+}
+
+/*
+ * @brief:  Check one accel sample, the callback is called before the return for each raised event
+ * @param:  motion - Detector state
+ * 			accel_raw - Three element vector of counts (@MPU_AccelReadRaw)
+ * @retval: Events raised at this sample, OR of @MPU_MOTION_EVENT
+ */
+uint8_t MPU_MotionProcess(MPU_MOTION *motion, const int16_t accel_raw[]){
+
+	uint8_t events = 0;
+	int32_t difference[3], high[3];
+	uint32_t magnitude_sq, high_sq;
+
+	motion->stats.samples++;
+
+	if(!motion->baseline_set){
+		for(uint8_t i = 0; i < 3; i++)
+			motion->baseline[i] = (int32_t)accel_raw[i] << MOTION_BASELINE_SHIFT;
+		motion->baseline_set = 1;
+	}
+
+	for(uint8_t i = 0; i < 3; i++){								/* High pass for the tap, a - slow mean */
+		difference[i] = accel_raw[i] - (motion->baseline[i] >> MOTION_BASELINE_SHIFT);
+		high[i] = difference[i];
+		if(high[i] > INT16_MAX)
+			high[i] = INT16_MAX;									/* Each square below 2^30, the sum fits 32 bits */
+		else if(high[i] < -INT16_MAX)
+			high[i] = -INT16_MAX;
+	}
+
+	if(motion->wom_hold_samples > 0){
+		if(motion->wom_remaining == 0){
+			for(uint8_t i = 0; i < 3; i++)
+				motion->baseline[i] += difference[i];
+			motion->stats.gated++;
+			return 0;
+		}
+		motion->wom_remaining--;
+	}
+
+	magnitude_sq = (uint32_t)(accel_raw[0] * accel_raw[0]) + (uint32_t)(accel_raw[1] * accel_raw[1]) + (uint32_t)(accel_raw[2] * accel_raw[2]);
+	high_sq = (uint32_t)(high[0] * high[0]) + (uint32_t)(high[1] * high[1]) + (uint32_t)(high[2] * high[2]);
+
+	/* Free-fall, raised once when the window is complete */
+	if(magnitude_sq < motion->free_fall_enter){
+		if(motion->free_fall_count == 0 || magnitude_sq < motion->free_fall_min)
+			motion->free_fall_min = magnitude_sq;
+		if(motion->free_fall_count < UINT16_MAX && ++motion->free_fall_count == motion->free_fall_samples){
+			MotionRaise(motion, MOTION_FREE_FALL, motion->free_fall_min, motion->free_fall_count, accel_raw);
+			events |= MOTION_FREE_FALL;
+		}
+	}
+	else if(magnitude_sq > motion->free_fall_exit || motion->free_fall_count < motion->free_fall_samples)
+		motion->free_fall_count = 0;								/* Inside the hysteresis a raised free-fall is kept */
+
+	/* Shock */
+	if(magnitude_sq > motion->shock_enter){
+		if(motion->shock_count == 0 || magnitude_sq > motion->shock_peak)
+			motion->shock_peak = magnitude_sq;
+		if(motion->shock_count < UINT16_MAX && ++motion->shock_count == motion->shock_samples){
+			MotionRaise(motion, MOTION_SHOCK, motion->shock_peak, motion->shock_count, accel_raw);
+			events |= MOTION_SHOCK;
+			motion->tap_count = UINT16_MAX;							/* The peak is the shock, not a tap */
+		}
+	}
+	else if(magnitude_sq < motion->shock_exit || motion->shock_count < motion->shock_samples)
+		motion->shock_count = 0;
+
+	/* Tap, raised when a short peak ends */
+	if(motion->tap_quiet > 0)
+		motion->tap_quiet--;
+	else if(motion->tap_count == UINT16_MAX){
+		if(high_sq < motion->tap_exit)
+			motion->tap_count = 0;
+	}
+	else if(motion->tap_count == 0){
+		if(high_sq > motion->tap_enter){
+			motion->tap_count = 1;
+			motion->tap_peak = high_sq;
+		}
+	}
+	else if(high_sq >= motion->tap_exit){
+		if(high_sq > motion->tap_peak)
+			motion->tap_peak = high_sq;
+		if(++motion->tap_count > motion->tap_max_samples)
+			motion->tap_count = UINT16_MAX;							/* A movement, wait until it ends */
+	}
+	else{
+		MotionRaise(motion, MOTION_TAP, motion->tap_peak, motion->tap_count, accel_raw);
+		events |= MOTION_TAP;
+		motion->tap_count = 0;
+		motion->tap_quiet = motion->tap_quiet_samples;
+	}
+
+	if(motion->tap_count == 0 || motion->tap_count == UINT16_MAX){	/* Frozen during a peak, so a long push can not decay into a tap */
+		for(uint8_t i = 0; i < 3; i++)
+			motion->baseline[i] += difference[i];
+	}
+
+	return events;
+}
+
+/*
+ * @brief:  Check one sample given as the 6 accel bytes of a burst or fifo frame (ACCEL_XOUT_H first, big endian)
+ * @param:  motion - Detector state
+ * 			raw - 6 bytes, the first ones of @MPU_ReadAllRaw frames and of fifo frames with the accel enabled
+ * @retval: Events raised, OR of @MPU_MOTION_EVENT
+ */
+uint8_t MPU_MotionProcessBytes(MPU_MOTION *motion, const uint8_t raw[]){
+
+	int16_t accel_raw[3];
+
+	accel_raw[0] = (int16_t)(raw[0] << 8 | raw[1]);
+	accel_raw[1] = (int16_t)(raw[2] << 8 | raw[3]);
+	accel_raw[2] = (int16_t)(raw[4] << 8 | raw[5]);
+
+	return MPU_MotionProcess(motion, accel_raw);
+}
+
+/*
+ * @brief:  Check every sample of a batch read by @MPU_FifoReadBatchRaw (counts, before @MPU_BatchConvert)
+ * @param:  motion - Detector state
+ * 			batch - Batch with the accel arrays filled
+ * @retval: Events raised by any sample of the batch, OR of @MPU_MOTION_EVENT
+ */
+uint8_t MPU_MotionProcessBatch(MPU_MOTION *motion, const MPU_SOA_BATCH *batch){
+
+	uint8_t events = 0;
+	int16_t accel_raw[3];
+
+	for(uint16_t i = 0; i < batch->length; i++){
+		accel_raw[0] = (int16_t)batch->ax[i];
+		accel_raw[1] = (int16_t)batch->ay[i];
+		accel_raw[2] = (int16_t)batch->az[i];
+		events |= MPU_MotionProcess(motion, accel_raw);
+	}
+
+	return events;
+}
+
+/*
+ * @brief:  Read the newest sample and check it, call it at the data-ready interrupt (or from the task it wakes)
+ * 			A wake-on-motion flag at INT_STATUS arms the detection for wom_hold_ms
+ * @param:  motion - Detector state
+ * @retval: Events raised, OR of @MPU_MOTION_EVENT
+ */
+uint8_t MPU_MotionDataReady(MPU_MOTION *motion){
+
+	int16_t accel_raw[3];
+
+	if(MPU_AccelReadRaw(accel_raw) & WOM_INT_BIT)
+		MPU_MotionArm(motion);
+
+	return MPU_MotionProcess(motion, accel_raw);
+}
+
+/*
+ * @brief:  Arm the detection for wom_hold_ms, for a wake-on-motion interrupt seen by the application (INT pin or INT_STATUS)
+ * @param:  motion - Detector state
+ * @retval: None
+ */
+void MPU_MotionArm(MPU_MOTION *motion){
+
+	motion->wom_remaining = motion->wom_hold_samples;
+	motion->stats.wom_interrupts++;
+}
+
+/*
+ * @brief:  Event and sample counters
+ * @param:  motion - Detector state
+ * 			stats - Where the counters will be copied
+ * @retval: None
+ */
+void MPU_MotionGetStats(const MPU_MOTION *motion, MPU_MOTION_STATS *stats){
+
+	*stats = motion->stats;
+}
+
+/*
+ * @brief:  Internal function, squared magnitude in counts^2 of a threshold in mg, at the full scale in use
+ */
+static uint32_t SquaredCounts(int32_t mg){
+
+	uint64_t counts, squared;
+
+	if(mg <= 0)
+		return 0;
+
+	counts = (uint64_t)mg * accel_sensitivity_used / 1000;
+	squared = counts * counts;
+
+	return squared > UINT32_MAX ? UINT32_MAX : (uint32_t)squared;
+}
+
+/*
+ * @brief:  Internal function, window in samples, at least one
+ */
+static uint16_t WindowSamples(uint16_t ms, uint16_t rate_hz){
+
+	uint32_t samples = (uint32_t)ms * rate_hz / 1000;
+
+	if(samples == 0)
+		return 1;
+
+	return samples > UINT16_MAX - 1 ? UINT16_MAX - 1 : samples;
+}
+
+/*
+ * @brief:  Internal function, count one event and call the callback
+ */
+static void MotionRaise(MPU_MOTION *motion, MPU_MOTION_EVENT event, uint32_t magnitude_sq, uint16_t duration, const int16_t accel_raw[]){
+
+	MPU_MOTION_INFO info;
+
+	if(event == MOTION_FREE_FALL)
+		motion->stats.free_falls++;
+	else if(event == MOTION_SHOCK)
+		motion->stats.shocks++;
+	else
+		motion->stats.taps++;
+
+	if(motion->callback == NULL)
+		return;
+
+	info.event = event;
+	info.magnitude_sq = magnitude_sq;
+	info.duration = duration;
+	info.accel[0] = accel_raw[0];
+	info.accel[1] = accel_raw[1];
+	info.accel[2] = accel_raw[2];
+	info.sample = motion->stats.samples - 1;
+
+	motion->callback(&info, motion->context);
+}
@@ -0,0 +1,140 @@
+/*
+ * MPU_Motion.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+#ifndef INC_MPU_MOTION_H_
+#define INC_MPU_MOTION_H_
+
+#include "MPU_SPEC.h"
+
+/*
+ * Motion events on the raw accel stream, for protective shutdown:
+ *
+ *		free-fall:	|a| below free_fall_mg for free_fall_ms
+ *		shock:		|a| above shock_mg for shock_samples consecutive samples (1 = the sample that crossed it)
+ *		tap:		|a - slow mean| above tap_mg, back below it within tap_max_ms, then no new tap for tap_quiet_ms
+ *
+ * The thresholds are converted once at @MPU_MotionInit to squared counts, so each sample costs three integer multiplies and compares,
+ * no float and no square root. Each event is armed again only when its magnitude leaves the threshold by hysteresis_mg.
+ * The callback is called inside the processing function, so from the data-ready path when @MPU_MotionDataReady is called at the
+ * data-ready interrupt (or by the sampling task it wakes): the latency is the read of one sample plus the debounce.
+ *
+ * Samples come from @MPU_MotionDataReady (one 7 bytes read of INT_STATUS and the accel), from burst reads (@MPU_MotionProcessBytes)
+ * or from fifo batches of @MPU_FifoReadBatchRaw (@MPU_MotionProcessBatch).
+ *
+ * Hardware first stage: with wom_hold_ms > 0 the events are raised only for wom_hold_ms after a wake-on-motion interrupt
+ * (@MPU_WakeOnMotionEnable), seen at the INT_STATUS of @MPU_MotionDataReady or given by @MPU_MotionArm from a dedicated pin.
+ * Call @MPU_MotionInit again after @MPU_AccelScaleChange, the thresholds depend on the full scale. A shock threshold above the full
+ * scale never fires, use 16 g for high-g shocks.
+ */
+#ifndef MOTION_FREE_FALL_MG
+#define MOTION_FREE_FALL_MG			300				//|a| below it is free-fall
+#endif
+
+#ifndef MOTION_FREE_FALL_MS
+#define MOTION_FREE_FALL_MS			20				//About 2 mm of fall
+#endif
+
+#ifndef MOTION_SHOCK_MG
+#define MOTION_SHOCK_MG				6000
+#endif
+
+#ifndef MOTION_SHOCK_SAMPLES
+#define MOTION_SHOCK_SAMPLES		1
+#endif
+
+#ifndef MOTION_TAP_MG
+#define MOTION_TAP_MG				1500			//High pass magnitude of a tap
+#endif
+
+#ifndef MOTION_TAP_MAX_MS
+#define MOTION_TAP_MAX_MS			20				//Longer peaks are movements, not taps
+#endif
+
+#ifndef MOTION_TAP_QUIET_MS
+#define MOTION_TAP_QUIET_MS			100				//Dead time after a tap, the ringing is not a second tap
+#endif
+
+#ifndef MOTION_HYSTERESIS_MG
+#define MOTION_HYSTERESIS_MG		100
+#endif
+
+#define MOTION_BASELINE_SHIFT		5				//Slow mean of the tap high pass, time constant of 2^5 samples
+
+typedef enum{
+	MOTION_FREE_FALL	= 0x01,
+	MOTION_SHOCK		= 0x02,
+	MOTION_TAP			= 0x04
+}MPU_MOTION_EVENT;
+
+typedef struct{
+	uint16_t free_fall_mg;
+	uint16_t free_fall_ms;
+	uint16_t shock_mg;
+	uint16_t shock_samples;
+	uint16_t tap_mg;
+	uint16_t tap_max_ms;
+	uint16_t tap_quiet_ms;
+	uint16_t hysteresis_mg;
+	uint16_t sample_rate_hz;					//Rate of the processed samples, converts the ms windows to samples
+	uint16_t wom_hold_ms;						//0 to detect always, otherwise events only after a wake-on-motion interrupt
+}MPU_MOTION_CONFIG;
+
+typedef struct{
+	MPU_MOTION_EVENT event;
+	uint32_t magnitude_sq;						//Peak (shock, tap) or minimum (free-fall) squared magnitude, counts^2
+	uint16_t duration;							//Samples the magnitude stayed past the threshold
+	int16_t accel[3];							//Sample that raised the event, counts
+	uint32_t sample;							//Index of that sample since @MPU_MotionInit
+}MPU_MOTION_INFO;
+
+typedef void (*MPU_MOTION_CALLBACK)(const MPU_MOTION_INFO *info, void *context);
+
+typedef struct{
+	uint32_t samples;
+	uint32_t free_falls;
+	uint32_t shocks;
+	uint32_t taps;
+	uint32_t gated;								//Samples not checked because no wake-on-motion interrupt was seen
+	uint32_t wom_interrupts;
+}MPU_MOTION_STATS;
+
+typedef struct{
+	uint32_t free_fall_enter, free_fall_exit;	//Squared thresholds, counts^2
+	uint32_t shock_enter, shock_exit;
+	uint32_t tap_enter, tap_exit;
+	uint16_t free_fall_samples;
+	uint16_t shock_samples;
+	uint16_t tap_max_samples;
+	uint16_t tap_quiet_samples;
+	uint32_t wom_hold_samples;
+
+	uint16_t free_fall_count;
+	uint16_t shock_count;
+	uint16_t tap_count;							//0 idle, UINT16_MAX waiting for the end of a too long peak
+	uint16_t tap_quiet;
+	uint32_t wom_remaining;
+	uint32_t free_fall_min, shock_peak, tap_peak;
+	int32_t baseline[3];						//Slow mean, counts << MOTION_BASELINE_SHIFT
+	uint8_t baseline_set;
+
+	MPU_MOTION_CALLBACK callback;
+	void *context;
+	MPU_MOTION_STATS stats;
+}MPU_MOTION;
+
+/*
+ * Motion event functions
+ */
+void MPU_MotionInit(MPU_MOTION *motion, const MPU_MOTION_CONFIG *config, MPU_MOTION_CALLBACK callback, void *context);
+uint8_t MPU_MotionProcess(MPU_MOTION *motion, const int16_t accel_raw[]);
+uint8_t MPU_MotionProcessBytes(MPU_MOTION *motion, const uint8_t raw[]);
+uint8_t MPU_MotionProcessBatch(MPU_MOTION *motion, const MPU_SOA_BATCH *batch);
+uint8_t MPU_MotionDataReady(MPU_MOTION *motion);
+void MPU_MotionArm(MPU_MOTION *motion);
+void MPU_MotionGetStats(const MPU_MOTION *motion, MPU_MOTION_STATS *stats);
+
+#endif /* INC_MPU_MOTION_H_ */
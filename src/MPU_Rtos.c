@@ -0,0 +1,199 @@
+/*
+ * MPU_Rtos.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+/*
+ * RTOS integration, see MPU_Rtos.h.
+ * The latest sample is a sequence lock with one writer (the sampling task): the sequence is odd while the sample is written, a reader copies
+ * the sample and takes it only if the sequence was even and did not change during the copy. Readers never block the sampling task.
+ */
+
+#include "MPU_Rtos.h"
+
+#ifdef MPU_USE_RTOS
+
+static void SamplingTask(void *argument);
+static void SamplePublish(const MPU_RTOS_SAMPLE *sample);
+
+static void *busMutex = NULL;
+static MPU_RTOS_SAMPLE latestSample;
+static uint32_t latestSequence = 0;						/* Odd while latestSample is written */
+static MPU_RTOS_STATS rtosStats;
+
+static volatile uint8_t samplingRun = 0;
+static volatile uint8_t samplingStopped = 1;
+static uint32_t samplingPeriodMs;
+
+/*
+ * @brief:  Create the bus lock. Call it before the tasks start to use the driver, @MPU_Init can run before or after it
+ * @param:  None
+ * @retval: RTOS_OK or RTOS_ERROR
+ */
+uint8_t MPU_RtosInit(){
+
+	if(busMutex == NULL)
+		busMutex = MPU_PortMutexCreate();
+
+	return busMutex != NULL ? RTOS_OK : RTOS_ERROR;
+}
+
+/*
+ * @brief:  Start the sampling task, it reads all of the sensors with @MPU_ReadAllSensores and publishes the sample
+ * @param:  period_ms - Sampling period, 0 to sample at each @MPU_RtosDataReadyFromISR (INT pin with RAW_RDY_EN)
+ * 			priority - Task priority of the port, it should be above the tasks that use the sample
+ * @retval: RTOS_OK or RTOS_ERROR
+ */
+uint8_t MPU_RtosStartSampling(uint32_t period_ms, uint32_t priority){
+
+	if(!samplingStopped || MPU_RtosInit() != RTOS_OK)
+		return RTOS_ERROR;
+
+	samplingPeriodMs = period_ms;
+	samplingRun = 1;
+	samplingStopped = 0;
+
+	if(MPU_PortTaskCreate(SamplingTask, NULL, priority, RTOS_SAMPLING_STACK_BYTES) != RTOS_OK){
+		samplingRun = 0;
+		samplingStopped = 1;
+		return RTOS_ERROR;
+	}
+
+	return RTOS_OK;
+}
+
+/*
+ * @brief:  Ask the sampling task to end and wait for it, at most one period or RTOS_DATA_READY_TIMEOUT_MS
+ * @param:  None
+ * @retval: None
+ */
+void MPU_RtosStopSampling(){
+
+	samplingRun = 0;
+
+	while(!samplingStopped)
+		MPU_PortSleepPeriod(0);
+}
+
+/*
+ * @brief:  Wake the sampling task, call it from the interrupt of the MPU INT pin when the period is 0
+ * @param:  None
+ * @retval: None
+ */
+void MPU_RtosDataReadyFromISR(){
+
+	MPU_PortSignalFromISR();
+}
+
+/*
+ * @brief:  Copy the last published sample without taking the bus lock, it can be called by any task
+ * @param:  sample - Where the sample will be copied
+ * @retval: Sequence of the sample (0 if no sample was published yet), compare with the last one to know if it is new
+ */
+uint32_t MPU_RtosGetLatest(MPU_RTOS_SAMPLE *sample){
+
+	uint32_t before, after;
+
+	for(;;){
+		before = __atomic_load_n(&latestSequence, __ATOMIC_ACQUIRE);
+
+		if(!(before & 1)){
+			memcpy(sample, &latestSample, sizeof(MPU_RTOS_SAMPLE));
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			after = __atomic_load_n(&latestSequence, __ATOMIC_RELAXED);
+
+			if(before == after)
+				return sample->sequence;
+		}
+
+		__atomic_fetch_add(&rtosStats.reader_retries, 1, __ATOMIC_RELAXED);
+	}
+}
+
+/*
+ * @brief:  Counters of the sampling task and of the bus lock
+ * @param:  stats - Where the counters will be copied
+ * @retval: None
+ */
+void MPU_RtosGetStats(MPU_RTOS_STATS *stats){
+
+	stats->samples = __atomic_load_n(&rtosStats.samples, __ATOMIC_RELAXED);
+	stats->lock_taken = __atomic_load_n(&rtosStats.lock_taken, __ATOMIC_RELAXED);
+	stats->lock_contended = __atomic_load_n(&rtosStats.lock_contended, __ATOMIC_RELAXED);
+	stats->reader_retries = __atomic_load_n(&rtosStats.reader_retries, __ATOMIC_RELAXED);
+}
+
+/*
+ * @brief:  Take the bus lock, used by the driver through MPU_BUS_LOCK. It does nothing before @MPU_RtosInit
+ * @param:  None
+ * @retval: None
+ */
+void MPU_BusLock(){
+
+	if(busMutex == NULL)
+		return;
+
+	if(!MPU_PortMutexTryLock(busMutex)){
+		__atomic_fetch_add(&rtosStats.lock_contended, 1, __ATOMIC_RELAXED);
+		MPU_PortMutexLock(busMutex);
+	}
+
+	__atomic_fetch_add(&rtosStats.lock_taken, 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * @brief:  Give the bus lock back, used by the driver through MPU_BUS_UNLOCK
+ * @param:  None
+ * @retval: None
+ */
+void MPU_BusUnlock(){
+
+	if(busMutex != NULL)
+		MPU_PortMutexUnlock(busMutex);
+}
+
+/*
+ * @brief:  Internal function, body of the sampling task
+ */
+static void SamplingTask(void *argument){
+
+	MPU_RTOS_SAMPLE sample = {0};
+
+	(void)argument;
+
+	while(samplingRun){
+
+		if(samplingPeriodMs)
+			MPU_PortSleepPeriod(samplingPeriodMs);
+		else if(!MPU_PortWaitSignal(RTOS_DATA_READY_TIMEOUT_MS))
+			continue;
+
+		MPU_ReadAllSensores(sample.accel, sample.gyro, sample.mag);
+		sample.timestamp_ms = MPU_PortTimeMs();
+
+		SamplePublish(&sample);
+	}
+
+	MPU_PortTaskExit(&samplingStopped);							/* Sets samplingStopped once a new start can not be touched by this task */
+}
+
+/*
+ * @brief:  Internal function, writer side of the sequence lock
+ */
+static void SamplePublish(const MPU_RTOS_SAMPLE *sample){
+
+	uint32_t sequence = __atomic_load_n(&latestSequence, __ATOMIC_RELAXED);
+
+	__atomic_store_n(&latestSequence, sequence + 1, __ATOMIC_RELAXED);		/* Odd, readers retry */
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	memcpy(&latestSample, sample, sizeof(MPU_RTOS_SAMPLE));
+	latestSample.sequence = (sequence + 2) / 2;
+
+	__atomic_store_n(&latestSequence, sequence + 2, __ATOMIC_RELEASE);
+	__atomic_fetch_add(&rtosStats.samples, 1, __ATOMIC_RELAXED);
+}
+
+#endif
@@ -0,0 +1,72 @@
+/*
+ * MPU_Rtos.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+#ifndef INC_MPU_RTOS_H_
+#define INC_MPU_RTOS_H_
+
+#include "MPU_SPEC.h"
+
+/*
+ * RTOS integration, compiled when MPU_USE_RTOS is defined (for the whole project, MPU_SPEC.h uses it for the bus lock):
+ *
+ *		- Bus lock: recursive mutex with priority inheritance taken by the driver operations, see MPU_BUS_LOCK at MPU_SPEC.h
+ *		- Sampling task: the only task that reads the sensors at the sample rate, by period or by the data-ready interrupt
+ *		- Latest sample: published with a sequence lock, other tasks read it without taking the bus lock
+ *
+ * The OS is reached through the port functions below, define MPU_RTOS_FREERTOS (MPU_RtosFreeRTOS.c) or MPU_RTOS_POSIX (MPU_RtosPosix.c)
+ */
+#ifndef RTOS_SAMPLING_STACK_BYTES
+#define RTOS_SAMPLING_STACK_BYTES		1024
+#endif
+
+#ifndef RTOS_DATA_READY_TIMEOUT_MS
+#define RTOS_DATA_READY_TIMEOUT_MS		100					//Sampling task wait for the data-ready signal before checking the stop request
+#endif
+
+#define RTOS_OK							0
+#define RTOS_ERROR						1
+
+typedef struct{
+	float accel[3];								//Same units of @MPU_ReadAllSensores
+	float gyro[3];
+	float mag[3];								//Last magnetometer sample, it is kept when the AK8963 has no new data
+	uint32_t timestamp_ms;						//Port time at the read
+	uint32_t sequence;							//Incremented at each published sample
+}MPU_RTOS_SAMPLE;
+
+typedef struct{
+	uint32_t samples;							//Samples published by the sampling task
+	uint32_t lock_taken;						//Bus lock acquisitions
+	uint32_t lock_contended;					//Acquisitions that found the lock with another task
+	uint32_t reader_retries;					//Latest sample copies repeated because a publish happened during the copy
+}MPU_RTOS_STATS;
+
+/*
+ * RTOS functions
+ */
+uint8_t MPU_RtosInit();
+uint8_t MPU_RtosStartSampling(uint32_t period_ms, uint32_t priority);
+void MPU_RtosStopSampling();
+void MPU_RtosDataReadyFromISR();
+uint32_t MPU_RtosGetLatest(MPU_RTOS_SAMPLE *sample);
+void MPU_RtosGetStats(MPU_RTOS_STATS *stats);
+
+/*
+ * Port functions, implemented by one port file
+ */
+void *MPU_PortMutexCreate();
+uint8_t MPU_PortMutexTryLock(void *mutex);
+void MPU_PortMutexLock(void *mutex);
+void MPU_PortMutexUnlock(void *mutex);
+uint8_t MPU_PortTaskCreate(void (*entry)(void *), void *argument, uint32_t priority, uint32_t stack_bytes);
+void MPU_PortTaskExit(volatile uint8_t *stopped);				/* Clears the task state of the port, then sets *stopped */
+void MPU_PortSleepPeriod(uint32_t period_ms);
+uint8_t MPU_PortWaitSignal(uint32_t timeout_ms);
+void MPU_PortSignalFromISR();
+uint32_t MPU_PortTimeMs();
+
+#endif /* INC_MPU_RTOS_H_ */
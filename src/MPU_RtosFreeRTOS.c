@@ -0,0 +1,92 @@
+/*
+ * MPU_RtosFreeRTOS.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+/*
+ * FreeRTOS port of MPU_Rtos.c, compiled when MPU_RTOS_FREERTOS is defined.
+ * The bus lock is a recursive mutex, FreeRTOS mutexes have priority inheritance. The data-ready signal is a direct task notification.
+ */
+
+#include "MPU_Rtos.h"
+
+#if defined(MPU_USE_RTOS) && defined(MPU_RTOS_FREERTOS)
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+static TaskHandle_t samplingTask = NULL;
+static TickType_t lastWake;
+
+void *MPU_PortMutexCreate(){
+
+	return xSemaphoreCreateRecursiveMutex();
+}
+
+uint8_t MPU_PortMutexTryLock(void *mutex){
+
+	return xSemaphoreTakeRecursive((SemaphoreHandle_t)mutex, 0) == pdTRUE;
+}
+
+void MPU_PortMutexLock(void *mutex){
+
+	xSemaphoreTakeRecursive((SemaphoreHandle_t)mutex, portMAX_DELAY);
+}
+
+void MPU_PortMutexUnlock(void *mutex){
+
+	xSemaphoreGiveRecursive((SemaphoreHandle_t)mutex);
+}
+
+uint8_t MPU_PortTaskCreate(void (*entry)(void *), void *argument, uint32_t priority, uint32_t stack_bytes){
+
+	lastWake = xTaskGetTickCount();
+
+	if(xTaskCreate(entry, "mpu", stack_bytes / sizeof(StackType_t), argument, priority, &samplingTask) != pdPASS)
+		return RTOS_ERROR;
+
+	return RTOS_OK;
+}
+
+void MPU_PortTaskExit(volatile uint8_t *stopped){
+
+	samplingTask = NULL;										/* Before stopped, a restart must not lose its new handle */
+	*stopped = 1;
+	vTaskDelete(NULL);
+}
+
+void MPU_PortSleepPeriod(uint32_t period_ms){
+
+	if(period_ms == 0 || xTaskGetCurrentTaskHandle() != samplingTask){
+		vTaskDelay(1);
+		return;
+	}
+
+	vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(period_ms));		/* Fixed rate, the read time does not add to the period */
+}
+
+uint8_t MPU_PortWaitSignal(uint32_t timeout_ms){
+
+	return ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout_ms)) != 0;
+}
+
+void MPU_PortSignalFromISR(){
+
+	BaseType_t woken = pdFALSE;
+
+	if(samplingTask == NULL)
+		return;
+
+	vTaskNotifyGiveFromISR(samplingTask, &woken);
+	portYIELD_FROM_ISR(woken);
+}
+
+uint32_t MPU_PortTimeMs(){
+
+	return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+#endif
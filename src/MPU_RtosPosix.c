@@ -0,0 +1,174 @@
+/*
+ * MPU_RtosPosix.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+/*
+ * POSIX threads port of MPU_Rtos.c, compiled when MPU_RTOS_POSIX is defined. Used to run the driver on Linux (with a HAL of the host)
+ * and to load test the bus lock and the latest sample with many reader threads (linux/MPU_TestRtos.c).
+ * The bus lock is a recursive mutex with PTHREAD_PRIO_INHERIT. The sampling thread asks for SCHED_FIFO at the given priority and
+ * falls back to the default policy when the process has no permission for it.
+ */
+
+#include "MPU_Rtos.h"
+
+#if defined(MPU_USE_RTOS) && defined(MPU_RTOS_POSIX)
+
+#include <pthread.h>
+#include <limits.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <time.h>
+
+static pthread_mutex_t signalMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t signalCondition = PTHREAD_COND_INITIALIZER;
+static uint32_t signalCount = 0;
+static struct timespec lastWake;
+static void (*taskEntry)(void *);							/* Entry and argument of the sampling task, one runs at a time */
+static void *taskArgument;
+
+static void *TaskTrampoline(void *unused);
+
+void *MPU_PortMutexCreate(){
+
+	pthread_mutexattr_t attributes;
+	pthread_mutex_t *mutex = malloc(sizeof(pthread_mutex_t));
+
+	if(mutex == NULL)
+		return NULL;
+
+	pthread_mutexattr_init(&attributes);
+	pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutexattr_setprotocol(&attributes, PTHREAD_PRIO_INHERIT);
+
+	if(pthread_mutex_init(mutex, &attributes) != 0){
+		free(mutex);
+		mutex = NULL;
+	}
+
+	pthread_mutexattr_destroy(&attributes);
+
+	return mutex;
+}
+
+uint8_t MPU_PortMutexTryLock(void *mutex){
+
+	return pthread_mutex_trylock((pthread_mutex_t *)mutex) == 0;
+}
+
+void MPU_PortMutexLock(void *mutex){
+
+	pthread_mutex_lock((pthread_mutex_t *)mutex);
+}
+
+void MPU_PortMutexUnlock(void *mutex){
+
+	pthread_mutex_unlock((pthread_mutex_t *)mutex);
+}
+
+uint8_t MPU_PortTaskCreate(void (*entry)(void *), void *argument, uint32_t priority, uint32_t stack_bytes){
+
+	pthread_attr_t attributes;
+	struct sched_param parameters = {.sched_priority = priority};
+	pthread_t thread;
+	int error;
+
+	clock_gettime(CLOCK_MONOTONIC, &lastWake);
+
+	pthread_attr_init(&attributes);
+	pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+	if(stack_bytes < PTHREAD_STACK_MIN)
+		stack_bytes = PTHREAD_STACK_MIN;
+	pthread_attr_setstacksize(&attributes, stack_bytes);
+	pthread_attr_setinheritsched(&attributes, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy(&attributes, SCHED_FIFO);
+	pthread_attr_setschedparam(&attributes, &parameters);
+
+	taskEntry = entry;
+	taskArgument = argument;
+
+	error = pthread_create(&thread, &attributes, TaskTrampoline, NULL);
+
+	if(error != 0){												/* No real time permission, default policy */
+		pthread_attr_setinheritsched(&attributes, PTHREAD_INHERIT_SCHED);
+		error = pthread_create(&thread, &attributes, TaskTrampoline, NULL);
+	}
+
+	pthread_attr_destroy(&attributes);
+
+	return error == 0 ? RTOS_OK : RTOS_ERROR;
+}
+
+void MPU_PortTaskExit(volatile uint8_t *stopped){
+
+	*stopped = 1;
+	pthread_exit(NULL);
+}
+
+void MPU_PortSleepPeriod(uint32_t period_ms){
+
+	struct timespec wake;
+
+	if(period_ms == 0){
+		sched_yield();
+		return;
+	}
+
+	lastWake.tv_nsec += (long)period_ms * 1000000;				/* Fixed rate, the read time does not add to the period */
+	lastWake.tv_sec += lastWake.tv_nsec / 1000000000;
+	lastWake.tv_nsec %= 1000000000;
+	wake = lastWake;
+
+	while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL) != 0);
+}
+
+uint8_t MPU_PortWaitSignal(uint32_t timeout_ms){
+
+	struct timespec deadline;
+	uint8_t signaled;
+
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+	deadline.tv_sec += timeout_ms / 1000 + deadline.tv_nsec / 1000000000;
+	deadline.tv_nsec %= 1000000000;
+
+	pthread_mutex_lock(&signalMutex);
+	while(signalCount == 0 && pthread_cond_timedwait(&signalCondition, &signalMutex, &deadline) == 0);
+	signaled = signalCount != 0;
+	signalCount = 0;
+	pthread_mutex_unlock(&signalMutex);
+
+	return signaled;
+}
+
+void MPU_PortSignalFromISR(){
+
+	pthread_mutex_lock(&signalMutex);
+	signalCount++;
+	pthread_cond_signal(&signalCondition);
+	pthread_mutex_unlock(&signalMutex);
+}
+
+uint32_t MPU_PortTimeMs(){
+
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint32_t)(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+/*
+ * @brief:  Internal function, pthread entry of the task, so the port entry keeps the void (*)(void *) type of the other ports
+ */
+static void *TaskTrampoline(void *unused){
+
+	(void)unused;
+	taskEntry(taskArgument);
+
+	return NULL;
+}
+
+#endif
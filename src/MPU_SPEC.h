@@ -22,6 +22,20 @@ typedef struct {
 	uint8_t data_cmd;					//holds information that will be send to make some register configuration, each mpu register will have
 }MPU_REGISTER;							//a data byte to save the actual information at the register mpu in mcu code.
 
+/*
+ * Bus lock, taken by every driver operation that needs more than one transaction (recursive, so the operations can be nested).
+ * Define MPU_USE_RTOS and add MPU_Rtos.c to give it a mutex with priority inheritance, otherwise it costs nothing
+ */
+#ifdef MPU_USE_RTOS
+void MPU_BusLock();
+void MPU_BusUnlock();
+#define MPU_BUS_LOCK()			MPU_BusLock()
+#define MPU_BUS_UNLOCK()		MPU_BusUnlock()
+#else
+#define MPU_BUS_LOCK()
+#define MPU_BUS_UNLOCK()
+#endif
+
 /*
  * Possible axis that can be disabled
  */
@@ -79,6 +93,12 @@ typedef enum{
 	RESET_TEMP			= 0x1
 }RESET_SENSOR_SIGNAL_PATH;
 
+/*
+ * Clock sources of PWR_MGMT_1 CLKSEL
+ */
+#define CLKSEL_INTERNAL			0					//20 MHz internal oscillator, several % of error
+#define CLKSEL_AUTO_PLL			1					//Gyro PLL when it is ready, selected by @MPU_Init
+
 I2C_HandleTypeDef mpu_i2c_comm;						//Holds the i2c peripheral registers used by the mcu to connect with MPU
 
 //When the IMU comes, it contain the OTP values of the Accel factory trim. (Application note)
@@ -94,6 +114,34 @@ I2C_HandleTypeDef mpu_i2c_comm;						//Holds the i2c peripheral registers used b
 #define accely_factory_trim	 29.5117188
 #define accelz_factory_trim  5.14160156
 
+/*
+ * Self-test, procedure and criteria of the InvenSense MPU-9250 self-test application note and AK8963 datasheet
+ */
+#define SELF_TEST_SAMPLES			200					//Samples averaged with and without self-test, 1 kHz so 200 ms each
+#define SELF_TEST_SETTLE_MS			20					//Stabilization after toggling the self-test bits
+#define SELF_TEST_SAMPLE_TIMEOUT_MS	5					//Maximum wait for one data ready, bounds the whole test
+#define SELF_TEST_GYRO_MIN_RATIO	0.5					//Minimum response / factory response
+#define SELF_TEST_ACCEL_MIN_RATIO	0.5
+#define SELF_TEST_ACCEL_MAX_RATIO	1.5
+#define SELF_TEST_GYRO_MIN_DPS		60					//Minimum response when the OTP code is 0
+#define SELF_TEST_GYRO_MAX_OFFSET	20					//Maximum gyro offset in °/s
+#define SELF_TEST_ACCEL_MIN_MG		225					//Response range when the OTP code is 0
+#define SELF_TEST_ACCEL_MAX_MG		675
+
+#define MAG_SELF_TEST_XY_LIMIT		200					//|HX|, |HY| limit (16 bit output, sensitivity adjusted)
+#define MAG_SELF_TEST_Z_MIN			-3200
+#define MAG_SELF_TEST_Z_MAX			-800
+
+typedef struct{
+	float gyro_response[3];				//Self-test response / factory response, or °/s when the OTP code is 0
+	float accel_response[3];			//Self-test response / factory response, or mg when the OTP code is 0
+	float gyro_offset[3];				//Gyro output without self-test in °/s
+	int16_t mag_response[3];			//AK8963 self-test output, sensitivity adjusted
+	uint8_t gyro_pass;					//Bit 0 X, bit 1 Y, bit 2 Z
+	uint8_t accel_pass;
+	uint8_t mag_pass;
+}MPU_SELF_TEST_RESULT;
+
 /*
  *	All of accelerometer specific definition will be placed at this place
  *
@@ -136,6 +184,58 @@ typedef enum{
 }MPU_GYRO_SCALE;
 
 float gyro_sensitivity_used;			//Currently gyroscope sensitivity used by the MPU
+
+/*
+ * 	All of temperature compensated bias model specific definition will be placed at this place
+ * 	The bias is stored at a table of temperature bins, the read path interpolates between the two bins around the die temperature
+ */
+#define TEMP_BIAS_BINS				16					//Number of temperature bins of the model
+#define TEMP_BIAS_MIN_C				-10.0				//Lower edge of the first bin in °C
+#define TEMP_BIAS_BIN_WIDTH_C		5.0					//Width of each bin in °C
+#define TEMP_BIAS_MIN_SAMPLES		50					//Samples needed before a bin is used at the read path
+#define TEMP_BIAS_MAX_WEIGHT		1000				//After this number of samples one bin behaves like an exponential average
+#define TEMP_BIAS_STILL_GYRO		2.0					//Maximum angular velocity (°/s, bias removed) to consider the device stationary
+#define TEMP_BIAS_STILL_ACCEL		0.3					//Maximum | |a| - 1g | (accel units) to consider the device stationary
+
+typedef struct{
+	float gyro_bias[TEMP_BIAS_BINS][3];			//Gyro bias (°/s) of each bin
+	float accel_bias[TEMP_BIAS_BINS][3];		//Accel bias along gravity (accel units) left after the six position calibration
+	uint16_t samples[TEMP_BIAS_BINS];			//Number of stationary samples used by each bin
+}MPU_TEMP_BIAS_MODEL;							//Store it with the rest of the calibration, see MPU_TempBiasGetModel/MPU_TempBiasSetModel
+
+/*
+ * 	All of adaptive calibration specific definition will be placed at this place
+ * 	Samples are grouped in blocks of CALIB_BLOCK_SAMPLES and the mean and variance of the block means are tracked with Welford's method,
+ * 	so the correlation between consecutive samples (DLPF) does not make the interval look narrower than it is.
+ * 	The averaging stops when z * std / sqrt(blocks) of every axis is below the tolerance
+ */
+#define CALIB_BLOCK_SAMPLES			8					//Samples averaged into one block
+#define CALIB_CONFIDENCE_Z			3.0					//Half width of the interval in standard errors (99.7 %)
+#define CALIB_WARMUP_BLOCKS			4					//Blocks before the motion test and the stop test are used
+#define CALIB_RESTART_REJECTS		64					//Consecutive rejected samples that restart the averaging (device moved)
+#define CALIB_SAMPLE_TIMEOUT_MS		5					//Maximum wait for one data ready
+#define CALIB_GYRO_TOLERANCE		0.02				//Default interval half width of @MPU_GyroCalibrateAdaptive, °/s
+#define CALIB_ACCEL_TOLERANCE		0.002				//Default interval half width of @MPU_AccelCalibrateAdaptive, g
+#define CALIB_GYRO_MOTION			1.0					//Default gyro motion threshold, °/s from the running mean
+#define CALIB_ACCEL_MOTION			0.05				//Default accel motion threshold, g from the running mean
+#define CALIB_MAX_SAMPLES			2000				//Default limit of samples read, the averaging stops without convergence
+
+typedef struct{
+	float tolerance;					//Half width of the confidence interval to reach, °/s for the gyro and g for the accel
+	float gyro_motion;					//A sample is rejected when one gyro axis is this far (°/s) from its running mean
+	float accel_motion;					//or one accel axis this far (g) from its running mean
+	uint16_t max_samples;				//Samples read limit, accepted and rejected
+}MPU_CALIB_CONFIG;
+
+typedef struct{
+	float mean[3];						//Averaged sensor output, °/s or accel output unit (see USE_SI)
+	float std[3];						//Standard deviation of one sample, same unit
+	float uncertainty[3];				//Achieved half width of the confidence interval of the mean, same unit
+	uint16_t samples;					//Accepted samples used by the mean
+	uint16_t rejected;					//Samples rejected by the motion test
+	uint8_t restarts;					//Times the averaging restarted after CALIB_RESTART_REJECTS
+	uint8_t converged;					//1 if every axis reached the tolerance before max_samples
+}MPU_CALIB_REPORT;
 /*
  * 	All of MPU fifo specific definition will be placed at this place
  *
@@ -158,6 +258,29 @@ float gyro_sensitivity_used;			//Currently gyroscope sensitivity used by the MPU
 #define FIFO_ENABLE_ACCEL		1
 #define FIFO_DISABLE_ACCEL		0
 
+#define FIFO_MAX_BURST_BYTES	255					//__MPU_READ length is one byte, so bigger reads are split in whole frames
+
+#define RAW_FRAME_BYTES			21					//@MPU_ReadAllRaw frame: the 14 bytes burst, HXL..HZH of the AK8963 and a status byte
+#define RAW_FRAME_MAG_NEW		0x01				//Status bit, HXL..HZH is a new measurement (otherwise the last one is repeated)
+
+/*
+ * Batch (structure of arrays) output, one array per channel so filters can consume blocks directly
+ */
+#define MPU_BATCH_ALIGN			16					//Alignment in bytes of the caller buffers (one 128 bit SIMD register)
+#define MPU_BATCH_PADDED(n)		(((n) + 3) & ~3)	//Number of elements rounded up to a multiple of 4 floats
+
+#define MPU_BATCH_BUFFER(name, n)	float name[MPU_BATCH_PADDED(n)] __attribute__((aligned(MPU_BATCH_ALIGN)))
+
+typedef struct{
+	float *ax, *ay, *az;				//Calibrated acceleration, one array per axis
+	float *gx, *gy, *gz;				//Bias removed angular velocity, one array per axis
+	float *temp;						//IC temperature, can be NULL if not needed
+	uint16_t capacity;					//Number of elements of each array, must be a multiple of 4 (see MPU_BATCH_PADDED)
+	uint16_t length;					//Number of valid samples written by the last batch read
+	uint8_t *ext;						//External sensor bytes of the fifo frames (ext_size per sample), NULL if not needed
+	uint8_t ext_size;					//Bytes of external sensors at each sample, written by the fifo read
+}MPU_SOA_BATCH;
+
 /*
  *
  * All of MPU magnetometer AK8963 specific definition will be placed at this place
@@ -186,6 +309,122 @@ typedef enum{
 
 float magx_Adj, magy_Adj, magz_Adj;
 
+/*
+ * All of auxiliary i2c master specific definition will be placed at this place
+ * SLV0 and SLV4 are used by the magnetometer, SLV1 to SLV3 read other sensors behind the MPU at every sample into EXT_SENS_DATA
+ */
+#define AUX_SLAVE_MAX_BYTES			15					//I2C_SLVx_LENG is 4 bits
+#define AUX_EXT_SENS_BYTES			24					//EXT_SENS_DATA_00 to EXT_SENS_DATA_23, shared by all of the slaves
+#define AUX_TIMEOUT_MS				10					//Maximum wait for one SLV4 transaction
+#define AUX_MAG_READ_BYTES			8					//SLV0 length while slaves 1 to 3 are attached (ST1..ST2), their offsets do not move
+
+#define AUX_OK						0
+#define AUX_NACK					1					//External sensor did not acknowledge
+#define AUX_TIMEOUT					2
+#define AUX_INVALID					3					//Slave number, length or EXT_SENS_DATA space not valid
+
+typedef struct{
+	uint8_t addr;						//7 bits i2c address of the external sensor
+	uint8_t reg;						//First register read at each sample
+	uint8_t length;						//Bytes read at each sample, 1 to AUX_SLAVE_MAX_BYTES
+	uint8_t swap;						//1 to swap the bytes of each word, for little endian sensors
+	uint8_t delayed;					//1 to read only every 1 + delay samples, see @MPU_AuxSetDelay
+	uint8_t to_fifo;					//1 to write the bytes at fifo after the gyro data
+}MPU_AUX_SLAVE;
+
+/*
+ * All of bus scheduler specific definition will be placed at this place
+ * While the writes are deferred, the register writes are queued and sent at the flush: writes to adjacent registers of the same device
+ * become one auto-increment burst, and the queued operations are served by priority (in order inside the same priority)
+ */
+#define BUS_QUEUE_SIZE				32					//Queued operations, the queue is flushed when full
+#define BUS_MAX_BURST				16					//Registers written by one coalesced burst
+
+typedef enum{
+	MPU_BUS_PRIORITY_SAMPLE		= 0,					/* Data register reads, served first */
+	MPU_BUS_PRIORITY_NORMAL		= 1,
+	MPU_BUS_PRIORITY_CONFIG		= 2						/* Configuration traffic, deferred writes use it */
+}MPU_BUS_PRIORITY;
+
+#define BUS_PRIORITIES				3
+
+typedef struct{
+	uint32_t requested;					//Start/stop transactions that the operations would take one by one
+	uint32_t issued;					//Transactions sent to the bus
+	uint32_t saved;						//requested - issued
+	uint32_t bursts;					//Coalesced write bursts (two or more registers)
+}MPU_BUS_STATS;
+
+/*
+ * Magnetometer scheduler, one single measurement is triggered by SLV4 every N accel/gyro samples and read back N samples later
+ */
+#define MAG_MEASUREMENT_TIME_MS		9					//Maximum time of one AK8963 single measurement (datasheet)
+#define MAG_CALIB_SAMPLE_TIMEOUT_MS	200					//Maximum wait for one sample of @MPU_MagCalibrate, above the 125 ms of the 8 Hz mode
+
+#define MAG_SCHEDULER_OK			0
+#define MAG_SCHEDULER_TOO_FAST		1					//divisor / imu rate is shorter than one measurement plus the read back
+#define MAG_SCHEDULER_TOO_SLOW		2					//divisor above 32, I2C_MST_DLY is 5 bits
+
+typedef struct{
+	uint32_t due;						//Read backs of a triggered measurement
+	uint32_t samples;					//Measurements returned
+	uint32_t not_ready;					//Read backs without ST1 DRDY, the measurement did not end in divisor samples
+	uint32_t overflows;					//Read backs with ST2 HOFL
+}MPU_MAG_SCHEDULER_STATS;
+
+/*
+ * All of wake-on-motion specific definition will be placed at this place
+ * The accel intelligence compares each sample with the previous one and sets WOM_INT (INT_STATUS bit 6) when any axis moved more than WOM_THR
+ */
+#define WOM_THRESHOLD_LSB_MG		4					//WOM_THR resolution, 0 to 1020 mg
+#define WOM_INT_BIT					(1 << 6)			//INT_ENABLE WOM_EN and INT_STATUS WOM_INT
+#define RAW_RDY_INT_BIT				(1 << 0)
+
+typedef enum{
+	WOM_CONTINUOUS		= 0xFF,							/* Keep the normal sampling, WOM only adds its interrupt */
+	WOM_ODR_0_24HZ		= 0,							/* Accel only low power cycle, LP_ACCEL_ODR codes */
+	WOM_ODR_0_49HZ		= 1,
+	WOM_ODR_0_98HZ		= 2,
+	WOM_ODR_1_95HZ		= 3,
+	WOM_ODR_3_91HZ		= 4,
+	WOM_ODR_7_81HZ		= 5,
+	WOM_ODR_15_63HZ		= 6,
+	WOM_ODR_31_25HZ		= 7,
+	WOM_ODR_62_50HZ		= 8,
+	WOM_ODR_125HZ		= 9,
+	WOM_ODR_250HZ		= 10,
+	WOM_ODR_500HZ		= 11
+}MPU_WOM_ODR;
+
+/*
+ * All of configuration profile specific definition will be placed at this place
+ * A profile holds every field of the sampling configuration, it is checked without the device by @MPU_ProfileValidate and applied as
+ * three bursts over the contiguous ranges 0x19-0x1D (SMPLRT_DIV..ACCEL_CONFIG2), 0x23-0x27 (FIFO_EN..I2C_SLV0_CTRL) and
+ * 0x6A-0x6C (USER_CTRL..PWR_MGMT_2). The aux i2c master bits (SLV0, I2C_MST_CTRL, I2C_MST_EN and the slave bits of FIFO_EN) belong
+ * to the magnetometer and @MPU_AuxAttach, they are written with their current values
+ */
+#define PROFILE_OK					0
+#define PROFILE_INVALID_SCALE		1
+#define PROFILE_INVALID_FILTER		2					//DLPF code above 7 or FCHOICE_B out of range
+#define PROFILE_INVALID_FIFO		3					//Slave bits at fifo_enable (see @MPU_AuxAttach) or fifo_mode above 1
+#define PROFILE_INVALID_CLOCK		4					//CLKSEL 6 is reserved and 7 stops the clock
+#define PROFILE_INVALID_POWER		5					//Disable axis code above 7
+
+typedef struct{
+	uint8_t sample_rate_div;			//SMPLRT_DIV, rate = 1 kHz / (1 + div) while the DLPF is used
+	DLPF gyro_dlpf;						//CONFIG DLPF_CFG, gyro and temperature, see @MPU_GyroTempLowPassFilterConfig
+	uint8_t gyro_fchoice_b;				//GYRO_CONFIG FCHOICE_B, GYRO_FCHOICE11 (0) to use the DLPF
+	MPU_GYRO_SCALE gyro_scale;
+	MPU_ACCEL_SCALE accel_scale;
+	uint8_t accel_fchoice_b;			//ACCEL_CONFIG2 bit 3, 0 to use the DLPF, see @MPU_AccelLowPassFilterConfig
+	DLPF accel_dlpf;
+	uint8_t fifo_enable;				//FIFO_EN bits 7 to 3 (temperature, gyro X, Y, Z, accel), 0 to disable the fifo
+	uint8_t fifo_mode;					//FIFO_MODE_OVERRIDE or FIFO_MODE_NOT_OVERRIDE
+	uint8_t clock_source;				//PWR_MGMT_1 CLKSEL, CLKSEL_AUTO_PLL or CLKSEL_INTERNAL
+	MPU_DISABLE_AXIS accel_disable;
+	MPU_DISABLE_AXIS gyro_disable;
+}MPU_CONFIG_PROFILE;
+
 
 /*
  * MPU-9250 available registers
@@ -328,38 +567,68 @@ void MPU_ResetDataRegisters();
 void MPU_SignalPathReset(RESET_SENSOR_SIGNAL_PATH sensor_to_reset);
 void MPU_ResetWholeIC();
 uint8_t MPU_ReadAllSensores(float accel_data[], float gyro_data[], float mag_data[]);
+uint8_t MPU_ReadAllRaw(uint8_t frame[]);
+uint8_t MPU_ImuReadRaw(int16_t accel_raw[], int16_t gyro_raw[]);
+float MPU_SampleRateNominal();
+void MPU_ConvertRawScaled(const int16_t accel_raw[], const int16_t gyro_raw[], MPU_ACCEL_SCALE accel_scale, MPU_GYRO_SCALE gyro_scale,
+						  float accel_data[], float gyro_data[]);
 float MPU_Temperature_Read();
+uint8_t MPU_SelfTest(MPU_SELF_TEST_RESULT *result);
+void MPU_I2CHandleInit(I2C_HandleTypeDef *handle, uint8_t I2Cx);
 /*
  * Fifo functions
  */
 int16_t MPU_FifoReadData();
 int16_t MPU_FifoCounter();
 void MPU_FifoConfig(uint8_t enable_mpu_components, uint8_t fifo_mode);
+uint16_t MPU_FifoReadBatch(MPU_SOA_BATCH *batch);
+uint16_t MPU_FifoReadBatchRaw(MPU_SOA_BATCH *batch);
+uint16_t MPU_FifoReadRaw(uint8_t data[], uint16_t max_frames);
+uint8_t MPU_FifoFrameBytes();
+void MPU_BatchConvert(MPU_SOA_BATCH *batch);
+uint16_t MPU_BurstReadBatch(MPU_SOA_BATCH *batch, uint16_t numberOfSamples);
 
 /*
  * Accelerometer functions
  */
 float MPU_AccelRead(AXIS axis);
+void MPU_AccelReadVector(float accel_data[]);
 void MPU_AccelScaleChange(MPU_ACCEL_SCALE new_scale);
 void MPU_AccelLowPassFilterConfig(uint8_t ACCEL_FCHOICE, uint8_t A_DLPF_CFG);
 void MPU_AccelOffset(AXIS axis, float value);
 void MPU_AccelCalibrate(uint16_t numberOfSamples, UART_HandleTypeDef *uart);
+uint8_t MPU_AccelCalibrateAdaptive(const MPU_CALIB_CONFIG *config, UART_HandleTypeDef *uart, MPU_CALIB_REPORT report[6]);
 uint8_t MPU_GetFlagAccelCalibrated();
+uint8_t MPU_AccelReadRaw(int16_t accel_raw[]);
 
 /*
  * Gyroscope functions
  */
 float MPU_GyroRead(AXIS axis);
+void MPU_GyroReadVector(float gyro_data[]);
 void MPU_GyroScaleChange(MPU_GYRO_SCALE new_scale);
 void MPU_GyroTempLowPassFilterConfig(uint8_t FCHOICE, DLPF DLPF_CFG);
 void MPU_GyroOffset(AXIS axis, float value);
 void MPU_GyroCalibrate(uint16_t numberOfSamples);
+uint8_t MPU_GyroCalibrateAdaptive(const MPU_CALIB_CONFIG *config, MPU_CALIB_REPORT *report);
 uint8_t MPU_GetFlagGyroCalibrated();
+void MPU_GyroAdjustBias(const float delta[]);
+void MPU_GyroGetBias(float bias[]);
+uint8_t MPU_GyroBiasOffload();
 /*
  * Temperature sensor functions
  */
 int16_t MPU_ReadIC_Temperature();
 
+/*
+ * Temperature compensated bias model functions
+ */
+void MPU_TempBiasEnable(uint8_t enable);
+uint8_t MPU_TempBiasLearn();
+void MPU_TempBiasGetModel(MPU_TEMP_BIAS_MODEL *model);
+void MPU_TempBiasSetModel(const MPU_TEMP_BIAS_MODEL *model);
+void MPU_TempBiasClear();
+
 /*
  * Magnetometer functions
  *
@@ -368,9 +637,57 @@ uint8_t MPU_MagGetInfo();
 uint8_t MPU_MagGetStatus1();
 uint8_t MPU_MagGetStatus2();
 float MPU_MagRead(AXIS axis);
+uint8_t MPU_MagReadVector(float mag_data[]);
 uint8_t MPU_MagWhoAmI();
 uint8_t MPU_MagConfigControl2(uint8_t reset);
 void MPU_MagI2CDisable();
-void MPU_MagCalibrate(uint16_t numberOfSamples, UART_HandleTypeDef *uart);
+uint8_t MPU_MagCalibrate(uint16_t numberOfSamples, UART_HandleTypeDef *uart);
+uint8_t MPU_GetFlagMagCalibrated();
+void MPU_MagGetCorrection(float soft_iron[], float hard_iron[]);
+void MPU_MagSetCorrection(const float soft_iron[], const float hard_iron[]);
+uint8_t MPU_MagSchedulerStart(uint8_t divisor, float imu_rate_hz);
+uint8_t MPU_MagSchedulerTick(float mag_data[]);
+void MPU_MagSchedulerStop();
+void MPU_MagSchedulerGetStats(MPU_MAG_SCHEDULER_STATS *stats);
+
+/*
+ * Auxiliary i2c functions
+ */
+uint8_t MPU_AuxAttach(uint8_t slave, const MPU_AUX_SLAVE *config);
+void MPU_AuxDetach(uint8_t slave);
+void MPU_AuxSetDelay(uint8_t delay);
+uint8_t MPU_AuxWrite(uint8_t addr, uint8_t reg, uint8_t value);
+uint8_t MPU_AuxReadByte(uint8_t addr, uint8_t reg, uint8_t *value);
+uint8_t MPU_AuxDataOffset(uint8_t slave);
+void MPU_AuxRead(uint8_t slave, uint8_t data[]);
+uint8_t MPU_AuxBurstRead(uint8_t raw[]);
+uint8_t MPU_AuxFifoBytes();
+
+/*
+ * Bus scheduler functions
+ */
+void MPU_BusDeferBegin();
+uint8_t MPU_BusDeferEnd();
+uint8_t MPU_BusQueueWrite(MPU_REGISTER reg, uint8_t addr, MPU_BUS_PRIORITY priority);
+uint8_t MPU_BusQueueRead(MPU_REGISTER reg, uint8_t number_of_bytes, uint8_t data_return[], uint8_t addr, MPU_BUS_PRIORITY priority);
+uint8_t MPU_BusFlush();
+void MPU_BusGetStats(MPU_BUS_STATS *stats);
+void MPU_BusResetStats();
+
+/*
+ * Interrupt functions
+ */
+void MPU_WakeOnMotionEnable(uint16_t threshold_mg, MPU_WOM_ODR odr);
+void MPU_WakeOnMotionDisable();
+uint8_t MPU_InterruptStatus();
+
+/*
+ * Configuration profile functions
+ */
+uint8_t MPU_ProfileValidate(const MPU_CONFIG_PROFILE *profile);
+uint8_t MPU_ProfileApply(const MPU_CONFIG_PROFILE *profile);
+void MPU_ProfileGet(MPU_CONFIG_PROFILE *profile);
+void MPU_ProfileReapply();
+uint8_t MPU_ProfileVerify();
 
 #endif /* INC_MPU_SPEC_H_ */
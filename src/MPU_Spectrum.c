@@ -0,0 +1,302 @@
+/*
+ * MPU_Spectrum.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+/*
+ * On-device vibration spectrum, fed by blocks of one accelerometer channel (for example batch.az after @MPU_FifoReadBatch).
+ * Only the summary (band energies, peak, RMS) needs to leave the device, the full PSD stays available at MPU_SPECTRUM.psd
+ */
+
+#include "MPU_Spectrum.h"
+#include <math.h>
+
+#ifdef SPECTRUM_USE_CMSIS
+#include "arm_math.h"
+static arm_rfft_fast_instance_f32 rfftInstance;
+#else
+static float twiddleCos[SPECTRUM_FFT_SIZE / 2 + 1];		/* cos(2*pi*k/N) */
+static float twiddleSin[SPECTRUM_FFT_SIZE / 2 + 1];		/* sin(2*pi*k/N) */
+#endif
+
+static float window[SPECTRUM_FFT_SIZE];
+static float windowPower;								/* Sum of the squared window, used at the PSD scale */
+static uint8_t tablesReady = 0;
+
+static void SpectrumTables();
+static uint8_t SpectrumFrame(MPU_SPECTRUM *spectrum);
+static void SpectrumSummary(MPU_SPECTRUM *spectrum);
+static void RealFftPower(float *x, float *power);
+#ifndef SPECTRUM_USE_CMSIS
+static void ComplexFft(float *buffer, uint16_t size);
+#endif
+
+/*
+ * @brief:  Initialize one spectrum engine
+ * @param:  spectrum - Engine state
+ * 			sample_rate_hz - Rate of the samples that will be fed
+ * 			band_edges_hz - SPECTRUM_BANDS + 1 increasing frequencies, band b goes from band_edges_hz[b] to band_edges_hz[b + 1]
+ * @retval: None
+ */
+void MPU_SpectrumInit(MPU_SPECTRUM *spectrum, float sample_rate_hz, const float band_edges_hz[]){
+
+	memset(spectrum, 0, sizeof(MPU_SPECTRUM));
+
+	spectrum->sample_rate_hz = sample_rate_hz;
+	memcpy(spectrum->band_edges_hz, band_edges_hz, sizeof(spectrum->band_edges_hz));
+
+	if(!tablesReady)
+		SpectrumTables();
+}
+
+/*
+ * @brief:  Feed one block of samples. Each time SPECTRUM_HOP new samples complete a frame it is transformed and accumulated,
+ * 			so the work is spread along the blocks
+ * @param:  spectrum - Engine state
+ * 			samples - New samples, oldest first
+ * 			count - Number of samples
+ * @retval: 1 if a new summary is ready, see @MPU_SpectrumGetSummary
+ */
+uint8_t MPU_SpectrumFeed(MPU_SPECTRUM *spectrum, const float samples[], uint16_t count){
+
+	uint8_t new_summary = 0;
+	uint16_t n;
+
+	for(uint16_t i = 0; i < count; i += n){
+
+		n = count - i;
+		if(n > SPECTRUM_FFT_SIZE - spectrum->fill)
+			n = SPECTRUM_FFT_SIZE - spectrum->fill;
+
+		memcpy(&spectrum->frame[spectrum->fill], &samples[i], n * sizeof(float));
+		spectrum->fill += n;
+
+		if(spectrum->fill == SPECTRUM_FFT_SIZE){
+
+			new_summary |= SpectrumFrame(spectrum);
+
+			memmove(spectrum->frame, &spectrum->frame[SPECTRUM_HOP], (SPECTRUM_FFT_SIZE - SPECTRUM_HOP) * sizeof(float));
+			spectrum->fill = SPECTRUM_FFT_SIZE - SPECTRUM_HOP;
+		}
+	}
+
+	return new_summary;
+}
+
+/*
+ * @brief:  Take the last summary
+ * @param:  spectrum - Engine state
+ * 			summary - Where the summary will be copied
+ * @retval: 1 if the summary is new since the last call, 0 otherwise (summary is still copied)
+ */
+uint8_t MPU_SpectrumGetSummary(MPU_SPECTRUM *spectrum, MPU_SPECTRUM_SUMMARY *summary){
+
+	uint8_t ready = spectrum->summary_ready;
+
+	memcpy(summary, &spectrum->summary, sizeof(MPU_SPECTRUM_SUMMARY));
+	spectrum->summary_ready = 0;
+
+	return ready;
+}
+
+/*
+ * @brief:  Internal function, Hann window and FFT tables shared by all of the engines
+ */
+static void SpectrumTables(){
+
+	windowPower = 0;
+
+	for(uint16_t n = 0; n < SPECTRUM_FFT_SIZE; n++){
+		window[n] = 0.5 - 0.5 * cosf(2 * M_PI * n / SPECTRUM_FFT_SIZE);		/* Periodic Hann, constant overlap-add at 50% */
+		windowPower += window[n] * window[n];
+	}
+
+#ifdef SPECTRUM_USE_CMSIS
+	arm_rfft_fast_init_f32(&rfftInstance, SPECTRUM_FFT_SIZE);
+#else
+	for(uint16_t k = 0; k <= SPECTRUM_FFT_SIZE / 2; k++){
+		twiddleCos[k] = cosf(2 * M_PI * k / SPECTRUM_FFT_SIZE);
+		twiddleSin[k] = sinf(2 * M_PI * k / SPECTRUM_FFT_SIZE);
+	}
+#endif
+
+	tablesReady = 1;
+}
+
+/*
+ * @brief:  Internal function, window and transform the current frame and add its power to the accumulator
+ * @retval: 1 if the frame completed SPECTRUM_AVERAGES frames and a new summary was made
+ */
+static uint8_t SpectrumFrame(MPU_SPECTRUM *spectrum){
+
+	float work[SPECTRUM_FFT_SIZE];
+	float power[SPECTRUM_BINS];
+	float mean = 0;
+
+#if SPECTRUM_REMOVE_MEAN
+	for(uint16_t n = 0; n < SPECTRUM_FFT_SIZE; n++)
+		mean += spectrum->frame[n];
+	mean /= SPECTRUM_FFT_SIZE;
+#endif
+
+	for(uint16_t n = 0; n < SPECTRUM_FFT_SIZE; n++)
+		work[n] = (spectrum->frame[n] - mean) * window[n];
+
+	RealFftPower(work, power);
+
+	for(uint16_t k = 0; k < SPECTRUM_BINS; k++)
+		spectrum->psd_accumulator[k] += power[k];
+
+	if(++spectrum->frames_accumulated < SPECTRUM_AVERAGES)
+		return 0;
+
+	SpectrumSummary(spectrum);
+
+	return 1;
+}
+
+/*
+ * @brief:  Internal function, average the accumulated power into the one-sided PSD and compute the summary
+ */
+static void SpectrumSummary(MPU_SPECTRUM *spectrum){
+
+	float scale = 1.0 / (spectrum->sample_rate_hz * windowPower * spectrum->frames_accumulated);
+	float bin_width = spectrum->sample_rate_hz / SPECTRUM_FFT_SIZE;
+	float total = 0;
+	float frequency;
+	MPU_SPECTRUM_SUMMARY *summary = &spectrum->summary;
+
+	memset(summary->band_energy, 0, sizeof(summary->band_energy));
+	summary->peak_psd = 0;
+	summary->peak_hz = 0;
+
+	for(uint16_t k = 0; k < SPECTRUM_BINS; k++){
+
+		spectrum->psd[k] = spectrum->psd_accumulator[k] * scale;
+		if(k != 0 && k != SPECTRUM_BINS - 1)
+			spectrum->psd[k] *= 2;							/* One-sided, the negative frequencies are folded */
+
+		spectrum->psd_accumulator[k] = 0;
+
+		if(k == 0)
+			continue;
+
+		frequency = k * bin_width;
+		total += spectrum->psd[k] * bin_width;
+
+		if(spectrum->psd[k] > summary->peak_psd){
+			summary->peak_psd = spectrum->psd[k];
+			summary->peak_hz = frequency;
+		}
+
+		for(uint8_t b = 0; b < SPECTRUM_BANDS; b++){
+			if(frequency >= spectrum->band_edges_hz[b] && frequency < spectrum->band_edges_hz[b + 1])
+				summary->band_energy[b] += spectrum->psd[k] * bin_width;
+		}
+	}
+
+	summary->rms = sqrtf(total);
+	summary->sequence++;
+
+	spectrum->frames_accumulated = 0;
+	spectrum->summary_ready = 1;
+}
+
+#ifdef SPECTRUM_USE_CMSIS
+
+/*
+ * @brief:  Internal function, |X[k]|^2 for k = 0..N/2 of N real samples. x is used as work buffer
+ */
+static void RealFftPower(float *x, float *power){
+
+	float out[SPECTRUM_FFT_SIZE];
+
+	arm_rfft_fast_f32(&rfftInstance, x, out, 0);
+
+	power[0] = out[0] * out[0];
+	power[SPECTRUM_FFT_SIZE / 2] = out[1] * out[1];				/* Nyquist real part is packed at out[1] */
+	arm_cmplx_mag_squared_f32(&out[2], &power[1], SPECTRUM_FFT_SIZE / 2 - 1);
+}
+
+#else
+
+/*
+ * @brief:  Internal function, |X[k]|^2 for k = 0..N/2 of N real samples. x is used as work buffer
+ * 			The real samples are packed as N/2 complex values z[n] = x[2n] + j*x[2n+1], transformed by a N/2 complex FFT and split:
+ * 			X[k] = (Z[k] + Z*[N/2-k])/2 - j*W^k*(Z[k] - Z*[N/2-k])/2, W = exp(-j*2*pi/N)
+ */
+static void RealFftPower(float *x, float *power){
+
+	uint16_t half = SPECTRUM_FFT_SIZE / 2;
+	uint16_t k1, k2;
+	float zr, zi, cr, ci, er, ei, odd_r, odd_i, wr, wi, xr, xi;
+
+	ComplexFft(x, half);
+
+	for(uint16_t k = 0; k <= half; k++){
+
+		k1 = (k == half) ? 0 : k;
+		k2 = (k == 0) ? 0 : half - k;
+
+		zr = x[2 * k1];		zi = x[2 * k1 + 1];
+		cr = x[2 * k2];		ci = -x[2 * k2 + 1];					/* conj(Z[N/2-k]) */
+
+		er = (zr + cr) * 0.5;			ei = (zi + ci) * 0.5;		/* Even samples spectrum */
+		odd_r = (zi - ci) * 0.5;		odd_i = -(zr - cr) * 0.5;	/* Odd samples spectrum, -j*(Z - Z*)/2 */
+
+		wr = twiddleCos[k];		wi = -twiddleSin[k];
+
+		xr = er + wr * odd_r - wi * odd_i;
+		xi = ei + wr * odd_i + wi * odd_r;
+
+		power[k] = xr * xr + xi * xi;
+	}
+}
+
+/*
+ * @brief:  Internal function, in place iterative radix-2 complex FFT of size points (interleaved real, imaginary)
+ */
+static void ComplexFft(float *buffer, uint16_t size){
+
+	uint16_t j = 0, bit, step, a, b;
+	float temp, tr, ti, wr, wi;
+
+	for(uint16_t i = 1; i < size; i++){						/* Bit reversed order */
+
+		for(bit = size >> 1; j & bit; bit >>= 1)
+			j ^= bit;
+		j ^= bit;
+
+		if(i < j){
+			temp = buffer[2 * i];		buffer[2 * i] = buffer[2 * j];			buffer[2 * j] = temp;
+			temp = buffer[2 * i + 1];	buffer[2 * i + 1] = buffer[2 * j + 1];	buffer[2 * j + 1] = temp;
+		}
+	}
+
+	for(uint16_t length = 2; length <= size; length <<= 1){
+
+		step = SPECTRUM_FFT_SIZE / length;					/* exp(-j*2*pi*k/length) = W^(k*step) */
+
+		for(uint16_t i = 0; i < size; i += length){
+			for(uint16_t k = 0; k < length / 2; k++){
+
+				wr = twiddleCos[k * step];
+				wi = -twiddleSin[k * step];
+				a = i + k;
+				b = a + length / 2;
+
+				tr = buffer[2 * b] * wr - buffer[2 * b + 1] * wi;
+				ti = buffer[2 * b] * wi + buffer[2 * b + 1] * wr;
+
+				buffer[2 * b]     = buffer[2 * a] - tr;
+				buffer[2 * b + 1] = buffer[2 * a + 1] - ti;
+				buffer[2 * a]     += tr;
+				buffer[2 * a + 1] += ti;
+			}
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,74 @@
+/*
+ * MPU_Spectrum.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+#ifndef INC_MPU_SPECTRUM_H_
+#define INC_MPU_SPECTRUM_H_
+
+#include "MPU_SPEC.h"
+
+/*
+ * Streaming vibration spectrum (Welch method) of one accelerometer channel:
+ *
+ *		samples -> frames of SPECTRUM_FFT_SIZE with SPECTRUM_HOP new samples each -> Hann window -> real FFT -> |X|^2 averaged
+ *		over SPECTRUM_AVERAGES frames -> PSD, band energies, peak and RMS
+ *
+ * Define SPECTRUM_USE_CMSIS to use arm_rfft_fast_f32 from CMSIS-DSP, otherwise a portable radix-2 real FFT is used.
+ */
+#ifndef SPECTRUM_FFT_SIZE
+#define SPECTRUM_FFT_SIZE		256					//Power of 2
+#endif
+
+#ifndef SPECTRUM_HOP
+#define SPECTRUM_HOP			(SPECTRUM_FFT_SIZE / 2)		//New samples per frame, SPECTRUM_FFT_SIZE/2 is 50% overlap
+#endif
+
+#ifndef SPECTRUM_AVERAGES
+#define SPECTRUM_AVERAGES		8					//Frames averaged for each summary
+#endif
+
+#ifndef SPECTRUM_BANDS
+#define SPECTRUM_BANDS			4					//Number of band energy outputs
+#endif
+
+#ifndef SPECTRUM_REMOVE_MEAN
+#define SPECTRUM_REMOVE_MEAN	1					//Remove the frame mean (gravity) before the window
+#endif
+
+#define SPECTRUM_BINS			(SPECTRUM_FFT_SIZE / 2 + 1)
+
+#if (SPECTRUM_FFT_SIZE & (SPECTRUM_FFT_SIZE - 1)) != 0 || SPECTRUM_FFT_SIZE < 8
+#error "SPECTRUM_FFT_SIZE must be a power of 2"
+#endif
+
+typedef struct{
+	float band_energy[SPECTRUM_BANDS];			//Mean square acceleration at each band, (accel unit)^2
+	float peak_hz;								//Frequency of the highest PSD bin (DC excluded)
+	float peak_psd;								//PSD at the peak, (accel unit)^2/Hz
+	float rms;									//RMS acceleration over the whole spectrum (DC excluded)
+	uint32_t sequence;							//Incremented at each new summary
+}MPU_SPECTRUM_SUMMARY;
+
+typedef struct{
+	float frame[SPECTRUM_FFT_SIZE];				//Last samples, oldest first
+	uint16_t fill;
+	float psd_accumulator[SPECTRUM_BINS];
+	uint16_t frames_accumulated;
+	float psd[SPECTRUM_BINS];					//Last averaged one-sided PSD, (accel unit)^2/Hz
+	float sample_rate_hz;
+	float band_edges_hz[SPECTRUM_BANDS + 1];
+	MPU_SPECTRUM_SUMMARY summary;
+	uint8_t summary_ready;
+}MPU_SPECTRUM;
+
+/*
+ * Spectrum functions
+ */
+void MPU_SpectrumInit(MPU_SPECTRUM *spectrum, float sample_rate_hz, const float band_edges_hz[]);
+uint8_t MPU_SpectrumFeed(MPU_SPECTRUM *spectrum, const float samples[], uint16_t count);
+uint8_t MPU_SpectrumGetSummary(MPU_SPECTRUM *spectrum, MPU_SPECTRUM_SUMMARY *summary);
+
+#endif /* INC_MPU_SPECTRUM_H_ */
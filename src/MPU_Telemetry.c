@@ -0,0 +1,271 @@
+/*
+ * MPU_Telemetry.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+/*
+ * Binary telemetry, see MPU_Telemetry.h for the frame format.
+ * Only @MPU_TelemetryTxComplete runs at the interrupt and it only clears busy, so the buffers are never touched by two contexts:
+ * the task fills the active buffer and starts the DMA, the interrupt tells it ended.
+ */
+
+#include "MPU_Telemetry.h"
+
+static uint16_t Crc16(const uint8_t data[], uint16_t size);
+static uint16_t CobsEncode(const uint8_t input[], uint16_t size, uint8_t output[]);
+static void TelemetryKick(MPU_TELEMETRY *telemetry);
+
+/*
+ * CRC-16/CCITT-FALSE (polynomial 0x1021, initial 0xFFFF), one nibble per step
+ */
+static const uint16_t crcTable[16] = {
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+	0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+/*
+ * @brief:  Start one telemetry link
+ * @param:  telemetry - State of the link
+ * 			uart - UART with a DMA TX channel, HAL_UART_TxCpltCallback must call @MPU_TelemetryTxComplete
+ * @retval: None
+ */
+void MPU_TelemetryInit(MPU_TELEMETRY *telemetry, UART_HandleTypeDef *uart){
+
+	memset(telemetry, 0, sizeof(MPU_TELEMETRY));
+	telemetry->uart = uart;
+}
+
+/*
+ * @brief:  Frame one packet into the buffers and start the DMA if it is idle. It never waits for the UART
+ * @param:  telemetry - State of the link
+ * 			type - One @MPU_TELEMETRY_TYPE value (other values can be used by the application)
+ * 			payload - Packet data, up to TELEMETRY_MAX_PAYLOAD bytes
+ * 			size - Bytes at payload
+ * 			timestamp_ms - Time of the data, for example HAL_GetTick()
+ * @retval: 1 if the packet was queued, 0 if it was dropped
+ */
+uint8_t MPU_TelemetrySend(MPU_TELEMETRY *telemetry, MPU_TELEMETRY_TYPE type, const uint8_t payload[], uint8_t size, uint32_t timestamp_ms){
+
+	uint8_t packet[TELEMETRY_MAX_PACKET];
+	uint16_t length = TELEMETRY_HEADER_BYTES + size, crc;
+
+	if(size > TELEMETRY_MAX_PAYLOAD)
+		return 0;
+
+	if(telemetry->fill + TELEMETRY_MAX_FRAME > TELEMETRY_BUFFER_BYTES){
+		if(telemetry->busy){									/* Both buffers taken */
+			telemetry->stats.dropped++;
+			return 0;
+		}
+		TelemetryKick(telemetry);
+	}
+
+	packet[0] = type;
+	packet[1] = telemetry->sequence++;
+	packet[2] = timestamp_ms;
+	packet[3] = timestamp_ms >> 8;
+	packet[4] = timestamp_ms >> 16;
+	packet[5] = timestamp_ms >> 24;
+	memcpy(&packet[TELEMETRY_HEADER_BYTES], payload, size);
+
+	crc = Crc16(packet, length);
+	packet[length++] = crc;
+	packet[length++] = crc >> 8;
+
+	length = CobsEncode(packet, length, &telemetry->buffer[telemetry->active][telemetry->fill]);
+	telemetry->buffer[telemetry->active][telemetry->fill + length] = 0x00;		/* Delimiter */
+	telemetry->fill += length + 1;
+
+	telemetry->stats.packets++;
+	telemetry->stats.bytes += length + 1;
+
+	if(!telemetry->busy)
+		TelemetryKick(telemetry);
+
+	return 1;
+}
+
+/*
+ * @brief:  Send one raw frame, see @MPU_ReadAllRaw
+ * @param:  telemetry - State of the link
+ * 			frame - TELEMETRY_RAW_BYTES bytes
+ * 			timestamp_ms - Time of the read
+ * @retval: 1 if queued, 0 if dropped
+ */
+uint8_t MPU_TelemetrySendRaw(MPU_TELEMETRY *telemetry, const uint8_t frame[], uint32_t timestamp_ms){
+
+	return MPU_TelemetrySend(telemetry, TELEMETRY_RAW, frame, TELEMETRY_RAW_BYTES, timestamp_ms);
+}
+
+/*
+ * @brief:  Send one calibrated sample, for example the outputs of @MPU_ReadAllSensores
+ * @param:  telemetry - State of the link
+ * 			accel_data, gyro_data, mag_data - Three element vectors
+ * 			timestamp_ms - Time of the read
+ * @retval: 1 if queued, 0 if dropped
+ */
+uint8_t MPU_TelemetrySendSample(MPU_TELEMETRY *telemetry, const float accel_data[], const float gyro_data[], const float mag_data[], uint32_t timestamp_ms){
+
+	uint8_t payload[9 * sizeof(float)];
+
+	memcpy(&payload[0], accel_data, 3 * sizeof(float));		/* Cortex-M floats are IEEE 754 little endian, the host reads them as is */
+	memcpy(&payload[12], gyro_data, 3 * sizeof(float));
+	memcpy(&payload[24], mag_data, 3 * sizeof(float));
+
+	return MPU_TelemetrySend(telemetry, TELEMETRY_SAMPLE, payload, sizeof(payload), timestamp_ms);
+}
+
+/*
+ * @brief:  Send a text message at the same stream, longer texts are cut at TELEMETRY_MAX_PAYLOAD characters
+ * @param:  telemetry - State of the link
+ * 			text - Null terminated string
+ * @retval: 1 if queued, 0 if dropped
+ */
+uint8_t MPU_TelemetrySendText(MPU_TELEMETRY *telemetry, const char *text){
+
+	size_t size = strlen(text);
+
+	if(size > TELEMETRY_MAX_PAYLOAD)
+		size = TELEMETRY_MAX_PAYLOAD;
+
+	return MPU_TelemetrySend(telemetry, TELEMETRY_TEXT, (const uint8_t *)text, size, HAL_GetTick());
+}
+
+/*
+ * @brief:  Start the DMA of the frames waiting at the buffer, if it is idle. The send functions do it already,
+ * 			call it when nothing more will be sent for a while
+ * @param:  telemetry - State of the link
+ * @retval: None
+ */
+void MPU_TelemetryPoll(MPU_TELEMETRY *telemetry){
+
+	if(!telemetry->busy && telemetry->fill > 0)
+		TelemetryKick(telemetry);
+}
+
+/*
+ * @brief:  End of one DMA transfer, call it from HAL_UART_TxCpltCallback
+ * @param:  telemetry - State of the link
+ * 			huart - Handle given by the callback, other UARTs are ignored
+ * @retval: None
+ */
+void MPU_TelemetryTxComplete(MPU_TELEMETRY *telemetry, UART_HandleTypeDef *huart){
+
+	if(huart == telemetry->uart)
+		telemetry->busy = 0;
+}
+
+/*
+ * @brief:  Receiver side, decode one frame (bytes between two delimiters, without them) and check its CRC
+ * @param:  frame - COBS bytes
+ * 			size - Bytes at frame
+ * 			packet - Where type, sequence, timestamp and payload will be placed, TELEMETRY_MAX_PACKET bytes
+ * @retval: Bytes of the packet without the CRC, -1 if the frame is malformed or the CRC does not match
+ */
+int16_t MPU_TelemetryUnpack(const uint8_t frame[], uint16_t size, uint8_t packet[]){
+
+	uint16_t read = 0, write = 0;
+	uint8_t code;
+
+	while(read < size){
+		code = frame[read++];
+		if(code == 0)
+			return -1;
+
+		for(uint8_t i = 1; i < code; i++){
+			if(read >= size || write >= TELEMETRY_MAX_PACKET)
+				return -1;
+			packet[write++] = frame[read++];
+		}
+
+		if(code != 0xFF && read < size){
+			if(write >= TELEMETRY_MAX_PACKET)
+				return -1;
+			packet[write++] = 0x00;
+		}
+	}
+
+	if(write < TELEMETRY_HEADER_BYTES + 2 || Crc16(packet, write - 2) != (packet[write - 2] | packet[write - 1] << 8))
+		return -1;
+
+	return write - 2;
+}
+
+/*
+ * @brief:  Counters of the link
+ * @param:  telemetry - State of the link
+ * 			stats - Where the counters will be copied
+ * @retval: None
+ */
+void MPU_TelemetryGetStats(const MPU_TELEMETRY *telemetry, MPU_TELEMETRY_STATS *stats){
+
+	*stats = telemetry->stats;
+}
+
+/*
+ * @brief:  Internal function, send the active buffer by DMA and fill the other one. Called only when busy is 0
+ */
+static void TelemetryKick(MPU_TELEMETRY *telemetry){
+
+	if(telemetry->fill == 0)
+		return;
+
+	telemetry->busy = 1;
+	if(HAL_UART_Transmit_DMA(telemetry->uart, telemetry->buffer[telemetry->active], telemetry->fill) != HAL_OK){
+		telemetry->busy = 0;
+		telemetry->stats.dropped++;								/* The frames of the buffer are lost, the next ones start clean */
+	}
+	else
+		telemetry->stats.transfers++;
+
+	telemetry->active ^= 1;
+	telemetry->fill = 0;
+}
+
+/*
+ * @brief:  Internal function, CRC-16/CCITT-FALSE
+ */
+static uint16_t Crc16(const uint8_t data[], uint16_t size){
+
+	uint16_t crc = 0xFFFF;
+
+	for(uint16_t i = 0; i < size; i++){
+		crc = (crc << 4) ^ crcTable[(crc >> 12) ^ (data[i] >> 4)];
+		crc = (crc << 4) ^ crcTable[(crc >> 12) ^ (data[i] & 0x0F)];
+	}
+
+	return crc;
+}
+
+/*
+ * @brief:  Internal function, consistent overhead byte stuffing, output has no zero byte
+ * @retval: Bytes written to output, at most size + size / 254 + 1
+ */
+static uint16_t CobsEncode(const uint8_t input[], uint16_t size, uint8_t output[]){
+
+	uint16_t read = 0, write = 1, code_index = 0;
+	uint8_t code = 1;
+
+	while(read < size){
+		if(input[read] == 0){
+			output[code_index] = code;
+			code = 1;
+			code_index = write++;
+			read++;
+		}
+		else{
+			output[write++] = input[read++];
+			if(++code == 0xFF){
+				output[code_index] = code;
+				code = 1;
+				code_index = write++;
+			}
+		}
+	}
+
+	output[code_index] = code;
+
+	return write;
+}
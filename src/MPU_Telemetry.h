@@ -0,0 +1,83 @@
+/*
+ * MPU_Telemetry.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+#ifndef INC_MPU_TELEMETRY_H_
+#define INC_MPU_TELEMETRY_H_
+
+#include "MPU_SPEC.h"
+
+/*
+ * Binary telemetry over one UART, sent by DMA without waiting:
+ *
+ *		packet = type, sequence, timestamp_ms (u32), payload, CRC-16/CCITT-FALSE of the previous bytes (u16), little endian
+ *		frame  = COBS(packet), 0x00
+ *
+ * The zero delimiter resynchronizes the receiver after any lost byte, and the CRC rejects corrupted frames.
+ * Frames are written into one of two buffers while the other is sent by HAL_UART_Transmit_DMA. When the DMA ends the filled buffer
+ * goes next, so many frames leave in one DMA. When both buffers are full the new packet is dropped and counted, the caller never waits.
+ *
+ * A raw 9-axis packet (TELEMETRY_RAW) is 31 bytes on the wire (6 header, 21 payload, 2 CRC, 1 COBS, 1 delimiter): 1 kHz needs
+ * 310 kbit/s, use 921600 baud (about 3 kHz).
+ * A calibrated packet (TELEMETRY_SAMPLE, 9 floats) is 46 bytes.
+ *
+ * @MPU_TelemetryTxComplete must be called from HAL_UART_TxCpltCallback. The send functions must be called from one task (or the main loop).
+ */
+#ifndef TELEMETRY_BUFFER_BYTES
+#define TELEMETRY_BUFFER_BYTES		256				//Each of the two DMA buffers
+#endif
+
+#define TELEMETRY_MAX_PAYLOAD		64
+#define TELEMETRY_HEADER_BYTES		6				//type, sequence, timestamp
+#define TELEMETRY_MAX_PACKET		(TELEMETRY_HEADER_BYTES + TELEMETRY_MAX_PAYLOAD + 2)
+#define TELEMETRY_MAX_FRAME			(TELEMETRY_MAX_PACKET + TELEMETRY_MAX_PACKET / 254 + 2)		//COBS overhead and delimiter
+#define TELEMETRY_RAW_BYTES			RAW_FRAME_BYTES	//Burst of @MPU_ReadAllSensores (14), AK8963 HXL..HZH (6) and status, see @MPU_ReadAllRaw
+
+#if TELEMETRY_BUFFER_BYTES < TELEMETRY_MAX_FRAME
+#error "TELEMETRY_BUFFER_BYTES must hold at least one frame"
+#endif
+
+/*
+ * Packet types
+ */
+typedef enum{
+	TELEMETRY_RAW		= 0x01,					/* TELEMETRY_RAW_BYTES as read, same layout as the frames of MPU_Allan (-f 21), the
+											   magnetometer is new only with RAW_FRAME_MAG_NEW at the last byte */
+	TELEMETRY_SAMPLE	= 0x02,					/* accel[3], gyro[3], mag[3] as float, units of @MPU_ReadAllSensores */
+	TELEMETRY_TEXT		= 0x03					/* Characters without terminator */
+}MPU_TELEMETRY_TYPE;
+
+typedef struct{
+	uint32_t packets;							//Packets placed at the buffers
+	uint32_t bytes;								//Frame bytes placed at the buffers
+	uint32_t dropped;							//Packets lost because both buffers were full (or the DMA start failed)
+	uint32_t transfers;							//DMA transfers started
+}MPU_TELEMETRY_STATS;
+
+typedef struct{
+	UART_HandleTypeDef *uart;
+	uint8_t buffer[2][TELEMETRY_BUFFER_BYTES];
+	uint16_t fill;								//Bytes at the buffer being filled
+	uint8_t active;								//Buffer being filled, the other one may be at the DMA
+	volatile uint8_t busy;						//DMA running, cleared by @MPU_TelemetryTxComplete
+	uint8_t sequence;
+	MPU_TELEMETRY_STATS stats;
+}MPU_TELEMETRY;
+
+/*
+ * Telemetry functions
+ */
+void MPU_TelemetryInit(MPU_TELEMETRY *telemetry, UART_HandleTypeDef *uart);
+uint8_t MPU_TelemetrySend(MPU_TELEMETRY *telemetry, MPU_TELEMETRY_TYPE type, const uint8_t payload[], uint8_t size, uint32_t timestamp_ms);
+uint8_t MPU_TelemetrySendRaw(MPU_TELEMETRY *telemetry, const uint8_t frame[], uint32_t timestamp_ms);
+uint8_t MPU_TelemetrySendSample(MPU_TELEMETRY *telemetry, const float accel_data[], const float gyro_data[], const float mag_data[], uint32_t timestamp_ms);
+uint8_t MPU_TelemetrySendText(MPU_TELEMETRY *telemetry, const char *text);
+void MPU_TelemetryPoll(MPU_TELEMETRY *telemetry);
+void MPU_TelemetryTxComplete(MPU_TELEMETRY *telemetry, UART_HandleTypeDef *huart);
+int16_t MPU_TelemetryUnpack(const uint8_t frame[], uint16_t size, uint8_t packet[]);
+void MPU_TelemetryGetStats(const MPU_TELEMETRY *telemetry, MPU_TELEMETRY_STATS *stats);
+
+#endif /* INC_MPU_TELEMETRY_H_ */
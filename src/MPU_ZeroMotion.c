@@ -0,0 +1,184 @@
+/*
+ * MPU_ZeroMotion.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+#include "MPU_ZeroMotion.h"
+#include <math.h>
+
+static uint8_t ZeroMotionStill(const MPU_ZERO_MOTION *zero_motion);
+static void ZeroMotionRestart(MPU_ZERO_MOTION *zero_motion);
+
+/*
+ * @brief:  Convert the thresholds of the configuration for the full scales in use and clear the window
+ * @param:  zero_motion - Detector state
+ * 			config - Thresholds, NULL for the ZERO_MOTION_* defaults without offload
+ * @retval: None
+ */
+void MPU_ZeroMotionInit(MPU_ZERO_MOTION *zero_motion, const MPU_ZERO_MOTION_CONFIG *config){
+
+	MPU_ZERO_MOTION_CONFIG defaults = {ZERO_MOTION_GYRO_STD_MDPS, ZERO_MOTION_GYRO_RATE_MDPS, ZERO_MOTION_ACCEL_STD_MG,
+									   ZERO_MOTION_ACCEL_TOL_MG, ZERO_MOTION_BIAS_GAIN, 0};
+	float gyro_std, accel_std, low, high;
+
+	if(config == NULL)
+		config = &defaults;
+
+	memset(zero_motion, 0, sizeof(MPU_ZERO_MOTION));
+
+	gyro_std = config->gyro_std_mdps * gyro_sensitivity_used / 1000 * ZERO_MOTION_WINDOW;
+	accel_std = (float)config->accel_std_mg * accel_sensitivity_used / 1000 * ZERO_MOTION_WINDOW;
+	low = (float)(1000 - config->accel_tolerance_mg) * accel_sensitivity_used / 1000 * ZERO_MOTION_WINDOW;
+	high = (float)(1000 + config->accel_tolerance_mg) * accel_sensitivity_used / 1000 * ZERO_MOTION_WINDOW;
+
+	zero_motion->gyro_variance_limit = (int64_t)(gyro_std * gyro_std);
+	zero_motion->accel_variance_limit = (int64_t)(accel_std * accel_std);
+	zero_motion->gyro_rate_limit = config->gyro_rate_mdps * gyro_sensitivity_used / 1000 * ZERO_MOTION_WINDOW;
+	zero_motion->gravity_low = config->accel_tolerance_mg < 1000 ? (int64_t)(low * low) : 0;
+	zero_motion->gravity_high = (int64_t)(high * high);
+	zero_motion->gyro_sensitivity = gyro_sensitivity_used;
+	zero_motion->bias_gain = config->bias_gain;
+	zero_motion->offload = config->offload;
+}
+
+/*
+ * @brief:  Add one sample to the window, update the bias after each ZERO_MOTION_WINDOW still samples
+ * @param:  zero_motion - Detector state
+ * 			accel_raw - Three element vector of accelerometer counts
+ * 			gyro_raw - Three element vector of gyroscope counts
+ * @retval: OR of @MPU_ZERO_MOTION_EVENT
+ */
+uint8_t MPU_ZeroMotionProcess(MPU_ZERO_MOTION *zero_motion, const int16_t accel_raw[], const int16_t gyro_raw[]){
+
+	int16_t *slot = zero_motion->window[zero_motion->head];
+	uint8_t events = ZERO_MOTION_STILL;
+	float bias[3], delta[3];
+	uint8_t offload = 0;
+
+	if(zero_motion->count == ZERO_MOTION_WINDOW){
+		for(uint8_t i = 0; i < 6; i++){							/* The oldest sample leaves the window */
+			zero_motion->sum[i] -= slot[i];
+			zero_motion->square_sum[i] -= (int32_t)slot[i] * slot[i];
+		}
+	}
+	else
+		zero_motion->count++;
+
+	for(uint8_t i = 0; i < 3; i++){
+		slot[i] = accel_raw[i];
+		slot[i + 3] = gyro_raw[i];
+	}
+	for(uint8_t i = 0; i < 6; i++){
+		zero_motion->sum[i] += slot[i];
+		zero_motion->square_sum[i] += (int32_t)slot[i] * slot[i];
+	}
+
+	if(++zero_motion->head == ZERO_MOTION_WINDOW)
+		zero_motion->head = 0;
+
+	zero_motion->stats.samples++;
+
+	if(zero_motion->count < ZERO_MOTION_WINDOW || !ZeroMotionStill(zero_motion)){
+		zero_motion->since_update = 0;
+		return 0;
+	}
+
+	zero_motion->stats.still++;
+
+	if(zero_motion->bias_gain <= 0 || ++zero_motion->since_update < ZERO_MOTION_WINDOW)
+		return events;
+
+	zero_motion->since_update = 0;									/* The next update uses a new window */
+
+	MPU_GyroGetBias(bias);
+
+	for(uint8_t k = 0; k < 3; k++){
+		zero_motion->stats.residual[k] = zero_motion->sum[k + 3] / (ZERO_MOTION_WINDOW * zero_motion->gyro_sensitivity) - bias[k];
+		delta[k] = zero_motion->bias_gain * zero_motion->stats.residual[k];
+		if(fabsf(bias[k] + delta[k]) >= 1 / 32.8f)					/* One step of the offset registers */
+			offload = zero_motion->offload;
+	}
+
+	MPU_GyroAdjustBias(delta);
+	zero_motion->stats.updates++;
+	events |= ZERO_MOTION_UPDATED;
+
+	if(offload){
+		if(!MPU_GyroBiasOffload())
+			zero_motion->stats.saturated++;
+		zero_motion->stats.offloads++;
+		events |= ZERO_MOTION_OFFLOADED;
+		ZeroMotionRestart(zero_motion);								/* The counts of the window hold the old offset */
+	}
+
+	return events;
+}
+
+/*
+ * @brief:  Read the newest sample (@MPU_ImuReadRaw) and process it
+ * @param:  zero_motion - Detector state
+ * @retval: OR of @MPU_ZERO_MOTION_EVENT
+ */
+uint8_t MPU_ZeroMotionDataReady(MPU_ZERO_MOTION *zero_motion){
+
+	int16_t accel_raw[3], gyro_raw[3];
+
+	MPU_ImuReadRaw(accel_raw, gyro_raw);
+
+	return MPU_ZeroMotionProcess(zero_motion, accel_raw, gyro_raw);
+}
+
+/*
+ * @brief:  Still windows and bias update counters
+ * @param:  zero_motion - Detector state
+ * 			stats - Where the counters will be copied
+ * @retval: None
+ */
+void MPU_ZeroMotionGetStats(const MPU_ZERO_MOTION *zero_motion, MPU_ZERO_MOTION_STATS *stats){
+
+	*stats = zero_motion->stats;
+}
+
+/*
+ * @brief:  Internal function, check the full window: N^2 * variance = N * sum(x^2) - sum(x)^2, no division
+ */
+static uint8_t ZeroMotionStill(const MPU_ZERO_MOTION *zero_motion){
+
+	int64_t variance, magnitude = 0;
+	float bias[3];
+
+	for(uint8_t i = 0; i < 6; i++){
+		variance = ZERO_MOTION_WINDOW * zero_motion->square_sum[i] - (int64_t)zero_motion->sum[i] * zero_motion->sum[i];
+		if(variance > (i < 3 ? zero_motion->accel_variance_limit : zero_motion->gyro_variance_limit))
+			return 0;
+	}
+
+	for(uint8_t i = 0; i < 3; i++)
+		magnitude += (int64_t)zero_motion->sum[i] * zero_motion->sum[i];
+
+	if(magnitude < zero_motion->gravity_low || magnitude > zero_motion->gravity_high)
+		return 0;
+
+	MPU_GyroGetBias(bias);
+
+	for(uint8_t k = 0; k < 3; k++){
+		if(fabsf(zero_motion->sum[k + 3] - bias[k] * zero_motion->gyro_sensitivity * ZERO_MOTION_WINDOW) > zero_motion->gyro_rate_limit)
+			return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * @brief:  Internal function, empty the window
+ */
+static void ZeroMotionRestart(MPU_ZERO_MOTION *zero_motion){
+
+	memset(zero_motion->sum, 0, sizeof(zero_motion->sum));
+	memset(zero_motion->square_sum, 0, sizeof(zero_motion->square_sum));
+	zero_motion->head = 0;
+	zero_motion->count = 0;
+	zero_motion->since_update = 0;
+}
@@ -0,0 +1,113 @@
+/*
+ * MPU_ZeroMotion.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+#ifndef INC_MPU_ZEROMOTION_H_
+#define INC_MPU_ZEROMOTION_H_
+
+#include "MPU_SPEC.h"
+
+/*
+ * Zero-motion detection and gyro bias tracking, on the raw counts of each sample:
+ *
+ *		still:		over the last ZERO_MOTION_WINDOW samples, every gyro and accel axis with a standard deviation below gyro_std_mdps
+ *					and accel_std_mg, the mean rate within gyro_rate_mdps of the bias in use and the mean acceleration within
+ *					accel_tolerance_mg of 1 g
+ *		update:		after each ZERO_MOTION_WINDOW still samples, bias += bias_gain * (window mean - bias) (@MPU_GyroAdjustBias),
+ *					a first order low pass of the bias with a time constant of 1 / bias_gain windows
+ *
+ * The window keeps integer sums of the counts and of their squares, so the sliding variance costs a few integer operations per
+ * sample and does not drift. The rate limit keeps a slow constant rotation, which has no variance, out of the bias.
+ *
+ * With offload set, the bias is moved to the offset registers (@MPU_GyroBiasOffload) when one axis holds at least one register
+ * step (1/32.8 °/s), so the fifo and the data registers also carry the corrected rate. The window restarts after it, the counts
+ * change by the moved bias.
+ *
+ * The bias is the one in use (@MPU_GyroGetBias): with the temperature bias model (@MPU_TempBiasEnable) it is the model bias at the
+ * temperature of the last read, and an update shifts the learned bins with the static bias. Feed the counts of @MPU_ImuReadRaw (done
+ * by @MPU_ZeroMotionDataReady) or of another read that takes the temperature, so the bias matches the sample.
+ * With bias_gain above 0 this tracker owns the bias in use: do not call @MPU_EkfCommitBias at the same time, each one would take the
+ * corrections of the other as its own residual. Use bias_gain = 0 (detect only) to keep the bias with the filter.
+ *
+ * Samples come from @MPU_ZeroMotionDataReady (one 15 bytes read) or from @MPU_ZeroMotionProcess with counts of other reads.
+ * At 1 kHz feed every 8th sample, so the window covers about one second. The thresholds depend on the full scales: call
+ * @MPU_ZeroMotionInit again after @MPU_AccelScaleChange, @MPU_GyroScaleChange or a switch of MPU_AutoRange.h.
+ */
+#ifndef ZERO_MOTION_WINDOW
+#define ZERO_MOTION_WINDOW			128				//Samples of the sliding window
+#endif
+
+#ifndef ZERO_MOTION_GYRO_STD_MDPS
+#define ZERO_MOTION_GYRO_STD_MDPS	200				//About three times the noise at DLPF_CFG3
+#endif
+
+#ifndef ZERO_MOTION_GYRO_RATE_MDPS
+#define ZERO_MOTION_GYRO_RATE_MDPS	500
+#endif
+
+#ifndef ZERO_MOTION_ACCEL_STD_MG
+#define ZERO_MOTION_ACCEL_STD_MG	10
+#endif
+
+#ifndef ZERO_MOTION_ACCEL_TOL_MG
+#define ZERO_MOTION_ACCEL_TOL_MG	50
+#endif
+
+#ifndef ZERO_MOTION_BIAS_GAIN
+#define ZERO_MOTION_BIAS_GAIN		0.05f			//Time constant of 20 windows
+#endif
+
+typedef enum{
+	ZERO_MOTION_STILL		= 0x01,					/* The window ending at this sample is still */
+	ZERO_MOTION_UPDATED		= 0x02,					/* The bias was updated */
+	ZERO_MOTION_OFFLOADED	= 0x04					/* The bias was moved to the offset registers */
+}MPU_ZERO_MOTION_EVENT;
+
+typedef struct{
+	uint16_t gyro_std_mdps;
+	uint16_t gyro_rate_mdps;
+	uint16_t accel_std_mg;
+	uint16_t accel_tolerance_mg;
+	float bias_gain;							//0 to detect only
+	uint8_t offload;							//1 to move the bias to the offset registers
+}MPU_ZERO_MOTION_CONFIG;
+
+typedef struct{
+	uint32_t samples;
+	uint32_t still;								//Samples ending a still window
+	uint32_t updates;
+	uint32_t offloads;
+	uint32_t saturated;							//Offloads that did not fit the offset registers
+	float residual[3];							//Window mean - bias at the last update, °/s
+}MPU_ZERO_MOTION_STATS;
+
+typedef struct{
+	int16_t window[ZERO_MOTION_WINDOW][6];		//Accel X, Y, Z then gyro X, Y, Z counts
+	int32_t sum[6];
+	int64_t square_sum[6];
+	uint16_t head;
+	uint16_t count;
+	uint16_t since_update;						//Still samples since the last update
+
+	int64_t gyro_variance_limit;				//N^2 * variance, counts^2
+	int64_t accel_variance_limit;
+	float gyro_rate_limit;						//N * counts
+	int64_t gravity_low, gravity_high;			//(N * counts)^2 of 1 g -/+ the tolerance
+	float gyro_sensitivity;
+	float bias_gain;
+	uint8_t offload;
+	MPU_ZERO_MOTION_STATS stats;
+}MPU_ZERO_MOTION;
+
+/*
+ * Zero-motion functions
+ */
+void MPU_ZeroMotionInit(MPU_ZERO_MOTION *zero_motion, const MPU_ZERO_MOTION_CONFIG *config);
+uint8_t MPU_ZeroMotionProcess(MPU_ZERO_MOTION *zero_motion, const int16_t accel_raw[], const int16_t gyro_raw[]);
+uint8_t MPU_ZeroMotionDataReady(MPU_ZERO_MOTION *zero_motion);
+void MPU_ZeroMotionGetStats(const MPU_ZERO_MOTION *zero_motion, MPU_ZERO_MOTION_STATS *stats);
+
+#endif /* INC_MPU_ZEROMOTION_H_ */
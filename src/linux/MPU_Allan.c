@@ -0,0 +1,520 @@
+/*
+ * MPU_Allan.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+/*
+ * Host tool, overlapping Allan deviation of recorded raw frames, all nine axes:
+ *
+ *		MPU_Allan -r rate_hz [-f 14|20|21] [-j threads] [-p points_per_decade] [-a accel_lsb] [-g gyro_lsb] [-m mag_unit] file > adev.csv
+ *
+ * One frame is the 14 bytes burst of @MPU_ReadAllSensores (ACCEL_XOUT_H to GYRO_ZOUT_L, big endian, the temperature is skipped),
+ * optionally followed by the 6 bytes HXL..HZH of the AK8963 (little endian, as at EXT_SENS_DATA), 20 bytes frames, and by the status
+ * byte of @MPU_ReadAllRaw, 21 bytes frames (the default, the TELEMETRY_RAW payload).
+ * The AK8963 measures at 100 Hz at most, slower than the IMU, so most frames repeat the last measurement. With 21 bytes frames the
+ * magnetometer axes are a second series of the frames with RAW_FRAME_MAG_NEW only, at their mean rate; their cluster sizes, so their
+ * tau, are not the ones of the IMU axes and the other cells of their CSV lines are empty. 20 bytes frames take every magnetometer
+ * value, right only for logs with one new measurement per frame.
+ *
+ * For a cluster of m samples the overlapping Allan variance is 1/2 <(mean of the next m - mean of the last m)^2> over every start k.
+ * The file is mapped and read once, in order, into int16 counts (2 bytes per axis and frame, less than the file). The counts are
+ * written to a mapped temporary file, unlinked at once, next to the log (or at TMPDIR when that directory is not writable), so logs
+ * larger than the RAM are paged in and out by the kernel like the log itself; only the prefix sums are in memory. The starts k are
+ * split in chunks of ALLAN_CHUNK_FRAMES taken by the threads, and each chunk computes every cluster size (log spaced, -p per decade)
+ * in tiles of ALLAN_TILE_FRAMES: for one tile and one size the three cursors k, k + m and k + 2m read three short runs of memory,
+ * so the threads share the counts without streaming the whole log once per size. The two window sums slide by one sample per step
+ * with int64 arithmetic, exact for int16 counts; at the start of a chunk they come from prefix sums kept per tile.
+ * Cost is about 20 ns per frame and cluster size on one core: 10 million frames (2.8 h at 1 kHz) with 63 sizes take 12 s on one core
+ * and 120 MB for the counts, read from the page cache when it holds them.
+ *
+ * Output: CSV with tau (s) and the Allan deviation of each axis at stdout (lines in increasing tau), in counts or in the units given
+ * by -a (LSB/g), -g (LSB/°/s) and -m (uT/LSB). A summary goes to stderr: the deviation at tau = 1 s (angle/velocity random walk, N)
+ * and the minimum deviation / 0.664 (bias instability, B).
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define ALLAN_AXES					9
+#define ALLAN_MAX_POINTS			1024
+#define ALLAN_MAX_THREADS			256
+#define ALLAN_CHUNK_FRAMES			262144			//Starts of one work item
+#define ALLAN_TILE_FRAMES			4096			//Starts computed for every size before the next ones, also the prefix sum step
+#define ALLAN_BIAS_FACTOR			0.664			//Minimum of the flicker floor, sqrt(2 ln2 / pi)
+#define ALLAN_MAG_NEW				0x01			//RAW_FRAME_MAG_NEW of MPU_SPEC.h, at the last byte of 21 bytes frames
+
+typedef struct{
+	int16_t *counts;								/* frames * axes, mapped from a temporary file, see CountsCreate */
+	size_t counts_bytes;
+	int64_t *prefix;								/* Sum of the counts before each tile, (tiles + 1) * axes */
+	size_t frames;
+	uint8_t first;									/* Axis of the first value, 6 for the magnetometer series */
+	uint8_t axes;
+	double rate;									/* Hz */
+	uint64_t cluster[ALLAN_MAX_POINTS];
+	uint16_t points;
+	size_t chunks;
+	double sum[ALLAN_MAX_POINTS][ALLAN_AXES];		/* counts^2, indexed from first, added by the chunks under lock */
+	double avar[ALLAN_MAX_POINTS][ALLAN_AXES];
+}ALLAN_SERIES;
+
+typedef struct{
+	ALLAN_SERIES series[2];							/* IMU axes (all nine for 20 bytes frames), magnetometer of 21 bytes frames */
+	uint8_t count;
+	size_t next;									/* Next chunk, of the first series then of the second, taken with __atomic */
+	pthread_mutex_t lock;
+}ALLAN_JOB;
+
+typedef struct{
+	int64_t first[ALLAN_MAX_POINTS][ALLAN_AXES];
+	int64_t second[ALLAN_MAX_POINTS][ALLAN_AXES];
+	double sum[ALLAN_MAX_POINTS][ALLAN_AXES];
+}ALLAN_SCRATCH;									/* Window sums of one chunk, one per thread */
+
+static const char *axisName[ALLAN_AXES] = {"ax", "ay", "az", "gx", "gy", "gz", "mx", "my", "mz"};
+
+static uint8_t SeriesCreate(ALLAN_SERIES *series, const char *path, const uint8_t *data, size_t frames, uint8_t frame_bytes, uint8_t first,
+						   uint8_t axes);
+static int16_t *CountsCreate(const char *path, size_t bytes);
+static void SeriesFree(ALLAN_SERIES *series);
+static void WindowSum(const ALLAN_SERIES *series, uint64_t start, uint64_t length, int64_t sum[]);
+static void AllanChunk(ALLAN_JOB *job, ALLAN_SERIES *series, size_t chunk, ALLAN_SCRATCH *scratch);
+static void *AllanWorker(void *argument);
+static uint16_t ClusterSizes(uint64_t cluster[], size_t frames, uint16_t per_decade);
+
+int main(int argc, char *argv[]){
+
+	ALLAN_JOB *job;
+	ALLAN_SERIES *series;
+	pthread_t threads[ALLAN_MAX_THREADS];
+	double rate = 0, scale[ALLAN_AXES], best[ALLAN_AXES], best_tau[ALLAN_AXES], at_one[ALLAN_AXES];
+	double accel_lsb = 0, gyro_lsb = 0, mag_unit = 0;
+	long threads_count = sysconf(_SC_NPROCESSORS_ONLN), started = 0;
+	int per_decade = 10, frame_bytes = 21, option, fd;
+	uint16_t line[2] = {0, 0};
+	size_t frames;
+	struct stat status;
+	void *map;
+
+	while((option = getopt(argc, argv, "r:f:j:p:a:g:m:")) != -1){
+		switch(option){
+			case 'r':	rate = atof(optarg);			break;
+			case 'f':	frame_bytes = atoi(optarg);		break;
+			case 'j':	threads_count = atol(optarg);	break;
+			case 'p':	per_decade = atoi(optarg);		break;
+			case 'a':	accel_lsb = atof(optarg);		break;
+			case 'g':	gyro_lsb = atof(optarg);		break;
+			case 'm':	mag_unit = atof(optarg);		break;
+			default:	optind = argc + 1;				break;
+		}
+	}
+
+	if(optind != argc - 1 || rate <= 0 || (frame_bytes != 14 && frame_bytes != 20 && frame_bytes != 21) || per_decade < 1){
+		fprintf(stderr, "usage: %s -r rate_hz [-f 14|20|21] [-j threads] [-p points_per_decade] [-a accel_lsb] [-g gyro_lsb] [-m mag_unit] file\n", argv[0]);
+		return 2;
+	}
+
+	if(threads_count < 1)
+		threads_count = 1;
+	if(threads_count > ALLAN_MAX_THREADS)
+		threads_count = ALLAN_MAX_THREADS;
+
+	fd = open(argv[optind], O_RDONLY);
+	if(fd < 0 || fstat(fd, &status) != 0){
+		perror(argv[optind]);
+		return 1;
+	}
+
+	frames = status.st_size / frame_bytes;
+	if(frames < 3){
+		fprintf(stderr, "%s: less than 3 frames\n", argv[optind]);
+		return 1;
+	}
+
+	map = mmap(NULL, frames * frame_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+	if(map == MAP_FAILED){
+		perror("mmap");
+		return 1;
+	}
+	madvise(map, frames * frame_bytes, MADV_SEQUENTIAL);
+
+	job = calloc(1, sizeof(ALLAN_JOB));
+	if(job == NULL){
+		perror("calloc");
+		return 1;
+	}
+	pthread_mutex_init(&job->lock, NULL);
+
+	if(!SeriesCreate(&job->series[0], argv[optind], map, frames, frame_bytes, 0, frame_bytes == 20 ? 9 : 6) ||
+	   (frame_bytes == 21 && !SeriesCreate(&job->series[1], argv[optind], map, frames, frame_bytes, 6, 3))){
+		perror("counts");
+		return 1;
+	}
+
+	munmap(map, frames * frame_bytes);								/* Every count is at the temporary files */
+	close(fd);
+
+	job->count = 1;
+	job->series[0].rate = rate;
+	if(job->series[1].frames >= 3){									/* Else the log has no magnetometer */
+		job->series[1].rate = rate * job->series[1].frames / frames;
+		job->count = 2;
+	}
+
+	for(uint8_t s = 0; s < job->count; s++){
+		series = &job->series[s];
+		series->points = ClusterSizes(series->cluster, series->frames, per_decade);
+		series->chunks = (series->frames - 1 + ALLAN_CHUNK_FRAMES - 1) / ALLAN_CHUNK_FRAMES;		/* frames - 1 starts of m = 1 */
+	}
+
+	for(; started < threads_count; started++){
+		if(pthread_create(&threads[started], NULL, AllanWorker, job) != 0)
+			break;
+	}
+	if(started == 0)												/* No thread, the chunks run here */
+		AllanWorker(job);
+	for(long i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+
+	if(job->next < job->series[0].chunks + job->series[1].chunks){		/* No thread could allocate its window sums */
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	for(uint8_t s = 0; s < job->count; s++){
+		series = &job->series[s];
+		for(uint16_t p = 0; p < series->points; p++){
+			double m = series->cluster[p], terms = series->frames - 2 * series->cluster[p] + 1;
+
+			for(uint8_t a = 0; a < series->axes; a++)
+				series->avar[p][a] = series->sum[p][a] / (2.0 * m * m * terms);
+		}
+	}
+
+	for(uint8_t a = 0; a < ALLAN_AXES; a++){
+		scale[a] = 1;
+		if(a < 3 && accel_lsb > 0)
+			scale[a] = 1 / accel_lsb;
+		else if(a >= 3 && a < 6 && gyro_lsb > 0)
+			scale[a] = 1 / gyro_lsb;
+		else if(a >= 6 && mag_unit > 0)
+			scale[a] = mag_unit;
+		best[a] = INFINITY;
+		best_tau[a] = 0;
+		at_one[a] = 0;
+	}
+
+	printf("tau_s");
+	for(uint8_t s = 0; s < job->count; s++){
+		for(uint8_t a = 0; a < job->series[s].axes; a++)
+			printf(",%s", axisName[job->series[s].first + a]);
+	}
+	printf("\n");
+
+	while(1){															/* Lines of both series in increasing tau */
+		uint8_t s = job->count;
+		double tau = INFINITY;
+
+		for(uint8_t c = 0; c < job->count; c++){
+			if(line[c] < job->series[c].points && job->series[c].cluster[line[c]] / job->series[c].rate < tau){
+				s = c;
+				tau = job->series[c].cluster[line[c]] / job->series[c].rate;
+			}
+		}
+		if(s == job->count)
+			break;
+
+		series = &job->series[s];
+		uint16_t p = line[s]++;
+
+		printf("%.9g", tau);
+		for(uint8_t c = 0; c < s; c++){
+			for(uint8_t a = 0; a < job->series[c].axes; a++)
+				printf(",");
+		}
+
+		for(uint8_t a = series->first; a < series->first + series->axes; a++){
+			double deviation = sqrt(series->avar[p][a - series->first]) * scale[a];
+
+			printf(",%.9g", deviation);
+
+			if(deviation > 0 && deviation < best[a]){
+				best[a] = deviation;
+				best_tau[a] = tau;
+			}
+
+			if(p > 0 && series->cluster[p - 1] / series->rate <= 1 && tau >= 1){		/* Log-log interpolation at 1 s */
+				double tau0 = series->cluster[p - 1] / series->rate, deviation0 = sqrt(series->avar[p - 1][a - series->first]) * scale[a];
+				double f = log(1 / tau0) / log(tau / tau0);
+
+				if(deviation0 > 0 && deviation > 0)
+					at_one[a] = exp(log(deviation0) + f * (log(deviation) - log(deviation0)));
+			}
+		}
+
+		for(uint8_t c = s + 1; c < job->count; c++){
+			for(uint8_t a = 0; a < job->series[c].axes; a++)
+				printf(",");
+		}
+		printf("\n");
+	}
+
+	fprintf(stderr, "%zu frames, %.1f s, %u cluster sizes, %ld threads\n", frames, frames / rate, job->series[0].points, started ? started : 1);
+	if(job->count > 1)
+		fprintf(stderr, "%zu magnetometer measurements, %.2f Hz, %u cluster sizes\n", job->series[1].frames, job->series[1].rate,
+				job->series[1].points);
+	fprintf(stderr, "axis   N (tau=1s)     B (min/0.664)  tau_B (s)\n");
+	for(uint8_t s = 0; s < job->count; s++){
+		for(uint8_t a = job->series[s].first; a < job->series[s].first + job->series[s].axes; a++)
+			fprintf(stderr, "%-6s %-14.6g %-14.6g %.3g\n", axisName[a], at_one[a], isinf(best[a]) ? 0 : best[a] / ALLAN_BIAS_FACTOR, best_tau[a]);
+	}
+
+	SeriesFree(&job->series[0]);
+	SeriesFree(&job->series[1]);
+	pthread_mutex_destroy(&job->lock);
+	free(job);
+
+	return 0;
+}
+
+/*
+ * @brief:  Internal function, one sequential pass over the frames: the counts of the axes first .. first + axes - 1 (accel, gyro big
+ * 			endian, mag little endian) and their prefix sums per tile. The magnetometer series (first = 6) of 21 bytes frames takes only
+ * 			the frames with ALLAN_MAG_NEW
+ * @retval: 0 if the temporary file or the prefix sums could not be allocated
+ */
+static uint8_t SeriesCreate(ALLAN_SERIES *series, const char *path, const uint8_t *data, size_t frames, uint8_t frame_bytes, uint8_t first,
+						   uint8_t axes){
+
+	int64_t running[ALLAN_AXES] = {0};
+	size_t count = 0;
+
+	series->first = first;
+	series->axes = axes;
+	series->counts_bytes = frames * axes * sizeof(int16_t);
+	series->counts = CountsCreate(path, series->counts_bytes);
+	series->prefix = malloc((frames / ALLAN_TILE_FRAMES + 2) * axes * sizeof(int64_t));
+	if(series->counts == NULL || series->prefix == NULL)
+		return 0;
+
+	for(size_t i = 0; i < frames; i++, data += frame_bytes){
+		int16_t *value = &series->counts[count * axes];
+
+		if(first == 6 && !(data[20] & ALLAN_MAG_NEW))
+			continue;
+
+		for(uint8_t a = 0; a < axes; a++){
+			uint8_t axis = first + a;
+
+			if(axis < 3)
+				value[a] = (int16_t)(data[2 * axis] << 8 | data[2 * axis + 1]);
+			else if(axis < 6)
+				value[a] = (int16_t)(data[2 * axis + 2] << 8 | data[2 * axis + 3]);		/* The temperature is skipped */
+			else
+				value[a] = (int16_t)(data[2 * axis + 2] | data[2 * axis + 3] << 8);
+		}
+
+		if(count % ALLAN_TILE_FRAMES == 0)
+			memcpy(&series->prefix[count / ALLAN_TILE_FRAMES * axes], running, axes * sizeof(int64_t));
+		for(uint8_t a = 0; a < axes; a++)
+			running[a] += value[a];
+		count++;
+	}
+
+	if(count % ALLAN_TILE_FRAMES == 0)
+		memcpy(&series->prefix[count / ALLAN_TILE_FRAMES * axes], running, axes * sizeof(int64_t));
+
+	series->frames = count;
+
+	return 1;
+}
+
+static void SeriesFree(ALLAN_SERIES *series){
+
+	if(series->counts != NULL)
+		munmap(series->counts, series->counts_bytes);
+	free(series->prefix);
+}
+
+/*
+ * @brief:  Internal function, shared mapping of an unlinked temporary file of the given size, next to the log or at TMPDIR (/tmp)
+ * 			The space is reserved, so a full disk fails here and not with SIGBUS at a write of the mapping
+ * @retval: NULL if no file could be created, reserved or mapped (errno is set)
+ */
+static int16_t *CountsCreate(const char *path, size_t bytes){
+
+	const char *slash = strrchr(path, '/'), *tmp = getenv("TMPDIR");
+	char name[4096];
+	void *map;
+	int fd, error;
+
+	if(slash != NULL)
+		snprintf(name, sizeof(name), "%.*s/.MPU_Allan.XXXXXX", (int)(slash - path), path);
+	else
+		snprintf(name, sizeof(name), ".MPU_Allan.XXXXXX");
+
+	fd = mkstemp(name);
+	if(fd < 0){
+		snprintf(name, sizeof(name), "%s/MPU_Allan.XXXXXX", tmp != NULL ? tmp : "/tmp");
+		fd = mkstemp(name);
+		if(fd < 0)
+			return NULL;
+	}
+	unlink(name);													/* Removed when the mapping ends */
+
+	error = posix_fallocate(fd, 0, bytes);
+	if(error != 0){
+		close(fd);
+		errno = error;
+		return NULL;
+	}
+
+	map = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	return map == MAP_FAILED ? NULL : map;
+}
+
+/*
+ * @brief:  Internal function, sum of the counts start .. start + length - 1 of every axis, from the prefix sums and at most two
+ * 			partial tiles
+ */
+static void WindowSum(const ALLAN_SERIES *series, uint64_t start, uint64_t length, int64_t sum[]){
+
+	const uint8_t axes = series->axes;
+	uint64_t end = start + length, tile_start = start / ALLAN_TILE_FRAMES, tile_end = end / ALLAN_TILE_FRAMES;
+
+	for(uint8_t a = 0; a < axes; a++)
+		sum[a] = series->prefix[tile_end * axes + a] - series->prefix[tile_start * axes + a];
+
+	for(uint64_t i = tile_start * ALLAN_TILE_FRAMES; i < start; i++){
+		for(uint8_t a = 0; a < axes; a++)
+			sum[a] -= series->counts[i * axes + a];
+	}
+
+	for(uint64_t i = tile_end * ALLAN_TILE_FRAMES; i < end; i++){
+		for(uint8_t a = 0; a < axes; a++)
+			sum[a] += series->counts[i * axes + a];
+	}
+}
+
+/*
+ * @brief:  Internal function, the starts of one chunk for every cluster size:
+ * 			first = x[k .. k+m-1], second = x[k+m .. k+2m-1], both slide by one sample per step
+ */
+static void AllanChunk(ALLAN_JOB *job, ALLAN_SERIES *series, size_t chunk, ALLAN_SCRATCH *scratch){
+
+	int64_t (*first)[ALLAN_AXES] = scratch->first, (*second)[ALLAN_AXES] = scratch->second;
+	double (*sum)[ALLAN_AXES] = scratch->sum;
+	const uint8_t axes = series->axes;
+	const uint64_t begin = (uint64_t)chunk * ALLAN_CHUNK_FRAMES;
+	uint64_t end = begin + ALLAN_CHUNK_FRAMES;
+	uint16_t points = 0;
+
+	while(points < series->points && begin < series->frames - 2 * series->cluster[points] + 1){	/* Sizes with starts at this chunk */
+		WindowSum(series, begin, series->cluster[points], first[points]);
+		WindowSum(series, begin + series->cluster[points], series->cluster[points], second[points]);
+		memset(sum[points], 0, sizeof(sum[points]));
+		points++;
+	}
+
+	if(end > series->frames - 1)
+		end = series->frames - 1;
+
+	for(uint64_t tile = begin; tile < end; tile += ALLAN_TILE_FRAMES){
+		for(uint16_t p = 0; p < points; p++){
+			const uint64_t m = series->cluster[p], terms = series->frames - 2 * m + 1;
+			uint64_t last = tile + ALLAN_TILE_FRAMES < end ? tile + ALLAN_TILE_FRAMES : end;
+			const int16_t *x0, *x1, *x2;
+
+			if(tile >= terms)
+				break;													/* Larger sizes have fewer starts */
+			if(last > terms)
+				last = terms;
+
+			x0 = &series->counts[tile * axes];
+			x1 = x0 + m * axes;
+			x2 = x1 + m * axes;
+
+			for(uint64_t k = tile; k < last; k++){
+
+				for(uint8_t a = 0; a < axes; a++){
+					double difference = (double)(second[p][a] - first[p][a]);
+					sum[p][a] += difference * difference;
+				}
+
+				if(k + 1 == terms)
+					break;
+
+				for(uint8_t a = 0; a < axes; a++){
+					first[p][a] += x1[a] - x0[a];
+					second[p][a] += x2[a] - x1[a];
+				}
+
+				x0 += axes;
+				x1 += axes;
+				x2 += axes;
+			}
+		}
+	}
+
+	pthread_mutex_lock(&job->lock);
+	for(uint16_t p = 0; p < points; p++){
+		for(uint8_t a = 0; a < axes; a++)
+			series->sum[p][a] += sum[p][a];
+	}
+	pthread_mutex_unlock(&job->lock);
+}
+
+static void *AllanWorker(void *argument){
+
+	ALLAN_JOB *job = argument;
+	ALLAN_SCRATCH *scratch = malloc(sizeof(ALLAN_SCRATCH));
+	size_t taken;
+
+	if(scratch == NULL)
+		return NULL;											/* The chunks are left to the other threads */
+
+	while((taken = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) < job->series[0].chunks + job->series[1].chunks){
+		if(taken < job->series[0].chunks)
+			AllanChunk(job, &job->series[0], taken, scratch);
+		else
+			AllanChunk(job, &job->series[1], taken - job->series[0].chunks, scratch);
+	}
+
+	free(scratch);
+
+	return NULL;
+}
+
+/*
+ * @brief:  Internal function, distinct log spaced cluster sizes from 1 to (frames - 1) / 2
+ * @retval: Number of sizes
+ */
+static uint16_t ClusterSizes(uint64_t cluster[], size_t frames, uint16_t per_decade){
+
+	uint64_t largest = (frames - 1) / 2, size;
+	uint16_t points = 0;
+
+	for(uint32_t i = 0; points < ALLAN_MAX_POINTS; i++){
+		size = (uint64_t)floor(pow(10, (double)i / per_decade));
+		if(size > largest)
+			break;
+		if(points == 0 || size != cluster[points - 1])
+			cluster[points++] = size;
+	}
+
+	return points;
+}
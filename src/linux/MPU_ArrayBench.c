@@ -0,0 +1,130 @@
+/*
+ * MPU_ArrayBench.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+/*
+ * Host tool, read time of MPU_Array.c against the number of devices:
+ *
+ *		gcc -O2 -std=gnu11 -fshort-enums -fcommon -Isrc/linux -Isrc src/linux/MPU_ArrayBench.c src/MPU_Array.c src/MPU_Driver.c \
+ *			src/linux/MPU_Linux.c src/linux/MPU_LinuxFake.c -lm -o MPU_ArrayBench
+ *		MPU_ArrayBench [-n reads] [-w warmup] [-f bus_hz] [-1 /dev/i2c-N] [-2 /dev/i2c-N] [-3 /dev/i2c-N] > array.csv
+ *
+ * Without -1, -2 or -3 the devices are the fake of MPU_LinuxFake.c, with them the devices are real (the first one must be the
+ * one at I2C1 address 0x68, given to MPU_Init). Device i of a run with N devices is at bus (i % 3) + 1, address 0x68 for the first
+ * three and 0x69 for the others, the same spread of buses recommended for the array.
+ *
+ * Output: CSV at stdout, one line per N with the time of one @MPU_ArrayRead in µs (minimum, median, mean, 90th percentile), the reads
+ * that did not give every device and the ioctls of each read. The two model columns are the bus time of the 14 bytes bursts at
+ * bus_hz (156 bits each): serial is one device after the other, parallel is the most loaded bus, what the schedule gives on the MCU.
+ * Linux has no interrupt driven transfer, each read is one blocking ioctl, so the measured time grows with N at any spread of buses:
+ * on the fake it is the host cost of the schedule, on real devices it should follow the serial column.
+ */
+
+#include "MPU_Array.h"
+#include "MPU_Linux.h"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_MAX_READS				100000
+#define BENCH_BURST_BITS			156				//START, address + W, register, repeated START, address + R, 14 bytes, STOP
+
+static double Now();
+static int CompareDouble(const void *a, const void *b);
+
+int main(int argc, char *argv[]){
+
+	static double samples[BENCH_MAX_READS];
+	static MPU_ARRAY array;
+	const uint8_t i2c[ARRAY_MAX_DEVICES] = {USE_I2C1, USE_I2C2, USE_I2C3, USE_I2C1, USE_I2C2, USE_I2C3};
+	const uint8_t addr[ARRAY_MAX_DEVICES] = {USE_ADDR1, USE_ADDR1, USE_ADDR1, USE_ADDR2, USE_ADDR2, USE_ADDR2};
+	int reads = 1000, warmup = 50, option;
+	double bus_hz = 400000;
+	uint8_t real = 0;
+	float accel[3], gyro[3];
+
+	while((option = getopt(argc, argv, "n:w:f:1:2:3:")) != -1){
+		switch(option){
+			case 'n':	reads = atoi(optarg);						break;
+			case 'w':	warmup = atoi(optarg);						break;
+			case 'f':	bus_hz = atof(optarg);						break;
+			case '1':
+			case '2':
+			case '3':	MPU_LinuxSetDevice(option - '0', optarg);	real = 1;	break;
+			default:	optind = argc + 1;							break;
+		}
+	}
+
+	if(optind != argc || reads < 1 || reads > BENCH_MAX_READS || warmup < 0 || bus_hz <= 0){
+		fprintf(stderr, "usage: %s [-n reads] [-w warmup] [-f bus_hz] [-1 /dev/i2c-N] [-2 /dev/i2c-N] [-3 /dev/i2c-N]\n", argv[0]);
+		return 2;
+	}
+
+	if(!real)
+		MPU_LinuxSetOps(MPU_LinuxFakeOps());
+
+	MPU_Init(USE_I2C1, USE_ADDR1, 0, 0);
+
+	printf("devices,buses,reads,min_us,median_us,mean_us,p90_us,incomplete,ioctls_per_read,model_serial_us,model_parallel_us\n");
+
+	for(uint8_t count = 1; count <= ARRAY_MAX_DEVICES; count++){
+		uint8_t buses = count < ARRAY_BUSES ? count : ARRAY_BUSES;
+		uint8_t most_loaded = (count + ARRAY_BUSES - 1) / ARRAY_BUSES;
+		double burst_us = BENCH_BURST_BITS / bus_hz * 1e6, mean = 0, median, start;
+		MPU_LINUX_STATS before, after;
+		int incomplete = 0;
+
+		MPU_ArrayInit(&array, i2c, addr, count, ARRAY_SYNC_NONE);
+
+		for(int i = 0; i < warmup; i++)
+			MPU_ArrayRead(&array, accel, gyro);
+
+		MPU_LinuxGetStats(&before);
+
+		for(int i = 0; i < reads; i++){
+			start = Now();
+			if(MPU_ArrayRead(&array, accel, gyro) != ARRAY_READ_OK)
+				incomplete++;
+			samples[i] = (Now() - start) / 1e3;
+			mean += samples[i] / reads;
+		}
+
+		MPU_LinuxGetStats(&after);
+
+		qsort(samples, reads, sizeof(double), CompareDouble);
+		median = reads % 2 ? samples[reads / 2] : (samples[reads / 2 - 1] + samples[reads / 2]) / 2;
+
+		printf("%u,%u,%d,%.3f,%.3f,%.3f,%.3f,%d,%.2f,%.1f,%.1f\n", count, buses, reads, samples[0], median, mean,
+				samples[(reads * 9) / 10], incomplete, (double)(after.ioctls - before.ioctls) / reads, count * burst_us, most_loaded * burst_us);
+		fflush(stdout);
+
+		fprintf(stderr, "%u devices on %u buses: %10.3f us median, model %6.1f us serial, %6.1f us parallel\n", count, buses, median,
+				count * burst_us, most_loaded * burst_us);
+	}
+
+	return 0;
+}
+
+/*
+ * @brief:  Internal function, monotonic time
+ * @retval: ns
+ */
+static double Now(){
+
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+static int CompareDouble(const void *a, const void *b){
+
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
@@ -0,0 +1,416 @@
+/*
+ * MPU_Bench.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+/*
+ * Host tool, microbenchmark of the math and conversion kernels of MPU_Driver.c:
+ *
+ *		gcc -O2 -std=gnu11 -fshort-enums -fcommon -Isrc/linux -Isrc src/linux/MPU_Bench.c src/linux/MPU_Linux.c -lm -o MPU_Bench
+ *		MPU_Bench [-r repetitions] [-w warmup] [-t min_rep_ms] [-k kernel] [-c before.csv] > after.csv
+ *
+ * The kernels are static, so the driver is compiled into this file. Each case runs as many iterations as needed for one repetition
+ * to take at least -t ms, then -w repetitions are discarded (caches, branch predictors, CPU frequency) and -r are timed with
+ * CLOCK_MONOTONIC. The inputs rotate over a small set so no call sees a constant, and the outputs go to a volatile sink.
+ *
+ * Output: CSV at stdout, one line per case with the time of one call in ns (minimum, median, mean, standard deviation, 90th percentile).
+ * With -c the medians of a previous run are added with the speedup (before / after), so a change of the math comes with both numbers:
+ *
+ *		MPU_Bench > before.csv; (change MPU_Driver.c, rebuild); MPU_Bench -c before.csv
+ *
+ * Use the median to compare, the minimum shows the best case and the standard deviation how noisy the machine was.
+ * These are host numbers, they rank the alternatives, the cycles of a Cortex-M are not a multiple of them.
+ */
+
+#include "../MPU_Driver.c"
+
+#include <getopt.h>
+#include <time.h>
+
+#define BENCH_MAX_REPETITIONS		1000
+#define BENCH_MAX_BASELINE			64
+#define BENCH_INPUTS				16				//Different inputs rotated at the calls
+#define BENCH_MAG_MAX				10000
+#define BENCH_BATCH					256
+
+typedef struct{
+	const char *name;
+	uint32_t size;									/* Problem size, meaning given by the case (samples, matrix order) */
+	void (*run)(uint32_t size, uint64_t iterations);
+}BENCH_CASE;
+
+typedef struct{
+	char name[64];
+	uint32_t size;
+	double median;
+}BENCH_BASELINE;
+
+static volatile float sink;
+
+static float inputSquare[BENCH_INPUTS][9 * 9];		/* Well conditioned (diagonally dominant) matrices */
+static float inputRows[BENCH_INPUTS][6 * 4];		/* Six pose averages and a one column, as given to accelCalibration */
+static uint8_t inputRaw[BENCH_INPUTS][8];			/* Sensor bytes, also used as ST1, HXL..HZH, ST2 */
+static float magSamples[(BENCH_MAG_MAX + BENCH_INPUTS) * 3];
+static float accelParam[12];
+
+static void RunMatrixMult1x4x3(uint32_t size, uint64_t iterations);
+static void RunMatrixMult4x6x4(uint32_t size, uint64_t iterations);
+static void RunMatrixMultVector(uint32_t size, uint64_t iterations);
+static void RunMatrixTransp(uint32_t size, uint64_t iterations);
+static void RunMatrixInv(uint32_t size, uint64_t iterations);
+static void RunAccelCalibration(uint32_t size, uint64_t iterations);
+static void RunMagEllipsoidFit(uint32_t size, uint64_t iterations);
+static void RunAccelVectorTransform(uint32_t size, uint64_t iterations);
+static void RunGyroVectorTransform(uint32_t size, uint64_t iterations);
+static void RunMagVectorTransform(uint32_t size, uint64_t iterations);
+static void RunBatchConvert(uint32_t size, uint64_t iterations);
+static void BenchSetup();
+static double Now();
+static double TimeRepetition(const BENCH_CASE *bench, uint64_t iterations);
+static int CompareDouble(const void *a, const void *b);
+static uint8_t BaselineLoad(const char *path, BENCH_BASELINE baseline[], uint8_t *count);
+
+static const BENCH_CASE benchCases[] = {
+	{"matrixMult_1x4x3",		1,		RunMatrixMult1x4x3},		/* Per accel sample calibration */
+	{"matrixMult_4x6x4",		6,		RunMatrixMult4x6x4},		/* wt * w of accelCalibration */
+	{"matrixMult_NxNx1",		9,		RunMatrixMultVector},		/* Mag least squares solution */
+	{"matrixTransp_6x4",		6,		RunMatrixTransp},
+	{"matrixInv",				3,		RunMatrixInv},
+	{"matrixInv",				4,		RunMatrixInv},
+	{"matrixInv",				9,		RunMatrixInv},
+	{"accelCalibration",		6,		RunAccelCalibration},
+	{"magEllipsoidFit",			100,	RunMagEllipsoidFit},
+	{"magEllipsoidFit",			1000,	RunMagEllipsoidFit},
+	{"magEllipsoidFit",			10000,	RunMagEllipsoidFit},
+	{"AccelVectorTransform",	1,		RunAccelVectorTransform},
+	{"GyroVectorTransform",		1,		RunGyroVectorTransform},
+	{"MagVectorTransform",		1,		RunMagVectorTransform},
+	{"BatchConvert",			BENCH_BATCH,	RunBatchConvert},	/* Accel, gyro and temperature of one batch */
+};
+
+int main(int argc, char *argv[]){
+
+	static double samples[BENCH_MAX_REPETITIONS];
+	static BENCH_BASELINE baseline[BENCH_MAX_BASELINE];
+	uint8_t baseline_count = 0;
+	int repetitions = 31, warmup = 3, option;
+	double min_rep_ms = 10;
+	const char *filter = NULL, *before = NULL;
+
+	while((option = getopt(argc, argv, "r:w:t:k:c:")) != -1){
+		switch(option){
+			case 'r':	repetitions = atoi(optarg);		break;
+			case 'w':	warmup = atoi(optarg);			break;
+			case 't':	min_rep_ms = atof(optarg);		break;
+			case 'k':	filter = optarg;				break;
+			case 'c':	before = optarg;				break;
+			default:	optind = argc + 1;				break;
+		}
+	}
+
+	if(optind != argc || repetitions < 1 || repetitions > BENCH_MAX_REPETITIONS || warmup < 0 || min_rep_ms <= 0){
+		fprintf(stderr, "usage: %s [-r repetitions] [-w warmup] [-t min_rep_ms] [-k kernel] [-c before.csv]\n", argv[0]);
+		return 2;
+	}
+
+	if(before != NULL && !BaselineLoad(before, baseline, &baseline_count)){
+		perror(before);
+		return 1;
+	}
+
+	BenchSetup();
+
+	printf("kernel,size,iterations,repetitions,min_ns,median_ns,mean_ns,stddev_ns,p90_ns%s\n", before != NULL ? ",before_median_ns,speedup" : "");
+
+	for(uint8_t c = 0; c < sizeof(benchCases) / sizeof(benchCases[0]); c++){
+		const BENCH_CASE *bench = &benchCases[c];
+		uint64_t iterations = 1;
+		double mean = 0, deviation = 0, median;
+
+		if(filter != NULL && strstr(bench->name, filter) == NULL)
+			continue;
+
+		while(TimeRepetition(bench, iterations) < min_rep_ms * 1e6 && iterations < (1ULL << 40))
+			iterations *= 2;
+
+		for(int i = 0; i < warmup; i++)
+			TimeRepetition(bench, iterations);
+
+		for(int i = 0; i < repetitions; i++){
+			samples[i] = TimeRepetition(bench, iterations) / iterations;
+			mean += samples[i] / repetitions;
+		}
+
+		for(int i = 0; i < repetitions; i++)
+			deviation += (samples[i] - mean) * (samples[i] - mean);
+		deviation = repetitions > 1 ? sqrt(deviation / (repetitions - 1)) : 0;
+
+		qsort(samples, repetitions, sizeof(double), CompareDouble);
+		median = repetitions % 2 ? samples[repetitions / 2] : (samples[repetitions / 2 - 1] + samples[repetitions / 2]) / 2;
+
+		printf("%s,%u,%llu,%d,%.3f,%.3f,%.3f,%.3f,%.3f", bench->name, bench->size, (unsigned long long)iterations, repetitions,
+				samples[0], median, mean, deviation, samples[(repetitions * 9) / 10 < repetitions ? (repetitions * 9) / 10 : repetitions - 1]);
+
+		if(before != NULL){
+			double old = 0;
+
+			for(uint8_t b = 0; b < baseline_count; b++)
+				if(strcmp(baseline[b].name, bench->name) == 0 && baseline[b].size == bench->size)
+					old = baseline[b].median;
+
+			if(old > 0)
+				printf(",%.3f,%.3f", old, old / median);
+			else
+				printf(",,");
+		}
+		printf("\n");
+		fflush(stdout);
+
+		fprintf(stderr, "%-22s %6u %12.1f ns  (+- %.1f)\n", bench->name, bench->size, median, deviation);
+	}
+
+	return 0;
+}
+
+static void RunMatrixMult1x4x3(uint32_t size, uint64_t iterations){
+
+	float vector[4] = {0, 0, 0, 1}, result[3];
+
+	(void)size;
+
+	for(uint64_t i = 0; i < iterations; i++){
+		memcpy(vector, inputSquare[i % BENCH_INPUTS], 3 * sizeof(float));
+		matrixMult(vector, accelParam, result, 1, 4, 3);
+		sink = result[0];
+	}
+}
+
+static void RunMatrixMult4x6x4(uint32_t size, uint64_t iterations){
+
+	float transposed[4 * 6], result[4 * 4];
+
+	(void)size;
+
+	matrixTransp(inputRows[0], transposed, 6, 4);
+	for(uint64_t i = 0; i < iterations; i++){
+		matrixMult(transposed, inputRows[i % BENCH_INPUTS], result, 4, 6, 4);
+		sink = result[0];
+	}
+}
+
+static void RunMatrixMultVector(uint32_t size, uint64_t iterations){
+
+	float result[9];
+
+	for(uint64_t i = 0; i < iterations; i++){
+		matrixMult(inputSquare[i % BENCH_INPUTS], inputSquare[(i + 1) % BENCH_INPUTS], result, size, size, 1);
+		sink = result[0];
+	}
+}
+
+static void RunMatrixTransp(uint32_t size, uint64_t iterations){
+
+	float result[6 * 4];
+
+	(void)size;
+
+	for(uint64_t i = 0; i < iterations; i++){
+		matrixTransp(inputRows[i % BENCH_INPUTS], result, 6, 4);
+		sink = result[1];
+	}
+}
+
+static void RunMatrixInv(uint32_t size, uint64_t iterations){
+
+	float input[BENCH_INPUTS][9 * 9], result[9 * 9];
+
+	for(uint8_t n = 0; n < BENCH_INPUTS; n++)					/* Leading size x size block, kept diagonally dominant */
+		for(uint32_t r = 0; r < size; r++)
+			for(uint32_t c = 0; c < size; c++)
+				input[n][r * size + c] = inputSquare[n][r * 9 + c];
+
+	for(uint64_t i = 0; i < iterations; i++){
+		matrixInv(input[i % BENCH_INPUTS], result, size, size);
+		sink = result[0];
+	}
+}
+
+static void RunAccelCalibration(uint32_t size, uint64_t iterations){
+
+	(void)size;
+
+	for(uint64_t i = 0; i < iterations; i++){
+		accelCalibration(inputRows[i % BENCH_INPUTS]);
+		sink = accelCalibrationParam[0];
+	}
+}
+
+static void RunMagEllipsoidFit(uint32_t size, uint64_t iterations){
+
+	float soft_iron[3][3], hard_iron[3];
+
+	for(uint64_t i = 0; i < iterations; i++){
+		sink = magEllipsoidFit(&magSamples[(i % BENCH_INPUTS) * 3], size, soft_iron, hard_iron);
+		sink = hard_iron[0];
+	}
+}
+
+static void RunAccelVectorTransform(uint32_t size, uint64_t iterations){
+
+	float result[3];
+
+	(void)size;
+
+	for(uint64_t i = 0; i < iterations; i++){
+		AccelVectorTransform(inputRaw[i % BENCH_INPUTS], result);
+		sink = result[2];
+	}
+}
+
+static void RunGyroVectorTransform(uint32_t size, uint64_t iterations){
+
+	float result[3];
+
+	(void)size;
+
+	for(uint64_t i = 0; i < iterations; i++){
+		GyroVectorTransform(inputRaw[i % BENCH_INPUTS], result);
+		sink = result[2];
+	}
+}
+
+static void RunMagVectorTransform(uint32_t size, uint64_t iterations){
+
+	float result[3];
+
+	(void)size;
+
+	for(uint64_t i = 0; i < iterations; i++){
+		MagVectorTransform(inputRaw[i % BENCH_INPUTS], result);
+		sink = result[2];
+	}
+}
+
+static void RunBatchConvert(uint32_t size, uint64_t iterations){
+
+	static MPU_BATCH_BUFFER(ax, BENCH_BATCH);
+	static MPU_BATCH_BUFFER(ay, BENCH_BATCH);
+	static MPU_BATCH_BUFFER(az, BENCH_BATCH);
+	static MPU_BATCH_BUFFER(gx, BENCH_BATCH);
+	static MPU_BATCH_BUFFER(gy, BENCH_BATCH);
+	static MPU_BATCH_BUFFER(gz, BENCH_BATCH);
+	static MPU_BATCH_BUFFER(temp, BENCH_BATCH);
+	MPU_SOA_BATCH batch = {ax, ay, az, gx, gy, gz, temp, BENCH_BATCH, BENCH_BATCH, NULL, 0};
+
+	for(uint64_t i = 0; i < iterations; i++){
+		for(uint32_t j = 0; j < size; j++){							/* Counts as decoded from the fifo, part of the cost */
+			const uint8_t *raw = inputRaw[(i + j) % BENCH_INPUTS];
+			ax[j] = (int16_t)(raw[0] << 8 | raw[1]);	ay[j] = (int16_t)(raw[2] << 8 | raw[3]);	az[j] = (int16_t)(raw[4] << 8 | raw[5]);
+			gx[j] = (int16_t)(raw[2] << 8 | raw[3]);	gy[j] = (int16_t)(raw[4] << 8 | raw[5]);	gz[j] = (int16_t)(raw[6] << 8 | raw[7]);
+			temp[j] = (int16_t)(raw[1] << 8 | raw[0]);
+		}
+		BatchConvert(&batch, size, 0xF8);
+		sink = ax[size - 1] + gz[size - 1];
+	}
+}
+
+/*
+ * @brief:  Internal function, driver state and inputs, the same at every run (fixed seed)
+ */
+static void BenchSetup(){
+
+	uint32_t seed = 12345;
+	float axis[3] = {42, 25, 33}, center[3] = {12, -30, 8}, u[3], norm;
+
+	#define BENCH_RANDOM()	((seed = seed * 1664525 + 1013904223) >> 8) / (float)(1 << 24)
+
+	accel_sensitivity_used = 4096;
+	gyro_sensitivity_used = 32.8;
+	gyroxStaticBias = 0.4;	gyroyStaticBias = -0.2;	gyrozStaticBias = 0.1;
+	magx_Adj = 1.02;		magy_Adj = 0.98;		magz_Adj = 1.05;
+	MagCorrectionUpdate();
+
+	for(uint8_t i = 0; i < 12; i++)
+		accelParam[i] = (i % 4 == 0 && i < 9) ? 1.0f : 0.01f * (i + 1);
+	accelCalibrationParam = accelParam;
+
+	for(uint8_t n = 0; n < BENCH_INPUTS; n++){
+		for(uint8_t r = 0; r < 9; r++)
+			for(uint8_t c = 0; c < 9; c++)
+				inputSquare[n][r * 9 + c] = (r == c ? 10.0f : 0.0f) + BENCH_RANDOM() - 0.5f;
+
+		for(uint8_t r = 0; r < 6; r++){
+			for(uint8_t c = 0; c < 3; c++)
+				inputRows[n][r * 4 + c] = (c == (5 - r) / 2 ? (r % 2 ? -G : G) : 0) + 0.1f * (BENCH_RANDOM() - 0.5f);
+			inputRows[n][r * 4 + 3] = 1;
+		}
+
+		for(uint8_t b = 0; b < 8; b++)
+			inputRaw[n][b] = BENCH_RANDOM() * 256;
+		inputRaw[n][0] |= 0x01;										/* DRDY, as a good mag read */
+	}
+
+	for(uint32_t i = 0; i < BENCH_MAG_MAX + BENCH_INPUTS; i++){		/* Ellipsoid with noise */
+		for(uint8_t j = 0; j < 3; j++)
+			u[j] = BENCH_RANDOM() - 0.5f;
+		norm = sqrtf(u[0] * u[0] + u[1] * u[1] + u[2] * u[2]) + 1e-6f;
+		for(uint8_t j = 0; j < 3; j++)
+			magSamples[i * 3 + j] = center[j] + axis[j] * u[j] / norm + 0.3f * (BENCH_RANDOM() - 0.5f);
+	}
+
+	#undef BENCH_RANDOM
+}
+
+static double Now(){
+
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+/*
+ * @brief:  Internal function, one repetition of a case
+ * @retval: Elapsed ns
+ */
+static double TimeRepetition(const BENCH_CASE *bench, uint64_t iterations){
+
+	double start = Now();
+
+	bench->run(bench->size, iterations);
+
+	return Now() - start;
+}
+
+static int CompareDouble(const void *a, const void *b){
+
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+/*
+ * @brief:  Internal function, kernel, size and median of a CSV written by a previous run
+ * @retval: 0 if the file can not be opened
+ */
+static uint8_t BaselineLoad(const char *path, BENCH_BASELINE baseline[], uint8_t *count){
+
+	FILE *file = fopen(path, "r");
+	char line[256];
+
+	if(file == NULL)
+		return 0;
+
+	while(fgets(line, sizeof(line), file) != NULL && *count < BENCH_MAX_BASELINE){
+		BENCH_BASELINE *entry = &baseline[*count];
+
+		if(sscanf(line, "%63[^,],%u,%*u,%*d,%*f,%lf", entry->name, &entry->size, &entry->median) == 3)
+			(*count)++;
+	}
+
+	fclose(file);
+
+	return 1;
+}
@@ -0,0 +1,477 @@
+/*
+ * MPU_Linux.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+/*
+ * Linux userspace transport, see MPU_Linux.h.
+ * One transport is kept for each I2C1, I2C2 and I2C3 instance, handles of the same instance share it (the driver and MPU_Array).
+ * The queued messages point into the transport buffer, so they stay valid until the ioctl that sends them.
+ * The queues are shared by the threads of the POSIX port: the flushes made outside of the driver calls (tick, delay, @MPU_LinuxFlush,
+ * @MPU_LinuxClose) take the bus lock, the other HAL calls come from the driver, which holds it.
+ */
+
+#include "MPU_Linux.h"
+#include "MPU_SPEC.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <linux/spi/spidev.h>
+
+typedef struct{
+	int fd;
+	uint8_t spi;										/* 1 for a spidev file */
+	uint8_t spi_register;								/* Register selected by a one byte transmit, read by the next receive */
+	uint8_t count;										/* Queued messages */
+	uint16_t used;										/* Queued bytes at buffer */
+	struct i2c_msg messages[LINUX_MAX_MESSAGES];
+	struct spi_ioc_transfer transfers[LINUX_MAX_MESSAGES];
+	uint8_t buffer[LINUX_BUFFER_BYTES];
+	uint8_t *read_data;									/* SPI read of the last message, copied out after the ioctl */
+	uint8_t *read_rx;
+	uint16_t read_size;
+}LINUX_TRANSPORT;
+
+static int DefaultOpen(const char *path, int flags);
+static int DefaultIoctl(int fd, unsigned long request, void *argument);
+static LINUX_TRANSPORT *Transport(I2C_HandleTypeDef *hi2c);
+static uint8_t *TransportReserve(LINUX_TRANSPORT *transport, uint8_t messages, uint16_t bytes);
+static void TransportAdd(LINUX_TRANSPORT *transport, uint8_t addr, uint16_t flags, uint8_t *tx, uint8_t *rx, uint16_t size);
+static HAL_StatusTypeDef TransportWrite(LINUX_TRANSPORT *transport, uint8_t addr, uint8_t reg, uint8_t *data, uint16_t size);
+static HAL_StatusTypeDef TransportRead(LINUX_TRANSPORT *transport, uint8_t addr, uint8_t reg, uint8_t *data, uint16_t size);
+static HAL_StatusTypeDef TransportFlush(LINUX_TRANSPORT *transport);
+static void FlushAll();
+
+static MPU_LINUX_OPS linuxOps = {DefaultOpen, DefaultIoctl, close};
+static const char *devicePath[3] = {"/dev/i2c-1", "/dev/i2c-2", "/dev/i2c-3"};
+static LINUX_TRANSPORT *transports[3];
+static MPU_LINUX_STATS linuxStats;
+
+/*
+ * @brief:  Choose the device file of one I2C instance, before @MPU_Init (or @MPU_ArrayInit)
+ * @param:  i2c - USE_I2C1, USE_I2C2 or USE_I2C3, as given to @MPU_Init
+ * 			path - "/dev/i2c-N" or "/dev/spidevX.Y", the string must stay valid
+ * @retval: None
+ */
+void MPU_LinuxSetDevice(uint8_t i2c, const char *path){
+
+	if(i2c >= 1 && i2c <= 3)
+		devicePath[i2c - 1] = path;
+}
+
+/*
+ * @brief:  Replace the system calls used to reach the device, for example by @MPU_LinuxFakeOps. Call it before the first open
+ * @param:  ops - open, ioctl and close functions
+ * @retval: None
+ */
+void MPU_LinuxSetOps(const MPU_LINUX_OPS *ops){
+
+	linuxOps = *ops;
+}
+
+/*
+ * @brief:  Send the queued writes now. The driver does not need it, reads, delays and ticks flush the queue
+ * @param:  hi2c - Handle of the device
+ * @retval: HAL_OK, or HAL_ERROR if the ioctl failed
+ */
+HAL_StatusTypeDef MPU_LinuxFlush(I2C_HandleTypeDef *hi2c){
+
+	LINUX_TRANSPORT *transport = Transport(hi2c);
+	HAL_StatusTypeDef status;
+
+	if(transport == NULL)
+		return HAL_ERROR;
+
+	MPU_BUS_LOCK();
+	status = TransportFlush(transport);
+	MPU_BUS_UNLOCK();
+
+	return status;
+}
+
+/*
+ * @brief:  Send the queued writes and close the device file of one instance
+ * @param:  hi2c - Handle of the device
+ * @retval: None
+ */
+void MPU_LinuxClose(I2C_HandleTypeDef *hi2c){
+
+	LINUX_TRANSPORT *transport = Transport(hi2c);
+	uintptr_t instance = (uintptr_t)hi2c->Instance;
+
+	if(transport == NULL)
+		return;
+
+	MPU_BUS_LOCK();
+
+	TransportFlush(transport);
+	linuxOps.close(transport->fd);
+	free(transport);
+
+	transports[instance - 1] = NULL;
+	hi2c->transport = NULL;
+
+	MPU_BUS_UNLOCK();
+}
+
+/*
+ * @brief:  System calls and messages since the start
+ * @param:  stats - Where the counters will be copied
+ * @retval: None
+ */
+void MPU_LinuxGetStats(MPU_LINUX_STATS *stats){
+
+	*stats = linuxStats;
+}
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c){
+
+	uintptr_t instance = (uintptr_t)hi2c->Instance;
+	LINUX_TRANSPORT *transport;
+	uint8_t mode = SPI_MODE_3, bits = 8;
+	uint32_t speed = LINUX_SPI_SPEED_HZ;
+
+	if(instance < 1 || instance > 3)
+		return HAL_ERROR;
+
+	hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+
+	if(transports[instance - 1] != NULL){						/* Other handle of the same instance */
+		hi2c->transport = transports[instance - 1];
+		return HAL_OK;
+	}
+
+	transport = calloc(1, sizeof(LINUX_TRANSPORT));
+	if(transport == NULL)
+		return HAL_ERROR;
+
+	transport->fd = linuxOps.open(devicePath[instance - 1], O_RDWR);
+	if(transport->fd < 0){
+		free(transport);
+		return HAL_ERROR;
+	}
+
+	transport->spi = strstr(devicePath[instance - 1], "spidev") != NULL;
+	if(transport->spi){
+		linuxOps.ioctl(transport->fd, SPI_IOC_WR_MODE, &mode);
+		linuxOps.ioctl(transport->fd, SPI_IOC_WR_BITS_PER_WORD, &bits);
+		linuxOps.ioctl(transport->fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed);
+	}
+
+	transports[instance - 1] = transport;
+	hi2c->transport = transport;
+
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c){
+
+	hi2c->ErrorCode = HAL_I2C_ERROR_NONE;						/* The transport stays open, other handles of the instance use it */
+
+	return Transport(hi2c) == NULL ? HAL_ERROR : HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout){
+
+	LINUX_TRANSPORT *transport = Transport(hi2c);
+
+	(void)Timeout;												/* The adapter driver has its own */
+
+	if(transport == NULL || Size == 0)
+		return HAL_ERROR;
+
+	if(transport->spi && Size == 1){							/* Register address of the next receive */
+		transport->spi_register = pData[0];
+		return HAL_OK;
+	}
+
+	return TransportWrite(transport, DevAddress >> 1, pData[0], &pData[1], Size - 1);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Receive(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout){
+
+	LINUX_TRANSPORT *transport = Transport(hi2c);
+
+	(void)Timeout;
+
+	if(transport == NULL)
+		return HAL_ERROR;
+
+	if(transport->spi)
+		return TransportRead(transport, DevAddress >> 1, transport->spi_register, pData, Size);
+
+	if(TransportReserve(transport, 1, 0) == NULL)				/* The register address queued by the transmit goes in the same ioctl */
+		return HAL_ERROR;
+
+	TransportAdd(transport, DevAddress >> 1, I2C_M_RD, NULL, pData, Size);
+
+	return TransportFlush(transport);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout){
+
+	LINUX_TRANSPORT *transport = Transport(hi2c);
+
+	(void)MemAddSize;											/* Always I2C_MEMADD_SIZE_8BIT */
+	(void)Timeout;
+
+	return transport == NULL ? HAL_ERROR : TransportWrite(transport, DevAddress >> 1, MemAddress, pData, Size);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout){
+
+	LINUX_TRANSPORT *transport = Transport(hi2c);
+
+	(void)MemAddSize;
+	(void)Timeout;
+
+	return transport == NULL ? HAL_ERROR : TransportRead(transport, DevAddress >> 1, MemAddress, pData, Size);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size){
+
+	HAL_StatusTypeDef status = HAL_I2C_Mem_Read(hi2c, DevAddress, MemAddress, MemAddSize, pData, Size, HAL_MAX_DELAY);	/* Done before it returns */
+
+	hi2c->ErrorCode = (status == HAL_OK) ? HAL_I2C_ERROR_NONE : HAL_I2C_ERROR_AF;
+
+	return HAL_OK;												/* As the STM32, the end of the transfer reports the error */
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Abort_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress){
+
+	(void)hi2c;
+	(void)DevAddress;
+
+	return HAL_ERROR;											/* Nothing is ever in flight */
+}
+
+HAL_I2C_StateTypeDef HAL_I2C_GetState(I2C_HandleTypeDef *hi2c){
+
+	(void)hi2c;
+
+	return HAL_I2C_STATE_READY;
+}
+
+uint32_t HAL_I2C_GetError(I2C_HandleTypeDef *hi2c){
+
+	return hi2c->ErrorCode;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout){
+
+	(void)Timeout;
+
+	return write(huart->Instance, pData, Size) == Size ? HAL_OK : HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size){
+
+	if(HAL_UART_Transmit(huart, pData, Size, HAL_MAX_DELAY) != HAL_OK)
+		return HAL_ERROR;
+
+	HAL_UART_TxCpltCallback(huart);								/* Done before it returns, the end of the transfer is reported at once */
+
+	return HAL_OK;
+}
+
+/*
+ * @brief:  End of a HAL_UART_Transmit_DMA, weak as in the STM32 HAL: the application defines it (for @MPU_TelemetryTxComplete)
+ */
+__attribute__((weak)) void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart){
+
+	(void)huart;
+}
+
+void HAL_Delay(uint32_t Delay){
+
+	struct timespec duration = {.tv_sec = Delay / 1000, .tv_nsec = (long)(Delay % 1000) * 1000000};
+
+	FlushAll();
+	while(nanosleep(&duration, &duration) != 0);
+}
+
+uint32_t HAL_GetTick(void){
+
+	struct timespec now;
+
+	FlushAll();													/* Time based waits see the writes done */
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint32_t)(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+/*
+ * @brief:  Internal function, system calls of the real device
+ */
+static int DefaultOpen(const char *path, int flags){
+
+	return open(path, flags);
+}
+
+static int DefaultIoctl(int fd, unsigned long request, void *argument){
+
+	return ioctl(fd, request, argument);
+}
+
+/*
+ * @brief:  Internal function, transport of one handle (NULL if HAL_I2C_Init failed)
+ */
+static LINUX_TRANSPORT *Transport(I2C_HandleTypeDef *hi2c){
+
+	return (LINUX_TRANSPORT *)hi2c->transport;
+}
+
+/*
+ * @brief:  Internal function, room for messages and bytes at the queue, the queue is sent first when they do not fit
+ * @retval: Where the bytes can be placed, NULL if they never fit
+ */
+static uint8_t *TransportReserve(LINUX_TRANSPORT *transport, uint8_t messages, uint16_t bytes){
+
+	if(messages > LINUX_MAX_MESSAGES || bytes > LINUX_BUFFER_BYTES)
+		return NULL;
+
+	if(transport->count + messages > LINUX_MAX_MESSAGES || transport->used + bytes > LINUX_BUFFER_BYTES){
+		if(TransportFlush(transport) != HAL_OK)
+			return NULL;
+	}
+
+	return &transport->buffer[transport->used];
+}
+
+/*
+ * @brief:  Internal function, add one message to the queue. I2C uses tx for a write and rx for a read, SPI uses both (full duplex)
+ */
+static void TransportAdd(LINUX_TRANSPORT *transport, uint8_t addr, uint16_t flags, uint8_t *tx, uint8_t *rx, uint16_t size){
+
+	if(transport->spi){
+		struct spi_ioc_transfer *transfer = &transport->transfers[transport->count];
+
+		memset(transfer, 0, sizeof(struct spi_ioc_transfer));
+		transfer->tx_buf = (uintptr_t)tx;
+		transfer->rx_buf = (uintptr_t)rx;
+		transfer->len = size;
+		transfer->speed_hz = LINUX_SPI_SPEED_HZ;
+		transfer->bits_per_word = 8;
+		transfer->cs_change = 1;								/* Each register operation has its own chip select frame */
+	}
+	else{
+		struct i2c_msg *message = &transport->messages[transport->count];
+
+		message->addr = addr;
+		message->flags = flags;
+		message->len = size;
+		message->buf = (flags & I2C_M_RD) ? rx : tx;
+	}
+
+	transport->count++;
+}
+
+/*
+ * @brief:  Internal function, queue one write of size bytes starting at reg
+ */
+static HAL_StatusTypeDef TransportWrite(LINUX_TRANSPORT *transport, uint8_t addr, uint8_t reg, uint8_t *data, uint16_t size){
+
+	uint8_t *tx = TransportReserve(transport, 1, size + 1);
+
+	if(tx == NULL)
+		return HAL_ERROR;
+
+	tx[0] = transport->spi ? (reg & 0x7F) : reg;
+	memcpy(&tx[1], data, size);
+	transport->used += size + 1;
+
+	TransportAdd(transport, addr, 0, tx, NULL, size + 1);
+
+	return HAL_OK;
+}
+
+/*
+ * @brief:  Internal function, queue one read of size bytes starting at reg and send the queue with it
+ */
+static HAL_StatusTypeDef TransportRead(LINUX_TRANSPORT *transport, uint8_t addr, uint8_t reg, uint8_t *data, uint16_t size){
+
+	uint8_t *tx;
+
+	if(transport->spi){
+		tx = TransportReserve(transport, 1, 2 * (size + 1));
+		if(tx == NULL)
+			return HAL_ERROR;
+
+		memset(tx, 0, size + 1);
+		tx[0] = reg | 0x80;
+		transport->read_rx = &tx[size + 1];
+		transport->read_data = data;
+		transport->read_size = size;
+		transport->used += 2 * (size + 1);
+
+		TransportAdd(transport, addr, 0, tx, transport->read_rx, size + 1);
+	}
+	else{
+		tx = TransportReserve(transport, 2, 1);
+		if(tx == NULL)
+			return HAL_ERROR;
+
+		tx[0] = reg;
+		transport->used += 1;
+
+		TransportAdd(transport, addr, 0, tx, NULL, 1);
+		TransportAdd(transport, addr, I2C_M_RD, NULL, data, size);		/* Repeated start, same I2C_RDWR */
+	}
+
+	return TransportFlush(transport);
+}
+
+/*
+ * @brief:  Internal function, send every queued message with one ioctl
+ */
+static HAL_StatusTypeDef TransportFlush(LINUX_TRANSPORT *transport){
+
+	int result;
+
+	if(transport->count == 0)
+		return HAL_OK;
+
+	if(transport->spi){
+		transport->transfers[transport->count - 1].cs_change = 0;		/* Release the chip select at the end */
+		result = linuxOps.ioctl(transport->fd, SPI_IOC_MESSAGE(transport->count), transport->transfers);
+	}
+	else{
+		struct i2c_rdwr_ioctl_data batch = {.msgs = transport->messages, .nmsgs = transport->count};
+
+		result = linuxOps.ioctl(transport->fd, I2C_RDWR, &batch);
+	}
+
+	linuxStats.ioctls++;
+	linuxStats.messages += transport->count;
+
+	if(transport->read_data != NULL && result >= 0)
+		memcpy(transport->read_data, &transport->read_rx[1], transport->read_size);
+
+	transport->count = 0;
+	transport->used = 0;
+	transport->read_data = NULL;
+
+	return result < 0 ? HAL_ERROR : HAL_OK;
+}
+
+/*
+ * @brief:  Internal function, send the queue of every open transport
+ */
+static void FlushAll(){
+
+	MPU_BUS_LOCK();												/* Ticks and delays also come from threads outside of the driver */
+
+	for(uint8_t i = 0; i < 3; i++){
+		if(transports[i] != NULL)
+			TransportFlush(transports[i]);
+	}
+
+	MPU_BUS_UNLOCK();
+}
@@ -0,0 +1,70 @@
+/*
+ * MPU_Linux.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+#ifndef INC_MPU_LINUX_H_
+#define INC_MPU_LINUX_H_
+
+#include "stm32f4xx_hal.h"
+
+/*
+ * Linux userspace transport of the driver, behind the HAL functions used by __MPU_READ/__MPU_WRITE:
+ *
+ *		- /dev/i2c-N: I2C_RDWR combined transactions, the register address and the data of a read go with a repeated start
+ *		- /dev/spidevX.Y: SPI_IOC_MESSAGE, register address | 0x80 for reads, chip select released between the operations
+ *
+ * Writes are queued and sent together with the next read (or delay, tick or @MPU_LinuxFlush) in one ioctl, so a configuration
+ * sequence followed by its check costs one system call.
+ * Over SPI every address goes to the chip select of the device, the AK8963 bypass reads of the driver do not reach the magnetometer.
+ */
+#ifndef LINUX_MAX_MESSAGES
+#define LINUX_MAX_MESSAGES			32				//Messages of one ioctl, I2C_RDWR accepts up to 42
+#endif
+
+#ifndef LINUX_BUFFER_BYTES
+#define LINUX_BUFFER_BYTES			1024			//Bytes of the queued messages of one ioctl
+#endif
+
+#ifndef LINUX_SPI_SPEED_HZ
+#define LINUX_SPI_SPEED_HZ			1000000			//MPU-9250 SPI is 1 MHz for all of the registers (20 MHz for the data registers only)
+#endif
+
+typedef struct{
+	int (*open)(const char *path, int flags);
+	int (*ioctl)(int fd, unsigned long request, void *argument);
+	int (*close)(int fd);
+}MPU_LINUX_OPS;
+
+typedef struct{
+	uint32_t ioctls;							//System calls made to the device
+	uint32_t messages;							//Messages sent by them
+}MPU_LINUX_STATS;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Linux transport functions
+ */
+void MPU_LinuxSetDevice(uint8_t i2c, const char *path);
+void MPU_LinuxSetOps(const MPU_LINUX_OPS *ops);
+HAL_StatusTypeDef MPU_LinuxFlush(I2C_HandleTypeDef *hi2c);
+void MPU_LinuxClose(I2C_HandleTypeDef *hi2c);
+void MPU_LinuxGetStats(MPU_LINUX_STATS *stats);
+
+/*
+ * Fake device, an MPU-9250 and an AK8963 register file behind the same file descriptor interface, the AK8963 also behind the
+ * I2C master of the MPU-9250 (EXT_SENS_DATA, SLV4), see MPU_LinuxFake.c
+ */
+const MPU_LINUX_OPS *MPU_LinuxFakeOps();
+uint8_t *MPU_LinuxFakeRegisters(uint8_t addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_MPU_LINUX_H_ */
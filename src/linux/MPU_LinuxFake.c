@@ -0,0 +1,293 @@
+/*
+ * MPU_LinuxFake.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+/*
+ * Fake device of the Linux transport, used with @MPU_LinuxSetOps(@MPU_LinuxFakeOps()) to run the driver without the sensor.
+ * It answers I2C_RDWR for the MPU-9250 (0x68 and 0x69) and the AK8963 (0x0C), and SPI_IOC_MESSAGE for the MPU-9250 at 0x68.
+ * Registers auto increment as in the device, FIFO_R_W does not. Test code writes the sensor data with @MPU_LinuxFakeRegisters.
+ *
+ * The AK8963 is behind the auxiliary bus of the MPU-9250 at 0x68, as in the package:
+ *		- bypass:		the host reaches 0x0C only while INT_PIN_CFG BYPASS_EN is set
+ *		- I2C master:	with USER_CTRL I2C_MST_EN set, each read of the MPU-9250 first runs one sample of the master: the enabled
+ *						SLV0..SLV3 reads fill EXT_SENS_DATA in slave order, their writes send I2C_SLVx_DO, and an enabled SLV4 makes
+ *						its single transfer (I2C_SLV4_DI, I2C_MST_STATUS SLV4_DONE or SLV4_NACK, the enable bit clears). Other
+ *						addresses than 0x0C do not acknowledge. I2C_MST_STATUS clears when it is read
+ *		- AK8963:		reading ST2 clears DRDY and DOR of ST1, test code sets ST1 again for the next measurement
+ * Byte swap, REG_DIS, grouping of I2C_SLVx_CTRL and the access delay (I2C_MST_DLY) are not modeled, a delayed slave is accessed at
+ * every read.
+ */
+
+#include "MPU_Linux.h"
+#include <errno.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <linux/spi/spidev.h>
+
+#define FAKE_FD_BASE				100
+#define FAKE_MAX_FILES				8
+#define FAKE_FIFO_R_W				0x74
+#define FAKE_SLV0_ADDR				0x25			//ADDR, REG and CTRL of SLV0..SLV3 follow each other
+#define FAKE_SLV4_ADDR				0x31			//ADDR, REG, DO, CTRL, DI
+#define FAKE_MST_STATUS				0x36
+#define FAKE_INT_PIN_CFG			0x37
+#define FAKE_EXT_SENS_DATA			0x49
+#define FAKE_SLV0_DO				0x63
+#define FAKE_USER_CTRL				0x6A
+#define FAKE_MAG_ADDR				0x0C
+#define FAKE_MAG_ST1				0x02
+#define FAKE_MAG_ST2				0x09
+
+static int FakeOpen(const char *path, int flags);
+static int FakeIoctl(int fd, unsigned long request, void *argument);
+static int FakeClose(int fd);
+static void FakeReset();
+static void FakeTransfer(uint8_t *registers, uint8_t *pointer, uint8_t size, uint8_t *tx, uint8_t *rx, uint16_t length);
+static void FakeMasterSample();
+static uint8_t FakeMagRead(uint8_t reg);
+
+static const MPU_LINUX_OPS fakeOps = {FakeOpen, FakeIoctl, FakeClose};
+static uint8_t fakeMpu[2][128];
+static uint8_t fakeMag[32];
+static uint8_t fakePointer[3];								/* Register pointer of 0x68, 0x69 and 0x0C */
+static uint8_t fakeSpi[FAKE_MAX_FILES];
+static uint8_t fakeOpen[FAKE_MAX_FILES];
+static uint8_t fakeReady = 0;
+
+/*
+ * @brief:  Fake system calls, give them to @MPU_LinuxSetOps
+ * @param:  None
+ * @retval: open, ioctl and close of the fake device
+ */
+const MPU_LINUX_OPS *MPU_LinuxFakeOps(){
+
+	if(!fakeReady)
+		FakeReset();
+
+	return &fakeOps;
+}
+
+/*
+ * @brief:  Register file of one fake device, to set the sensor data or check what the driver wrote
+ * @param:  addr - 7 bit address, 0x68, 0x69 (MPU-9250) or 0x0C (AK8963)
+ * @retval: 128 registers of the MPU-9250 or 32 of the AK8963, NULL for other addresses
+ */
+uint8_t *MPU_LinuxFakeRegisters(uint8_t addr){
+
+	if(!fakeReady)
+		FakeReset();
+
+	switch(addr){
+		case 0x68:	return fakeMpu[0];
+		case 0x69:	return fakeMpu[1];
+		case 0x0C:	return fakeMag;
+		default:	return NULL;
+	}
+}
+
+/*
+ * @brief:  Internal function, power on values of the registers read by the driver
+ */
+static void FakeReset(){
+
+	memset(fakeMpu, 0, sizeof(fakeMpu));
+	memset(fakeMag, 0, sizeof(fakeMag));
+
+	for(uint8_t i = 0; i < 2; i++){
+		fakeMpu[i][0x6B] = 0x01;								/* PWR_MGMT_1 */
+		fakeMpu[i][0x75] = 0x71;								/* WHO_AM_I */
+	}
+
+	fakeMag[0x00] = 0x48;										/* WIA */
+	fakeMag[0x10] = 128;										/* ASAX, ASAY, ASAZ: unit adjustment */
+	fakeMag[0x11] = 128;
+	fakeMag[0x12] = 128;
+
+	fakeReady = 1;
+}
+
+static int FakeOpen(const char *path, int flags){
+
+	(void)flags;
+
+	for(uint8_t i = 0; i < FAKE_MAX_FILES; i++){
+		if(!fakeOpen[i]){
+			fakeOpen[i] = 1;
+			fakeSpi[i] = strstr(path, "spidev") != NULL;
+			return FAKE_FD_BASE + i;
+		}
+	}
+
+	errno = EMFILE;
+	return -1;
+}
+
+static int FakeClose(int fd){
+
+	if(fd < FAKE_FD_BASE || fd >= FAKE_FD_BASE + FAKE_MAX_FILES || !fakeOpen[fd - FAKE_FD_BASE]){
+		errno = EBADF;
+		return -1;
+	}
+
+	fakeOpen[fd - FAKE_FD_BASE] = 0;
+	return 0;
+}
+
+static int FakeIoctl(int fd, unsigned long request, void *argument){
+
+	if(fd < FAKE_FD_BASE || fd >= FAKE_FD_BASE + FAKE_MAX_FILES || !fakeOpen[fd - FAKE_FD_BASE]){
+		errno = EBADF;
+		return -1;
+	}
+
+	if(!fakeSpi[fd - FAKE_FD_BASE] && request == I2C_RDWR){
+		struct i2c_rdwr_ioctl_data *batch = argument;
+
+		for(uint32_t i = 0; i < batch->nmsgs; i++){
+			struct i2c_msg *message = &batch->msgs[i];
+			uint8_t *registers, *pointer, size;
+
+			switch(message->addr){
+				case 0x68:	registers = fakeMpu[0];	pointer = &fakePointer[0];	size = 128;	break;
+				case 0x69:	registers = fakeMpu[1];	pointer = &fakePointer[1];	size = 128;	break;
+				case 0x0C:	registers = fakeMag;	pointer = &fakePointer[2];	size = 32;	break;
+				default:	errno = ENXIO;	return -1;			/* No acknowledge */
+			}
+
+			if(registers == fakeMag && !(fakeMpu[0][FAKE_INT_PIN_CFG] & 0x02)){
+				errno = ENXIO;									/* Behind the auxiliary bus without BYPASS_EN */
+				return -1;
+			}
+
+			if(registers == fakeMpu[0] && (message->flags & I2C_M_RD))
+				FakeMasterSample();
+
+			if(message->flags & I2C_M_RD)
+				FakeTransfer(registers, pointer, size, NULL, message->buf, message->len);
+			else if(message->len > 0){
+				*pointer = message->buf[0] % size;
+				FakeTransfer(registers, pointer, size, &message->buf[1], NULL, message->len - 1);
+			}
+		}
+
+		return batch->nmsgs;
+	}
+
+	if(fakeSpi[fd - FAKE_FD_BASE]){
+		if(request == SPI_IOC_WR_MODE || request == SPI_IOC_WR_BITS_PER_WORD || request == SPI_IOC_WR_MAX_SPEED_HZ)
+			return 0;
+
+		if(_IOC_TYPE(request) == SPI_IOC_MAGIC && _IOC_NR(request) == 0){
+			struct spi_ioc_transfer *transfers = argument;
+			uint32_t count = _IOC_SIZE(request) / sizeof(struct spi_ioc_transfer);
+
+			for(uint32_t i = 0; i < count; i++){
+				uint8_t *tx = (uint8_t *)(uintptr_t)transfers[i].tx_buf;
+				uint8_t *rx = (uint8_t *)(uintptr_t)transfers[i].rx_buf;
+
+				if(transfers[i].len == 0 || tx == NULL)
+					continue;
+
+				fakePointer[0] = tx[0] & 0x7F;
+				if(tx[0] & 0x80){
+					FakeMasterSample();
+					FakeTransfer(fakeMpu[0], &fakePointer[0], 128, NULL, rx == NULL ? NULL : &rx[1], transfers[i].len - 1);
+				}
+				else
+					FakeTransfer(fakeMpu[0], &fakePointer[0], 128, &tx[1], NULL, transfers[i].len - 1);
+			}
+
+			return 0;
+		}
+	}
+
+	errno = ENOTTY;
+	return -1;
+}
+
+/*
+ * @brief:  Internal function, write tx or read into rx from the register pointer, advancing it
+ */
+static void FakeTransfer(uint8_t *registers, uint8_t *pointer, uint8_t size, uint8_t *tx, uint8_t *rx, uint16_t length){
+
+	for(uint16_t i = 0; i < length; i++){
+		if(tx != NULL)
+			registers[*pointer] = tx[i];
+		else if(rx != NULL && registers == fakeMag)
+			rx[i] = FakeMagRead(*pointer);
+		else if(rx != NULL){
+			rx[i] = registers[*pointer];
+			if(*pointer == FAKE_MST_STATUS)
+				registers[FAKE_MST_STATUS] = 0;					/* Cleared by the read */
+		}
+
+		if(registers != fakeMag && *pointer == FAKE_FIFO_R_W)
+			continue;
+
+		*pointer = (*pointer + 1) % size;
+	}
+}
+
+/*
+ * @brief:  Internal function, one sample of the I2C master of the MPU-9250 at 0x68, the AK8963 is its only slave
+ */
+static void FakeMasterSample(){
+
+	uint8_t *mpu = fakeMpu[0];
+	uint8_t *slave, offset = 0;
+
+	if(!(mpu[FAKE_USER_CTRL] & 0x20))
+		return;
+
+	for(uint8_t i = 0; i < 4; i++){
+		slave = &mpu[FAKE_SLV0_ADDR + 3 * i];								/* ADDR, REG, CTRL */
+
+		if(!(slave[2] & 0x80))
+			continue;
+
+		if((slave[0] & 0x7F) != FAKE_MAG_ADDR)
+			mpu[FAKE_MST_STATUS] |= 1 << i;									/* I2C_SLVx_NACK, its EXT_SENS_DATA is not written */
+		else if(!(slave[0] & 0x80))
+			fakeMag[slave[1] % 32] = mpu[FAKE_SLV0_DO + i];
+		else{
+			for(uint8_t k = 0; k < (slave[2] & 0x0F) && offset + k < 24; k++)
+				mpu[FAKE_EXT_SENS_DATA + offset + k] = FakeMagRead((slave[1] + k) % 32);
+		}
+
+		if(slave[0] & 0x80)
+			offset += slave[2] & 0x0F;
+	}
+
+	slave = &mpu[FAKE_SLV4_ADDR];											/* ADDR, REG, DO, CTRL, DI */
+
+	if(slave[3] & 0x80){
+		if((slave[0] & 0x7F) != FAKE_MAG_ADDR)
+			mpu[FAKE_MST_STATUS] |= 1 << 4;									/* I2C_SLV4_NACK */
+		else{
+			if(slave[0] & 0x80)
+				slave[4] = FakeMagRead(slave[1] % 32);
+			else
+				fakeMag[slave[1] % 32] = slave[2];
+			mpu[FAKE_MST_STATUS] |= 1 << 6;									/* I2C_SLV4_DONE */
+		}
+		slave[3] &= ~0x80;
+	}
+}
+
+/*
+ * @brief:  Internal function, one register of the AK8963, reading ST2 ends the measurement
+ */
+static uint8_t FakeMagRead(uint8_t reg){
+
+	uint8_t value = fakeMag[reg];
+
+	if(reg == FAKE_MAG_ST2)
+		fakeMag[FAKE_MAG_ST1] &= ~0x03;										/* DRDY and DOR */
+
+	return value;
+}
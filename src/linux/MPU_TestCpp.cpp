@@ -0,0 +1,103 @@
+/*
+ * MPU_TestCpp.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+/*
+ * Host test, the C++ front-end of MPU9250.hpp against the C API, both on the fake device of MPU_LinuxFake.c:
+ *
+ *		gcc -c -std=gnu11 -fshort-enums -fcommon -Isrc/linux -Isrc src/MPU_Driver.c src/linux/MPU_Linux.c src/linux/MPU_LinuxFake.c
+ *		g++ -std=c++11 -fshort-enums -Isrc/linux -Isrc src/linux/MPU_TestCpp.cpp MPU_Driver.o MPU_Linux.o MPU_LinuxFake.o -lm -o MPU_TestCpp
+ *		MPU_TestCpp
+ *
+ * For every full scale: the register values written by init, the sensitivities (accel_sensitivity_used, gyro_sensitivity_used),
+ * the raw counts and the converted gyro and temperature of the same sample must match. Exit status is the number of failed checks.
+ */
+
+#include "MPU9250.hpp"
+#include "MPU_Linux.h"
+#include <cmath>
+#include <cstdio>
+
+extern "C" {												/* MPU_SPEC.h defines the driver globals, only the used symbols are declared */
+	void MPU_Init(uint8_t i2c, uint8_t mpu_i2c_addr, uint8_t accel_scale, uint8_t gyro_scale);
+	uint8_t MPU_WhoAmI();
+	void MPU_AccelScaleChange(uint8_t new_scale);
+	void MPU_GyroScaleChange(uint8_t new_scale);
+	void MPU_GyroReadVector(float gyro_data[]);
+	void MPU_GyroGetBias(float bias[]);
+	uint8_t MPU_ImuReadRaw(int16_t accel_raw[], int16_t gyro_raw[]);
+	float MPU_Temperature_Read();
+	extern uint16_t accel_sensitivity_used;
+	extern float gyro_sensitivity_used;
+}
+
+static I2C_HandleTypeDef bus;
+static int failures = 0;
+
+static void check(bool condition, const char *what, int scale){
+
+	if(!condition){
+		printf("FAIL scale %d: %s\n", scale, what);
+		failures++;
+	}
+}
+
+template<mpu::AccelScale Accel, mpu::GyroScale Gyro>
+static void checkScale(uint8_t *registers){
+
+	using Imu = mpu::Mpu9250<mpu::HalI2c<&bus>, Accel, Gyro, mpu::units::Driver>;
+	int scale = static_cast<int>(Accel);
+	int16_t accel_c[3], gyro_c[3], accel_cpp[3], gyro_cpp[3];
+	float gyro_vector[3], bias[3];
+	mpu::Sample sample;
+
+	MPU_AccelScaleChange(static_cast<uint8_t>(Accel));
+	MPU_GyroScaleChange(static_cast<uint8_t>(Gyro));
+	MPU_WhoAmI();											/* Sends the queued writes */
+	uint8_t gyro_config = registers[mpu::reg::GYRO_CONFIG], accel_config = registers[mpu::reg::ACCEL_CONFIG];
+
+	check(Imu::init(), "init", scale);
+	check(registers[mpu::reg::GYRO_CONFIG] == gyro_config && registers[mpu::reg::ACCEL_CONFIG] == accel_config, "FS_SEL registers", scale);
+	check(mpu::accelLsbPerG(Accel) == accel_sensitivity_used, "accel sensitivity", scale);
+	check(mpu::gyroLsbPerDps(Gyro) == gyro_sensitivity_used, "gyro sensitivity", scale);
+
+	MPU_ImuReadRaw(accel_c, gyro_c);
+	check(Imu::readRaw(accel_cpp, gyro_cpp), "readRaw", scale);
+	for(uint8_t i = 0; i < 3; i++)
+		check(accel_c[i] == accel_cpp[i] && gyro_c[i] == gyro_cpp[i], "raw counts", scale);
+
+	MPU_GyroReadVector(gyro_vector);
+	MPU_GyroGetBias(bias);
+	check(Imu::read(sample), "read", scale);
+	for(uint8_t i = 0; i < 3; i++)
+		check(std::fabs(sample.gyro[i] - (gyro_vector[i] + bias[i])) <= 1e-5f * std::fabs(sample.gyro[i]) + 1e-6f, "gyro °/s", scale);
+
+	check(std::fabs(sample.temperature - MPU_Temperature_Read()) < 1e-4f, "temperature °C", scale);
+}
+
+int main(){
+
+	MPU_LinuxSetOps(MPU_LinuxFakeOps());
+	MPU_Init(1, 1, 0, 0);
+
+	bus.Instance = I2C1;
+	HAL_I2C_Init(&bus);
+
+	uint8_t *registers = MPU_LinuxFakeRegisters(mpu::ADDR_1);
+	const uint8_t counts[14] = {0x3F, 0x12, 0xC0, 0x35, 0x20, 0x00, 0x01, 0x4E, 0x7F, 0x00, 0x80, 0x10, 0x00, 0x21};
+
+	for(uint8_t i = 0; i < sizeof(counts); i++)
+		registers[mpu::reg::ACCEL_XOUT_H + i] = counts[i];
+
+	checkScale<mpu::AccelScale::G2, mpu::GyroScale::Dps250>(registers);
+	checkScale<mpu::AccelScale::G4, mpu::GyroScale::Dps500>(registers);
+	checkScale<mpu::AccelScale::G8, mpu::GyroScale::Dps1000>(registers);
+	checkScale<mpu::AccelScale::G16, mpu::GyroScale::Dps2000>(registers);
+
+	printf("%s, %d failed checks\n", failures ? "FAIL" : "OK", failures);
+
+	return failures;
+}
@@ -0,0 +1,161 @@
+/*
+ * MPU_TestLinux.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+/*
+ * Host test, the driver through the Linux transport on the fake device of MPU_LinuxFake.c:
+ *
+ *		gcc -std=gnu11 -fshort-enums -fcommon -Isrc/linux -Isrc src/linux/MPU_TestLinux.c src/MPU_Driver.c src/linux/MPU_Linux.c \
+ *			src/linux/MPU_LinuxFake.c -lm -o MPU_TestLinux
+ *		MPU_TestLinux
+ *
+ * Checks the registers written by @MPU_Init, the queue of writes sent with the next read in one ioctl (also @MPU_FifoCounter), the raw
+ * counts, the data ready timeout of @MPU_BurstReadBatch, and the magnetometer behind the I2C master: @MPU_MagReadVector through SLV0 and
+ * EXT_SENS_DATA (DRDY, HOFL, the end of the measurement at ST2), @MPU_MagSchedulerTick (DRDY, the delays of SLV0 and SLV4) with the
+ * magnetometer of @MPU_ReadAllRaw frames, the single transfers of SLV4 (@MPU_AuxReadByte, @MPU_AuxWrite) and one slave of
+ * @MPU_AuxAttach next to the magnetometer read of SLV0. The same checks run over I2C and over spidev.
+ * Exit status is the number of failed checks.
+ */
+
+#include "MPU_SPEC.h"
+#include "MPU_Linux.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TEST_MAG_ADDR				0x0C
+
+static int failures = 0;
+
+static void Check(uint8_t condition, const char *what, const char *bus);
+static void CheckBus(uint8_t i2c, const char *bus);
+
+int main(){
+
+	MPU_LinuxSetOps(MPU_LinuxFakeOps());
+	MPU_LinuxSetDevice(USE_I2C2, "/dev/spidev0.0");
+
+	CheckBus(USE_I2C1, "i2c");
+	CheckBus(USE_I2C2, "spi");
+
+	printf("%s, %d failed checks\n", failures ? "FAIL" : "OK", failures);
+
+	return failures;
+}
+
+static void Check(uint8_t condition, const char *what, const char *bus){
+
+	if(!condition){
+		printf("FAIL %s: %s\n", bus, what);
+		failures++;
+	}
+}
+
+/*
+ * @brief:  Internal function, every check on the device at one I2C instance
+ */
+static void CheckBus(uint8_t i2c, const char *bus){
+
+	uint8_t *mpu = MPU_LinuxFakeRegisters(ACCELGYRO_ADDR_1);
+	uint8_t *mag = MPU_LinuxFakeRegisters(TEST_MAG_ADDR);
+	const uint8_t counts[6] = {0x01, 0x00, 0xFE, 0xFF, 0x00, 0x40};	/* 1, -2, 16384 */
+	const uint8_t imu[14] = {0x12, 0x34, 0xFF, 0x00, 0x40, 0x00, 0x00, 0x00, 0x00, 0x83, 0xFF, 0x7D, 0x7F, 0xFF};
+	MPU_LINUX_STATS before, after;
+	MPU_MAG_SCHEDULER_STATS stats;
+	int16_t accel_raw[3], gyro_raw[3];
+	float field[3] = {0}, adjust, lsb;
+	uint8_t frame[RAW_FRAME_BYTES];
+	uint8_t value = 0;
+	MPU_BATCH_BUFFER(ax, 4); MPU_BATCH_BUFFER(ay, 4); MPU_BATCH_BUFFER(az, 4);
+	MPU_BATCH_BUFFER(gx, 4); MPU_BATCH_BUFFER(gy, 4); MPU_BATCH_BUFFER(gz, 4);
+	MPU_SOA_BATCH batch = {ax, ay, az, gx, gy, gz, NULL, 4, 0, NULL, 0};
+	const MPU_AUX_SLAVE slave = {TEST_MAG_ADDR, 0x00, 2, 0, 1, 0};		/* WIA and INFO of the AK8963, delayed */
+	uint8_t ext[2] = {0};
+
+	MPU_Init(i2c, USE_ADDR1, 0, 0);
+
+	MPU_WhoAmI();
+	Check((mpu[0x6B] & 0x07) == CLKSEL_AUTO_PLL, "PWR_MGMT_1 CLKSEL", bus);
+	Check(mpu[0x6A] & (1 << 5), "USER_CTRL I2C_MST_EN", bus);
+	Check(!(mpu[0x37] & (1 << 1)), "INT_PIN_CFG BYPASS_EN off after init", bus);
+
+	MPU_LinuxGetStats(&before);
+	MPU_GyroTempLowPassFilterConfig(0, DLPF_CFG3);
+	Check(MPU_WhoAmI() == 0x71, "WHO_AM_I", bus);
+	MPU_LinuxGetStats(&after);
+	Check(after.ioctls - before.ioctls == 1, "writes sent with the next read", bus);
+	Check((mpu[0x1A] & 0x07) == DLPF_CFG3, "CONFIG DLPF_CFG", bus);
+
+	mpu[0x72] = 0x01;													/* FIFO_COUNTH, FIFO_COUNTL: 288 bytes */
+	mpu[0x73] = 0x20;
+	MPU_BusDeferBegin();
+	MPU_GyroTempLowPassFilterConfig(0, DLPF_CFG4);
+	Check(MPU_FifoCounter() == 0x120 && (mpu[0x1A] & 0x07) == DLPF_CFG4, "fifo count read after the queued writes", bus);
+	MPU_BusDeferEnd();
+
+	for(uint8_t i = 0; i < sizeof(imu); i++)
+		mpu[0x3B + i] = imu[i];
+	MPU_ImuReadRaw(accel_raw, gyro_raw);
+	Check(accel_raw[0] == 0x1234 && accel_raw[1] == -256 && accel_raw[2] == 0x4000, "accel counts", bus);
+	Check(gyro_raw[0] == 0x0083 && gyro_raw[1] == -131 && gyro_raw[2] == 0x7FFF, "gyro counts", bus);
+
+	mpu[0x3A] = 0x01;													/* INT_STATUS RAW_DATA_RDY_INT */
+	Check(MPU_BurstReadBatch(&batch, 4) == 4 && batch.length == 4, "batch read", bus);
+	mpu[0x3A] = 0x00;
+	Check(MPU_BurstReadBatch(&batch, 4) == 0 && batch.length == 0, "batch read ends without data ready", bus);
+
+	for(uint8_t i = 0; i < 6; i++)
+		mag[0x03 + i] = counts[i];
+	mag[0x02] = 0x01;													/* ST1 DRDY */
+	mag[0x09] = 0x10;													/* ST2 BITM */
+
+	adjust = (mag[0x10] - 128.0) / 256.0 + 1;							/* Over spidev the ASA reads of the init reach the MPU-9250 */
+	if(i2c != USE_I2C1)
+		adjust = (mpu[0x10] - 128.0) / 256.0 + 1;
+
+	lsb = AK8963_SENSITIVITY * adjust;
+
+	Check(MPU_MagReadVector(field) == 1, "mag new data", bus);
+	Check(fabsf(field[0] - lsb) < 1e-3f && fabsf(field[1] + 2 * lsb) < 1e-3f && fabsf(field[2] - 16384 * lsb) < 1e-1f,
+		  "mag field through EXT_SENS_DATA", bus);
+	Check(!(mag[0x02] & 0x01), "ST2 read ends the measurement", bus);
+	Check(MPU_MagReadVector(field) == 0, "mag without DRDY", bus);
+
+	mag[0x02] = 0x01;
+	mag[0x09] = 0x18;													/* HOFL */
+	Check(MPU_MagReadVector(field) == 0, "mag overflow", bus);
+
+	Check(MPU_MagSchedulerStart(20, 1000) == MAG_SCHEDULER_OK, "mag scheduler start", bus);
+	mag[0x02] = 0x01;
+	mag[0x09] = 0x10;
+	for(uint8_t i = 1; i < 20; i++)
+		Check(MPU_MagSchedulerTick(field) == 0, "mag scheduler not due", bus);
+	Check(MPU_MagSchedulerTick(field) == 1, "mag scheduler new data", bus);
+	Check(MPU_MagRead(X_AXIS) != -60000 && MPU_MagRead(Y_AXIS) != -60000 && MPU_MagRead(Z_AXIS) != -60000, "mag scheduler axis reads", bus);
+	Check(MPU_MagRead(X_AXIS) == -60000 && MPU_MagReadVector(field) == 0, "mag scheduler sample returned once", bus);
+	Check((mpu[0x67] & 0x11) == 0x11 && (mpu[0x34] & 0x1F) == 19, "SLV0 and SLV4 delayed by the divisor", bus);
+	Check(MPU_ReadAllRaw(frame) == 1 && frame[20] == RAW_FRAME_MAG_NEW && !memcmp(&frame[14], counts, 6), "raw frame new mag", bus);
+	Check(MPU_ReadAllRaw(frame) == 0 && frame[20] == 0 && !memcmp(&frame[14], counts, 6), "raw frame repeats the last mag", bus);
+	for(uint8_t i = 1; i <= 20; i++)
+		MPU_MagSchedulerTick(field);													/* ST2 was read, no DRDY */
+	MPU_MagSchedulerGetStats(&stats);
+	Check(stats.due == 2 && stats.samples == 1 && stats.not_ready == 1, "mag scheduler counts the read without DRDY", bus);
+	MPU_MagSchedulerStop();
+	Check(!(mpu[0x67] & 0x11) && (mpu[0x34] & 0x1F) == 0, "mag scheduler stop restores the delays", bus);
+
+	Check(MPU_AuxReadByte(TEST_MAG_ADDR, 0x00, &value) == AUX_OK && value == 0x48, "SLV4 read of WIA", bus);
+	Check(MPU_AuxWrite(TEST_MAG_ADDR, 0x0C, 0x5A) == AUX_OK && mag[0x0C] == 0x5A, "SLV4 write", bus);
+	Check(MPU_AuxReadByte(0x1E, 0x00, &value) == AUX_NACK, "SLV4 no acknowledge", bus);
+
+	MPU_MagReadVector(field);														/* SLV0 reads ST1..ST2 again */
+	Check(MPU_AuxAttach(1, &slave) == AUX_OK && MPU_AuxDataOffset(1) == AUX_MAG_READ_BYTES, "SLV1 attach", bus);
+	Check(MPU_MagWhoAmI() == 0x48 && (mpu[0x27] & 0x0F) == AUX_MAG_READ_BYTES && (mpu[0x67] & 0x02), "mag read with SLV1 attached keeps SLV0", bus);
+	MPU_AuxRead(1, ext);
+	Check(ext[0] == 0x48 && MPU_AuxDataOffset(1) == AUX_MAG_READ_BYTES, "SLV1 data after SLV0", bus);
+	MPU_AuxDetach(1);
+	MPU_WhoAmI();
+	Check(!(mpu[0x2A] & 0x80) && !(mpu[0x67] & 0x02), "SLV1 detach clears the enable and the delay", bus);
+}
@@ -0,0 +1,276 @@
+/*
+ * MPU_TestRtos.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+/*
+ * Host stress test, MPU_Rtos.c over the POSIX threads port on the fake device of MPU_LinuxFake.c:
+ *
+ *		gcc -O2 -std=gnu11 -fshort-enums -fcommon -pthread -DMPU_USE_RTOS -DMPU_RTOS_POSIX -Isrc/linux -Isrc src/linux/MPU_TestRtos.c \
+ *			src/MPU_Rtos.c src/MPU_RtosPosix.c src/MPU_Driver.c src/linux/MPU_Linux.c src/linux/MPU_LinuxFake.c -lm -o MPU_TestRtos
+ *		MPU_TestRtos [-t seconds] [-r readers] [-b bus_threads]
+ *
+ * Threads running at the same time for the given seconds:
+ *
+ *		sensor:		cycles the fake data registers through TEST_PATTERNS samples (under the bus lock) and signals data ready
+ *		sampling:	the task of @MPU_RtosStartSampling with period 0, one @MPU_ReadAllSensores per data ready
+ *		readers:	@MPU_RtosGetLatest in a loop, each copy must be one whole sample: the accel and gyro vectors of one pattern,
+ *					converted before the start, and a sequence that never goes back
+ *		bus:		each one a CONFIG write queued by the driver and sent with the next read (WHO_AM_I), inside one bus lock,
+ *					the fake register must hold the value of that thread and WHO_AM_I must read 0x71
+ *
+ * Output: samples, reader copies and bus operations per second, lock acquisitions, the share that found the lock taken and the
+ * reader retries (@MPU_RtosGetStats). Exit status is the number of failed checks.
+ */
+
+#include "MPU_Rtos.h"
+#include "MPU_Linux.h"
+
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define TEST_PATTERNS				64
+#define TEST_MAX_THREADS			32
+#define TEST_SENSOR_PERIOD_US		200				//Data ready period of the sensor thread
+
+typedef struct{
+	uint8_t index;
+	uint32_t operations;
+	uint32_t errors;								/* Torn samples or sequence going back (readers), wrong registers (bus) */
+}TEST_THREAD;
+
+static void Check(uint8_t condition, const char *what);
+static void PatternWrite(uint8_t *registers, uint8_t pattern);
+static uint8_t PatternMatch(const MPU_RTOS_SAMPLE *sample);
+static void *SensorThread(void *argument);
+static void *ReaderThread(void *argument);
+static void *BusThread(void *argument);
+static double Now();
+
+static int failures = 0;
+static volatile uint8_t testRun = 1;
+static uint8_t *fakeMpu;
+static float patternAccel[TEST_PATTERNS][3];
+static float patternGyro[TEST_PATTERNS][3];
+
+int main(int argc, char *argv[]){
+
+	pthread_t sensor, readers[TEST_MAX_THREADS], bus[TEST_MAX_THREADS];
+	TEST_THREAD reader_state[TEST_MAX_THREADS] = {0}, bus_state[TEST_MAX_THREADS] = {0};
+	MPU_RTOS_STATS stats;
+	MPU_RTOS_SAMPLE sample;
+	double seconds = 2, start, elapsed;
+	int reader_count = 4, bus_count = 2, option;
+	uint32_t reads = 0, reader_errors = 0, operations = 0, bus_errors = 0;
+	float mag[3];
+
+	while((option = getopt(argc, argv, "t:r:b:")) != -1){
+		switch(option){
+			case 't':	seconds = atof(optarg);			break;
+			case 'r':	reader_count = atoi(optarg);	break;
+			case 'b':	bus_count = atoi(optarg);		break;
+			default:	optind = argc + 1;				break;
+		}
+	}
+
+	if(optind != argc || seconds <= 0 || reader_count < 1 || reader_count > TEST_MAX_THREADS || bus_count < 0 || bus_count > TEST_MAX_THREADS){
+		fprintf(stderr, "usage: %s [-t seconds] [-r readers] [-b bus_threads]\n", argv[0]);
+		return 2;
+	}
+
+	MPU_LinuxSetOps(MPU_LinuxFakeOps());
+	fakeMpu = MPU_LinuxFakeRegisters(ACCELGYRO_ADDR_1);
+
+	MPU_Init(USE_I2C1, USE_ADDR1, 0, 0);
+
+	for(uint8_t p = 0; p < TEST_PATTERNS; p++){					/* Expected samples, converted by the driver before the threads */
+		PatternWrite(fakeMpu, p);
+		MPU_ReadAllSensores(patternAccel[p], patternGyro[p], mag);
+	}
+
+	Check(MPU_RtosInit() == RTOS_OK, "bus lock created");
+	Check(MPU_RtosStartSampling(0, 10) == RTOS_OK, "sampling task started");
+
+	start = Now();
+
+	if(pthread_create(&sensor, NULL, SensorThread, NULL) != 0){
+		Check(0, "sensor thread created");
+		return failures;
+	}
+
+	for(int i = 0; i < reader_count; i++){
+		reader_state[i].index = i;
+		if(pthread_create(&readers[i], NULL, ReaderThread, &reader_state[i]) != 0){
+			Check(0, "reader thread created");
+			reader_count = i;
+			break;
+		}
+	}
+
+	for(int i = 0; i < bus_count; i++){
+		bus_state[i].index = i;
+		if(pthread_create(&bus[i], NULL, BusThread, &bus_state[i]) != 0){
+			Check(0, "bus thread created");
+			bus_count = i;
+			break;
+		}
+	}
+
+	while(Now() - start < seconds * 1e9){
+		struct timespec tick = {0, 10000000};
+		nanosleep(&tick, NULL);
+	}
+
+	testRun = 0;
+
+	pthread_join(sensor, NULL);
+	for(int i = 0; i < reader_count; i++)
+		pthread_join(readers[i], NULL);
+	for(int i = 0; i < bus_count; i++)
+		pthread_join(bus[i], NULL);
+
+	elapsed = (Now() - start) / 1e9;
+
+	MPU_RtosStopSampling();
+	MPU_RtosGetStats(&stats);
+
+	for(int i = 0; i < reader_count; i++){
+		reads += reader_state[i].operations;
+		reader_errors += reader_state[i].errors;
+	}
+	for(int i = 0; i < bus_count; i++){
+		operations += bus_state[i].operations;
+		bus_errors += bus_state[i].errors;
+	}
+
+	Check(stats.samples > 1, "samples published");
+	Check(MPU_RtosGetLatest(&sample) == stats.samples, "sequence of the last sample");
+	Check(reader_errors == 0, "reader copies are whole samples in sequence");
+	Check(bus_errors == 0, "queued writes and reads of the bus threads");
+
+	printf("%.2f s, %d readers, %d bus threads\n", elapsed, reader_count, bus_count);
+	printf("samples:        %10u  %10.0f /s\n", stats.samples, stats.samples / elapsed);
+	printf("reader copies:  %10u  %10.0f /s, %u retries, %u bad\n", reads, reads / elapsed, stats.reader_retries, reader_errors);
+	printf("bus operations: %10u  %10.0f /s, %u bad\n", operations, operations / elapsed, bus_errors);
+	printf("bus lock:       %10u  %10.0f /s, %u contended (%.1f %%)\n", stats.lock_taken, stats.lock_taken / elapsed, stats.lock_contended,
+			stats.lock_taken ? 100.0 * stats.lock_contended / stats.lock_taken : 0);
+
+	printf("%s, %d failed checks\n", failures ? "FAIL" : "OK", failures);
+
+	return failures;
+}
+
+static void Check(uint8_t condition, const char *what){
+
+	if(!condition){
+		printf("FAIL %s\n", what);
+		failures++;
+	}
+}
+
+/*
+ * @brief:  Internal function, ACCEL_XOUT_H to GYRO_ZOUT_L of one pattern, every axis different
+ */
+static void PatternWrite(uint8_t *registers, uint8_t pattern){
+
+	for(uint8_t i = 0; i < 7; i++){
+		int16_t value = (int16_t)(pattern * 401 + i * 1013 - 12000);
+
+		registers[0x3B + 2 * i] = (uint16_t)value >> 8;
+		registers[0x3C + 2 * i] = value;
+	}
+}
+
+/*
+ * @brief:  Internal function, the copied sample is one of the patterns
+ */
+static uint8_t PatternMatch(const MPU_RTOS_SAMPLE *sample){
+
+	for(uint8_t p = 0; p < TEST_PATTERNS; p++){
+		if(!memcmp(sample->accel, patternAccel[p], sizeof(sample->accel)) && !memcmp(sample->gyro, patternGyro[p], sizeof(sample->gyro)))
+			return 1;
+	}
+
+	return 0;
+}
+
+static void *SensorThread(void *argument){
+
+	struct timespec period = {0, TEST_SENSOR_PERIOD_US * 1000};
+	uint8_t pattern = 0;
+
+	(void)argument;
+
+	while(testRun){
+		MPU_BusLock();											/* The sampling task never sees half of a pattern */
+		PatternWrite(fakeMpu, pattern);
+		MPU_BusUnlock();
+
+		pattern = (pattern + 1) % TEST_PATTERNS;
+
+		MPU_RtosDataReadyFromISR();
+		nanosleep(&period, NULL);
+	}
+
+	return NULL;
+}
+
+static void *ReaderThread(void *argument){
+
+	TEST_THREAD *state = argument;
+	MPU_RTOS_SAMPLE sample;
+	uint32_t last = 0, sequence;
+
+	while(testRun){
+		sequence = MPU_RtosGetLatest(&sample);
+		state->operations++;
+
+		if(sequence == 0)										/* Nothing published yet */
+			continue;
+
+		if(sequence < last || !PatternMatch(&sample))
+			state->errors++;
+
+		last = sequence;
+	}
+
+	return NULL;
+}
+
+static void *BusThread(void *argument){
+
+	TEST_THREAD *state = argument;
+	uint8_t filter = state->index % 6 + 1;					/* DLPF_CFG1..6, the threads start at different values */
+
+	while(testRun){
+		MPU_BusLock();
+
+		MPU_GyroTempLowPassFilterConfig(0, filter);				/* Queued, sent with the read below */
+		if(MPU_WhoAmI() != 0x71 || (fakeMpu[0x1A] & 0x07) != filter)
+			state->errors++;
+
+		MPU_BusUnlock();
+
+		state->operations++;
+		filter = filter % 6 + 1;
+	}
+
+	return NULL;
+}
+
+/*
+ * @brief:  Internal function, monotonic time
+ * @retval: ns
+ */
+static double Now(){
+
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e9 + now.tv_nsec;
+}
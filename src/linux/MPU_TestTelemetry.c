@@ -0,0 +1,101 @@
+/*
+ * MPU_TestTelemetry.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+/*
+ * Host test, MPU_Telemetry.c over the UART of the Linux HAL, written to a pipe and decoded back:
+ *
+ *		gcc -std=gnu11 -fshort-enums -fcommon -Isrc/linux -Isrc src/linux/MPU_TestTelemetry.c src/MPU_Telemetry.c src/MPU_Driver.c \
+ *			src/linux/MPU_Linux.c src/linux/MPU_LinuxFake.c -lm -o MPU_TestTelemetry
+ *		MPU_TestTelemetry
+ *
+ * Sends TEST_PACKETS raw packets, many more than one buffer holds. HAL_UART_Transmit_DMA ends before it returns and calls
+ * HAL_UART_TxCpltCallback, so no packet may be dropped and every buffer must be a new transfer. Each frame read from the pipe must
+ * pass the CRC, with the sequence, timestamp and payload of its packet.
+ * Exit status is the number of failed checks.
+ */
+
+#include "MPU_Telemetry.h"
+#include "MPU_Linux.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#define TEST_PACKETS				100
+
+static void Check(uint8_t condition, const char *what);
+
+static int failures = 0;
+static MPU_TELEMETRY telemetry;
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart){
+
+	MPU_TelemetryTxComplete(&telemetry, huart);
+}
+
+int main(){
+
+	static uint8_t wire[TEST_PACKETS * TELEMETRY_MAX_FRAME];
+	UART_HandleTypeDef uart;
+	MPU_TELEMETRY_STATS stats;
+	uint8_t frame[RAW_FRAME_BYTES], packet[TELEMETRY_MAX_PACKET];
+	uint16_t start = 0, decoded = 0, bad = 0;
+	ssize_t size;
+	int pipe_fd[2];
+
+	if(pipe(pipe_fd) != 0){
+		perror("pipe");
+		return 1;
+	}
+
+	uart.Instance = pipe_fd[1];
+	MPU_TelemetryInit(&telemetry, &uart);
+
+	for(uint16_t i = 0; i < TEST_PACKETS; i++){
+		for(uint8_t j = 0; j < RAW_FRAME_BYTES; j++)
+			frame[j] = i + j;											/* Zeros at some offsets, COBS must carry them */
+		MPU_TelemetrySendRaw(&telemetry, frame, 1000 + i);
+	}
+	MPU_TelemetryPoll(&telemetry);										/* The last partial buffer */
+
+	MPU_TelemetryGetStats(&telemetry, &stats);
+	Check(stats.packets == TEST_PACKETS && stats.dropped == 0, "every packet queued");
+	Check(stats.transfers > 1 && !telemetry.busy, "one transfer per buffer, the callback ends each one");
+
+	close(pipe_fd[1]);
+	size = read(pipe_fd[0], wire, sizeof(wire));
+	Check(size == (ssize_t)stats.bytes, "bytes on the wire");
+
+	for(ssize_t i = 0; i < size; i++){
+		if(wire[i] != 0)
+			continue;
+
+		int16_t length = MPU_TelemetryUnpack(&wire[start], i - start, packet);
+		uint32_t timestamp = packet[2] | packet[3] << 8 | packet[4] << 16 | (uint32_t)packet[5] << 24;
+
+		if(length != TELEMETRY_HEADER_BYTES + RAW_FRAME_BYTES || packet[0] != TELEMETRY_RAW || packet[1] != (uint8_t)decoded ||
+		   timestamp != 1000u + decoded || packet[TELEMETRY_HEADER_BYTES + 3] != (uint8_t)(decoded + 3))
+			bad++;
+
+		decoded++;
+		start = i + 1;
+	}
+
+	Check(decoded == TEST_PACKETS && bad == 0, "frames decoded in order");
+
+	printf("%u packets, %u transfers, %u bytes, %u bad frames\n", stats.packets, stats.transfers, stats.bytes, bad);
+	printf("%s, %d failed checks\n", failures ? "FAIL" : "OK", failures);
+
+	return failures;
+}
+
+static void Check(uint8_t condition, const char *what){
+
+	if(!condition){
+		printf("FAIL %s\n", what);
+		failures++;
+	}
+}
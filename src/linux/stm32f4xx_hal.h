@@ -0,0 +1,93 @@
+/*
+ * stm32f4xx_hal.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Bruno Otávio
+ */
+
+/*
+ * Subset of the STM32 HAL used by the driver, implemented for Linux userspace by MPU_Linux.c.
+ * Put this directory at the include path instead of the STM32 HAL, the driver sources are used as they are.
+ */
+
+#ifndef INC_LINUX_STM32F4XX_HAL_H_
+#define INC_LINUX_STM32F4XX_HAL_H_
+
+#include <stdint.h>
+
+typedef enum{
+	HAL_OK			= 0x00,
+	HAL_ERROR		= 0x01,
+	HAL_BUSY		= 0x02,
+	HAL_TIMEOUT		= 0x03
+}HAL_StatusTypeDef;
+
+typedef enum{
+	HAL_I2C_STATE_RESET		= 0x00,
+	HAL_I2C_STATE_READY		= 0x20,
+	HAL_I2C_STATE_BUSY		= 0x24
+}HAL_I2C_StateTypeDef;
+
+#define HAL_I2C_ERROR_NONE			0x00000000U
+#define HAL_I2C_ERROR_AF			0x00000004U		//No acknowledge
+
+typedef struct{
+	uint32_t ClockSpeed;
+	uint32_t DutyCycle;
+	uint32_t OwnAddress1;
+	uint32_t AddressingMode;
+	uint32_t DualAddressMode;
+	uint32_t OwnAddress2;
+	uint32_t GeneralCallMode;
+	uint32_t NoStretchMode;
+}I2C_InitTypeDef;
+
+typedef struct{
+	void *Instance;								//I2C1, I2C2 or I2C3, selects the device file, see @MPU_LinuxSetDevice
+	I2C_InitTypeDef Init;
+	uint32_t ErrorCode;							//HAL_I2C_ERROR_* of the last interrupt driven read
+	void *transport;							//Linux transport state, created by HAL_I2C_Init
+}I2C_HandleTypeDef;
+
+typedef struct{
+	int Instance;								//File descriptor where the bytes are written (1 for stdout)
+}UART_HandleTypeDef;
+
+#define I2C1						((void *)1)
+#define I2C2						((void *)2)
+#define I2C3						((void *)3)
+
+#define I2C_DUTYCYCLE_2				0
+#define I2C_ADDRESSINGMODE_7BIT		0
+#define I2C_DUALADDRESS_DISABLE		0
+#define I2C_GENERALCALL_DISABLE		0
+#define I2C_NOSTRETCH_DISABLE		0
+#define I2C_MEMADD_SIZE_8BIT		1
+
+#define HAL_MAX_DELAY				0xFFFFFFFFU
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Master_Receive(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Master_Abort_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress);
+HAL_I2C_StateTypeDef HAL_I2C_GetState(I2C_HandleTypeDef *hi2c);
+uint32_t HAL_I2C_GetError(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size);
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart);
+void HAL_Delay(uint32_t Delay);
+uint32_t HAL_GetTick(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_LINUX_STM32F4XX_HAL_H_ */